@@ -143,9 +143,11 @@ gfal2_context_t gfal2_context_new(GError **err)
     }
     gfal_initCredentialLocation(context);
     context->plugin_opt.plugin_number = 0;
+    pthread_rwlock_init(&context->plugin_opt.dispatch_lock, NULL);
     int ret = gfal_plugins_instance(context, &tmp_err);
     if (ret <= 0 && tmp_err) {
         gfal2_propagate_prefixed_error(err, tmp_err, __func__);
+        pthread_rwlock_destroy(&context->plugin_opt.dispatch_lock);
         g_key_file_free(context->config);
         g_free(context);
         return NULL;
@@ -170,6 +172,9 @@ void gfal2_context_free(gfal2_context_t context)
     gfal_file_descriptor_handle_destroy(context->fdescs);
     g_key_file_free(context->config);
     g_list_free(context->plugin_opt.sorted_plugin);
+    if (context->plugin_opt.dispatch_cache)
+        g_hash_table_destroy(context->plugin_opt.dispatch_cache);
+    pthread_rwlock_destroy(&context->plugin_opt.dispatch_lock);
     g_mutex_free(context->mux_cancel);
     g_hook_list_clear(&context->cancel_hooks);
     g_free(context->agent_name);
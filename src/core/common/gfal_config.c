@@ -201,6 +201,7 @@ gint gfal2_set_opt_string(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_string(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->config_generation);
     return 0;
 }
 
@@ -235,6 +236,7 @@ gint gfal2_set_opt_integer(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_integer(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->config_generation);
     return 0;
 }
 
@@ -270,6 +272,7 @@ gint gfal2_set_opt_boolean(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_boolean(context->config, group_name, key, value);
+    g_atomic_int_inc(&context->config_generation);
     return 0;
 }
 
@@ -289,6 +292,7 @@ gint gfal2_set_opt_string_list(gfal2_context_t context, const gchar *group_name,
 {
     g_assert(context != NULL);
     g_key_file_set_string_list(context->config, group_name, key, list, length);
+    g_atomic_int_inc(&context->config_generation);
     return 0;
 }
 
@@ -319,6 +323,7 @@ gchar **gfal2_get_opt_string_list_with_default(gfal2_context_t context,
 gint gfal2_load_opts_from_file(gfal2_context_t context, const char *path,
     GError **error)
 {
+    g_atomic_int_inc(&context->config_generation);
     return gfal_load_configuration_to_conf_manager(context->config, path, error);
 }
 
@@ -332,10 +337,18 @@ gchar **gfal2_get_opt_keys(gfal2_context_t context, const gchar *group_name, gsi
 gboolean gfal2_remove_opt(gfal2_context_t context, const gchar *group_name,
     const gchar *key, GError **error)
 {
+    g_atomic_int_inc(&context->config_generation);
     return g_key_file_remove_key(context->config, group_name, key, error);
 }
 
 
+guint gfal2_get_config_generation(gfal2_context_t context)
+{
+    g_assert(context != NULL);
+    return (guint) g_atomic_int_get(&context->config_generation);
+}
+
+
 gint gfal2_set_user_agent(gfal2_context_t handle, const char *user_agent,
     const char *version, GError **error)
 {
@@ -343,6 +356,7 @@ gint gfal2_set_user_agent(gfal2_context_t handle, const char *user_agent,
     handle->agent_name = g_strdup(user_agent);
     g_free(handle->agent_version);
     handle->agent_version = g_strdup(version);
+    g_atomic_int_inc(&handle->config_generation);
     return 0;
 }
 
@@ -364,6 +378,7 @@ gint gfal2_add_client_info(gfal2_context_t handle, const char *key, const char *
     keyval->key = g_strdup(key);
     keyval->value = g_strdup(value);
     g_ptr_array_add(handle->client_info, keyval);
+    g_atomic_int_inc(&handle->config_generation);
     return 0;
 }
 
@@ -379,6 +394,7 @@ gint gfal2_remove_client_info(gfal2_context_t handle, const char *key, GError **
     gfal_key_value_t keyval = (gfal_key_value_t) g_ptr_array_index(handle->client_info, i);
     gfal_free_keyvalue(keyval, NULL);
     g_ptr_array_remove_index_fast(handle->client_info, i);
+    g_atomic_int_inc(&handle->config_generation);
 
     return 0;
 }
@@ -389,6 +405,7 @@ gint gfal2_clear_client_info(gfal2_context_t handle, GError **error)
     g_ptr_array_foreach(handle->client_info, gfal_free_keyvalue, NULL);
     g_ptr_array_free(handle->client_info, FALSE);
     handle->client_info = g_ptr_array_new();
+    g_atomic_int_inc(&handle->config_generation);
     return 0;
 }
 
@@ -259,6 +259,17 @@ gchar **gfal2_get_opt_keys(gfal2_context_t context, const gchar *group_name, gsi
 gboolean gfal2_remove_opt(gfal2_context_t context, const gchar *group_name,
     const gchar *key, GError **error);
 
+
+/**
+ * Counter bumped on every change of the configuration,
+ * the user agent or the client information of the context.
+ * Lets plugins know when values derived from those must be recomputed
+ * @note Credentials have their own counter, see gfal2_cred_get_generation
+ * @param context : context of gfal2
+ * @return the current generation
+ */
+guint gfal2_get_config_generation(gfal2_context_t context);
+
 /**
  * Set the user agent for those protocols that support this
  */
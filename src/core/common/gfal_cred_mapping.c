@@ -47,6 +47,31 @@ static void node_copy(gpointer src, gpointer user_data)
 }
 
 
+// Counter of the credential type, within gfal_handle_::cred_generation
+static volatile gint *cred_generation(gfal2_context_t handle, const char *type)
+{
+    static const char *types[GFAL_CRED_GENERATION_SLOTS - 1] = {
+        GFAL_CRED_X509_CERT, GFAL_CRED_X509_KEY, GFAL_CRED_USER, GFAL_CRED_PASSWD, GFAL_CRED_BEARER
+    };
+    int i;
+    for (i = 0; type && i < GFAL_CRED_GENERATION_SLOTS - 1; ++i) {
+        if (strcmp(type, types[i]) == 0) {
+            return &handle->cred_generation[i];
+        }
+    }
+    return &handle->cred_generation[GFAL_CRED_GENERATION_SLOTS - 1];
+}
+
+
+static void cred_generation_bump_all(gfal2_context_t handle)
+{
+    int i;
+    for (i = 0; i < GFAL_CRED_GENERATION_SLOTS; ++i) {
+        g_atomic_int_inc(&handle->cred_generation[i]);
+    }
+}
+
+
 static void node_free(gpointer ptr)
 {
     gfal2_cred_node_t *node = ptr;
@@ -101,11 +126,13 @@ int gfal2_cred_set(gfal2_context_t handle, const char *url_prefix, const gfal2_c
 
     // If cred is NULL, done
     if (cred == NULL) {
+        cred_generation_bump_all(handle);
         node_free(node);
         return 0;
     }
 
     handle->cred_mapping = g_list_insert_sorted(handle->cred_mapping, node, node_compare);
+    g_atomic_int_inc(cred_generation(handle, cred->type));
     return 0;
 }
 
@@ -156,6 +183,7 @@ int gfal2_cred_del(gfal2_context_t handle, const char *type, const char *url, GE
             (strcmp(node->url_prefix, url) == 0)) {
             node_free(node);
             handle->cred_mapping = g_list_delete_link(handle->cred_mapping, item);
+            g_atomic_int_inc(cred_generation(handle, type));
             return 0;
         }
     }
@@ -167,6 +195,7 @@ int gfal2_cred_clean(gfal2_context_t handle, GError **error)
 {
     g_list_free_full(handle->cred_mapping, node_free);
     handle->cred_mapping = NULL;
+    cred_generation_bump_all(handle);
     return 0;
 }
 
@@ -181,6 +210,12 @@ int gfal2_cred_copy(gfal2_context_t dest, const gfal2_context_t src, GError **er
 }
 
 
+guint gfal2_cred_get_generation(gfal2_context_t handle, const char *type)
+{
+    return (guint) g_atomic_int_get(cred_generation(handle, type));
+}
+
+
 typedef struct {
     gfal_cred_func_t callback;
     void *user_data;
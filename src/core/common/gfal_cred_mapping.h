@@ -123,6 +123,15 @@ int gfal2_cred_clean(gfal2_context_t handle, GError **error);
  */
 int gfal2_cred_copy(gfal2_context_t dest, const gfal2_context_t src, GError **error);
 
+/**
+ * Counter bumped whenever a credential of the given type is set or removed
+ * Cheap to read, so plugins can tell when values derived from the credentials must be recomputed
+ * @param handle        The gfal2 context
+ * @param type          Credential type. Types not predefined share a single counter
+ * @return              The current generation
+ */
+guint gfal2_cred_get_generation(gfal2_context_t handle, const char *type);
+
 /**
  * Iterate over all registered credentials
  * @param handle        The gfal2 context
@@ -31,6 +31,7 @@ gfal_file_handle gfal_file_handle_new(const char* module_name, gpointer fdesc)
     f->fdesc = fdesc;
     f->ext_data = NULL;
     f->path = NULL;
+    f->plugin = NULL;
     return f;
 }
 
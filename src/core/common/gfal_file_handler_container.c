@@ -28,24 +28,43 @@
 #include "gfal_file_handler_container.h"
 
 
-// generate a new unique key
-static int gfal_file_key_generatorG(gfal_file_handle_container fhandle, GError** err)
+// return the slot of the given key, or NULL if it was never allocated
+static struct _gfal_file_handle_slot* gfal_file_slot_get(gfal_file_handle_container fhandle, int key)
 {
-    g_return_val_err_if_fail(fhandle, 0, err,
-            "[gfal_file_descriptor_generatorG] Invalid  arg file handle");
-    int ret = rand();
-    GHashTable* c = fhandle->container;
-    if (g_hash_table_size(c) > G_MAXINT / 2) {
-        gfal2_set_error(err, gfal2_get_plugins_quark(), EMFILE, __func__,
-                "Too many files open");
-        ret = 0;
+    if (key <= 0 || (key & GFAL_FD_SLOT_MASK) == 0)
+        return NULL;
+    const guint index = (key & GFAL_FD_SLOT_MASK) - 1;
+    struct _gfal_file_handle_slot* segment = g_atomic_pointer_get(&fhandle->segments[index >> GFAL_FD_SEGMENT_BITS]);
+    if (segment == NULL)
+        return NULL;
+    return &segment[index & (GFAL_FD_SEGMENT_SIZE - 1)];
+}
+
+
+static gint gfal_file_key_generation(int key)
+{
+    return (key >> GFAL_FD_SLOT_BITS) & GFAL_FD_GENERATION_MASK;
+}
+
+
+// pick a free slot, reusing the released ones once more than GFAL_FD_REUSE_DELAY are waiting,
+// so the generation of a slot wraps as late as possible
+// return the slot index, or -1 if there is none left
+static gint gfal_file_slot_allocate(gfal_file_handle_container fhandle)
+{
+    if (g_queue_get_length(&fhandle->free_slots) > GFAL_FD_REUSE_DELAY ||
+        (fhandle->used_slots >= GFAL_FD_MAX_SLOTS && !g_queue_is_empty(&fhandle->free_slots))) {
+        return GPOINTER_TO_INT(g_queue_pop_head(&fhandle->free_slots)) - 1;
     }
-    else {
-        while (ret == 0 || g_hash_table_lookup(c, GINT_TO_POINTER(ret)) != NULL) {
-            ret = rand();
-        }
+    if (fhandle->used_slots >= GFAL_FD_MAX_SLOTS) {
+        return -1;
+    }
+    const guint index = fhandle->used_slots++;
+    if (fhandle->segments[index >> GFAL_FD_SEGMENT_BITS] == NULL) {
+        g_atomic_pointer_set(&fhandle->segments[index >> GFAL_FD_SEGMENT_BITS],
+                g_new0(struct _gfal_file_handle_slot, GFAL_FD_SEGMENT_SIZE));
     }
-    return ret;
+    return index;
 }
 
 /*
@@ -57,15 +76,17 @@ int gfal_add_new_file_desc(gfal_file_handle_container fhandle, gpointer pfile,
 {
     g_return_val_err_if_fail(fhandle && pfile, 0, err,
             "[gfal_add_new_file_desc] Invalid  arg fhandle and/or pfile");
+    int key = 0;
     pthread_mutex_lock(&(fhandle->m_container));
-    GError* tmp_err = NULL;
-    GHashTable* c = fhandle->container;
-    int key = gfal_file_key_generatorG(fhandle, &tmp_err);
-    if (key != 0) {
-        g_hash_table_insert(c, GINT_TO_POINTER(key), pfile);
+    gint index = gfal_file_slot_allocate(fhandle);
+    if (index < 0) {
+        gfal2_set_error(err, gfal2_get_plugins_quark(), EMFILE, __func__,
+                "Too many files open");
     }
-    if (tmp_err) {
-        gfal2_propagate_prefixed_error(err, tmp_err, __func__);
+    else {
+        struct _gfal_file_handle_slot* slot = gfal_file_slot_get(fhandle, index + 1);
+        g_atomic_pointer_set(&slot->fdesc, pfile);
+        key = (slot->generation << GFAL_FD_SLOT_BITS) | (index + 1);
     }
     pthread_mutex_unlock(&(fhandle->m_container));
     return key;
@@ -76,14 +97,25 @@ int gfal_add_new_file_desc(gfal_file_handle_container fhandle, gpointer pfile,
 gboolean gfal_remove_file_desc(gfal_file_handle_container fhandle, int key,
         GError** err)
 {
+    gpointer p = NULL;
     pthread_mutex_lock(&(fhandle->m_container));
-    GHashTable* c = fhandle->container;
-    gboolean p = g_hash_table_remove(c, GINT_TO_POINTER(key));
-    if (!p)
+    struct _gfal_file_handle_slot* slot = gfal_file_slot_get(fhandle, key);
+    if (slot && slot->fdesc && slot->generation == gfal_file_key_generation(key)) {
+        p = slot->fdesc;
+        g_atomic_pointer_set(&slot->fdesc, NULL);
+        g_atomic_int_set(&slot->generation, (slot->generation + 1) & GFAL_FD_GENERATION_MASK);
+        g_queue_push_tail(&fhandle->free_slots, GINT_TO_POINTER(key & GFAL_FD_SLOT_MASK));
+    }
+    pthread_mutex_unlock(&(fhandle->m_container));
+
+    if (!p) {
         gfal2_set_error(err, gfal2_get_plugins_quark(), EBADF, __func__,
                 "bad file descriptor");
-    pthread_mutex_unlock(&(fhandle->m_container));
-    return p;
+        return FALSE;
+    }
+    if (fhandle->destroyer)
+        fhandle->destroyer(p);
+    return TRUE;
 }
 
 
@@ -91,7 +123,8 @@ gboolean gfal_remove_file_desc(gfal_file_handle_container fhandle, int key,
 gfal_file_handle_container gfal_file_descriptor_handle_create(GDestroyNotify destroyer)
 {
     gfal_file_handle_container d = g_malloc0(sizeof(struct _gfal_file_handle_container));
-    d->container = g_hash_table_new_full(NULL, NULL, NULL, destroyer);
+    d->destroyer = destroyer;
+    g_queue_init(&d->free_slots);
     pthread_mutex_init(&(d->m_container), NULL);
     return d;
 }
@@ -99,9 +132,15 @@ gfal_file_handle_container gfal_file_descriptor_handle_create(GDestroyNotify des
 
 void gfal_file_descriptor_handle_destroy(gfal_file_handle_container fhandle)
 {
-    if (fhandle->container) {
-        g_hash_table_destroy(fhandle->container);
+    int i, j;
+    for (i = 0; i < GFAL_FD_MAX_SEGMENTS && fhandle->segments[i] != NULL; ++i) {
+        for (j = 0; j < GFAL_FD_SEGMENT_SIZE && fhandle->destroyer; ++j) {
+            if (fhandle->segments[i][j].fdesc)
+                fhandle->destroyer(fhandle->segments[i][j].fdesc);
+        }
+        g_free(fhandle->segments[i]);
     }
+    g_queue_clear(&fhandle->free_slots);
     pthread_mutex_destroy(&fhandle->m_container);
     g_free(fhandle);
 }
@@ -118,13 +157,20 @@ gfal_file_handle gfal_file_handle_bind(gfal_file_handle_container h,
 {
     g_return_val_err_if_fail(fd, 0, err, "invalid dir descriptor");
 
-
-    pthread_mutex_lock(&(h->m_container));
-    gpointer p = g_hash_table_lookup(h->container, GINT_TO_POINTER(fd));
+    gpointer p = NULL;
+    struct _gfal_file_handle_slot* slot = gfal_file_slot_get(h, fd);
+    if (slot) {
+        const gint generation = gfal_file_key_generation(fd);
+        if (g_atomic_int_get(&slot->generation) == generation) {
+            p = g_atomic_pointer_get(&slot->fdesc);
+            // the slot may have been released, and reused, meanwhile
+            if (g_atomic_int_get(&slot->generation) != generation)
+                p = NULL;
+        }
+    }
     if (!p) {
         gfal2_set_error(err, gfal2_get_plugins_quark(), EBADF, __func__,
             "bad file descriptor");
     }
-    pthread_mutex_unlock(&(h->m_container));
     return (gfal_file_handle)p;
 }
@@ -34,8 +34,36 @@ extern "C"
 {
 #endif
 
+/*
+ * File descriptors are encoded as (generation << GFAL_FD_SLOT_BITS) | (slot + 1)
+ * The generation of a slot changes every time it is released, so a stale
+ * descriptor does not resolve to the handle that reused its slot.
+ * The generation only has 11 bits, and wraps after 2048 releases of the same slot.
+ * Released slots are not reused before GFAL_FD_REUSE_DELAY others have been released,
+ * so a stale descriptor can alias a new handle only after some 2 million closes.
+ */
+#define GFAL_FD_SLOT_BITS 20
+#define GFAL_FD_SLOT_MASK ((1 << GFAL_FD_SLOT_BITS) - 1)
+#define GFAL_FD_GENERATION_MASK ((1 << (31 - GFAL_FD_SLOT_BITS)) - 1)
+#define GFAL_FD_MAX_SLOTS GFAL_FD_SLOT_MASK
+#define GFAL_FD_REUSE_DELAY 1024
+
+/* slots are allocated by segments, which are never moved nor freed before the container */
+#define GFAL_FD_SEGMENT_BITS 10
+#define GFAL_FD_SEGMENT_SIZE (1 << GFAL_FD_SEGMENT_BITS)
+#define GFAL_FD_MAX_SEGMENTS (1 << (GFAL_FD_SLOT_BITS - GFAL_FD_SEGMENT_BITS))
+
+struct _gfal_file_handle_slot {
+	gpointer fdesc;
+	gint generation;
+};
+
 struct _gfal_file_handle_container {
-	GHashTable* container;
+	struct _gfal_file_handle_slot* segments[GFAL_FD_MAX_SEGMENTS];
+	guint used_slots;
+	GQueue free_slots;
+	GDestroyNotify destroyer;
+	// lookups are lock-free, only the allocation and the release of slots are serialized
 	pthread_mutex_t m_container;
 };
 
@@ -46,6 +74,8 @@ struct _gfal_file_handle {
 	gpointer ext_data;
 	gpointer fdesc;
     gchar* path;
+    // plugin owning this handle, resolved from module_name when NULL
+    struct _gfal_plugin_interface* plugin;
 };
 
 
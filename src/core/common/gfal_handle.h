@@ -27,6 +27,7 @@
 #endif
 
 #include "gfal_plugin_interface.h"
+#include <pthread.h>
 
 /* enforce proper calling convention */
 #ifdef __cplusplus
@@ -39,10 +40,17 @@ struct _gfal_plugin_opts {
     gfal_plugin_interface plugin_list[MAX_PLUGIN_LIST];
     GList* sorted_plugin;
     int plugin_number;
+    // (scheme, plugin_mode) -> gfal_plugin_interface*
+    GHashTable* dispatch_cache;
+    pthread_rwlock_t dispatch_lock;
 };
 typedef struct _gfal_plugin_opts gfal_plugin_opts;
 
 
+// Predefined credential types, plus one slot shared by the others
+#define GFAL_CRED_GENERATION_SLOTS 6
+
+
 struct gfal_handle_ {
 	gboolean initiated;
 	// struct of the plugin opts
@@ -59,6 +67,11 @@ struct gfal_handle_ {
 	// Credential mapping
     GList *cred_mapping;
 
+    // Bumped on every change of the configuration, the user agent or the client information
+    volatile gint config_generation;
+    // Bumped on every change of the credentials, one counter per predefined type plus one for the others
+    volatile gint cred_generation[GFAL_CRED_GENERATION_SLOTS];
+
     // client information
     char* agent_name;
     char* agent_version;
@@ -37,6 +37,9 @@
 #error "GFAL_PLUGIN_DIR_DEFAULT should be define at compile time"
 #endif
 
+// Longest URL scheme considered for the plugin dispatch cache
+#define GFAL_PLUGIN_SCHEME_MAX_LEN 32
+
 
 /*
  * function to use in order to create a new plugin interface
@@ -79,6 +82,72 @@ gboolean gfal_plugin_checker_safe(gfal_plugin_interface* cata_list,
         return FALSE;
 }
 
+// Copy the scheme of the url into scheme
+// return the scheme length, or 0 if the url has no valid scheme
+static size_t gfal_plugin_url_scheme(const char* url, char* scheme, size_t s_scheme)
+{
+    size_t i;
+    if (url == NULL || !g_ascii_isalpha(url[0]))
+        return 0;
+    for (i = 0; url[i] != ':'; ++i) {
+        if (i + 1 >= s_scheme)
+            return 0;
+        if (!g_ascii_isalnum(url[i]) && url[i] != '+' && url[i] != '-' && url[i] != '.')
+            return 0;
+        scheme[i] = url[i];
+    }
+    scheme[i] = '\0';
+    return i;
+}
+
+// return FALSE only if the plugin declared its schemes, and the given one is not part of them
+static gboolean gfal_plugin_may_claim_scheme(const gfal_plugin_interface* cata_list, const char* scheme)
+{
+    const char* const* p;
+    if (cata_list->url_schemes == NULL)
+        return TRUE;
+    for (p = cata_list->url_schemes; *p != NULL; ++p) {
+        if (g_ascii_strcasecmp(*p, scheme) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// drop all the cached plugin resolutions, and re-create the cache if enabled
+static void gfal_plugin_dispatch_cache_reset(gfal2_context_t handle, gboolean enabled)
+{
+    pthread_rwlock_wrlock(&handle->plugin_opt.dispatch_lock);
+    if (handle->plugin_opt.dispatch_cache) {
+        g_hash_table_destroy(handle->plugin_opt.dispatch_cache);
+        handle->plugin_opt.dispatch_cache = NULL;
+    }
+    if (enabled) {
+        handle->plugin_opt.dispatch_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+    pthread_rwlock_unlock(&handle->plugin_opt.dispatch_lock);
+}
+
+static gfal_plugin_interface* gfal_plugin_dispatch_cache_lookup(gfal2_context_t handle, const char* key)
+{
+    gfal_plugin_interface* cata_list = NULL;
+    pthread_rwlock_rdlock(&handle->plugin_opt.dispatch_lock);
+    if (handle->plugin_opt.dispatch_cache) {
+        cata_list = g_hash_table_lookup(handle->plugin_opt.dispatch_cache, key);
+    }
+    pthread_rwlock_unlock(&handle->plugin_opt.dispatch_lock);
+    return cata_list;
+}
+
+static void gfal_plugin_dispatch_cache_insert(gfal2_context_t handle, const char* key,
+        gfal_plugin_interface* cata_list)
+{
+    pthread_rwlock_wrlock(&handle->plugin_opt.dispatch_lock);
+    if (handle->plugin_opt.dispatch_cache) {
+        g_hash_table_replace(handle->plugin_opt.dispatch_cache, g_strdup(key), cata_list);
+    }
+    pthread_rwlock_unlock(&handle->plugin_opt.dispatch_lock);
+}
+
 //
 // Resolve entry point in a plugin and add it to the current plugin list
 //
@@ -126,11 +195,22 @@ int gfal_plugins_delete(gfal2_context_t handle, GError** err)
         }
 
         handle->plugin_opt.plugin_number = 0;
+        gfal_plugin_dispatch_cache_reset(handle, FALSE);
     }
     return 0;
 }
 
 
+// record the plugin owning a newly opened handle, so the I/O calls do not need to look it up by name
+// plugins may return a handle created by another plugin (i.e srm opening the TURL), so the name must match
+static void gfal_plugin_bind_file_handle(gfal_plugin_interface* p, gfal_file_handle fh)
+{
+    if (fh && fh->plugin == NULL &&
+        strncmp(p->getName(), fh->module_name, GFAL_MODULE_NAME_SIZE) == 0)
+        fh->plugin = p;
+}
+
+
 // return the proper plugin linked to this file handle
 gfal_plugin_interface* gfal_plugin_map_file_handle(gfal2_context_t handle, gfal_file_handle fh, GError** err)
 {
@@ -140,9 +220,14 @@ gfal_plugin_interface* gfal_plugin_map_file_handle(gfal2_context_t handle, gfal_
     int n = gfal_plugins_instance(handle, &tmp_err);
     if (n > 0) {
         cata_list = handle->plugin_opt.plugin_list;
+        // fast path, the plugin was recorded at open time
+        if (fh->plugin >= cata_list && fh->plugin < cata_list + n)
+            return fh->plugin;
         for (i = 0; i < n; ++i) {
-            if (strncmp(cata_list[i].getName(), fh->module_name, GFAL_MODULE_NAME_SIZE) == 0)
-                return &(cata_list[i]);
+            if (strncmp(cata_list[i].getName(), fh->module_name, GFAL_MODULE_NAME_SIZE) == 0) {
+                fh->plugin = &(cata_list[i]);
+                return fh->plugin;
+            }
         }
         g_set_error(&tmp_err, gfal2_get_plugins_quark(), EBADF, "No gfal_module with the handle name : %s", fh->module_name);
     }
@@ -353,6 +438,10 @@ int gfal_plugins_sort(gfal2_context_t handle, GError ** err)
     handle->plugin_opt.sorted_plugin = g_list_sort(
             handle->plugin_opt.sorted_plugin, &gfal_plugin_compare);
 
+    // the plugin order changed, so any cached resolution may be wrong now
+    gfal_plugin_dispatch_cache_reset(handle,
+            gfal2_get_opt_boolean_with_default(handle, CORE_CONFIG_GROUP, "PLUGIN_DISPATCH_CACHE", TRUE));
+
     if (gfal2_log_get_level() >= G_LOG_LEVEL_DEBUG) { // print plugin order
         GString* strbuff = g_string_new(" plugin priority order: ");
         GList* l = handle->plugin_opt.sorted_plugin;
@@ -405,15 +494,41 @@ gfal_plugin_interface* gfal_find_plugin(gfal2_context_t handle, const char * url
     gboolean compatible = FALSE;
     const int n_plugins = gfal_plugins_instance(handle, &tmp_err);
     if (n_plugins > 0) {
+        char scheme[GFAL_PLUGIN_SCHEME_MAX_LEN];
+        char key[GFAL_PLUGIN_SCHEME_MAX_LEN + 16];
+        const gboolean has_scheme = (gfal_plugin_url_scheme(url, scheme, sizeof(scheme)) > 0);
+        // A resolution can be cached only if the plugins before the matching one
+        // were discarded by their declared schemes, and not by a check on the full url
+        gboolean cacheable = has_scheme;
+
+        if (has_scheme) {
+            snprintf(key, sizeof(key), "%s:%d", scheme, acc_mode);
+            gfal_plugin_interface* cached = gfal_plugin_dispatch_cache_lookup(handle, key);
+            // the owner still validates the full url, but the other plugins are not asked
+            if (cached) {
+                compatible = gfal_plugin_checker_safe(cached, url, acc_mode, &tmp_err);
+                if (compatible && !tmp_err)
+                    return cached;
+            }
+        }
+
         GList * plugin_list = g_list_first(handle->plugin_opt.sorted_plugin);
-        while (plugin_list != NULL) {
+        while (plugin_list != NULL && tmp_err == NULL) {
             gfal_plugin_interface* plugin_ifce = plugin_list->data;
+            plugin_list = g_list_next(plugin_list);
+
+            if (has_scheme && !gfal_plugin_may_claim_scheme(plugin_ifce, scheme))
+                continue;
+
             compatible = gfal_plugin_checker_safe(plugin_ifce, url, acc_mode, &tmp_err);
             if (tmp_err)
                 break;
-            if (compatible)
+            if (compatible) {
+                if (cacheable)
+                    gfal_plugin_dispatch_cache_insert(handle, key, plugin_ifce);
                 return plugin_ifce;
-            plugin_list = g_list_next(plugin_list);
+            }
+            cacheable = FALSE;
         }
     }
     if (tmp_err) {
@@ -613,8 +728,10 @@ gfal_file_handle gfal_plugin_opendirG(gfal2_context_t handle, const char* name,
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, name, GFAL_PLUGIN_OPENDIR, &tmp_err);
 
-    if (p)
+    if (p) {
         resu = p->opendirG(gfal_get_plugin_handle(p), name, &tmp_err);
+        gfal_plugin_bind_file_handle(p, resu);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -640,8 +757,10 @@ gfal_file_handle gfal_plugin_openG(gfal2_context_t handle, const char * path, in
 
     gfal_plugin_interface* p = gfal_find_plugin(handle, path, GFAL_PLUGIN_OPEN, &tmp_err);
 
-    if (p)
+    if (p) {
         resu = p->openG(gfal_get_plugin_handle(p), path, flag, mode, &tmp_err);
+        gfal_plugin_bind_file_handle(p, resu);
+    }
 
     G_RETURN_ERR(resu, tmp_err, err);
 }
@@ -800,6 +919,33 @@ ssize_t gfal_plugin_preadG(gfal2_context_t handle, gfal_file_handle fh, void* bu
     G_RETURN_ERR(res, tmp_err, err);
 }
 
+// Execute a vectored read on the appropriate plugin, or one pread per chunk if it has none
+ssize_t gfal_plugin_readvG(gfal2_context_t handle, gfal_file_handle fh, gfal2_iovec_t* vector, int count, GError** err)
+{
+    g_return_val_err_if_fail(handle && fh && (vector || count == 0), -1, err, "[gfal_plugin_readvG] Invalid args ");
+    GError* tmp_err = NULL;
+    ssize_t res = -1;
+    int i;
+    gfal_plugin_interface* if_cata = gfal_plugin_map_file_handle(handle, fh, &tmp_err);
+    if (!tmp_err) {
+        if (if_cata->readvG) {
+            res = if_cata->readvG(if_cata->plugin_data, fh, vector, count, &tmp_err);
+        }
+        else {
+            res = 0;
+            for (i = 0; i < count && !tmp_err; ++i) {
+                vector[i].nbytes = gfal_plugin_preadG(handle, fh, vector[i].buffer, vector[i].size,
+                    vector[i].offset, &tmp_err);
+                if (vector[i].nbytes > 0)
+                    res += vector[i].nbytes;
+            }
+            if (tmp_err)
+                res = -1;
+        }
+    }
+    G_RETURN_ERR(res, tmp_err, err);
+}
+
 // Simulate a pread operation in case of non-parallels write support
 // this is slower than a normal pread/pwrite operation
 static ssize_t gfal_plugin_simulate_pwriteG(gfal2_context_t handle, gfal_plugin_interface* if_cata, gfal_file_handle fh, void* buff, size_t s_buff,
@@ -1123,6 +1269,51 @@ int gfal_plugin_unlink_listG(gfal2_context_t handle, int nbfiles, const char* co
 }
 
 
+int gfal_plugin_stat_listG(gfal2_context_t handle, int nbfiles, const char* const* uris,
+        struct stat* stats, GError ** errors)
+{
+    GError* tmp_err = NULL;
+    int resu = -1;
+    int i;
+    gfal_plugin_interface* p = gfal_find_plugin(handle, *uris, GFAL_PLUGIN_STAT, &tmp_err);
+
+    if (p && p->stat_listG) {
+        resu = p->stat_listG(gfal_get_plugin_handle(p), nbfiles, uris, stats, errors);
+    }
+    // Fallback, each url is resolved on its own
+    else {
+        g_clear_error(&tmp_err);
+        resu = 0;
+        for (i = 0; i < nbfiles; ++i) {
+            if (gfal_plugin_statG(handle, uris[i], &stats[i], &(errors[i])) < 0)
+                resu = -1;
+        }
+    }
+
+    return resu;
+}
+
+
+int gfal_plugin_list_treeG(gfal2_context_t handle, const char* url, gfal2_tree_entry_cb callback,
+        void* user_data, GError** err)
+{
+    GError* tmp_err = NULL;
+    int resu = -1;
+    gfal_plugin_interface* p = gfal_find_plugin(handle, url, GFAL_PLUGIN_OPENDIR, &tmp_err);
+
+    if (p) {
+        if (p->list_treeG) {
+            resu = p->list_treeG(gfal_get_plugin_handle(p), url, callback, user_data, &tmp_err);
+        }
+        else {
+            gfal2_set_error(&tmp_err, gfal2_get_plugins_quark(), EPROTONOSUPPORT,
+                            __func__, "The plugin does not support recursive listing");
+        }
+    }
+    G_RETURN_ERR(resu, tmp_err, err);
+}
+
+
 int gfal_plugin_abort_filesG(gfal2_context_t handle, int nbfiles,
         const char* const * uris, const char* token, GError ** errors)
 {
@@ -30,6 +30,7 @@
 #include "gfal_constants.h"
 #include "gfal_file_handle.h"
 #include <transfer/gfal_transfer_plugins.h>
+#include <file/gfal_file_api.h>
 
 #include <glib.h>
 #include <sys/stat.h>
@@ -742,9 +743,52 @@ struct _gfal_plugin_interface {
                             gboolean write_access, unsigned validity, const char* const* activities,
                             char* buff, size_t s_buff, GError** err);
 
+  /**
+   * OPTIONAL: NULL terminated list of the URL schemes this plugin can claim (i.e {"gsiftp", "ftp", NULL})
+   *
+   * When set, check_plugin_url must never return TRUE for an URL whose scheme is not
+   * in this list. The core relies on it to skip the plugin when resolving URLs of other
+   * schemes, and to cache the plugin resolved for a given scheme and operation.
+   */
+  const char* const* url_schemes;
+
+  /**
+   * OPTIONAL: read several chunks of an open file in one go
+   *
+   * If not implemented, each chunk is read with preadG, or its simulation.
+   * nbytes must be set for each chunk of the vector
+   *
+   * @return total number of bytes read, -1 on error
+   */
+  ssize_t (*readvG)(plugin_handle plugin_data, gfal_file_handle fd, gfal2_iovec_t* vector, int count,
+                    GError** err);
+
+  /**
+   * OPTIONAL: stat several urls in one go
+   *
+   * If not implemented, statG is called for each url
+   *
+   * @param stats : array of nbfiles stat structures to fill
+   * @param errors : array of nbfiles errors, set for each url that failed
+   * @return 0 if all succeeded, -1 if at least one failed
+   */
+  int (*stat_listG)(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                    struct stat* stats, GError** errors);
+
+  /**
+   * OPTIONAL: list a whole subtree in one operation, see gfal2_list_tree
+   *
+   * If not implemented, gfal2_list_tree fails with EPROTONOSUPPORT
+   *
+   * @param callback : to be called for each entry, if it returns non 0 stop with ECANCELED
+   * @return 0 if success, -1 if error occurs
+   */
+  int (*list_treeG)(plugin_handle plugin_data, const char* url, gfal2_tree_entry_cb callback,
+                    void* user_data, GError** err);
+
       // reserved for future usage
 	 //! @cond
-     void* future[4];
+     void* future[1];
 	 //! @endcond
 };
 
@@ -785,6 +829,7 @@ int gfal_plugin_readG(gfal2_context_t handle, gfal_file_handle fh, void* buff, s
 
 ssize_t gfal_plugin_preadG(gfal2_context_t handle, gfal_file_handle fh, void* buff, size_t s_buff, off_t offset, GError** err);
 ssize_t gfal_plugin_pwriteG(gfal2_context_t handle, gfal_file_handle fh, void* buff, size_t s_buff, off_t offset, GError** err);
+ssize_t gfal_plugin_readvG(gfal2_context_t handle, gfal_file_handle fh, gfal2_iovec_t* vector, int count, GError** err);
 
 
 int gfal_plugin_unlinkG(gfal2_context_t handle, const char* path, GError** err);
@@ -834,6 +879,12 @@ int gfal_plugin_release_file_listG(gfal2_context_t handle, int nbfiles, const ch
 
 int gfal_plugin_unlink_listG(gfal2_context_t handle, int nbfiles, const char* const* uris, GError ** errors);
 
+int gfal_plugin_stat_listG(gfal2_context_t handle, int nbfiles, const char* const* uris,
+        struct stat* stats, GError ** errors);
+
+int gfal_plugin_list_treeG(gfal2_context_t handle, const char* url, gfal2_tree_entry_cb callback,
+        void* user_data, GError** err);
+
 int gfal_plugin_abort_filesG(gfal2_context_t handle, int nbfiles, const char* const* uris, const char* token, GError ** err);
 
 ssize_t gfal_plugin_qos_check_classes(gfal2_context_t handle, const char* url, const char* type,
@@ -161,6 +161,24 @@ struct dirent *gfal2_readdirpp(gfal2_context_t context, DIR *dir,
 }
 
 
+int gfal2_list_tree(gfal2_context_t context, const char *url, gfal2_tree_entry_cb callback,
+    void *user_data, GError **err)
+{
+    GError *tmp_err = NULL;
+    int ret = -1;
+    GFAL2_BEGIN_SCOPE_CANCEL(context, -1, err);
+    if (url == NULL || callback == NULL || context == NULL) {
+        g_set_error(&tmp_err, gfal2_get_core_quark(), EFAULT,
+            "url or/and callback or/and context are NULL");
+    }
+    else {
+        ret = gfal_plugin_list_treeG(context, url, callback, user_data, &tmp_err);
+    }
+    GFAL2_END_SCOPE_CANCEL(context);
+    G_RETURN_ERR(ret, tmp_err, err);
+}
+
+
 int gfal2_closedir(gfal2_context_t handle, DIR *d, GError **err)
 {
     GError *tmp_err = NULL;
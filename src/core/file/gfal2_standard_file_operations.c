@@ -607,6 +607,36 @@ int gfal2_unlink_list(gfal2_context_t context, int nbfiles, const char *const *u
 }
 
 
+int gfal2_stat_list(gfal2_context_t context, int nbfiles, const char *const *urls,
+    struct stat *stats, GError **errors)
+{
+    GError *tmp_err = NULL;
+    int res = 0;
+
+    if (urls == NULL || *urls == NULL || stats == NULL || context == NULL) {
+        g_set_error(&tmp_err, gfal2_get_core_quark(), EFAULT,
+            "urls or/and stats or/and context are an incorrect arguments");
+        res = -1;
+    }
+    else {
+        res = gfal2_start_scope_cancel(context, &tmp_err);
+        if (res == 0) {
+            res = gfal_plugin_stat_listG(context, nbfiles, urls, stats, errors);
+            gfal2_end_scope_cancel(context);
+        }
+    }
+
+    if (tmp_err) {
+        int i;
+        for (i = 0; i < nbfiles; ++i) {
+            errors[i] = g_error_copy(tmp_err);
+        }
+        g_error_free(tmp_err);
+    }
+    return res;
+}
+
+
 int gfal2_abort_files(gfal2_context_t context, int nbfiles, const char *const *urls, const char *token, GError **err)
 {
     GError *tmp_err = NULL;
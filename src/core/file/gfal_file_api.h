@@ -239,6 +239,40 @@ struct dirent* gfal2_readdirpp(gfal2_context_t context, DIR* d, struct stat* st,
  */
 int gfal2_closedir(gfal2_context_t context, DIR* d, GError ** err);
 
+/**
+ * @brief entry of a recursive listing, see \ref gfal2_list_tree
+ */
+typedef struct gfal2_tree_entry {
+    /// Path relative to the listed directory, '/' separated. Only valid during the callback
+    const char* path;
+    /// Meta-data of the entry
+    struct stat st;
+} gfal2_tree_entry_t;
+
+/**
+ * @brief called for each entry of a recursive listing
+ * @return 0 to go on with the listing, any other value stops it
+ */
+typedef int (*gfal2_tree_entry_cb)(const gfal2_tree_entry_t* entry, void* user_data);
+
+/**
+ * @brief list a whole subtree in one operation
+ *
+ * The callback is called for every entry under url, directories included, in no specific order.
+ * Only some protocols can do this. Otherwise the call fails with EPROTONOSUPPORT or EOPNOTSUPP,
+ * and the tree has to be walked with \ref gfal2_opendir
+ *
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param url : url of the directory
+ * @param callback : called for each entry
+ * @param user_data : passed as is to the callback
+ * @param err : GError error report
+ * @return 0 if success, negative value if error, set err properly in case of error.
+ *  ECANCELED if the callback stopped the listing
+ */
+int gfal2_list_tree(gfal2_context_t context, const char* url, gfal2_tree_entry_cb callback,
+        void* user_data, GError ** err);
+
 /**
  * @brief create a symbolic link
  *
@@ -563,6 +597,22 @@ int gfal2_release_file_list(gfal2_context_t context, int nbfiles, const char* co
  */
 int gfal2_unlink_list(gfal2_context_t context, int nbfiles, const char* const* urls, GError ** errors);
 
+/**
+ * @brief Perform a bulk stat
+ *
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param nbfiles : number of files
+ * @param urls    : paths of the files to stat
+ * @param stats   : Pre-allocated array of nbfiles stat structures, filled for each successful stat
+ * @param errors  : Pre-allocated array with nbfiles pointers to errors, initialized to NULL.
+ *                  It is the user's responsability to allocate and free.
+ * @return 0 if all the stats succeeded, -1 if at least one failed. errors tells which one
+ * @note The plugin tried will be the one that matches the first url
+ * @note If bulk stat is not supported, gfal2_stat will be called nbfiles times
+ */
+int gfal2_stat_list(gfal2_context_t context, int nbfiles, const char* const* urls,
+        struct stat* stats, GError ** errors);
+
 /**
  * @brief abort a list of files
  * @param context : gfal2 handle, see \ref gfal2_context_new
@@ -731,6 +781,31 @@ int gfal2_flush(gfal2_context_t context, int fd, GError ** err);
  */
 ssize_t gfal2_pread(gfal2_context_t context, int fd, void * buffer, size_t count, off_t offset, GError ** err);
 
+/**
+ * @brief one chunk of a vectored read, see \ref gfal2_readv
+ */
+typedef struct gfal2_iovec {
+    off_t offset;   /**< where to read from */
+    size_t size;    /**< number of bytes to read */
+    void* buffer;   /**< buffer for the read data, at least size bytes */
+    ssize_t nbytes; /**< filled with the number of bytes read into buffer */
+} gfal2_iovec_t;
+
+/**
+ * @brief read several chunks of a file descriptor, each at its own offset
+ *
+ * Plugins able to do so send all the chunks at once (i.e multi-range requests for HTTP),
+ * otherwise each chunk is read as with \ref gfal2_pread
+ *
+ * @param context : gfal2 handle, see \ref gfal2_context_new
+ * @param fd : file descriptor
+ * @param vector : chunks to read. nbytes is set for each one of them
+ * @param count : number of chunks
+ * @param err : GError error report
+ * @return total number of read bytes, -1 on failure, set err properly in case of error.
+ */
+ssize_t gfal2_readv(gfal2_context_t context, int fd, gfal2_iovec_t* vector, int count, GError ** err);
+
 /**
  * @brief write to file descriptor at a given offset
  *
@@ -88,6 +88,7 @@ extern GQuark GFAL_EVENT_IPV4;            /**< Triggered to register the transfe
 extern GQuark GFAL_EVENT_IPV6;            /**< Triggered to register the transfer is done over IPv6 */
 extern GQuark GFAL_EVENT_EVICT;           /**< Triggered after a file eviction operation  */
 extern GQuark GFAL_EVENT_CLEANUP;         /**< Triggered after a delete to cleanup a failed transfer */
+extern GQuark GFAL_EVENT_STREAM_PERF;     /**< Triggered with the throughput of each stream of a multi-stream transfer */
 
 /**
  * Types for for GFAL_EVENT_TRANSFER_TYPE
@@ -142,7 +143,13 @@ typedef enum {
     /// Compare user provided checksum vs destination
     GFALT_CHECKSUM_TARGET  = 0x02,
     /// Compare user provided checksum vs both, *or* source checksum vs target checksum
-    GFALT_CHECKSUM_BOTH = (GFALT_CHECKSUM_SOURCE | GFALT_CHECKSUM_TARGET)
+    GFALT_CHECKSUM_BOTH = (GFALT_CHECKSUM_SOURCE | GFALT_CHECKSUM_TARGET),
+    /// Modifier for GFALT_CHECKSUM_SOURCE: on streamed copies, compute the source checksum
+    /// from the data as it is copied, instead of reading the source again.
+    /// Set alone, it implies GFALT_CHECKSUM_SOURCE. Ignored by third party copies.
+    GFALT_CHECKSUM_INLINE = 0x04,
+    /// Compare the checksum computed while copying vs target
+    GFALT_CHECKSUM_BOTH_INLINE = (GFALT_CHECKSUM_BOTH | GFALT_CHECKSUM_INLINE)
 } gfalt_checksum_mode_t;
 
 /**
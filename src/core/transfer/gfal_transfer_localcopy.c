@@ -19,15 +19,20 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 
 #include <gfal_api.h>
 #include <common/gfal_plugin_interface.h>
+#include <common/gfal_plugin.h>
 #include <checksums/checksums.h>
+#include <localio/gfal2_local_reader.h>
 #include "gfal_transfer_plugins.h"
 #include "gfal_transfer_internal.h"
 
 
 const size_t DEFAULT_BUFFER_SIZE = 4194304;
+const int DEFAULT_PIPELINE_DEPTH = 2;
+const int MAX_PARALLEL_WORKERS = 64;
 
 
 static GQuark local_copy_domain() {
@@ -151,8 +156,446 @@ static void send_performance_data(gfalt_params_t params, const char* src, const
 }
 
 
+// check for cancellation and timeout, and send the performance markers
+// return 0 if the transfer can go on, -1 and set error otherwise
+static int streamed_copy_checkpoint(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, struct perf_data_t* perf, time_t timeout, GError** error)
+{
+    // Make sure we don't have to cancel
+    if (gfal2_is_canceled(context)) {
+        g_set_error(error, local_copy_domain(), ECANCELED, "Transfer canceled");
+        return -1;
+    }
+    // Timed-out?
+    perf->now = time(NULL);
+    if (perf->now >= timeout) {
+        g_set_error(error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
+        return -1;
+    }
+    else if (perf->now - perf->last_update > 5) {
+        send_performance_data(params, src, dst, perf);
+        perf->done_since_last_update = 0;
+        perf->last_update = perf->now;
+    }
+    return 0;
+}
+
+
+static void streamed_copy_serial(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, gfal_file_handle f_src, gfal_file_handle f_dst,
+        char* buffer, size_t buffersize, gfal2_checksum_stream_t* checksum,
+        struct perf_data_t* perf, time_t timeout, GError** error)
+{
+    GError *nested_error = NULL;
+    ssize_t s_file = 1;
+
+    while (s_file > 0 && !nested_error) {
+        s_file = gfal_plugin_readG(context, f_src, buffer, buffersize, &nested_error);
+        if (s_file > 0) {
+            gfal_plugin_writeG(context, f_dst, buffer, s_file, &nested_error);
+            if (checksum)
+                gfal2_checksum_stream_update(checksum, buffer, s_file);
+        }
+
+        perf->done += s_file;
+        perf->done_since_last_update += s_file;
+
+        if (nested_error == NULL)
+            streamed_copy_checkpoint(context, params, src, dst, perf, timeout, &nested_error);
+    }
+
+    if (nested_error)
+        g_propagate_error(error, nested_error);
+}
+
+// the source is a local file read by the local reader, so its windows are written
+// directly into the destination, without being copied into an intermediate buffer
+static void streamed_copy_mapped(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, gfal2_local_reader_t* reader, gfal_file_handle f_dst,
+        gfal2_checksum_stream_t* checksum, struct perf_data_t* perf, time_t timeout, GError** error)
+{
+    GError *nested_error = NULL;
+    const void* data;
+    ssize_t s_file = 1;
+
+    while (s_file > 0 && !nested_error) {
+        s_file = gfal2_local_reader_next(reader, &data);
+        if (s_file < 0) {
+            g_set_error(&nested_error, local_copy_domain(), errno, "Failed to read the source: %s",
+                    strerror(errno));
+            break;
+        }
+        if (s_file > 0) {
+            gfal_plugin_writeG(context, f_dst, (void*)data, s_file, &nested_error);
+            if (checksum)
+                gfal2_checksum_stream_update(checksum, data, s_file);
+        }
+
+        perf->done += s_file;
+        perf->done_since_last_update += s_file;
+
+        if (nested_error == NULL)
+            streamed_copy_checkpoint(context, params, src, dst, perf, timeout, &nested_error);
+    }
+
+    if (nested_error)
+        g_propagate_error(error, nested_error);
+}
+
+// Ring of buffers shared between the reader thread, which fills them from the source,
+// and the calling thread, which drains them into the destination
+struct copy_pipeline_t {
+    gfal2_context_t context;
+    gfal_file_handle f_src;
+    size_t buffersize;
+    int depth;
+
+    char** buffers;
+    ssize_t* sizes;
+    int head, count;
+    gboolean eof, stop;
+    GError* error;
+
+    pthread_mutex_t lock;
+    pthread_cond_t filled, emptied;
+};
+
+
+static void* streamed_copy_reader(void* data)
+{
+    struct copy_pipeline_t* pipe = (struct copy_pipeline_t*)data;
+    GError* nested_error = NULL;
+
+    pthread_mutex_lock(&pipe->lock);
+    while (!pipe->stop) {
+        if (pipe->count == pipe->depth) {
+            pthread_cond_wait(&pipe->emptied, &pipe->lock);
+            continue;
+        }
+        // the writer never touches the slots after head + count, so this one can be filled unlocked
+        const int slot = (pipe->head + pipe->count) % pipe->depth;
+        pthread_mutex_unlock(&pipe->lock);
+
+        ssize_t s_file = gfal_plugin_readG(pipe->context, pipe->f_src,
+                pipe->buffers[slot], pipe->buffersize, &nested_error);
+
+        pthread_mutex_lock(&pipe->lock);
+        if (s_file <= 0) {
+            pipe->error = nested_error;
+            pipe->eof = TRUE;
+        }
+        else {
+            pipe->sizes[slot] = s_file;
+            ++pipe->count;
+        }
+        pthread_cond_signal(&pipe->filled);
+        if (pipe->eof)
+            break;
+    }
+    pthread_mutex_unlock(&pipe->lock);
+    return NULL;
+}
+
+
+static void streamed_copy_pipelined(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, gfal_file_handle f_src, gfal_file_handle f_dst,
+        char** buffers, size_t buffersize, int depth, gfal2_checksum_stream_t* checksum,
+        struct perf_data_t* perf, time_t timeout, GError** error)
+{
+    GError *nested_error = NULL;
+    struct copy_pipeline_t pipe;
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.context = context;
+    pipe.f_src = f_src;
+    pipe.buffersize = buffersize;
+    pipe.depth = depth;
+    pipe.buffers = buffers;
+    pipe.sizes = g_new0(ssize_t, depth);
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.filled, NULL);
+    pthread_cond_init(&pipe.emptied, NULL);
+
+    pthread_t reader;
+    int ret = pthread_create(&reader, NULL, streamed_copy_reader, &pipe);
+    if (ret != 0) {
+        g_set_error(&nested_error, local_copy_domain(), ret, "Could not start the reader thread");
+    }
+
+    while (!nested_error) {
+        pthread_mutex_lock(&pipe.lock);
+        if (pipe.count == 0 && !pipe.eof) {
+            // wake up regularly to check for cancellation and timeout while the source is slow
+            struct timespec wait_until;
+            clock_gettime(CLOCK_REALTIME, &wait_until);
+            wait_until.tv_sec += 1;
+            pthread_cond_timedwait(&pipe.filled, &pipe.lock, &wait_until);
+        }
+        const int slot = pipe.head;
+        const int available = pipe.count;
+        const gboolean eof = pipe.eof;
+        pthread_mutex_unlock(&pipe.lock);
+
+        if (available > 0) {
+            ssize_t s_file = pipe.sizes[slot];
+            gfal_plugin_writeG(context, f_dst, pipe.buffers[slot], s_file, &nested_error);
+            if (checksum)
+                gfal2_checksum_stream_update(checksum, pipe.buffers[slot], s_file);
+
+            pthread_mutex_lock(&pipe.lock);
+            pipe.head = (pipe.head + 1) % depth;
+            --pipe.count;
+            pthread_cond_signal(&pipe.emptied);
+            pthread_mutex_unlock(&pipe.lock);
+
+            perf->done += s_file;
+            perf->done_since_last_update += s_file;
+        }
+        else if (eof) {
+            break;
+        }
+
+        if (nested_error == NULL)
+            streamed_copy_checkpoint(context, params, src, dst, perf, timeout, &nested_error);
+    }
+
+    if (ret == 0) {
+        pthread_mutex_lock(&pipe.lock);
+        pipe.stop = TRUE;
+        pthread_cond_signal(&pipe.emptied);
+        pthread_mutex_unlock(&pipe.lock);
+        pthread_join(reader, NULL);
+    }
+
+    // a write or a cancellation error takes precedence over the read one
+    if (nested_error) {
+        g_clear_error(&pipe.error);
+        g_propagate_error(error, nested_error);
+    }
+    else if (pipe.error) {
+        g_propagate_error(error, pipe.error);
+    }
+
+    pthread_cond_destroy(&pipe.emptied);
+    pthread_cond_destroy(&pipe.filled);
+    pthread_mutex_destroy(&pipe.lock);
+    g_free(pipe.sizes);
+}
+
+
+static void free_buffers(char** buffers, int count)
+{
+    int i;
+    for (i = 0; i < count; ++i)
+        free(buffers[i]);
+    g_free(buffers);
+}
+
+
+// Shared state of the workers copying ranges of the file concurrently
+struct copy_parallel_t {
+    gfal2_context_t context;
+    gfal_file_handle f_src, f_dst;
+    size_t buffersize;
+    off_t filesize;
+
+    off_t next_offset;
+    size_t done;
+    int running;
+    gboolean stop;
+    GError* error;
+
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+};
+
+
+struct copy_parallel_worker_t {
+    struct copy_parallel_t* shared;
+    char* buffer;
+};
+
+
+// copy the range [offset, offset + size), return the number of bytes copied, or -1 on error
+static ssize_t streamed_copy_range(struct copy_parallel_t* shared, char* buffer,
+        off_t offset, size_t size, GError** error)
+{
+    size_t nread = 0, nwritten = 0;
+    while (nread < size) {
+        ssize_t ret = gfal_plugin_preadG(shared->context, shared->f_src, buffer + nread, size - nread,
+                offset + nread, error);
+        if (ret < 0)
+            return -1;
+        if (ret == 0) {
+            g_set_error(error, local_copy_domain(), EIO,
+                    "Unexpected end of file at %lld, expected %lld bytes",
+                    (long long)(offset + nread), (long long)shared->filesize);
+            return -1;
+        }
+        nread += ret;
+    }
+    while (nwritten < size) {
+        ssize_t ret = gfal_plugin_pwriteG(shared->context, shared->f_dst, buffer + nwritten, size - nwritten,
+                offset + nwritten, error);
+        if (ret < 0)
+            return -1;
+        if (ret == 0) {
+            g_set_error(error, local_copy_domain(), EIO,
+                    "Nothing written at %lld, %lld bytes left",
+                    (long long)(offset + nwritten), (long long)(size - nwritten));
+            return -1;
+        }
+        nwritten += ret;
+    }
+    return size;
+}
+
+
+static void* streamed_copy_parallel_worker(void* data)
+{
+    struct copy_parallel_worker_t* worker = (struct copy_parallel_worker_t*)data;
+    struct copy_parallel_t* shared = worker->shared;
+    GError* nested_error = NULL;
+
+    pthread_mutex_lock(&shared->lock);
+    while (!shared->stop && shared->next_offset < shared->filesize) {
+        const off_t offset = shared->next_offset;
+        const size_t size = MIN(shared->buffersize, (size_t)(shared->filesize - offset));
+        shared->next_offset += size;
+        pthread_mutex_unlock(&shared->lock);
+
+        ssize_t ret = streamed_copy_range(shared, worker->buffer, offset, size, &nested_error);
+
+        pthread_mutex_lock(&shared->lock);
+        if (ret < 0) {
+            if (shared->error == NULL)
+                shared->error = nested_error;
+            else
+                g_error_free(nested_error);
+            shared->stop = TRUE;
+        }
+        else {
+            shared->done += ret;
+        }
+        pthread_cond_signal(&shared->progress);
+    }
+    --shared->running;
+    pthread_cond_signal(&shared->progress);
+    pthread_mutex_unlock(&shared->lock);
+    return NULL;
+}
+
+
+static void streamed_copy_parallel(gfal2_context_t context, gfalt_params_t params,
+        const char* src, const char* dst, gfal_file_handle f_src, gfal_file_handle f_dst,
+        char** buffers, size_t buffersize, int workers, off_t filesize,
+        struct perf_data_t* perf, time_t timeout, GError** error)
+{
+    GError *nested_error = NULL;
+    struct copy_parallel_t shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.context = context;
+    shared.f_src = f_src;
+    shared.f_dst = f_dst;
+    shared.buffersize = buffersize;
+    shared.filesize = filesize;
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.progress, NULL);
+
+    struct copy_parallel_worker_t* worker_data = g_new0(struct copy_parallel_worker_t, workers);
+    pthread_t* threads = g_new0(pthread_t, workers);
+    int i, started;
+
+    for (started = 0; started < workers; ++started) {
+        worker_data[started].shared = &shared;
+        worker_data[started].buffer = buffers[started];
+        pthread_mutex_lock(&shared.lock);
+        ++shared.running;
+        pthread_mutex_unlock(&shared.lock);
+        int ret = pthread_create(&threads[started], NULL, streamed_copy_parallel_worker, &worker_data[started]);
+        if (ret != 0) {
+            pthread_mutex_lock(&shared.lock);
+            --shared.running;
+            pthread_mutex_unlock(&shared.lock);
+            // carry on with the workers already running, if any
+            if (started == 0)
+                g_set_error(&nested_error, local_copy_domain(), ret, "Could not start the copy workers");
+            break;
+        }
+    }
+
+    // progress, cancellation and timeout are handled here, while the workers copy
+    pthread_mutex_lock(&shared.lock);
+    while (shared.running > 0) {
+        struct timespec wait_until;
+        clock_gettime(CLOCK_REALTIME, &wait_until);
+        wait_until.tv_sec += 1;
+        pthread_cond_timedwait(&shared.progress, &shared.lock, &wait_until);
+
+        perf->done_since_last_update += shared.done - perf->done;
+        perf->done = shared.done;
+
+        if (!shared.stop && !nested_error) {
+            pthread_mutex_unlock(&shared.lock);
+            streamed_copy_checkpoint(context, params, src, dst, perf, timeout, &nested_error);
+            pthread_mutex_lock(&shared.lock);
+            if (nested_error)
+                shared.stop = TRUE;
+        }
+    }
+    perf->done = shared.done;
+    pthread_mutex_unlock(&shared.lock);
+
+    for (i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // cancellation or timeout takes precedence over the errors of the workers
+    if (nested_error) {
+        g_clear_error(&shared.error);
+        g_propagate_error(error, nested_error);
+    }
+    else if (shared.error) {
+        g_propagate_error(error, shared.error);
+    }
+
+    g_free(threads);
+    g_free(worker_data);
+    pthread_cond_destroy(&shared.progress);
+    pthread_mutex_destroy(&shared.lock);
+}
+
+
+// ranges can only be copied concurrently if both plugins do positional io natively
+static gboolean streamed_copy_can_be_parallel(gfal2_context_t context,
+        gfal_file_handle f_src, gfal_file_handle f_dst)
+{
+    gfal_plugin_interface* p_src = gfal_plugin_map_file_handle(context, f_src, NULL);
+    gfal_plugin_interface* p_dst = gfal_plugin_map_file_handle(context, f_dst, NULL);
+    return p_src && p_dst && p_src->preadG && p_dst->pwriteG;
+}
+
+
+static char** alloc_buffers(int count, size_t alignment, size_t buffersize, GError** error)
+{
+    int i;
+    char **buffers = g_new0(char*, count);
+    for (i = 0; i < count; ++i) {
+        errno = posix_memalign((void**)&buffers[i], alignment, buffersize);
+        if (errno) {
+            g_set_error(error, local_copy_domain(), errno, "Failed to allocate aligned buffer");
+            free_buffers(buffers, count);
+            return NULL;
+        }
+    }
+    return buffers;
+}
+
+
+// if checksum is not NULL, it is fed with the copied data
+// the number of bytes copied is put into copied
 static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
-        const char* src, const char* dst, GError** error)
+        const char* src, const char* dst, gfal2_checksum_stream_t* checksum, size_t* copied,
+        GError** error)
 {
     GError *nested_error = NULL;
 
@@ -165,11 +608,24 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
 
     size_t alignment = gfal2_get_opt_integer_with_default(context, "CORE", "COPY_BUFFER_ALIGNMENT", 512);
     size_t buffersize = gfal2_get_opt_integer_with_default(context, "CORE", "COPY_BUFFERSIZE", DEFAULT_BUFFER_SIZE);
-    char *buffer;
-    errno = posix_memalign((void**)&buffer, alignment, buffersize);
-    if (errno) {
-        g_set_error(error, local_copy_domain(), errno, "Failed to allocate aligned buffer");
-        return -1;
+    int depth = gfal2_get_opt_integer_with_default(context, "CORE", "COPY_PIPELINE_DEPTH", DEFAULT_PIPELINE_DEPTH);
+    if (depth < 1) {
+        depth = 1;
+    }
+    int workers = gfal2_get_opt_integer_with_default(context, "CORE", "COPY_PARALLEL_WORKERS", 1);
+    if (workers > MAX_PARALLEL_WORKERS) {
+        gfal2_log(G_LOG_LEVEL_WARNING, "COPY_PARALLEL_WORKERS=%d is too high, using %d workers",
+                workers, MAX_PARALLEL_WORKERS);
+        workers = MAX_PARALLEL_WORKERS;
+    }
+
+    // the ranges are not copied in order, so this is not possible if the checksum is computed on the way
+    off_t filesize = -1;
+    if (workers > 1 && checksum == NULL) {
+        struct stat st;
+        if (gfal2_stat(context, src, &st, NULL) == 0 && S_ISREG(st.st_mode)) {
+            filesize = st.st_size;
+        }
     }
 
     int src_open_flags = O_RDONLY;
@@ -188,7 +644,6 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
 
     gfal_file_handle f_src = gfal_plugin_openG(context, src, src_open_flags, 0, &nested_error);
     if (nested_error) {
-        free(buffer);
         gfal2_propagate_prefixed_error_extended(error, nested_error, __func__, "Could not open source: ");
         return -1;
     }
@@ -207,50 +662,74 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
 
     gfal_file_handle f_dst = gfal_plugin_openG(context, dst, dst_open_flags, 0755, &nested_error);
     if (nested_error) {
-        free(buffer);
         gfal_plugin_closeG(context, f_src, NULL);
         gfal2_propagate_prefixed_error_extended(error, nested_error, __func__, "Could not open destination: ");
         return -1;
     }
 
+    gboolean parallel = (filesize > (off_t)buffersize && streamed_copy_can_be_parallel(context, f_src, f_dst));
+    if (workers > 1 && !parallel) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  parallel copy not possible, fallback to a single stream");
+    }
+
+    // a local source can be mapped into memory, and written from there
+    gfal2_local_reader_t* reader = NULL;
+    if (!parallel && strncmp(src, "file://", 7) == 0 &&
+        gfal2_get_opt_boolean_with_default(context, "CORE", "LOCAL_READ_MMAP", FALSE)) {
+        off_t direct_io_threshold = ((off_t)gfal2_get_opt_integer_with_default(context, "CORE",
+                "LOCAL_READ_DIRECT_IO_MIN_SIZE", 0)) << 20;
+        reader = gfal2_local_reader_open(src + 7, 0, 0, buffersize, direct_io_threshold);
+        if (reader == NULL) {
+            gfal2_log(G_LOG_LEVEL_DEBUG, "  can not map the source (%s), fallback to buffered reads",
+                    strerror(errno));
+        }
+    }
+
+    const int nbuffers = reader ? 0 : (parallel ? workers : depth);
+
+    char **buffers = alloc_buffers(nbuffers, alignment, buffersize, &nested_error);
+    if (nested_error) {
+        if (reader)
+            gfal2_local_reader_close(reader);
+        gfal_plugin_closeG(context, f_dst, NULL);
+        gfal_plugin_closeG(context, f_src, NULL);
+        g_propagate_error(error, nested_error);
+        return -1;
+    }
+
     struct perf_data_t perf_data;
     perf_data.start = perf_data.now = perf_data.last_update = time(NULL);
     perf_data.done = perf_data.done_since_last_update = 0;
 
     const time_t timeout = perf_data.start + gfalt_get_timeout(params, NULL);
-    ssize_t s_file = 1;
-
-    gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %ld", src, dst, buffersize);
-
-    while (s_file > 0 && !nested_error) {
-        s_file = gfal_plugin_readG(context, f_src, buffer, buffersize, &nested_error);
-        if (s_file > 0) {
-            gfal_plugin_writeG(context, f_dst, buffer, s_file, &nested_error);
-        }
-
-        perf_data.done += s_file;
-        perf_data.done_since_last_update += s_file;
 
-        // Make sure we don't have to cancel
-        if (gfal2_is_canceled(context)) {
-            if (nested_error == NULL)
-                g_set_error(&nested_error, local_copy_domain(), ECANCELED, "Transfer canceled");
-        }
-        // Timed-out?
-        else {
-            perf_data.now = time(NULL);
-            if (perf_data.now >= timeout) {
-                if (nested_error == NULL)
-                    g_set_error(&nested_error, local_copy_domain(), ETIMEDOUT, "Transfer canceled because the timeout expired");
-            }
-            else if (perf_data.now - perf_data.last_update > 5) {
-                send_performance_data(params, src, dst, &perf_data);
-                perf_data.done_since_last_update = 0;
-                perf_data.last_update = perf_data.now;
-            }
-        }
+    if (parallel) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %ld and %d workers",
+                src, dst, buffersize, workers);
+        streamed_copy_parallel(context, params, src, dst, f_src, f_dst,
+                buffers, buffersize, workers, filesize, &perf_data, timeout, &nested_error);
+    }
+    else if (reader) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with %s reads of %ld bytes",
+                src, dst, gfal2_local_reader_mode_name(gfal2_local_reader_get_mode(reader)), buffersize);
+        streamed_copy_mapped(context, params, src, dst, reader, f_dst,
+                checksum, &perf_data, timeout, &nested_error);
+        gfal2_local_reader_close(reader);
     }
-    free(buffer);
+    else if (depth > 1) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %ld and pipeline depth %d",
+                src, dst, buffersize, depth);
+        streamed_copy_pipelined(context, params, src, dst, f_src, f_dst,
+                buffers, buffersize, depth, checksum, &perf_data, timeout, &nested_error);
+    }
+    else {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "  begin local transfer %s ->  %s with buffer size %ld",
+                src, dst, buffersize);
+        streamed_copy_serial(context, params, src, dst, f_src, f_dst,
+                buffers[0], buffersize, checksum, &perf_data, timeout, &nested_error);
+    }
+    free_buffers(buffers, nbuffers);
+    *copied = perf_data.done;
 
     gfal_plugin_closeG(context, f_dst, (nested_error)?NULL:(&nested_error));
     gfal_plugin_closeG(context, f_src, (nested_error)?NULL:(&nested_error));
@@ -267,6 +746,26 @@ static int streamed_copy(gfal2_context_t context, gfalt_params_t params,
 }
 
 
+// Remove a destination whose content is known to be wrong. Special files are left alone
+static void unlink_corrupted(gfal2_context_t context, const char* surl)
+{
+    GError* nested_error = NULL;
+    struct stat st;
+
+    if (gfal2_stat(context, surl, &st, &nested_error) == 0 &&
+        (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode) || S_ISSOCK(st.st_mode))) {
+        return;
+    }
+    g_clear_error(&nested_error);
+
+    if (gfal2_unlink(context, surl, &nested_error) != 0) {
+        gfal2_log(G_LOG_LEVEL_WARNING, "Could not remove %s after a checksum mismatch: %s",
+            surl, nested_error->message);
+        g_error_free(nested_error);
+    }
+}
+
+
 int perform_local_copy(gfal2_context_t context, gfalt_params_t params,
         const char* src, const char* dst, GError** error)
 {
@@ -290,8 +789,23 @@ int perform_local_copy(gfal2_context_t context, gfalt_params_t params,
         g_strlcpy(checksum_type, "ADLER32", sizeof(checksum_type));
     }
 
+    // INLINE on its own still asks for the source checksum
+    if (checksum_mode & GFALT_CHECKSUM_INLINE) {
+        checksum_mode |= GFALT_CHECKSUM_SOURCE;
+    }
+
+    // Source checksum computed while copying
+    gfal2_checksum_stream_t* inline_checksum = NULL;
+    if ((checksum_mode & GFALT_CHECKSUM_SOURCE) && (checksum_mode & GFALT_CHECKSUM_INLINE)) {
+        inline_checksum = gfal2_checksum_stream_new(checksum_type);
+        if (inline_checksum == NULL) {
+            gfal2_log(G_LOG_LEVEL_WARNING,
+                "Checksum type %s can not be computed while copying, get the source checksum instead", checksum_type);
+        }
+    }
+
     // Source checksum
-    if (checksum_mode & GFALT_CHECKSUM_SOURCE) {
+    if ((checksum_mode & GFALT_CHECKSUM_SOURCE) && inline_checksum == NULL) {
         plugin_trigger_event(params, local_copy_domain(), GFAL_EVENT_SOURCE, GFAL_EVENT_CHECKSUM_ENTER, "");
         gfal2_checksum(context, src, checksum_type, 0, 0, source_checksum, sizeof(source_checksum), &nested_error);
         if (nested_error != NULL) {
@@ -315,6 +829,7 @@ int perform_local_copy(gfal2_context_t context, gfalt_params_t params,
         create_parent(context, params, dst, &nested_error);
         if (nested_error != NULL) {
             gfal2_propagate_prefixed_error(error, nested_error, __func__);
+            gfal2_checksum_stream_free(inline_checksum);
             return -1;
         }
 
@@ -323,18 +838,40 @@ int perform_local_copy(gfal2_context_t context, gfalt_params_t params,
             unlink_if_exists(context, params, dst, &nested_error);
             if (nested_error != NULL) {
                 gfal2_propagate_prefixed_error(error, nested_error, __func__);
+                gfal2_checksum_stream_free(inline_checksum);
                 return -1;
             }
         }
     }
 
     // Do the transfer
-    streamed_copy(context, params, src, dst, &nested_error);
+    size_t copied = 0;
+    streamed_copy(context, params, src, dst, inline_checksum, &copied, &nested_error);
     if (nested_error != NULL) {
         gfal2_propagate_prefixed_error(error, nested_error, __func__);
+        gfal2_checksum_stream_free(inline_checksum);
         return -1;
     }
 
+    if (inline_checksum) {
+        plugin_trigger_event(params, local_copy_domain(), GFAL_EVENT_SOURCE, GFAL_EVENT_CHECKSUM_ENTER, "inline");
+        gfal2_checksum_stream_final(inline_checksum, source_checksum, sizeof(source_checksum));
+        gfal2_checksum_stream_free(inline_checksum);
+        // the source did not need to be read a second time
+        plugin_trigger_event(params, local_copy_domain(), GFAL_EVENT_SOURCE, GFAL_EVENT_CHECKSUM_EXIT,
+            "inline, saved %zu bytes", copied);
+
+        // The data is already at the destination, do not leave it there
+        if (user_checksum[0] && gfal_compare_checksums(user_checksum, source_checksum, 1024) != 0) {
+            unlink_corrupted(context, dst);
+            gfalt_set_error(error, local_copy_domain(), EIO, __func__,
+                    GFALT_ERROR_TRANSFER, GFALT_ERROR_CHECKSUM_MISMATCH,
+                    "Checksum of the copied data and user-specified checksum do not match: %s != %s",
+                    source_checksum, user_checksum);
+            return -1;
+        }
+    }
+
     // Destination checksum
     char *compare_against = user_checksum;
     char *compare_side = "User defined";
@@ -46,6 +46,7 @@ GQuark GFAL_EVENT_IPV4;
 GQuark GFAL_EVENT_IPV6;
 GQuark GFAL_EVENT_EVICT;
 GQuark GFAL_EVENT_CLEANUP;
+GQuark GFAL_EVENT_STREAM_PERF;
 
 
 __attribute__((constructor))
@@ -69,6 +70,7 @@ static void init_event_quarks() {
     GFAL_EVENT_IPV6 = g_quark_from_static_string("IPV6");
     GFAL_EVENT_EVICT = g_quark_from_static_string("EVICT");
     GFAL_EVENT_CLEANUP = g_quark_from_static_string("CLEANUP");
+    GFAL_EVENT_STREAM_PERF = g_quark_from_static_string("STREAM:PERF");
 }
 
 
@@ -30,6 +30,8 @@ void gfal_dcap_destroyG(plugin_handle handle);
 gboolean gfal_dcap_check_url(plugin_handle ch, const char* url,
         plugin_mode mode, GError** err);
 
+static const char* const dcap_url_schemes[] = {"dcap", "gsidcap", NULL};
+
 static int gfal_dcap_regex_compile(regex_t * rex, GError** err)
 {
     int ret = regcomp(rex, "^(dcap|gsidcap)://([:alnum:]|-|/|.|_)+$",
@@ -84,6 +86,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err)
     dcap_plugin.pwriteG = &gfal_dcap_pwriteG;
     dcap_plugin.lseekG = &gfal_dcap_lseekG;
     dcap_plugin.check_plugin_url = &gfal_dcap_check_url;
+    dcap_plugin.url_schemes = dcap_url_schemes;
     dcap_plugin.statG = &gfal_dcap_statG;
     dcap_plugin.lstatG = &gfal_dcap_lstatG;
     dcap_plugin.mkdirpG = &gfal_dcap_mkdirG;
@@ -19,6 +19,7 @@
  */
 
 #include <regex.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
@@ -35,24 +36,13 @@
 #include <attr/xattr.h>
 #endif
 #endif
-#include <zlib.h>
 
 #include <gfal_plugins_api.h>
 #include <checksums/checksums.h>
+#include <localio/gfal2_local_reader.h>
 #include <uri/gfal2_uri.h>
 #include <future/glib.h>
-
-typedef struct _chksum_interface{
-    // init checksum handle
-    void*  (*init)(void);
-    // compute checksum chunk
-    ssize_t (*update)(void* chk_handler, const char* buffer, size_t s_size);
-    // return checksum result : > 0 -> success, -1 : buffer to short
-    int (*getResult)(void* chk_handler, char* buffer, size_t s_b);
-} Chksum_interface;
-
-
-static const int FILE_PREFIX_LEN = 7; // file://
+#include "gfal_file_plugin.h"
 
 
 // File plugin GQuark
@@ -70,7 +60,7 @@ const char* gfal_file_plugin_getName(){
 /*
  * Return 1 if url is a file url
  */
-static int gfal_is_file(const char *url) {
+int gfal_is_file(const char *url) {
     GError *err = NULL;
     gfal2_uri *parsed = gfal2_parse_uri(url, &err);
     if (!parsed) {
@@ -85,6 +75,8 @@ static int gfal_is_file(const char *url) {
     return check;
 }
 
+static const char* const gfal_file_url_schemes[] = {"file", NULL};
+
 /*
  * url checker for the file module
  */
@@ -397,86 +389,143 @@ int gfal_plugin_file_symlink(plugin_handle plugin_data, const char *oldpath, con
 }
 
 
-// checksum wrapper
+// checksum implem
 
-static void *adler_init()
-{
-    unsigned long *lp = malloc(sizeof(unsigned long));
-    *lp = adler32(0L, Z_NULL, 0);
-    return (void *) lp;
-}
+typedef struct {
+    const char *path;
+    int fd;
+    off_t offset;
+    size_t length;
+    size_t chunk_size;
+    gboolean local_reader;
+    off_t direct_io_threshold;
+    gfal2_checksum_stream_t *stream;
+    int errcode;
+    gboolean threaded;
+} gfal_file_chk_range;
+
+
+// checksum a range of the file straight from the mapped file, or the O_DIRECT buffer
+static void gfal_plugin_file_chk_range_local_reader(gfal_file_chk_range *range)
+{
+    gfal2_local_reader_t *reader = gfal2_local_reader_open(range->path, range->offset, range->length,
+        range->chunk_size, range->direct_io_threshold);
+    if (reader == NULL) {
+        range->errcode = errno;
+        return;
+    }
 
-static ssize_t adler32_update(void *chk_handler, const char *buffer, size_t s)
-{
-    unsigned long *lp = (unsigned long *) chk_handler;
-    *lp = adler32(*lp, (const Bytef *) buffer, (uInt) s);
-    return (ssize_t) s;
+    const void *data;
+    size_t done = 0;
+    ssize_t ret;
+    while ((ret = gfal2_local_reader_next(reader, &data)) > 0) {
+        gfal2_checksum_stream_update(range->stream, data, ret);
+        done += ret;
+    }
+    if (ret < 0) {
+        range->errcode = errno;
+    }
+    else if (done != range->length) {
+        range->errcode = EIO;
+    }
+    gfal2_local_reader_close(reader);
 }
 
-static int adler32_getResult(void *chk_handler, char *resu, size_t s_b)
-{
-    unsigned long *lp = (unsigned long *) chk_handler;
-    snprintf(resu, s_b, "%08lx", *lp);
-    free(lp);
-    return 0;
-}
 
-static void *crc32_init()
+// checksum a range of the file, run by each thread of the parallel checksum
+static void* gfal_plugin_file_chk_range(void *data)
 {
-    unsigned long *lp = malloc(sizeof(unsigned long));
-    *lp = crc32(0L, Z_NULL, 0);
-    return (void *) lp;
-}
+    gfal_file_chk_range *range = (gfal_file_chk_range*) data;
+    if (range->local_reader) {
+        gfal_plugin_file_chk_range_local_reader(range);
+        return NULL;
+    }
 
-static ssize_t crc32_update(void *chk_handler, const char *buffer, size_t s)
-{
-    unsigned long *lp = (unsigned long *) chk_handler;
-    *lp = crc32(*lp, (const Bytef *) buffer, s);
-    return (ssize_t) s;
-}
+    char *buffer = malloc(range->chunk_size);
+    size_t done = 0;
 
-static int crc32_getResult(void *chk_handler, char *resu, size_t s_b)
-{
-    unsigned long *lp = (unsigned long *) chk_handler;
-    snprintf(resu, s_b, "%ld", *lp);
-    free(lp);
-    return 0;
+    while (done < range->length) {
+        ssize_t ret = pread(range->fd, buffer, MIN(range->chunk_size, range->length - done), range->offset + done);
+        if (ret < 0) {
+            range->errcode = errno;
+            break;
+        }
+        if (ret == 0) {
+            range->errcode = EIO;
+            break;
+        }
+        gfal2_checksum_stream_update(range->stream, buffer, ret);
+        done += ret;
+    }
+    free(buffer);
+    return NULL;
 }
 
-
-static void *md5_init()
+// split the range in as many parts as threads, and combine the partial checksums
+// with a single thread, the range is done by the calling thread
+static int gfal_plugin_file_chk_compute_ranges(const char *url, gfal2_checksum_stream_t *c_handle,
+    const char *check_type, off_t start_offset, size_t length, size_t chunk_size, int n_threads,
+    gboolean local_reader, off_t direct_io_threshold, GError **err)
 {
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) malloc(sizeof(GFAL_MD5_CTX));
-    gfal2_md5_init(ctx);
-    return (void *) ctx;
-}
+    int fd = -1;
+    if (!local_reader && (fd = open(url + FILE_PREFIX_LEN, O_RDONLY)) < 0) {
+        gfal_plugin_file_report_error(__func__, err);
+        return -1;
+    }
 
-static ssize_t md5_update(void *chk_handler, const char *buffer, size_t s)
-{
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) chk_handler;
-    gfal2_md5_update(ctx, buffer, (unsigned long) s);
-    return (ssize_t) s;
-}
+    gfal_file_chk_range *ranges = g_new0(gfal_file_chk_range, n_threads);
+    pthread_t *threads = g_new0(pthread_t, n_threads);
+    const size_t range_size = (n_threads > 1) ? ((length / n_threads) / chunk_size + 1) * chunk_size : length;
+    int i, started = 0, errcode = 0;
+    off_t offset = start_offset;
+
+    for (i = 0; i < n_threads && offset < start_offset + (off_t)length; ++i) {
+        ranges[i].path = url + FILE_PREFIX_LEN;
+        ranges[i].fd = fd;
+        ranges[i].offset = offset;
+        ranges[i].length = MIN(range_size, (size_t)(start_offset + length - offset));
+        ranges[i].chunk_size = chunk_size;
+        ranges[i].local_reader = local_reader;
+        ranges[i].direct_io_threshold = direct_io_threshold;
+        ranges[i].stream = (n_threads > 1) ? gfal2_checksum_stream_new(check_type) : c_handle;
+        offset += ranges[i].length;
+
+        ranges[i].threaded = (n_threads > 1 &&
+            pthread_create(&threads[i], NULL, gfal_plugin_file_chk_range, &ranges[i]) == 0);
+        if (!ranges[i].threaded) {
+            // do this one here
+            gfal_plugin_file_chk_range(&ranges[i]);
+        }
+        ++started;
+    }
 
-static int md5_getResult(void *chk_handler, char *resu, size_t s_b)
-{
-    GFAL_MD5_CTX *ctx = (GFAL_MD5_CTX *) chk_handler;
-    unsigned char buffer[16];
-    if (s_b < 33) // buffer to short
+    for (i = 0; i < started; ++i) {
+        if (ranges[i].threaded)
+            pthread_join(threads[i], NULL);
+        if (ranges[i].errcode && !errcode)
+            errcode = ranges[i].errcode;
+        if (ranges[i].stream != c_handle) {
+            gfal2_checksum_stream_combine(c_handle, ranges[i].stream, ranges[i].length);
+            gfal2_checksum_stream_free(ranges[i].stream);
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+    g_free(threads);
+    g_free(ranges);
+
+    if (errcode) {
+        gfal2_set_error(err, gfal2_get_plugin_file_quark(), errcode, __func__,
+            "Error during checksum calculation, read: %s", strerror(errcode));
         return -1;
-    gfal2_md5_final(buffer, ctx);
-    gfal2_md5_to_hex_string(buffer, resu, sizeof(buffer));
-    free(ctx);
+    }
     return 0;
 }
 
 
-// checksum implem
-
-static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, const char *check_type,
+int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const char *check_type,
     char *checksum_buffer, size_t buffer_length,
     off_t start_offset, size_t data_length,
-    Chksum_interface *i_chk,
     GError **err)
 {
     GError *tmp_err = NULL;
@@ -485,19 +534,60 @@ static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, con
     int fd;
     ssize_t ret = 0, remain_bytes = ((data_length > 0) ? (data_length) : (chunk_size));
 
+    gfal2_checksum_stream_t *c_handle = gfal2_checksum_stream_new(check_type);
+    if (c_handle == NULL) {
+        gfal2_set_error(err, gfal2_get_plugin_file_quark(), ENOSYS, __func__,
+            "Checksum type %s not supported for local files", check_type);
+        return -1;
+    }
+
+    // Big enough files are split between several threads, if the partial checksums can be combined
+    // Regular files may also be read through a memory mapping, or with O_DIRECT
+    int n_threads = gfal2_get_opt_integer_with_default(handle, CORE_CONFIG_GROUP, "CHECKSUM_THREADS", 1);
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+    const gboolean local_reader = gfal2_get_opt_boolean_with_default(handle, CORE_CONFIG_GROUP,
+        "LOCAL_READ_MMAP", FALSE);
+    const off_t direct_io_threshold = ((off_t)gfal2_get_opt_integer_with_default(handle, CORE_CONFIG_GROUP,
+        "LOCAL_READ_DIRECT_IO_MIN_SIZE", 0)) << 20;
+    struct stat st;
+    if ((n_threads > 1 || local_reader) &&
+        stat(url + FILE_PREFIX_LEN, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > start_offset) {
+        size_t length = st.st_size - start_offset;
+        if (data_length > 0 && data_length < length) {
+            length = data_length;
+        }
+        if (!gfal2_checksum_stream_can_combine(c_handle) || length < (size_t)(chunk_size * n_threads)) {
+            n_threads = 1;
+        }
+        if (n_threads > 1 || local_reader) {
+            ret = gfal_plugin_file_chk_compute_ranges(url, c_handle, check_type, start_offset, length,
+                chunk_size, n_threads, local_reader, direct_io_threshold, err);
+            if (ret == 0 && gfal2_checksum_stream_final(c_handle, checksum_buffer, buffer_length) < 0) {
+                gfal2_set_error(err, gfal2_get_plugin_file_quark(), ENOBUFS, __func__, "buffer for checksum too short");
+                ret = -1;
+            }
+            gfal2_checksum_stream_free(c_handle);
+            return ret;
+        }
+    }
+
     if ((fd = gfal2_open(handle, url, O_RDONLY, &tmp_err)) < 0) {
+        gfal2_checksum_stream_free(c_handle);
         g_prefix_error(err, "Error during checksum calculation, open ");
         gfal2_propagate_prefixed_error(err, tmp_err, __func__);
         return -1;
     }
 
     if (gfal2_lseek(handle, fd, start_offset, SEEK_SET, &tmp_err) < 0) {
+        gfal2_checksum_stream_free(c_handle);
+        gfal2_close(handle, fd, NULL);
         g_prefix_error(err, "Error during checksum calculation, lseek ");
         gfal2_propagate_prefixed_error(err, tmp_err, __func__);
         return -1;
     }
 
-    void *c_handle = i_chk->init();
     char *buffer = malloc(chunk_size);
     do {
         ret = gfal2_read(handle, fd, buffer, MIN(chunk_size, remain_bytes),  &tmp_err);
@@ -505,18 +595,20 @@ static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, con
             remain_bytes -= ret;
         }
         if (ret > 0) {
-            i_chk->update(c_handle, buffer, ret);
+            gfal2_checksum_stream_update(c_handle, buffer, ret);
         }
     } while (ret > 0 && remain_bytes > 0);
     free(buffer);
     gfal2_close(handle, fd, NULL);
 
-    if (i_chk->getResult(c_handle, checksum_buffer, buffer_length) < 0) {
+    int result = gfal2_checksum_stream_final(c_handle, checksum_buffer, buffer_length);
+    gfal2_checksum_stream_free(c_handle);
+    if (result < 0) {
         gfal2_set_error(err, gfal2_get_plugin_file_quark(), ENOBUFS, __func__, "buffer for checksum too short");
+        g_clear_error(&tmp_err);
         return -1;
     }
 
-
     if (ret < 0) {
         gfal2_set_error(err, gfal2_get_plugin_file_quark(), tmp_err->code, __func__,
             "Error during checksum calculation, read: %s", tmp_err->message);
@@ -527,43 +619,6 @@ static int gfal_plugin_file_chk_compute(plugin_handle data, const char *url, con
 }
 
 
-int gfal_plugin_filechecksum_calc(plugin_handle data, const char *url, const char *check_type,
-    char *checksum_buffer, size_t buffer_length,
-    off_t start_offset, size_t data_length,
-    GError **err)
-{
-    if (strcasecmp(check_type, "adler32") == 0) {
-        Chksum_interface ie = {.init = &adler_init,
-            .update = &adler32_update,
-            .getResult = &adler32_getResult};
-
-        return gfal_plugin_file_chk_compute(data, url, check_type, checksum_buffer,
-            buffer_length, start_offset, data_length,
-            &ie,
-            err);
-    } else if (strcasecmp(check_type, "crc32") == 0) {
-        Chksum_interface ie = {.init = &crc32_init,
-            .update = &crc32_update,
-            .getResult = &crc32_getResult};
-        return gfal_plugin_file_chk_compute(data, url, check_type, checksum_buffer,
-            buffer_length, start_offset, data_length,
-            &ie,
-            err);
-    } else if (strcasecmp(check_type, "md5") == 0) {
-        Chksum_interface ie = {.init = &md5_init,
-            .update = &md5_update,
-            .getResult = &md5_getResult};
-        return gfal_plugin_file_chk_compute(data, url, check_type, checksum_buffer,
-            buffer_length, start_offset, data_length,
-            &ie,
-            err);
-    }
-    gfal2_set_error(err, gfal2_get_plugin_file_quark(), ENOSYS, __func__,
-        "Checksum type %s not supported for local files", check_type);
-    return -1;
-}
-
-
 /*
  * Init function, called before all
  * */
@@ -574,6 +629,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
 
     file_plugin.plugin_data = handle;
     file_plugin.check_plugin_url = &gfal_file_check_url;
+    file_plugin.url_schemes = gfal_file_url_schemes;
     file_plugin.getName = &gfal_file_plugin_getName;
     file_plugin.plugin_delete = NULL;
     file_plugin.accessG = &gfal_plugin_file_access;
@@ -603,5 +659,8 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     file_plugin.setxattrG = &gfal_plugin_file_setxattr;
     file_plugin.checksum_calcG = &gfal_plugin_filechecksum_calc;
 
+    file_plugin.check_plugin_url_transfer = &gfal_plugin_file_check_url_transfer;
+    file_plugin.copy_file = &gfal_plugin_file_copy;
+
     return file_plugin;
 }
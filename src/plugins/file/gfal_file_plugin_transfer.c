@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#include <checksums/checksums.h>
+#include "gfal_file_plugin.h"
+
+// Chunk given to copy_file_range and sendfile, small enough to send performance markers
+static const size_t FILE_COPY_CHUNK = 64 << 20;
+
+
+typedef enum {
+    FILE_COPY_REFLINK, FILE_COPY_RANGE, FILE_COPY_SENDFILE, FILE_COPY_READWRITE
+} gfal_file_copy_method;
+
+static const char* gfal_file_copy_method_names[] = {
+    "reflink", "copy_file_range", "sendfile", "read/write"
+};
+
+
+gboolean gfal_plugin_file_check_url_transfer(plugin_handle handle, gfal2_context_t context,
+    const char *src, const char *dst, gfal_url2_check type)
+{
+    if (type != GFAL_FILE_COPY || src == NULL || dst == NULL)
+        return FALSE;
+    if (!gfal2_get_opt_boolean_with_default(context, CORE_CONFIG_GROUP, "FILE_COPY_OFFLOAD", TRUE))
+        return FALSE;
+    return gfal_is_file(src) && gfal_is_file(dst);
+}
+
+
+static ssize_t gfal_file_copy_range(int fd_src, int fd_dst, size_t len)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+    return syscall(SYS_copy_file_range, fd_src, NULL, fd_dst, NULL, len, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+static ssize_t gfal_file_copy_sendfile(int fd_src, int fd_dst, size_t len)
+{
+#ifdef __linux__
+    return sendfile(fd_dst, fd_src, NULL, len);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+static ssize_t gfal_file_copy_readwrite(int fd_src, int fd_dst, char *buffer, size_t len)
+{
+    ssize_t ret = read(fd_src, buffer, len);
+    if (ret > 0) {
+        ssize_t done = 0;
+        while (done < ret) {
+            ssize_t w = write(fd_dst, buffer + done, ret - done);
+            if (w < 0)
+                return -1;
+            done += w;
+        }
+    }
+    return ret;
+}
+
+
+// the kernel refuses the method for these files, so the next one must be tried
+static gboolean gfal_file_copy_not_supported(int errcode)
+{
+    return errcode == ENOSYS || errcode == EXDEV || errcode == EINVAL ||
+        errcode == EOPNOTSUPP || errcode == EBADF;
+}
+
+
+static int gfal_file_copy_data(gfal2_context_t context, gfalt_params_t params,
+    const char *src, const char *dst, int fd_src, int fd_dst, off_t size, GError **err)
+{
+    gfal_file_copy_method method = FILE_COPY_RANGE;
+    char *buffer = NULL;
+    size_t done = 0, done_since_last_update = 0;
+    time_t start = time(NULL), last_update = start, now;
+    const time_t timeout = start + gfalt_get_timeout(params, NULL);
+
+#ifdef FICLONE
+    if (size > 0 && gfal2_get_opt_boolean_with_default(context, CORE_CONFIG_GROUP, "FILE_COPY_REFLINK", TRUE)) {
+        if (ioctl(fd_dst, FICLONE, fd_src) == 0) {
+            method = FILE_COPY_REFLINK;
+            done = size;
+        }
+    }
+#endif
+    if (method != FILE_COPY_REFLINK && !gfal2_get_opt_boolean_with_default(context, CORE_CONFIG_GROUP,
+        "FILE_COPY_KERNEL", TRUE)) {
+        method = FILE_COPY_READWRITE;
+    }
+
+    while (method != FILE_COPY_REFLINK) {
+        ssize_t ret;
+        switch (method) {
+            case FILE_COPY_RANGE:
+                ret = gfal_file_copy_range(fd_src, fd_dst, FILE_COPY_CHUNK);
+                break;
+            case FILE_COPY_SENDFILE:
+                ret = gfal_file_copy_sendfile(fd_src, fd_dst, FILE_COPY_CHUNK);
+                break;
+            default:
+                if (buffer == NULL)
+                    buffer = g_malloc(FILE_COPY_CHUNK);
+                ret = gfal_file_copy_readwrite(fd_src, fd_dst, buffer, FILE_COPY_CHUNK);
+                break;
+        }
+
+        if (ret < 0) {
+            // fallback only if nothing has been written yet, the file offsets are still at 0
+            if (done == 0 && method != FILE_COPY_READWRITE && gfal_file_copy_not_supported(errno)) {
+                gfal2_log(G_LOG_LEVEL_DEBUG, "%s not supported (%s), try the next method",
+                    gfal_file_copy_method_names[method], strerror(errno));
+                ++method;
+                continue;
+            }
+            gfal_plugin_file_report_error(__func__, err);
+            break;
+        }
+        if (ret == 0)
+            break;
+
+        done += ret;
+        done_since_last_update += ret;
+
+        if (gfal2_is_canceled(context)) {
+            gfal2_set_error(err, gfal2_get_plugin_file_quark(), ECANCELED, __func__, "Transfer canceled");
+            break;
+        }
+        now = time(NULL);
+        if (now >= timeout) {
+            gfal2_set_error(err, gfal2_get_plugin_file_quark(), ETIMEDOUT, __func__,
+                "Transfer canceled because the timeout expired");
+            break;
+        }
+        else if (now - last_update > 5) {
+            struct _gfalt_transfer_status status;
+            status.average_baudrate = (size_t)(done / (now - start));
+            status.bytes_transfered = done;
+            status.instant_baudrate = (size_t)(done_since_last_update / (now - last_update));
+            status.transfer_time = now - start;
+            plugin_trigger_monitor(params, &status, src, dst);
+            done_since_last_update = 0;
+            last_update = now;
+        }
+    }
+    g_free(buffer);
+
+    if (*err != NULL)
+        return -1;
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "copied %zu bytes from %s to %s using %s",
+        done, src, dst, gfal_file_copy_method_names[method]);
+    return 0;
+}
+
+
+static int gfal_file_create_parent(gfalt_params_t params, const char *dst, GError **err)
+{
+    if (!gfalt_get_create_parent_dir(params, NULL))
+        return 0;
+
+    char *parent = g_path_get_dirname(dst + FILE_PREFIX_LEN);
+    int ret = g_mkdir_with_parents(parent, 0755);
+    g_free(parent);
+    if (ret < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_DESTINATION, GFALT_ERROR_PARENT, "Could not create the parent directory of %s: %s",
+            dst, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+static int gfal_file_unlink_if_exists(gfalt_params_t params, const char *dst, GError **err)
+{
+    struct stat st;
+    if (stat(dst + FILE_PREFIX_LEN, &st) < 0) {
+        if (errno == ENOENT)
+            return 0;
+        gfal_plugin_file_report_error(__func__, err);
+        return -1;
+    }
+
+    if (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode) || S_ISSOCK(st.st_mode)) {
+        gfal2_log(G_LOG_LEVEL_MESSAGE, "%s is a special file (%o), so keep going", dst, S_IFMT & st.st_mode);
+        return 0;
+    }
+
+    if (!gfalt_get_replace_existing_file(params, NULL)) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), EEXIST, __func__,
+            GFALT_ERROR_DESTINATION, GFALT_ERROR_EXISTS, "The file exists and overwrite is not set");
+        return -1;
+    }
+
+    if (unlink(dst + FILE_PREFIX_LEN) < 0) {
+        if (errno == ENOENT)
+            return 0;
+        gfal_plugin_file_report_error(__func__, err);
+        return -1;
+    }
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(),
+        GFAL_EVENT_DESTINATION, GFAL_EVENT_OVERWRITE_DESTINATION, "Deleted %s", dst);
+    return 0;
+}
+
+
+static int gfal_file_checksum(plugin_handle plugin_data, gfalt_params_t params, const char *url,
+    gfal_event_side_t side, const char *checksum_type, char *checksum, size_t checksum_len, GError **err)
+{
+    GError *tmp_err = NULL;
+
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), side, GFAL_EVENT_CHECKSUM_ENTER, "");
+    if (gfal_plugin_filechecksum_calc(plugin_data, url, checksum_type, checksum, checksum_len, 0, 0, &tmp_err) < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), tmp_err->code, __func__,
+            (side == GFAL_EVENT_SOURCE) ? GFALT_ERROR_SOURCE : GFALT_ERROR_DESTINATION, GFALT_ERROR_CHECKSUM,
+            "Could not get the checksum of %s: %s", url, tmp_err->message);
+        g_error_free(tmp_err);
+        return -1;
+    }
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), side, GFAL_EVENT_CHECKSUM_EXIT, "");
+    return 0;
+}
+
+
+int gfal_plugin_file_copy(plugin_handle plugin_data, gfal2_context_t context, gfalt_params_t params,
+    const char *src, const char *dst, GError **err)
+{
+    GError *tmp_err = NULL;
+    char checksum_type[1024] = {0};
+    char user_checksum[1024] = {0};
+    char source_checksum[1024] = {0};
+    const gboolean is_strict_mode = gfalt_get_strict_copy_mode(params, NULL);
+    gfalt_checksum_mode_t checksum_mode = GFALT_CHECKSUM_NONE;
+
+    if (!is_strict_mode) {
+        checksum_mode = gfalt_get_checksum(params, checksum_type, sizeof(checksum_type),
+            user_checksum, sizeof(user_checksum), NULL);
+    }
+    if (checksum_type[0] == '\0') {
+        g_strlcpy(checksum_type, "ADLER32", sizeof(checksum_type));
+    }
+
+    // The data never goes through user space, so an inline checksum is a checksum of the source
+    if (checksum_mode & GFALT_CHECKSUM_SOURCE) {
+        if (gfal_file_checksum(plugin_data, params, src, GFAL_EVENT_SOURCE, checksum_type,
+            source_checksum, sizeof(source_checksum), err) < 0)
+            return -1;
+
+        if (user_checksum[0] && gfal_compare_checksums(user_checksum, source_checksum, sizeof(source_checksum)) != 0) {
+            gfalt_set_error(err, gfal2_get_plugin_file_quark(), EIO, __func__,
+                GFALT_ERROR_SOURCE, GFALT_ERROR_CHECKSUM_MISMATCH,
+                "Source checksum and user-specified checksum do not match: %s != %s", source_checksum, user_checksum);
+            return -1;
+        }
+    }
+
+    if (!is_strict_mode) {
+        if (gfal_file_create_parent(params, dst, err) < 0 || gfal_file_unlink_if_exists(params, dst, err) < 0)
+            return -1;
+    }
+
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE, GFAL_EVENT_TRANSFER_ENTER,
+        "%s => %s", src, dst);
+
+    struct stat st;
+    int fd_src = open(src + FILE_PREFIX_LEN, O_RDONLY);
+    if (fd_src < 0 || fstat(fd_src, &st) < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_SOURCE, NULL, "Could not open the source: %s", strerror(errno));
+        if (fd_src >= 0)
+            close(fd_src);
+        return -1;
+    }
+    int fd_dst = open(dst + FILE_PREFIX_LEN, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+    if (fd_dst < 0) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), errno, __func__,
+            GFALT_ERROR_DESTINATION, NULL, "Could not open the destination: %s", strerror(errno));
+        close(fd_src);
+        return -1;
+    }
+
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE, GFAL_EVENT_TRANSFER_TYPE,
+        "%s", GFAL_TRANSFER_TYPE_STREAMED);
+
+    gfal_file_copy_data(context, params, src, dst, fd_src, fd_dst, st.st_size, &tmp_err);
+    close(fd_src);
+    if (close(fd_dst) < 0 && tmp_err == NULL) {
+        gfal_plugin_file_report_error(__func__, &tmp_err);
+    }
+    if (tmp_err != NULL) {
+        gfalt_set_error(err, gfal2_get_plugin_file_quark(), tmp_err->code, __func__,
+            GFALT_ERROR_TRANSFER, NULL, "%s", tmp_err->message);
+        g_error_free(tmp_err);
+        return -1;
+    }
+
+    plugin_trigger_event(params, gfal2_get_plugin_file_quark(), GFAL_EVENT_NONE, GFAL_EVENT_TRANSFER_EXIT,
+        "%s => %s", src, dst);
+
+    if (checksum_mode & GFALT_CHECKSUM_TARGET) {
+        char destination_checksum[1024];
+        const char *compare_against = user_checksum[0] ? user_checksum : source_checksum;
+        const char *compare_side = user_checksum[0] ? "User defined" : "Source";
+
+        if (gfal_file_checksum(plugin_data, params, dst, GFAL_EVENT_DESTINATION, checksum_type,
+            destination_checksum, sizeof(destination_checksum), err) < 0)
+            return -1;
+
+        if (gfal_compare_checksums(compare_against, destination_checksum, sizeof(destination_checksum)) != 0) {
+            gfalt_set_error(err, gfal2_get_plugin_file_quark(), EIO, __func__,
+                GFALT_ERROR_DESTINATION, GFALT_ERROR_CHECKSUM_MISMATCH,
+                "%s checksum and destination checksum do not match: %s != %s",
+                compare_side, compare_against, destination_checksum);
+            return -1;
+        }
+    }
+    return 0;
+}
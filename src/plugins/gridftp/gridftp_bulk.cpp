@@ -18,9 +18,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "gridftp_bulk_scheduler.h"
 #include "gridftp_filecopy.h"
 #include "gridftpwrapper.h"
 #include "gridftp_namespace.h"
@@ -33,12 +36,13 @@
 static const GQuark GSIFTP_BULK_DOMAIN = g_quark_from_static_string("GridFTP::Filecopy");
 
 
+
 struct GridFTPBulkData {
     GridFTPBulkData(size_t nbfiles) :
             srcs(NULL), dsts(NULL), checksums(nbfiles),
             errn(new int[nbfiles]), fsize(new off_t[nbfiles]),
-            index(0), nbfiles(nbfiles), started(new bool[nbfiles]),
-            params(NULL), error(NULL), done(false)
+            nbfiles(nbfiles), started(new bool[nbfiles]),
+            params(NULL), scheduler(NULL)
     {
         for (size_t i = 0; i < nbfiles; ++i) {
             started[i] = false;
@@ -53,8 +57,8 @@ struct GridFTPBulkData {
         delete [] started;
         delete [] errn;
         delete [] fsize;
-        if (error)
-            globus_object_free(error);
+        globus_mutex_destroy(&lock);
+        globus_cond_destroy(&cond);
     }
 
     const char* const* srcs;
@@ -63,18 +67,29 @@ struct GridFTPBulkData {
     int* errn;
     off_t* fsize;
 
-    size_t index, nbfiles;
+    size_t nbfiles;
     bool *started;
 
     gfalt_params_t params;
 
+    // Shared by the pipelines, protected by lock
+    GridFTPBulkScheduler* scheduler;
     globus_mutex_t lock;
     globus_cond_t cond;
-    globus_object_t* error;
-    bool done;
+
+    // Outcome of the transfer stage, only touched by the thread driving the pipelines.
+    // Failures are applied to errn once all the pipelines are over.
+    std::vector<bool> transferred;
+    std::vector<int> transfer_errn;
+    std::vector<std::string> transfer_error;
+    // Last failure of each group of pipelines, for the pairs left behind if all retire
+    std::map<std::string, std::pair<int, std::string> > last_error;
 };
 
 
+struct GridFTPBulkPipeline;
+
+
 struct GridFTPBulkPerformance {
     std::string source, destination;
     gfalt_params_t params;
@@ -82,6 +97,41 @@ struct GridFTPBulkPerformance {
     time_t start_time;
 
     globus_ftp_client_plugin_t* plugin;
+    GridFTPBulkPipeline* pipeline;
+};
+
+
+// A pipeline, with its own session, transferring pairs one after the other
+struct GridFTPBulkPipeline {
+    GridFTPBulkPipeline(GridFTPBulkData* pairs, size_t id) :
+            pairs(pairs), id(id), handler(NULL), cred_id_src(NULL), cred_id_dst(NULL),
+            ready(false), running(false), finished(false), error(NULL)
+    {
+    }
+
+    ~GridFTPBulkPipeline() {
+        if (error)
+            globus_object_free(error);
+    }
+
+    GridFTPBulkData* pairs;
+    size_t id;
+
+    GridFTPSessionHandler* handler;
+    globus_ftp_client_plugin_t throughput_plugin;
+    globus_ftp_client_handle_t ftp_handle;
+    globus_ftp_client_operationattr_t ftp_operation_attr_src, ftp_operation_attr_dst;
+    gss_cred_id_t cred_id_src, cred_id_dst;
+    GridFTPBulkPerformance perf;
+
+    // Set up successfully
+    bool ready;
+    // The following are protected by pairs->lock
+    // An operation has been launched, and its outcome has not been collected yet
+    bool running;
+    // The operation is over
+    bool finished;
+    globus_object_t* error;
 };
 
 
@@ -89,23 +139,14 @@ struct GridFTPBulkPerformance {
 static void gridftp_done_callback(void * user_arg, globus_ftp_client_handle_t * handle,
         globus_object_t * err)
 {
-    GridFTPBulkData* data = static_cast<GridFTPBulkData*>(user_arg);
+    GridFTPBulkPipeline* pipeline = static_cast<GridFTPBulkPipeline*>(user_arg);
+    GridFTPBulkData* data = pipeline->pairs;
 
+    globus_mutex_lock(&data->lock);
     if (err) {
-        data->error = globus_object_copy(err);
+        pipeline->error = globus_object_copy(err);
     }
-    else {
-        for (size_t i = 0; i < data->nbfiles; ++i) {
-            if (data->started[i]) {
-                plugin_trigger_event(data->params, GSIFTP_BULK_DOMAIN, GFAL_EVENT_NONE,
-                        GFAL_EVENT_TRANSFER_EXIT,
-                        "Done %s => %s", data->srcs[i], data->dsts[i]);
-            }
-        }
-    }
-
-    globus_mutex_lock(&data->lock);
-    data->done = true;
+    pipeline->finished = true;
     globus_cond_signal(&data->cond);
     globus_mutex_unlock(&data->lock);
 }
@@ -115,32 +156,31 @@ static void gridftp_done_callback(void * user_arg, globus_ftp_client_handle_t *
 static void gridftp_pipeline_callback(globus_ftp_client_handle_t * handle, char ** source_url,
         char ** dest_url, void * user_arg)
 {
-    GridFTPBulkData* data = static_cast<GridFTPBulkData*>(user_arg);
+    GridFTPBulkPipeline* pipeline = static_cast<GridFTPBulkPipeline*>(user_arg);
+    GridFTPBulkData* data = pipeline->pairs;
+    size_t index;
 
-    // Next
-    data->index++;
-
-    // Skip pairs marked as failed
-    while (data->index < data->nbfiles && data->errn[data->index]) {
-        gfal2_log(G_LOG_LEVEL_DEBUG,
-                "Skipping pair %d as marked failed with %d", data->index,
-                data->errn[data->index]);
-        data->index++;
+    // Next pair of the group, pairs marked as failed were never queued
+    globus_mutex_lock(&data->lock);
+    bool next = data->scheduler->next(pipeline->id, &index);
+    if (next) {
+        data->started[index] = true;
     }
+    globus_mutex_unlock(&data->lock);
 
     // Return next pair
-    if (data->index < data->nbfiles) {
-        *source_url = (char*)data->srcs[data->index];
-        *dest_url = (char*)data->dsts[data->index];
-        data->started[data->index] = true;
+    if (next) {
+        *source_url = (char*)data->srcs[index];
+        *dest_url = (char*)data->dsts[index];
 
-        gfal2_log(G_LOG_LEVEL_MESSAGE, "Providing pair %s => %s", *source_url, *dest_url);
+        gfal2_log(G_LOG_LEVEL_MESSAGE, "Providing pair %s => %s to pipeline %d",
+                *source_url, *dest_url, (int)pipeline->id);
     }
     else {
         *source_url = NULL;
         *dest_url = NULL;
 
-        gfal2_log(G_LOG_LEVEL_MESSAGE, "No more pairs to give");
+        gfal2_log(G_LOG_LEVEL_MESSAGE, "No more pairs to give to pipeline %d", (int)pipeline->id);
     }
 }
 
@@ -148,8 +188,12 @@ static void gridftp_pipeline_callback(globus_ftp_client_handle_t * handle, char
 static
 void gridftp_bulk_cancel(gfal2_context_t context, void* userdata)
 {
-    globus_ftp_client_handle_t* ftp_handle = static_cast<globus_ftp_client_handle_t*>(userdata);
-    globus_ftp_client_abort(ftp_handle);
+    std::vector<GridFTPBulkPipeline*>* pipelines = static_cast<std::vector<GridFTPBulkPipeline*>*>(userdata);
+    for (size_t i = 0; i < pipelines->size(); ++i) {
+        if ((*pipelines)[i]->ready) {
+            globus_ftp_client_abort(&(*pipelines)[i]->ftp_handle);
+        }
+    }
 }
 
 
@@ -166,6 +210,12 @@ static void gridftp_bulk_begin_cb(void * user_specific,
     pd->destination = dest_url;
     pd->start_time = time(NULL);
 
+    // Needed to know which pair to blame if the pipeline fails
+    GridFTPBulkData* data = pd->pipeline->pairs;
+    globus_mutex_lock(&data->lock);
+    data->scheduler->begin(pd->pipeline->id);
+    globus_mutex_unlock(&data->lock);
+
     plugin_trigger_event(pd->params, GSIFTP_BULK_DOMAIN, GFAL_EVENT_NONE,
             GFAL_EVENT_TRANSFER_ENTER,
             "(%s) %s => (%s) %s",
@@ -226,7 +276,7 @@ static
 void gridftp_pipeline_init_operationattr(globus_ftp_client_operationattr_t *ftp_operation_attr,
     const globus_ftp_client_operationattr_t *original,
     gss_cred_id_t *cred_id,
-    gfal2_context_t context, bool udt, const char *url, GError **op_error)
+    gfal2_context_t context, bool udt, const char *url)
 {
     globus_ftp_client_operationattr_copy(ftp_operation_attr, original);
     globus_ftp_client_operationattr_set_mode(ftp_operation_attr, GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
@@ -239,8 +289,8 @@ void gridftp_pipeline_init_operationattr(globus_ftp_client_operationattr_t *ftp_
         globus_ftp_client_operationattr_set_net_stack(ftp_operation_attr, "default");
     }
 
-    gchar *ucert = gfal2_cred_get(context, GFAL_CRED_X509_CERT, url, NULL, op_error);
-    gchar *ukey = gfal2_cred_get(context, GFAL_CRED_X509_KEY, url, NULL, op_error);
+    gchar *ucert = gfal2_cred_get(context, GFAL_CRED_X509_CERT, url, NULL, NULL);
+    gchar *ukey = gfal2_cred_get(context, GFAL_CRED_X509_KEY, url, NULL, NULL);
 
     gfal_globus_set_credentials(ucert,ukey, NULL, NULL, cred_id, ftp_operation_attr);
 
@@ -249,50 +299,38 @@ void gridftp_pipeline_init_operationattr(globus_ftp_client_operationattr_t *ftp_
 }
 
 
+// Get a session for the pipeline, and prepare its handle.
+// index is the first pair it will transfer.
 static
-int gridftp_pipeline_transfer(plugin_handle plugin_data,
-        gfal2_context_t context, bool udt, GridFTPBulkData* pairs, GError** op_error)
+void gridftp_pipeline_setup(GridFTPModule* gsiftp, gfal2_context_t context, bool udt, bool ipv6,
+        GridFTPBulkPipeline* pipeline, size_t index)
 {
-    GridFTPModule* gsiftp = static_cast<GridFTPModule*>(plugin_data);
-    GridFTPSessionHandler handler(gsiftp->get_session_factory(), pairs->srcs[0]);
-
-    globus_ftp_client_plugin_t throughput_plugin;
-    globus_ftp_client_handle_t ftp_handle;
-    globus_ftp_client_operationattr_t ftp_operation_attr_src, ftp_operation_attr_dst;
-    gss_cred_id_t cred_id_src = NULL, cred_id_dst = NULL;
-    globus_ftp_client_handleattr_t* ftp_handle_attr = handler.get_ftp_client_handleattr();
-
-    // First viable pair goes with the globus call
-    pairs->index = 0;
-    while (pairs->index < pairs->nbfiles && pairs->errn[pairs->index])
-        pairs->index++;
-    if (pairs->index >= pairs->nbfiles)
-        return 0;
+    GridFTPBulkData* pairs = pipeline->pairs;
 
-    pairs->started[pairs->index] = true;
+    pipeline->handler = new GridFTPSessionHandler(gsiftp->get_session_factory(), pairs->srcs[index]);
+    globus_ftp_client_handleattr_t* ftp_handle_attr = pipeline->handler->get_ftp_client_handleattr();
 
-    GridFTPBulkPerformance perf;
-    perf.params = pairs->params;
-    perf.ipv6 = gfal2_get_opt_boolean_with_default(context, GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_IPV6, false);
-    perf.plugin = &throughput_plugin;
+    pipeline->perf.params = pairs->params;
+    pipeline->perf.ipv6 = ipv6;
+    pipeline->perf.plugin = &pipeline->throughput_plugin;
+    pipeline->perf.pipeline = pipeline;
 
-    globus_ftp_client_throughput_plugin_init(&throughput_plugin,
+    globus_ftp_client_throughput_plugin_init(&pipeline->throughput_plugin,
             gridftp_bulk_begin_cb, NULL, gridftp_bulk_throughput_cb, gridftp_bulk_complete_cb,
-            &perf);
-    globus_ftp_client_throughput_plugin_set_copy_destroy(&throughput_plugin,
+            &pipeline->perf);
+    globus_ftp_client_throughput_plugin_set_copy_destroy(&pipeline->throughput_plugin,
             gridftp_bulk_copy_perf_cb, gridftp_bulk_destroy_perf_cb);
-    globus_ftp_client_handleattr_add_plugin(ftp_handle_attr, &throughput_plugin);
-
-    globus_ftp_client_handleattr_set_pipeline(ftp_handle_attr, 0, gridftp_pipeline_callback, pairs);
-    globus_ftp_client_handle_init(&ftp_handle, ftp_handle_attr);
+    globus_ftp_client_handleattr_add_plugin(ftp_handle_attr, &pipeline->throughput_plugin);
 
+    globus_ftp_client_handleattr_set_pipeline(ftp_handle_attr, 0, gridftp_pipeline_callback, pipeline);
+    globus_ftp_client_handle_init(&pipeline->ftp_handle, ftp_handle_attr);
 
     gridftp_pipeline_init_operationattr(
-        &ftp_operation_attr_src, handler.get_ftp_client_operationattr(), &cred_id_src,
-        context, udt, pairs->srcs[pairs->index], op_error);
+        &pipeline->ftp_operation_attr_src, pipeline->handler->get_ftp_client_operationattr(),
+        &pipeline->cred_id_src, context, udt, pairs->srcs[index]);
     gridftp_pipeline_init_operationattr(
-        &ftp_operation_attr_dst, handler.get_ftp_client_operationattr(), &cred_id_dst,
-        context, udt, pairs->dsts[pairs->index], op_error);
+        &pipeline->ftp_operation_attr_dst, pipeline->handler->get_ftp_client_operationattr(),
+        &pipeline->cred_id_dst, context, udt, pairs->dsts[index]);
 
     int nbstreams = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
             GRIDFTP_CONFIG_NB_STREAM, 0);
@@ -308,88 +346,340 @@ int gridftp_pipeline_transfer(plugin_handle plugin_data,
         parallelism.fixed.size = nbstreams;
         parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
 
-        globus_ftp_client_operationattr_set_mode(&ftp_operation_attr_src, GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
-        globus_ftp_client_operationattr_set_parallelism(&ftp_operation_attr_src, &parallelism);
-        globus_ftp_client_operationattr_set_mode(&ftp_operation_attr_dst, GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
-        globus_ftp_client_operationattr_set_parallelism(&ftp_operation_attr_dst, &parallelism);
+        globus_ftp_client_operationattr_set_mode(&pipeline->ftp_operation_attr_src, GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
+        globus_ftp_client_operationattr_set_parallelism(&pipeline->ftp_operation_attr_src, &parallelism);
+        globus_ftp_client_operationattr_set_mode(&pipeline->ftp_operation_attr_dst, GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
+        globus_ftp_client_operationattr_set_parallelism(&pipeline->ftp_operation_attr_dst, &parallelism);
     }
 
     if (buffer_size > 0) {
         tcp_buffer_size.mode = GLOBUS_FTP_CONTROL_TCPBUFFER_FIXED;
         tcp_buffer_size.fixed.size = buffer_size;
-        globus_ftp_client_operationattr_set_tcp_buffer(&ftp_operation_attr_src, &tcp_buffer_size);
-        globus_ftp_client_operationattr_set_tcp_buffer(&ftp_operation_attr_dst, &tcp_buffer_size);
+        globus_ftp_client_operationattr_set_tcp_buffer(&pipeline->ftp_operation_attr_src, &tcp_buffer_size);
+        globus_ftp_client_operationattr_set_tcp_buffer(&pipeline->ftp_operation_attr_dst, &tcp_buffer_size);
     }
 
+    pipeline->ready = true;
+}
 
-    gfal_cancel_token_t cancel_token;
-    cancel_token = gfal2_register_cancel_callback(context, gridftp_bulk_cancel, ftp_handle);
 
-    int res = 0;
-    try {
-        globus_result_t globus_return;
+static
+void gridftp_pipeline_teardown(GridFTPBulkPipeline* pipeline)
+{
+    if (pipeline->ready) {
+        globus_ftp_client_handleattr_t* ftp_handle_attr = pipeline->handler->get_ftp_client_handleattr();
 
-        globus_return = globus_ftp_client_third_party_transfer(&ftp_handle,
-                pairs->srcs[pairs->index], &ftp_operation_attr_src,
-                pairs->dsts[pairs->index], &ftp_operation_attr_dst,
-                GLOBUS_NULL, gridftp_done_callback, pairs);
-        gfal_globus_check_result(GSIFTP_BULK_DOMAIN, globus_return);
+        globus_ftp_client_handleattr_remove_plugin(ftp_handle_attr, &pipeline->throughput_plugin);
+        globus_ftp_client_throughput_plugin_destroy(&pipeline->throughput_plugin);
 
+        globus_ftp_client_handle_destroy(&pipeline->ftp_handle);
+        globus_ftp_client_operationattr_destroy(&pipeline->ftp_operation_attr_src);
+        globus_ftp_client_operationattr_destroy(&pipeline->ftp_operation_attr_dst);
+        globus_ftp_client_handleattr_set_pipeline(ftp_handle_attr, 0, NULL, NULL);
+
+        OM_uint32 minor_status;
+        gss_release_cred(&minor_status, &pipeline->cred_id_src);
+        gss_release_cred(&minor_status, &pipeline->cred_id_dst);
+        pipeline->ready = false;
+    }
+    delete pipeline->handler;
+    pipeline->handler = NULL;
+}
+
+
+// Start an operation on the pipeline, beginning with the given pair.
+// The lock must not be held, since Globus may ask for the next pair right away.
+static
+void gridftp_pipeline_launch(GridFTPBulkPipeline* pipeline, size_t index)
+{
+    GridFTPBulkData* pairs = pipeline->pairs;
+
+    globus_result_t globus_return = globus_ftp_client_third_party_transfer(&pipeline->ftp_handle,
+            pairs->srcs[index], &pipeline->ftp_operation_attr_src,
+            pairs->dsts[index], &pipeline->ftp_operation_attr_dst,
+            GLOBUS_NULL, gridftp_done_callback, pipeline);
+
+    if (globus_return != GLOBUS_SUCCESS) {
+        globus_object_t* error = globus_error_get(globus_return);
         globus_mutex_lock(&pairs->lock);
+        pipeline->error = error;
+        pipeline->finished = true;
+        globus_mutex_unlock(&pairs->lock);
+    }
+}
+
+
+static
+void gridftp_bulk_set_transfer_error(GridFTPBulkData* pairs, size_t index, int code, const std::string& msg)
+{
+    pairs->transfer_errn[index] = code;
+    pairs->transfer_error[index] = msg;
+}
+
+
+// Outcome of a pipeline operation, collected with the lock held, and reported after
+struct GridFTPBulkOutcome {
+    GridFTPBulkPipeline* pipeline;
+    GridFTPBulkScheduler::Outcome outcome;
+    globus_object_t* error;
+};
+
+
+static
+void gridftp_bulk_report(GridFTPBulkData* pairs, const GridFTPBulkOutcome& result)
+{
+    const GridFTPBulkScheduler::Outcome& outcome = result.outcome;
+
+    for (size_t i = 0; i < outcome.done.size(); ++i) {
+        size_t index = outcome.done[i];
+        pairs->transferred[index] = true;
+        plugin_trigger_event(pairs->params, GSIFTP_BULK_DOMAIN, GFAL_EVENT_NONE,
+                GFAL_EVENT_TRANSFER_EXIT,
+                "Done %s => %s", pairs->srcs[index], pairs->dsts[index]);
+    }
+
+    if (result.error) {
+        char *err_buffer = NULL;
+        int err_code = gfal_globus_error_convert(result.error, &err_buffer);
+        std::string err_msg(err_buffer ? err_buffer : "Unknown error");
+        g_free(err_buffer);
+
+        const std::string& key = pairs->scheduler->key(result.pipeline->id);
+        pairs->last_error[key] = std::make_pair(err_code, err_msg);
+
+        if (outcome.failed) {
+            size_t index = outcome.failed_pair;
+            gfal2_log(G_LOG_LEVEL_WARNING, "Bulk transfer of %s => %s failed with %s",
+                    pairs->srcs[index], pairs->dsts[index], err_msg.c_str());
+            gridftp_bulk_set_transfer_error(pairs, index, err_code, err_msg);
+        }
+        if (outcome.retired) {
+            gfal2_log(G_LOG_LEVEL_WARNING, "Pipeline %d for %s failed repeatedly, no more pairs will be given to it",
+                    (int)result.pipeline->id, key.c_str());
+        }
+        globus_object_free(result.error);
+    }
+}
+
+
+// Pairs with the same key can go through the same pipeline
+static
+std::string gridftp_bulk_pipeline_key(GridFTPBulkData* pairs, size_t index, bool ipv6)
+{
+    return return_host_and_port(pairs->srcs[index], ipv6) + " => " +
+            return_host_and_port(pairs->dsts[index], ipv6);
+}
+
+
+// Drive all the pipelines until there is nothing left to transfer.
+// Returns the number of pairs that failed, or -1 if the transfer failed as a whole
+// (nothing could be transferred, or timeout), in which case op_error is set instead.
+static
+int gridftp_bulk_transfer(plugin_handle plugin_data,
+        gfal2_context_t context, bool udt, GridFTPBulkData* pairs,
+        GError** file_errors, GError** op_error)
+{
+    GridFTPModule* gsiftp = static_cast<GridFTPModule*>(plugin_data);
+    bool ipv6 = gfal2_get_opt_boolean_with_default(context, GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_IPV6, false);
+    int max_pipelines = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_BULK_PIPELINES, 4);
+    int max_failures = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_BULK_PIPELINE_MAX_FAILURES, 3);
+
+    GridFTPBulkScheduler scheduler(std::max(max_pipelines, 1), std::max(max_failures, 0));
+    for (size_t i = 0; i < pairs->nbfiles; ++i) {
+        if (pairs->errn[i] == 0) {
+            scheduler.add(gridftp_bulk_pipeline_key(pairs, i, ipv6), i);
+        }
+    }
+    size_t npipelines = scheduler.build();
+    if (npipelines == 0)
+        return 0;
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Bulk transfer using %d pipelines", (int)npipelines);
+
+    pairs->scheduler = &scheduler;
+    pairs->transferred.assign(pairs->nbfiles, false);
+    pairs->transfer_errn.assign(pairs->nbfiles, 0);
+    pairs->transfer_error.assign(pairs->nbfiles, std::string());
+    pairs->last_error.clear();
+
+    std::vector<GridFTPBulkPipeline*> pipelines;
+    for (size_t p = 0; p < npipelines; ++p) {
+        GridFTPBulkPipeline* pipeline = new GridFTPBulkPipeline(pairs, p);
+        pipelines.push_back(pipeline);
+
+        size_t first;
+        scheduler.peek(p, &first);
+        try {
+            gridftp_pipeline_setup(gsiftp, context, udt, ipv6, pipeline, first);
+        }
+        catch (const Gfal::CoreException& e) {
+            gfal2_log(G_LOG_LEVEL_WARNING, "Could not set up pipeline %d for %s: %s",
+                    (int)p, scheduler.key(p).c_str(), e.what());
+            pairs->last_error[scheduler.key(p)] = std::make_pair(e.code(), std::string(e.what()));
+            scheduler.retire(p);
+        }
+    }
 
-        guint64 timeout = gfalt_get_timeout(pairs->params, NULL);
-        globus_abstime_t timeout_expires;
-        GlobusTimeAbstimeGetCurrent(timeout_expires);
-        timeout_expires.tv_sec += timeout;
+    gfal_cancel_token_t cancel_token;
+    cancel_token = gfal2_register_cancel_callback(context, gridftp_bulk_cancel, &pipelines);
+
+    guint64 timeout = gfalt_get_timeout(pairs->params, NULL);
+    globus_abstime_t timeout_expires;
+    GlobusTimeAbstimeGetCurrent(timeout_expires);
+    timeout_expires.tv_sec += timeout;
+    bool timed_out = false;
+
+    std::vector<std::pair<GridFTPBulkPipeline*, size_t> > launches;
+    std::vector<GridFTPBulkOutcome> outcomes;
+    std::vector<size_t> orphans;
+
+    globus_mutex_lock(&pairs->lock);
+    for (size_t p = 0; p < npipelines; ++p) {
+        size_t index;
+        if (pipelines[p]->ready && scheduler.next(p, &index)) {
+            pairs->started[index] = true;
+            pipelines[p]->running = true;
+            launches.push_back(std::make_pair(pipelines[p], index));
+        }
+    }
+    globus_mutex_unlock(&pairs->lock);
+
+    while (true) {
+        for (size_t i = 0; i < launches.size(); ++i) {
+            gridftp_pipeline_launch(launches[i].first, launches[i].second);
+        }
+        launches.clear();
+
+        globus_mutex_lock(&pairs->lock);
 
+        // Wait for any pipeline to finish its operation
+        bool any_running, any_finished;
         int wait_ret = 0;
-        while (!pairs->done && wait_ret != ETIMEDOUT) {
-            if (timeout > 0)
+        while (true) {
+            any_running = any_finished = false;
+            for (size_t p = 0; p < npipelines; ++p) {
+                any_running |= pipelines[p]->running;
+                any_finished |= pipelines[p]->finished;
+            }
+            if (any_finished || !any_running || wait_ret == ETIMEDOUT)
+                break;
+            if (timeout > 0 && !timed_out)
                 wait_ret = globus_cond_timedwait(&pairs->cond, &pairs->lock, &timeout_expires);
             else
                 wait_ret = globus_cond_wait(&pairs->cond, &pairs->lock);
         }
+        bool abort_all = (wait_ret == ETIMEDOUT && !any_finished);
+        bool stop = timed_out || abort_all || gfal2_is_canceled(context);
+
+        // Collect, and give more work to the pipelines that are done
+        for (size_t p = 0; p < npipelines; ++p) {
+            GridFTPBulkPipeline* pipeline = pipelines[p];
+            if (!pipeline->finished)
+                continue;
+
+            GridFTPBulkOutcome result;
+            result.pipeline = pipeline;
+            result.error = pipeline->error;
+            result.outcome = scheduler.finish(p, pipeline->error == NULL);
+            outcomes.push_back(result);
+
+            pipeline->error = NULL;
+            pipeline->finished = false;
+            pipeline->running = false;
+
+            size_t index;
+            if (!stop && scheduler.next(p, &index)) {
+                pairs->started[index] = true;
+                pipeline->running = true;
+                launches.push_back(std::make_pair(pipeline, index));
+            }
+        }
+        orphans = scheduler.orphans();
+
+        any_running = false;
+        for (size_t p = 0; p < npipelines; ++p) {
+            any_running |= pipelines[p]->running;
+        }
         globus_mutex_unlock(&pairs->lock);
 
-        if (pairs->error) {
-            char *err_buffer;
-            int err_code = gfal_globus_error_convert(pairs->error, &err_buffer);
-            if (err_code) {
-                gfal2_log(G_LOG_LEVEL_WARNING, "Bulk transfer failed with %s", err_buffer);
-                gfal2_set_error(op_error, GSIFTP_BULK_DOMAIN, err_code, __func__, "%s", err_buffer);
-                res = -1;
-                g_free(err_buffer);
+        // Stop everything on timeout, and wait for the pipelines to be over
+        if (abort_all) {
+            gfal2_log(G_LOG_LEVEL_WARNING, "Bulk transfer timed out, aborting");
+            timed_out = true;
+            for (size_t p = 0; p < npipelines; ++p) {
+                if (pipelines[p]->ready)
+                    globus_ftp_client_abort(&pipelines[p]->ftp_handle);
             }
         }
-        else if (wait_ret == ETIMEDOUT) {
-            gfal2_set_error(op_error, GSIFTP_BULK_DOMAIN, ETIMEDOUT, __func__, "Transfer timed out");
-            res = -1;
+
+        for (size_t i = 0; i < outcomes.size(); ++i) {
+            gridftp_bulk_report(pairs, outcomes[i]);
         }
-    }
-    catch (const Gfal::CoreException& e) {
-        gfal2_log(G_LOG_LEVEL_MESSAGE, "Bulk transfer failed with %s", e.what());
-        gfal2_set_error(op_error, e.domain(), e.code(), __func__, "%s", e.what());
-        res = -1;
+        outcomes.clear();
+
+        for (size_t i = 0; i < orphans.size(); ++i) {
+            size_t index = orphans[i];
+            std::string key = gridftp_bulk_pipeline_key(pairs, index, ipv6);
+            const std::pair<int, std::string>& error = pairs->last_error[key];
+            gridftp_bulk_set_transfer_error(pairs, index, error.first,
+                    "No pipeline left for " + key + ": " + error.second);
+        }
+
+        if (!any_running)
+            break;
     }
 
     gfal2_remove_cancel_callback(context, cancel_token);
 
-    globus_ftp_client_handleattr_remove_plugin(ftp_handle_attr, &throughput_plugin);
-    globus_ftp_client_throughput_plugin_destroy(&throughput_plugin);
+    for (size_t p = 0; p < npipelines; ++p) {
+        gridftp_pipeline_teardown(pipelines[p]);
+        delete pipelines[p];
+    }
+    pairs->scheduler = NULL;
 
-    globus_ftp_client_handle_destroy(&ftp_handle);
-    globus_ftp_client_operationattr_destroy(&ftp_operation_attr_src);
-    globus_ftp_client_operationattr_destroy(&ftp_operation_attr_dst);
-    globus_ftp_client_handleattr_set_pipeline(ftp_handle_attr, 0, NULL, NULL);
+    if (timed_out) {
+        gfal2_set_error(op_error, GSIFTP_BULK_DOMAIN, ETIMEDOUT, __func__, "Transfer timed out");
+        return -1;
+    }
 
-    OM_uint32 minor_status;
-    gss_release_cred(&minor_status, &cred_id_src);
-    gss_release_cred(&minor_status, &cred_id_dst);
+    // Pairs left behind when the transfer stopped
+    bool canceled = gfal2_is_canceled(context);
+    for (size_t i = 0; i < pairs->nbfiles; ++i) {
+        if (pairs->errn[i] == 0 && !pairs->transferred[i] && pairs->transfer_errn[i] == 0) {
+            gridftp_bulk_set_transfer_error(pairs, i, canceled ? EINTR : EIO,
+                    canceled ? "Operation canceled" : "Not transferred");
+        }
+    }
 
-    return res;
+    // Nothing went through, report as a failure of the whole transfer
+    size_t ntransferred = std::count(pairs->transferred.begin(), pairs->transferred.end(), true);
+    if (ntransferred == 0) {
+        for (size_t i = 0; i < pairs->nbfiles; ++i) {
+            if (pairs->transfer_errn[i]) {
+                gfal2_log(G_LOG_LEVEL_WARNING, "Bulk transfer failed with %s", pairs->transfer_error[i].c_str());
+                gfal2_set_error(op_error, GSIFTP_BULK_DOMAIN, pairs->transfer_errn[i], __func__,
+                        "%s", pairs->transfer_error[i].c_str());
+                return -1;
+            }
+        }
+    }
+
+    int nfailed = 0;
+    for (size_t i = 0; i < pairs->nbfiles; ++i) {
+        if (pairs->transfer_errn[i]) {
+            gfal2_set_error(&(file_errors[i]), GSIFTP_BULK_DOMAIN, pairs->transfer_errn[i],
+                    __func__, "%s", pairs->transfer_error[i].c_str());
+            pairs->errn[i] = pairs->transfer_errn[i];
+            ++nfailed;
+        }
+    }
+    return nfailed;
 }
 
 
+
 static
 int gridftp_bulk_check_sources(plugin_handle plugin_data, gfal2_context_t context,
         GridFTPBulkData* pairs, GError** file_errors)
@@ -635,25 +925,24 @@ int gridftp_bulk_copy(plugin_handle plugin_data, gfal2_context_t context, gfalt_
         bool udt = gfal2_get_opt_boolean_with_default(context,
                 GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_TRANSFER_UDT, false);
 
-        transfer_ret = gridftp_pipeline_transfer(plugin_data, context, udt, &pairs, op_error);
+        transfer_ret = gridftp_bulk_transfer(plugin_data, context, udt, &pairs, *file_errors, op_error);
         // If UDT was tried and it failed, give it another shot
         if (transfer_ret < 0 && strstr((*op_error)->message, "udt driver not whitelisted") && !gfal2_is_canceled(context)) {
             udt = false;
-            pairs.done = false;
-            globus_object_free(pairs.error);
-            pairs.error = NULL;
             g_error_free(*op_error);
             *op_error = NULL;
 
             gfal2_log(G_LOG_LEVEL_WARNING, "UDT transfer failed! Disabling and retrying...");
-            transfer_ret = gridftp_pipeline_transfer(plugin_data, context, udt, &pairs, op_error);
+            transfer_ret = gridftp_bulk_transfer(plugin_data, context, udt, &pairs, *file_errors, op_error);
         }
     }
     if (transfer_ret < 0)
         total_failed = nbfiles;
+    else
+        total_failed += transfer_ret;
 
     // Check destinations
-    if (transfer_ret == 0)
+    if (transfer_ret >= 0)
         total_failed += gridftp_bulk_close(plugin_data, context, &pairs, *file_errors);
 
     // Done
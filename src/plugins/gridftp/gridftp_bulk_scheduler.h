@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GRIDFTP_BULK_SCHEDULER_H
+#define GRIDFTP_BULK_SCHEDULER_H
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// Distribution of the pairs of a bulk transfer between several pipelines.
+/// A pipeline can only chain transfers between the same two servers, so pairs are
+/// grouped by a key identifying both endpoints, and each group is served by up to
+/// max_pipelines pipelines. Pipelines pull the next pair from the queue of their group
+/// as they progress, so a slow file does not hold back the others.
+/// A pipeline whose operations fail max_failures times in a row is retired,
+/// and the rest of the group is left to the remaining pipelines.
+/// There is no locking here, callers must serialize the access.
+class GridFTPBulkScheduler {
+public:
+    /// What happened to the pairs given to a pipeline operation
+    struct Outcome {
+        std::vector<size_t> done;   // transferred
+        bool failed;                // true if failed_pair has to be reported as failed
+        size_t failed_pair;
+        bool retired;               // the pipeline will not be given more pairs
+    };
+
+    /// A max_failures of 0 means pipelines are never retired
+    GridFTPBulkScheduler(size_t max_pipelines, unsigned max_failures):
+        max_pipelines(std::max<size_t>(max_pipelines, 1)), max_failures(max_failures)
+    {
+    }
+
+    /// Queue a pair under the group key
+    void add(const std::string& key, size_t pair)
+    {
+        auto i = group_index.find(key);
+        if (i == group_index.end()) {
+            i = group_index.insert(std::make_pair(key, groups.size())).first;
+            groups.push_back(Group(key));
+        }
+        groups[i->second].queue.push_back(pair);
+    }
+
+    /// Create the pipelines for the queued pairs, and return how many there are.
+    /// Pipelines are identified by their index, from 0 to the returned value.
+    size_t build()
+    {
+        pipelines.clear();
+        for (size_t g = 0; g < groups.size(); ++g) {
+            size_t count = std::min(max_pipelines, groups[g].queue.size());
+            for (size_t i = 0; i < count; ++i) {
+                pipelines.push_back(Pipeline(g));
+            }
+            groups[g].pipelines = count;
+            groups[g].retired = 0;
+        }
+        return pipelines.size();
+    }
+
+    size_t size() const
+    {
+        return pipelines.size();
+    }
+
+    const std::string& key(size_t pipeline) const
+    {
+        return groups[pipelines[pipeline].group].key;
+    }
+
+    /// Peek the first pair that would be given to the pipeline.
+    /// Returns false if there is none.
+    bool peek(size_t pipeline, size_t* pair) const
+    {
+        const Pipeline& p = pipelines[pipeline];
+        const Group& group = groups[p.group];
+        if (p.retired || group.queue.empty()) {
+            return false;
+        }
+        *pair = group.queue.front();
+        return true;
+    }
+
+    /// Give the next pair to the pipeline.
+    /// Returns false if there is none, or if the pipeline has been retired.
+    bool next(size_t pipeline, size_t* pair)
+    {
+        if (!peek(pipeline, pair)) {
+            return false;
+        }
+        Pipeline& p = pipelines[pipeline];
+        groups[p.group].queue.pop_front();
+        p.handed.push_back(*pair);
+        return true;
+    }
+
+    /// The pipeline started transferring the next of the pairs it has been given.
+    /// Implies the previous one is done.
+    void begin(size_t pipeline)
+    {
+        Pipeline& p = pipelines[pipeline];
+        if (p.begun < p.handed.size()) {
+            ++p.begun;
+        }
+    }
+
+    /// The current operation of the pipeline is over.
+    /// On success, all the pairs given are done.
+    /// On failure, the pair being transferred at the moment is blamed, the ones before
+    /// it are done, and those not started yet are put back in front of the queue.
+    Outcome finish(size_t pipeline, bool success)
+    {
+        Pipeline& p = pipelines[pipeline];
+        Group& group = groups[p.group];
+        Outcome outcome;
+        outcome.failed = false;
+        outcome.failed_pair = 0;
+
+        if (success) {
+            outcome.done = p.handed;
+            p.failures = 0;
+        }
+        else {
+            size_t blamed = (p.begun > 0) ? p.begun - 1 : 0;
+            if (blamed < p.handed.size()) {
+                outcome.done.assign(p.handed.begin(), p.handed.begin() + blamed);
+                outcome.failed = true;
+                outcome.failed_pair = p.handed[blamed];
+                group.queue.insert(group.queue.begin(), p.handed.begin() + blamed + 1, p.handed.end());
+            }
+            // Progress was made before failing, so the pipeline itself is not broken
+            p.failures = (blamed > 0) ? 1 : p.failures + 1;
+            if (max_failures > 0 && p.failures >= max_failures) {
+                retire(pipeline);
+            }
+        }
+
+        p.handed.clear();
+        p.begun = 0;
+        outcome.retired = p.retired;
+        return outcome;
+    }
+
+    /// Stop giving pairs to the pipeline, i.e. it could not be set up
+    void retire(size_t pipeline)
+    {
+        Pipeline& p = pipelines[pipeline];
+        if (!p.retired) {
+            p.retired = true;
+            ++groups[p.group].retired;
+        }
+    }
+
+    bool retired(size_t pipeline) const
+    {
+        return pipelines[pipeline].retired;
+    }
+
+    /// Take out the pairs that no pipeline can transfer anymore,
+    /// because all the pipelines of their group have been retired
+    std::vector<size_t> orphans()
+    {
+        std::vector<size_t> pairs;
+        for (auto g = groups.begin(); g != groups.end(); ++g) {
+            if (g->retired >= g->pipelines) {
+                pairs.insert(pairs.end(), g->queue.begin(), g->queue.end());
+                g->queue.clear();
+            }
+        }
+        return pairs;
+    }
+
+private:
+    struct Group {
+        Group(const std::string& key): key(key), pipelines(0), retired(0) {}
+
+        std::string key;
+        std::deque<size_t> queue;
+        size_t pipelines, retired;
+    };
+
+    struct Pipeline {
+        Pipeline(size_t group): group(group), begun(0), failures(0), retired(false) {}
+
+        size_t group;
+        std::vector<size_t> handed;   // pairs given to the running operation, in order
+        size_t begun;                 // how many of them have been started
+        unsigned failures;            // consecutive failed operations
+        bool retired;
+    };
+
+    const size_t max_pipelines;
+    const unsigned max_failures;
+
+    std::vector<Group> groups;
+    std::map<std::string, size_t> group_index;
+    std::vector<Pipeline> pipelines;
+};
+
+#endif // GRIDFTP_BULK_SCHEDULER_H
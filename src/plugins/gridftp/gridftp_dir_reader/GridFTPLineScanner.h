@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GRIDFTP_LINE_SCANNER_H
+#define GRIDFTP_LINE_SCANNER_H
+
+#include <sys/types.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+/// Split a listing stream into lines, without copying them.
+/// Data is read in large chunks, and lines are returned as pointers into the
+/// buffer, NUL terminated in place. Only a line split between two chunks is moved,
+/// to the beginning of the buffer, before reading the next chunk.
+class GridFTPLineScanner {
+public:
+    /// Read up to size bytes into buffer, returning 0 at the end of the stream.
+    /// Errors are reported throwing.
+    typedef std::function<ssize_t(char* buffer, size_t size)> Reader;
+
+    GridFTPLineScanner(Reader reader, size_t buffer_size = 262144):
+        reader(reader), buffer(std::max<size_t>(buffer_size, 2) + 1), begin(0), end(0), eof(false)
+    {
+    }
+
+    /// Read the first chunk, so errors from the server surface early
+    void fill()
+    {
+        if (begin == end && !eof) {
+            read_more();
+        }
+    }
+
+    /// Return the next line, stripped from surrounding whitespaces and the end of line,
+    /// or NULL at the end of the stream.
+    /// The line can be modified in place, and it is valid until the next call.
+    char* next_line(size_t* length = NULL)
+    {
+        while (true) {
+            char* data = buffer.data();
+            char* newline = static_cast<char*>(memchr(data + begin, '\n', end - begin));
+            if (newline) {
+                char* line = data + begin;
+                begin = newline + 1 - data;
+                return trim(line, newline, length);
+            }
+            if (eof) {
+                if (begin == end) {
+                    return NULL;
+                }
+                char* line = data + begin;
+                begin = end;
+                // buffer has an extra byte for this terminator
+                return trim(line, data + end, length);
+            }
+            read_more();
+        }
+    }
+
+private:
+    Reader reader;
+    std::vector<char> buffer;
+    size_t begin, end;
+    bool eof;
+
+    void read_more()
+    {
+        // Move the beginning of an incomplete line to the front
+        if (begin > 0) {
+            memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        // A single line bigger than the buffer
+        size_t capacity = buffer.size() - 1;
+        if (end == capacity) {
+            buffer.resize(capacity * 2 + 1);
+            capacity = buffer.size() - 1;
+        }
+        ssize_t ret = reader(buffer.data() + end, capacity - end);
+        if (ret <= 0) {
+            eof = true;
+        }
+        else {
+            end += ret;
+        }
+    }
+
+    static char* trim(char* line, char* line_end, size_t* length)
+    {
+        while (line < line_end && isspace(*line)) {
+            ++line;
+        }
+        while (line_end > line && isspace(line_end[-1])) {
+            --line_end;
+        }
+        *line_end = '\0';
+        if (length) {
+            *length = line_end - line;
+        }
+        return line;
+    }
+};
+
+#endif // GRIDFTP_LINE_SCANNER_H
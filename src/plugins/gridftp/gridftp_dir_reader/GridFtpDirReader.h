@@ -25,7 +25,8 @@
 #include <dirent.h>
 #include <sys/stat.h>
 
-#include "GridFTPStreamBuffer.h"
+#include "GridFTPLineScanner.h"
+#include "../gridftpwrapper.h"
 #include "../gridftpmodule.h"
 #include "../gridftp_parsing.h"
 
@@ -37,17 +38,26 @@ protected:
     GridFTPSessionHandler* handler;
     GridFTPRequestState* request_state;
     GridFTPStreamState *stream_state;
-    GridFTPStreamBuffer  *stream_buffer;
+    GridFTPLineScanner *line_scanner;
+
+    // Start splitting the listing in lines, once the request has been sent
+    void start_scanner(GQuark quark) {
+        GridFTPStreamState* stream = this->stream_state;
+        this->line_scanner = new GridFTPLineScanner([stream, quark](char* buffer, size_t size) {
+            return gridftp_read_stream(quark, stream, buffer, size, false);
+        });
+        this->line_scanner->fill();
+    }
 
 public:
     GridFtpDirReader():
-        handler(NULL), request_state(NULL), stream_state(NULL), stream_buffer(NULL)
+        handler(NULL), request_state(NULL), stream_state(NULL), line_scanner(NULL)
     {
         memset(&dbuffer, 0, sizeof(dbuffer));
     };
 
     virtual ~GridFtpDirReader() {
-        delete this->stream_buffer;
+        delete this->line_scanner;
         delete this->stream_state;
         delete this->request_state;
         delete this->handler;
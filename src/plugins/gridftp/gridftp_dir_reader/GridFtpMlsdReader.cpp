@@ -18,6 +18,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include "GridFtpDirReader.h"
 
 static const GQuark GridFtpMlsdReaderQuark = g_quark_from_static_string("GridftpSimpleListReader::readdir");
@@ -40,7 +41,7 @@ GridFtpMlsdReader::GridFtpMlsdReader(GridFTPModule* gsiftp, const char* path)
             this->request_state);
     gfal_globus_check_result(GridFtpMlsdReaderQuark, res);
 
-    this->stream_buffer = new GridFTPStreamBuffer(this->stream_state, GridFtpMlsdReaderQuark);
+    start_scanner(GridFtpMlsdReaderQuark);
 
     gfal2_log(G_LOG_LEVEL_DEBUG, " <- [GridftpListReader::GridftpListReader]");
 }
@@ -59,48 +60,20 @@ struct dirent* GridFtpMlsdReader::readdir()
 }
 
 
-static std::string& ltrim(std::string& str)
-{
-    size_t i = 0;
-    while (i < str.length() && isspace(str[i]))
-        ++i;
-    str = str.substr(i);
-    return str;
-}
-
-
-static std::string& rtrim(std::string& str)
-{
-    int i = str.length() - 1;
-    while (i >= 0 && isspace(str[i]))
-        --i;
-    str = str.substr(0, i + 1);
-    return str;
-}
-
-static std::string& trim(std::string& str)
-{
-    return ltrim(rtrim(str));
-}
-
-
 struct dirent* GridFtpMlsdReader::readdirpp(struct stat* st)
 {
-    std::string line;
-    std::istream in(stream_buffer);
-    if (!std::getline(in, line))
-        return NULL;
-
-    if (trim(line).empty())
+    size_t length;
+    char* line = line_scanner->next_line(&length);
+    if (line == NULL || length == 0)
         return NULL;
 
-    char* unparsed = strdup(line.c_str());
-    if (parse_mlst_line(unparsed, st, dbuffer.d_name, sizeof(dbuffer.d_name)) != GLOBUS_SUCCESS) {
-        free(unparsed);
+    // The line is parsed in place
+    if (parse_mlst_line(line, st, dbuffer.d_name, sizeof(dbuffer.d_name)) != GLOBUS_SUCCESS) {
+        // The parser may have split it already
+        std::replace(line, line + length, '\0', ' ');
         throw Gfal::CoreException(GridFtpMlsdReaderQuark, EINVAL,
-                std::string("Error parsing GridFTP line: '").append(line).append("\'"));
+                std::string("Error parsing GridFTP line: '").append(line, length).append("\'"));
     }
-    free(unparsed);
 
     if (dbuffer.d_name[0] == '\0')
         return NULL;
@@ -41,7 +41,7 @@ GridFtpSimpleListReader::GridFtpSimpleListReader(GridFTPModule* gsiftp, const ch
             this->request_state);
     gfal_globus_check_result(GridFTPSimpleReaderQuark, res);
 
-    stream_buffer = new GridFTPStreamBuffer(this->stream_state, GridFTPSimpleReaderQuark);
+    start_scanner(GridFTPSimpleReaderQuark);
 
     gfal2_log(G_LOG_LEVEL_DEBUG, " <- [GridftpSimpleListReader::GridftpSimpleListReader]");
 }
@@ -53,34 +53,16 @@ GridFtpSimpleListReader::~GridFtpSimpleListReader()
 }
 
 
-// try to extract dir information
-static int gridftp_readdir_parser(const std::string& line, struct dirent* entry)
-{
-    memset(entry->d_name, 0, sizeof(entry->d_name));
-    g_strlcpy(entry->d_name, line.c_str(), sizeof(entry->d_name));
-    char *p = stpncpy(entry->d_name, line.c_str(), sizeof(entry->d_name));
-    // clear new line madness
-    do {
-        *p = '\0';
-        --p;
-    } while (p >= entry->d_name && isspace(*p));
-    return 0;
-}
-
-
 struct dirent* GridFtpSimpleListReader::readdir()
 {
     gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridftpSimpleListReader::readdir]");
 
-    std::string line;
-    std::istream in(stream_buffer);
-    if (!std::getline(in, line))
+    char* line = line_scanner->next_line();
+    if (line == NULL)
         return NULL;
 
-    if (gridftp_readdir_parser(line, &dbuffer) != 0) {
-        throw Gfal::CoreException(GridFTPSimpleReaderQuark, EINVAL,
-                std::string("Error parsing GridFTP line: ").append(line));
-    }
+    // The scanner already strips the end of line
+    g_strlcpy(dbuffer.d_name, line, sizeof(dbuffer.d_name));
 
     if (dbuffer.d_name[0] == '\0')
         return NULL;
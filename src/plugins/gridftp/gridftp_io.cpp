@@ -25,6 +25,7 @@
 #include "gridftp_io.h"
 #include "gridftp_namespace.h"
 #include "gridftp_plugin.h"
+#include "gridftp_read_cache.h"
 
 static const GQuark GFAL_GRIDFTP_SCOPE_OPEN = g_quark_from_static_string("GridFTPModule::open");
 static const GQuark GFAL_GRIDFTP_SCOPE_READ = g_quark_from_static_string("GridFTPModule::read");
@@ -46,23 +47,32 @@ struct GridFTPFileDesc {
     std::string url;
     globus_mutex_t mutex;
 
+    // session kept for the partial reads, and the blocks read with it
+    GridFTPSessionHandler* pread_handler;
+    GridFTPReadCache* read_cache;
+    globus_mutex_t pread_mutex;
+
     GridFTPFileDesc(GridFTPSessionHandler* h, GridFTPRequestState* r,
             GridFTPStreamState * s, const std::string & _url, int flags) :
-            handler(h), request(r), stream(s)
+            handler(h), request(r), stream(s), pread_handler(NULL), read_cache(NULL)
     {
         gfal2_log(G_LOG_LEVEL_DEBUG, "create descriptor for %s", _url.c_str());
         this->open_flags = flags;
         current_offset = 0;
         url = _url;
         globus_mutex_init(&mutex, NULL);
+        globus_mutex_init(&pread_mutex, NULL);
     }
 
     virtual ~GridFTPFileDesc()
     {
         gfal2_log(G_LOG_LEVEL_DEBUG, "destroy descriptor for %s", url.c_str());
+        delete read_cache;
+        delete pread_handler;
         delete stream;
         delete request;
         delete handler;
+        globus_mutex_destroy(&pread_mutex);
         globus_mutex_destroy(&mutex);
     }
 
@@ -111,37 +121,105 @@ inline int gridftp_rw_commit_put(GQuark scope, GridFTPFileDesc* desc)
 
 
 // internal pread, do a read query with offset on a different descriptor, do not change the position of the current one.
+// The session is kept with the descriptor, so consecutive calls do not pay for its setup again.
+// While it is busy, concurrent calls use a session of their own rather than waiting for it.
 ssize_t gridftp_rw_internal_pread(GridFTPFactory * factory,
         GridFTPFileDesc* desc, void* buffer, size_t s_buff, off_t offset)
 {
     // throw Gfal::CoreException
     gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridFTPModule::internal_pread]");
 
-    GridFTPSessionHandler handler(factory, desc->url);
-    GridFTPRequestState request_state(&handler);
-    GridFTPStreamState stream_state(&handler);
+    const bool kept_session = (globus_mutex_trylock(&desc->pread_mutex) == 0);
+    std::unique_ptr<GridFTPSessionHandler> own_handler;
+    ssize_t r_size;
+    try {
+        GridFTPSessionHandler* handler;
+        if (kept_session) {
+            if (desc->pread_handler == NULL) {
+                desc->pread_handler = new GridFTPSessionHandler(factory, desc->url);
+            }
+            handler = desc->pread_handler;
+        }
+        else {
+            own_handler.reset(new GridFTPSessionHandler(factory, desc->url));
+            handler = own_handler.get();
+        }
+        GridFTPRequestState request_state(handler);
+        GridFTPStreamState stream_state(handler);
 
-    globus_result_t res = globus_ftp_client_partial_get(
-            handler.get_ftp_client_handle(), desc->url.c_str(),
-            handler.get_ftp_client_operationattr(),
-            NULL, offset, offset + s_buff,
-            globus_ftp_client_done_callback, &request_state);
-    gfal_globus_check_result(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, res);
+        globus_result_t res = globus_ftp_client_partial_get(
+                handler->get_ftp_client_handle(), desc->url.c_str(),
+                handler->get_ftp_client_operationattr(),
+                NULL, offset, offset + s_buff,
+                globus_ftp_client_done_callback, &request_state);
+        gfal_globus_check_result(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, res);
 
-    ssize_t r_size = gridftp_read_stream(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, &stream_state, buffer, s_buff, true);
+        r_size = gridftp_read_stream(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD, &stream_state, buffer, s_buff, true);
+
+        request_state.wait(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD);
+    }
+    catch (...) {
+        if (kept_session) {
+            // Do not keep a session in an unknown state
+            delete desc->pread_handler;
+            desc->pread_handler = NULL;
+            globus_mutex_unlock(&desc->pread_mutex);
+        }
+        throw;
+    }
+    if (kept_session) {
+        globus_mutex_unlock(&desc->pread_mutex);
+    }
 
-    request_state.wait(GFAL_GRIDFTP_SCOPE_INTERNAL_PREAD);
     gfal2_log(G_LOG_LEVEL_DEBUG, "[GridFTPModule::internal_pread] <-");
     return r_size;
+}
+
+
+// pread through the block cache, if enabled for the descriptor
+static ssize_t gridftp_rw_pread(GridFTPFactory * factory,
+        GridFTPFileDesc* desc, void* buffer, size_t s_buff, off_t offset)
+{
+    if (desc->read_cache) {
+        return desc->read_cache->pread(buffer, s_buff, offset);
+    }
+    return gridftp_rw_internal_pread(factory, desc, buffer, s_buff, offset);
+}
 
+
+static GridFTPReadCache* gridftp_read_cache_new(GridFTPFactory * factory, GridFTPFileDesc* desc)
+{
+    gfal2_context_t context = factory->get_gfal2_context();
+    if (!gfal2_get_opt_boolean_with_default(context, GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_PREAD_CACHE, TRUE)) {
+        return NULL;
+    }
+    gint block_size = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_PREAD_BLOCK_SIZE, 65536);
+    gint blocks = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_PREAD_CACHE_BLOCKS, 256);
+    gint readahead = gfal2_get_opt_integer_with_default(context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_PREAD_READAHEAD, 128);
+    if (block_size <= 0 || blocks <= 0) {
+        return NULL;
+    }
+    return new GridFTPReadCache(
+        [factory, desc](char* buffer, size_t size, off_t offset) {
+            return gridftp_rw_internal_pread(factory, desc, buffer, size, offset);
+        },
+        block_size, blocks, std::max(readahead, 0));
 }
 
+
 // internal pwrite, do a write query with offset on a different descriptor, do not change the position of the current one.
 ssize_t gridftp_rw_internal_pwrite(GridFTPFactory * factory,
         GridFTPFileDesc* desc, const void* buffer, size_t s_buff, off_t offset)
 { // throw Gfal::CoreException
     gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridFTPModule::internal_pwrite]");
 
+    if (desc->read_cache) {
+        desc->read_cache->invalidate();
+    }
+
     GridFTPSessionHandler handler(factory, desc->url);
     GridFTPRequestState request_state(&handler);
     GridFTPStreamState stream(&handler);
@@ -171,6 +249,9 @@ gfal_file_handle GridFTPModule::open(const char* url, int flag, mode_t mode)
     GridFTPRequestState* request = new GridFTPRequestState(handler);
 
     std::unique_ptr<GridFTPFileDesc> desc(new GridFTPFileDesc(handler, request, stream, url, flag));
+    if (!is_write_only(flag)) {
+        desc->read_cache = gridftp_read_cache_new(_handle_factory, desc.get());
+    }
 
     gfal2_log(G_LOG_LEVEL_DEBUG, " -> [GridFTPModule::open] ");
     globus_result_t res;
@@ -230,7 +311,7 @@ ssize_t GridFTPModule::read(gfal_file_handle handle, void* buffer, size_t count)
         }
         else {
             gfal2_log(G_LOG_LEVEL_DEBUG, " read with a pread ... ");
-            ret = gridftp_rw_internal_pread(_handle_factory, desc, buffer, count, desc->current_offset);
+            ret = gridftp_rw_pread(_handle_factory, desc, buffer, count, desc->current_offset);
         }
     }
     catch (...) {
@@ -274,7 +355,7 @@ ssize_t GridFTPModule::pread(gfal_file_handle handle, void* buffer,
         size_t count, off_t offset)
 {
     GridFTPFileDesc* desc = static_cast<GridFTPFileDesc*>(gfal_file_handle_get_fdesc(handle));
-    return gridftp_rw_internal_pread(_handle_factory, desc, buffer, count, offset);
+    return gridftp_rw_pread(_handle_factory, desc, buffer, count, offset);
 }
 
 
@@ -354,6 +354,10 @@ ssize_t GridFTPModule::getxattr(const char *path,
                 "Invalid path argument");
     }
 
+    if (strcmp(name, GRIDFTP_XATTR_SESSION_POOL) == 0) {
+        return get_session_pool_stats((char*)buff, s_buff);
+    }
+
     if (strncmp(name, GFAL_XATTR_SPACETOKEN, 10) != 0) {
         std::stringstream msg;
         msg << "'" << name << "' extended attributed not supported by GridFTP plugin";
@@ -430,6 +434,24 @@ ssize_t GridFTPModule::getxattr(const char *path,
 }
 
 
+ssize_t GridFTPModule::get_session_pool_stats(char *buff, size_t s_buff)
+{
+    SessionPoolStats stats = _handle_factory->get_pool_stats();
+    int size = snprintf(buff, s_buff,
+        "{\"hits\": %lu, \"misses\": %lu, \"evictions\": %lu, \"expirations\": %lu, "
+        "\"unhealthy\": %lu, \"idle\": %lu, \"endpoints\": %lu, "
+        "\"handshakes\": %lu, \"handshake_time\": %.6f}",
+        stats.hits, stats.misses, stats.evictions, stats.expirations,
+        stats.unhealthy, stats.idle, stats.endpoints,
+        stats.handshakes, stats.handshake_time);
+    if (size < 0 || (size_t)size >= s_buff) {
+        throw Gfal::CoreException(GFAL_GRIDFTP_SCOPE_GETXATTR, ERANGE,
+                "Buffer too small for the session pool statistics");
+    }
+    return size;
+}
+
+
 extern "C" ssize_t gfal_gridftp_getxattrG(plugin_handle handle, const char* path,
         const char *name, void *buff, size_t s_buff, GError** err)
 {
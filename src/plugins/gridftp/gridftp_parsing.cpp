@@ -16,6 +16,7 @@
 
 #include "gridftp_parsing.h"
 
+#include <cctype>
 #include <cstdio>
 #include <cstring>
 #include <glib.h>
@@ -27,96 +28,60 @@
 #include <gfal_api.h>
 
 
-// Adapted from http://cvs.globus.org/viewcvs.cgi/gass/copy/source/globus_gass_copy_glob.c
-static int copy_mdtm_to_timet(char * mdtm_str, int * time_out)
+// Parse n digits, returns -1 if there are not enough
+static int parse_digits(const char* p, int n)
 {
-    char * p;
-    struct tm tm;
-    struct tm gmt_now_tm;
-    struct tm * gmt_now_tm_p;
-    time_t offset;
-    time_t gmt_now;
-    time_t now;
-    time_t file_time;
-    int rc;
-
-    p = mdtm_str;
-
-    memset(&tm, '\0', sizeof(struct tm));
-
-    /* 4 digit year */
-    rc = sscanf(p, "%04d", &tm.tm_year);
-    if (rc != 1) {
-        goto error_exit;
-    }
-    tm.tm_year -= 1900;
-    p += 4;
-
-    /* 2 digit month [01-12] */
-    rc = sscanf(p, "%02d", &tm.tm_mon);
-    if (rc != 1) {
-        goto error_exit;
+    int value = 0;
+    for (int i = 0; i < n; ++i) {
+        if (!isdigit(static_cast<unsigned char>(p[i]))) {
+            return -1;
+        }
+        value = value * 10 + (p[i] - '0');
     }
-    tm.tm_mon--;
-    p += 2;
+    return value;
+}
 
-    /* 2 digit day/month [01-31] */
-    rc = sscanf(p, "%02d", &tm.tm_mday);
-    if (rc != 1) {
-        goto error_exit;
-    }
-    p += 2;
 
-    /* 2 digit hour [00-23] */
-    rc = sscanf(p, "%02d", &tm.tm_hour);
-    if (rc != 1) {
-        goto error_exit;
-    }
-    p += 2;
+// MDTM timestamps are YYYYMMDDHHMMSS, in UTC
+// This runs once per entry when listing, so avoid sscanf and mktime, which are expensive
+static int copy_mdtm_to_timet(const char * mdtm_str, int * time_out)
+{
+    struct tm tm;
+    memset(&tm, '\0', sizeof(struct tm));
 
-    /* 2 digit minute [00-59] */
-    rc = sscanf(p, "%02d", &tm.tm_min);
-    if (rc != 1) {
-        goto error_exit;
+    // Fields in order, with their offset, width, and range. Stop at the first bad one,
+    // so a short string is not read past its end
+    static const struct {
+        int offset, width, min, max;
+    } fields[] = {
+        {0, 4, 0, 9999},    // year
+        {4, 2, 1, 12},      // month
+        {6, 2, 1, 31},      // day
+        {8, 2, 0, 23},      // hour
+        {10, 2, 0, 59},     // minute
+        {12, 2, 0, 60},     // second, leap seconds included
+    };
+    int values[6];
+    for (int i = 0; i < 6; ++i) {
+        values[i] = parse_digits(mdtm_str + fields[i].offset, fields[i].width);
+        if (values[i] < fields[i].min || values[i] > fields[i].max) {
+            return -1;
+        }
     }
-    p += 2;
 
-    /* 2 digit second [00-60] */
-    rc = sscanf(p, "%02d", &tm.tm_sec);
-    if (rc != 1) {
-        goto error_exit;
-    }
-    p += 2;
+    tm.tm_year = values[0] - 1900;
+    tm.tm_mon = values[1] - 1;
+    tm.tm_mday = values[2];
+    tm.tm_hour = values[3];
+    tm.tm_min = values[4];
+    tm.tm_sec = values[5];
 
-    file_time = mktime(&tm);
+    time_t file_time = timegm(&tm);
     if (file_time == (time_t) -1) {
-        goto error_exit;
-    }
-
-    now = time(&now);
-    if (now == (time_t) -1) {
-        goto error_exit;
-    }
-
-    memset(&gmt_now_tm, '\0', sizeof(struct tm));
-    gmt_now_tm_p = globus_libc_gmtime_r(&now, &gmt_now_tm);
-    if (gmt_now_tm_p == NULL) {
-        goto error_exit;
+        return -1;
     }
-
-    gmt_now = mktime(&gmt_now_tm);
-    if (gmt_now == (time_t) -1) {
-        goto error_exit;
-    }
-
-    offset = now - gmt_now;
-
-    *time_out = file_time + offset;
-
+    *time_out = file_time;
     return 0;
-
-    error_exit:
-    return -1;
 }
 
 
@@ -212,25 +177,25 @@ globus_result_t parse_mlst_line(char *line, struct stat *stat_info, char *filena
                 type = GLOBUS_GASS_COPY_GLOB_ENTRY_OTHER;
             }
         }
-        if (strcmp(startfact, "unique") == 0) {
+        else if (strcmp(startfact, "unique") == 0) {
             unique_id = factval;
         }
-        if (strcmp(startfact, "unix.mode") == 0) {
+        else if (strcmp(startfact, "unix.mode") == 0) {
             mode_s = factval;
         }
-        if (strcmp(startfact, "modify") == 0) {
+        else if (strcmp(startfact, "modify") == 0) {
             modify_s = factval;
         }
-        if (strcmp(startfact, "size") == 0) {
+        else if (strcmp(startfact, "size") == 0) {
             size_s = factval;
         }
-        if (strcmp(startfact, "unix.slink") == 0) {
+        else if (strcmp(startfact, "unix.slink") == 0) {
             symlink_target = factval;
         }
-        if (strcmp(startfact, "unix.uid") == 0) {
+        else if (strcmp(startfact, "unix.uid") == 0) {
             stat_info->st_uid = atoi(factval);
         }
-        if (strcmp(startfact, "unix.gid") == 0) {
+        else if (strcmp(startfact, "unix.gid") == 0) {
             stat_info->st_gid = atoi(factval);
         }
 
@@ -254,11 +219,9 @@ globus_result_t parse_mlst_line(char *line, struct stat *stat_info, char *filena
     }
 
     if (size_s) {
-        off_t size;
-        int rc;
-
-        rc = sscanf(size_s, "%ld", &size);
-        if (rc == 1) {
+        char* size_end;
+        off_t size = strtoll(size_s, &size_end, 10);
+        if (size_end != size_s) {
             stat_info->st_size = size;
         }
     }
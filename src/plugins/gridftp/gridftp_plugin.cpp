@@ -29,6 +29,9 @@
 extern "C"{
 
 
+static const char* const gridftp_url_schemes[] = {"gsiftp", "ftp", NULL};
+
+
 static bool is_gridftp_uri(const char* src)
 {
     static const char gridftp_prefix[] = "gsiftp://";
@@ -137,6 +140,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err)
 
     ret.plugin_data = r;
     ret.check_plugin_url = &gridftp_check_url;
+    ret.url_schemes = gridftp_url_schemes;
     ret.plugin_delete = &gridftp_plugin_unload;
     ret.getName = &gridftp_plugin_name;
     ret.accessG = &gfal_gridftp_accessG;
@@ -37,12 +37,23 @@
 #define GRIDFTP_CONFIG_BLOCK_SIZE     "BLOCK_SIZE"
 #define GRIDFTP_CONFIG_NB_STREAM      "RD_NB_STREAM"
 #define GRIDFTP_CONFIG_RESOLVE_DNS    "RESOLVE_DNS"
+#define GRIDFTP_CONFIG_SESSION_CACHE_SIZE         "SESSION_CACHE_SIZE"
+#define GRIDFTP_CONFIG_SESSION_CACHE_PER_ENDPOINT "SESSION_CACHE_PER_ENDPOINT"
+#define GRIDFTP_CONFIG_SESSION_IDLE_TIMEOUT       "SESSION_IDLE_TIMEOUT"
+#define GRIDFTP_CONFIG_PREAD_CACHE        "PREAD_CACHE"
+#define GRIDFTP_CONFIG_PREAD_BLOCK_SIZE   "PREAD_BLOCK_SIZE"
+#define GRIDFTP_CONFIG_PREAD_CACHE_BLOCKS "PREAD_CACHE_BLOCKS"
+#define GRIDFTP_CONFIG_PREAD_READAHEAD    "PREAD_READAHEAD"
+#define GRIDFTP_CONFIG_BULK_PIPELINES              "BULK_PIPELINES"
+#define GRIDFTP_CONFIG_BULK_PIPELINE_MAX_FAILURES  "BULK_PIPELINE_MAX_FAILURES"
 
 #define GRIDFTP_CONFIG_TRANSFER_CHECKSUM       "COPY_CHECKSUM_TYPE"
 #define GRIDFTP_CONFIG_TRANSFER_PERF_TIMEOUT   "PERF_MARKER_TIMEOUT"
 #define GRIDFTP_CONFIG_TRANSFER_SKIP_CHECKSUM  "SKIP_SOURCE_CHECKSUM"
 #define GRIDFTP_CONFIG_TRANSFER_UDT            "ENABLE_UDT"
 
+// Extended attributes
+#define GRIDFTP_XATTR_SESSION_POOL    "gridftp.session_pool"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "gridftp_read_cache.h"
+
+
+GridFTPReadCache::GridFTPReadCache(Fetcher fetcher, size_t block_size, size_t max_blocks,
+    size_t max_readahead):
+    fetcher(fetcher), block_size(std::max<size_t>(block_size, 1)),
+    max_blocks(std::max<size_t>(max_blocks, 1)),
+    max_readahead(std::min(max_readahead, std::max<size_t>(max_blocks, 1) - 1)),
+    file_size(-1), last_end(-1), window(0), generation(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+ssize_t GridFTPReadCache::pread(void* buffer, size_t count, off_t offset)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (count == 0 || (file_size >= 0 && offset >= file_size)) {
+        return 0;
+    }
+
+    // Keep growing the read-ahead while the access is sequential
+    if (offset == last_end) {
+        window = std::min(std::max<size_t>(window * 2, 1), max_readahead);
+    }
+    else {
+        window = 0;
+    }
+
+    // Large reads would only flush the cache
+    if (count >= (block_size * max_blocks) / 2) {
+        const unsigned long read_generation = generation;
+        lock.unlock();
+        ssize_t ret = fetcher(static_cast<char*>(buffer), count, offset);
+        lock.lock();
+        ++stats.fetches;
+        stats.fetched += ret;
+        if ((size_t)ret < count && read_generation == generation) {
+            file_size = offset + ret;
+        }
+        last_end = offset + ret;
+        return ret;
+    }
+
+    char* out = static_cast<char*>(buffer);
+    size_t done = 0;
+    const off_t last_index = (offset + count - 1) / block_size;
+    const size_t read_window = window;
+    std::vector<char> fetched;
+
+    while (done < count) {
+        off_t position = offset + done;
+        off_t index = position / block_size;
+
+        const char* data;
+        size_t size;
+        const Block* block = lookup(index);
+        if (block) {
+            ++stats.hits;
+            data = block->data.data();
+            size = block->data.size();
+        }
+        else {
+            if (!fetch(lock, index, last_index, last_index + read_window, fetched)) {
+                break;
+            }
+            data = fetched.data();
+            size = std::min(block_size, fetched.size());
+        }
+
+        size_t in_block = position - index * block_size;
+        if (in_block >= size) {
+            break;
+        }
+        size_t n = std::min(size - in_block, count - done);
+        memcpy(out + done, data + in_block, n);
+        done += n;
+
+        // Short block, end of file
+        if (size < block_size) {
+            break;
+        }
+    }
+
+    last_end = offset + done;
+    return done;
+}
+
+
+void GridFTPReadCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    blocks.clear();
+    file_size = -1;
+    last_end = -1;
+    window = 0;
+    ++generation;
+}
+
+
+GridFTPReadCache::Stats GridFTPReadCache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+
+const GridFTPReadCache::Block* GridFTPReadCache::lookup(off_t index)
+{
+    auto i = blocks.find(index);
+    if (i == blocks.end()) {
+        return NULL;
+    }
+    lru.splice(lru.begin(), lru, i->second);
+    return &(*i->second);
+}
+
+
+// Fetch the block first, plus the following missing blocks up to last, which must be read anyway,
+// and up to limit, which are read-ahead. Stops at the first block already cached.
+// The lock is released while fetching, so hits are served meanwhile. The data is left in buffer,
+// and cached unless the cache was invalidated in between.
+// Returns false if first is past the end of the file.
+bool GridFTPReadCache::fetch(std::unique_lock<std::mutex>& lock, off_t first, off_t last, off_t limit,
+    std::vector<char>& buffer)
+{
+    off_t end = first + 1;
+    while (end <= std::max(last, limit) && (size_t)(end - first) < max_blocks &&
+           blocks.find(end) == blocks.end()) {
+        ++end;
+    }
+    if (file_size >= 0) {
+        end = std::min<off_t>(end, (file_size + block_size - 1) / block_size);
+        if (end <= first) {
+            return false;
+        }
+    }
+
+    const unsigned long fetch_generation = generation;
+    size_t size = (end - first) * block_size;
+    buffer.resize(size);
+
+    lock.unlock();
+    ssize_t ret = fetcher(buffer.data(), size, first * block_size);
+    lock.lock();
+
+    buffer.resize(ret);
+    ++stats.fetches;
+    stats.fetched += ret;
+    stats.misses += end - first;
+
+    if (fetch_generation == generation) {
+        if ((size_t)ret < size) {
+            file_size = first * block_size + ret;
+        }
+        for (off_t index = first; index < end; ++index) {
+            size_t start = (index - first) * block_size;
+            if (start >= (size_t)ret) {
+                break;
+            }
+            insert(index, buffer.data() + start, std::min(block_size, ret - start));
+        }
+    }
+    return ret > 0;
+}
+
+
+void GridFTPReadCache::insert(off_t index, const char* data, size_t size)
+{
+    auto existing = blocks.find(index);
+    if (existing != blocks.end()) {
+        lru.erase(existing->second);
+        blocks.erase(existing);
+    }
+    while (lru.size() >= max_blocks) {
+        blocks.erase(lru.back().index);
+        lru.pop_back();
+    }
+    lru.push_front(Block{index, std::vector<char>(data, data + size)});
+    blocks[index] = lru.begin();
+}
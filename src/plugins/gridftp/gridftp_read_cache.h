@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GRIDFTP_READ_CACHE_H
+#define GRIDFTP_READ_CACHE_H
+
+#include <sys/types.h>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+/// Block cache with read-ahead in front of the partial gets of a file handle.
+/// Missing adjacent blocks are fetched with a single request, and when the access
+/// is sequential the request is extended with a read-ahead window that doubles on
+/// each sequential read, up to max_readahead blocks.
+/// Reads larger than half the cache go straight to the fetcher.
+/// The cache is not locked while fetching, so concurrent reads that hit are not held back.
+class GridFTPReadCache {
+public:
+    /// Read up to size bytes at offset, returning less only at the end of the file.
+    /// Errors are reported throwing.
+    typedef std::function<ssize_t(char* buffer, size_t size, off_t offset)> Fetcher;
+
+    struct Stats {
+        unsigned long hits;           // blocks served from the cache
+        unsigned long misses;         // blocks that had to be fetched
+        unsigned long fetches;        // requests done by the fetcher
+        unsigned long long fetched;   // bytes returned by the fetcher
+    };
+
+    GridFTPReadCache(Fetcher fetcher, size_t block_size, size_t max_blocks, size_t max_readahead);
+
+    ssize_t pread(void* buffer, size_t count, off_t offset);
+
+    /// Drop all cached data, i.e. after the file has been written
+    void invalidate();
+
+    Stats get_stats() const;
+
+private:
+    struct Block {
+        off_t index;
+        std::vector<char> data;
+    };
+
+    Fetcher fetcher;
+    const size_t block_size;
+    const size_t max_blocks;
+    const size_t max_readahead;
+
+    mutable std::mutex mutex;
+    // Front is the most recently used
+    std::list<Block> lru;
+    std::unordered_map<off_t, std::list<Block>::iterator> blocks;
+    // File size, when known (a fetch returned less than requested)
+    off_t file_size;
+    // Where the previous read ended, and the current read-ahead window in blocks
+    off_t last_end;
+    size_t window;
+    // Bumped by invalidate, so fetches started before are not cached
+    unsigned long generation;
+    Stats stats;
+
+    const Block* lookup(off_t index);
+    bool fetch(std::unique_lock<std::mutex>& lock, off_t first, off_t last, off_t limit,
+        std::vector<char>& buffer);
+    void insert(off_t index, const char* data, size_t size);
+};
+
+#endif // GRIDFTP_READ_CACHE_H
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifndef GRIDFTP_SESSION_POOL_H
+#define GRIDFTP_SESSION_POOL_H
+
+#include <ctime>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/// Counters exposed by the session pool
+struct SessionPoolStats {
+    unsigned long hits;           // acquire served from the pool
+    unsigned long misses;         // acquire that had to create a new session
+    unsigned long evictions;      // idle sessions dropped because of the size limits
+    unsigned long expirations;    // idle sessions dropped because they were idle for too long
+    unsigned long unhealthy;      // idle sessions dropped because they failed the health check
+    unsigned long handshakes;     // number of handshakes accounted in handshake_time
+    double handshake_time;        // total time spent establishing new sessions, in seconds
+    unsigned long idle;           // sessions currently held by the pool
+    unsigned long endpoints;      // endpoints with at least one idle session
+};
+
+
+/// Pool of idle sessions, indexed by endpoint.
+/// The pool only holds sessions that are not in use: acquire() takes one out,
+/// release() gives it back. When a limit is exceeded, the least recently released
+/// session is evicted, instead of flushing the whole pool.
+/// Sessions are destroyed outside of the pool lock, since closing a connection may block.
+template <typename Session>
+class SessionPool {
+public:
+    typedef std::function<void(Session*)> Deleter;
+    typedef std::function<bool(Session*)> HealthCheck;
+    typedef std::function<time_t()> Clock;
+
+    SessionPool(Deleter deleter, Clock clock = Clock()):
+        deleter(deleter), clock(clock ? clock : Clock(default_clock)),
+        max_idle(400), max_idle_per_endpoint(0), max_idle_time(0)
+    {
+        stats_ = SessionPoolStats();
+    }
+
+    ~SessionPool()
+    {
+        clear();
+    }
+
+    /// Set the limits. A value of 0 means no limit.
+    /// Already pooled sessions are trimmed to the new limits.
+    void configure(size_t total, size_t per_endpoint, time_t idle_time)
+    {
+        std::vector<Session*> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            max_idle = total;
+            max_idle_per_endpoint = per_endpoint;
+            max_idle_time = idle_time;
+            collect_expired(victims);
+            while (max_idle && lru.size() > max_idle) {
+                evict(std::prev(lru.end()), victims);
+                ++stats_.evictions;
+            }
+            if (max_idle_per_endpoint) {
+                for (auto i = index.begin(); i != index.end();) {
+                    auto current = i++;
+                    while (current->second.size() > max_idle_per_endpoint) {
+                        ++stats_.evictions;
+                        if (evict(current->second.back(), victims)) {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        destroy(victims);
+    }
+
+    /// Take an idle session for the endpoint, or NULL if there is none.
+    /// The most recently released session is preferred, since its connection is the
+    /// most likely to be still alive. Candidates failing the health check are destroyed.
+    Session* acquire(const std::string& endpoint, const HealthCheck& healthy = HealthCheck())
+    {
+        std::vector<Session*> victims;
+        Session* session = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            collect_expired(victims);
+            while (session == NULL) {
+                auto i = index.find(endpoint);
+                if (i == index.end()) {
+                    break;
+                }
+                Session* candidate = unlink(i->second.front());
+
+                // The health check may be expensive, do not hold the lock meanwhile
+                lock.unlock();
+                bool ok = !healthy || healthy(candidate);
+                lock.lock();
+
+                if (ok) {
+                    session = candidate;
+                }
+                else {
+                    victims.push_back(candidate);
+                    ++stats_.unhealthy;
+                }
+            }
+            if (session) {
+                ++stats_.hits;
+            }
+            else {
+                ++stats_.misses;
+            }
+        }
+        destroy(victims);
+        return session;
+    }
+
+    /// Give back a session to the pool
+    void release(const std::string& endpoint, Session* session)
+    {
+        std::vector<Session*> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            collect_expired(victims);
+
+            lru.push_front(Entry{endpoint, session, clock()});
+            std::list<EntryIterator>& endpoint_entries = index[endpoint];
+            endpoint_entries.push_front(lru.begin());
+
+            if (max_idle_per_endpoint && endpoint_entries.size() > max_idle_per_endpoint) {
+                evict(endpoint_entries.back(), victims);
+                ++stats_.evictions;
+            }
+            while (max_idle && lru.size() > max_idle) {
+                evict(std::prev(lru.end()), victims);
+                ++stats_.evictions;
+            }
+        }
+        destroy(victims);
+    }
+
+    /// Destroy a session taken from the pool that turned out to be unusable
+    void discard(Session* session)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats_.unhealthy;
+        }
+        deleter(session);
+    }
+
+    /// Account for the time spent establishing a new session
+    void record_handshake(double seconds)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats_.handshakes;
+        stats_.handshake_time += seconds;
+    }
+
+    /// Destroy the sessions that have been idle for too long
+    void expire()
+    {
+        std::vector<Session*> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            collect_expired(victims);
+        }
+        destroy(victims);
+    }
+
+    /// Destroy all idle sessions
+    void clear()
+    {
+        std::vector<Session*> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto i = lru.begin(); i != lru.end(); ++i) {
+                victims.push_back(i->session);
+            }
+            lru.clear();
+            index.clear();
+        }
+        destroy(victims);
+    }
+
+    SessionPoolStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SessionPoolStats copy = stats_;
+        copy.idle = lru.size();
+        copy.endpoints = index.size();
+        return copy;
+    }
+
+private:
+    struct Entry {
+        std::string endpoint;
+        Session* session;
+        time_t released;
+    };
+    // Front is the most recently released
+    typedef typename std::list<Entry>::iterator EntryIterator;
+
+    Deleter deleter;
+    Clock clock;
+    size_t max_idle, max_idle_per_endpoint;
+    time_t max_idle_time;
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<std::string, std::list<EntryIterator>> index;
+    SessionPoolStats stats_;
+
+    static time_t default_clock()
+    {
+        return time(NULL);
+    }
+
+    // Remove the entry from the pool, and return its session
+    Session* unlink(EntryIterator entry, bool* last = NULL)
+    {
+        auto i = index.find(entry->endpoint);
+        i->second.remove(entry);
+        if (last) {
+            *last = i->second.empty();
+        }
+        if (i->second.empty()) {
+            index.erase(i);
+        }
+        Session* session = entry->session;
+        lru.erase(entry);
+        return session;
+    }
+
+    // Unlink the entry, queueing its session for destruction.
+    // Returns true if this was the last idle session of its endpoint.
+    bool evict(EntryIterator entry, std::vector<Session*>& victims)
+    {
+        bool last;
+        victims.push_back(unlink(entry, &last));
+        return last;
+    }
+
+    void collect_expired(std::vector<Session*>& victims)
+    {
+        if (max_idle_time <= 0) {
+            return;
+        }
+        time_t now = clock();
+        while (!lru.empty() && now - lru.back().released >= max_idle_time) {
+            evict(std::prev(lru.end()), victims);
+            ++stats_.expirations;
+        }
+    }
+
+    void destroy(std::vector<Session*>& victims)
+    {
+        for (auto i = victims.begin(); i != victims.end(); ++i) {
+            deleter(*i);
+        }
+    }
+};
+
+#endif // GRIDFTP_SESSION_POOL_H
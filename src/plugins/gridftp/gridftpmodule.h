@@ -107,6 +107,9 @@ public:
 private:
     GridFTPFactory * _handle_factory;
 
+    // Serialize the session pool counters as json
+    ssize_t get_session_pool_stats(char *buff, size_t s_buff);
+
 };
 
 
@@ -21,6 +21,7 @@
 #include <memory>
 #include <fstream>
 #include <sstream>
+#include <sys/stat.h>
 #include <uri/gfal2_uri.h>
 #include <exceptions/gfalcoreexception.hpp>
 #include <globus_ftp_client_debug_plugin.h>
@@ -74,13 +75,24 @@ GassCopyAttrHandler::~GassCopyAttrHandler()
 
 GridFTPSessionHandler::GridFTPSessionHandler(GridFTPFactory* f, const std::string &uri): factory(f)
 {
-    this->session = f->get_session(uri);
-
-    GridFTPRequestState req(this);
-    globus_result_t result = globus_ftp_client_feat(&this->session->handle_ftp, (char*)uri.c_str(), &this->session->operation_attr_ftp,
-                           &this->session->ftp_features, globus_ftp_client_done_callback, &req);
-    gfal_globus_check_result(GFAL_GLOBUS_DONE_SCOPE, result);
-    req.wait(GFAL_GLOBUS_DONE_SCOPE);
+    while (true) {
+        this->session = f->get_session(uri);
+        try {
+            request_features(uri);
+            break;
+        }
+        catch (const Gfal::CoreException& e) {
+            // A pooled session may have lost its control connection while idle,
+            // so communication errors get another chance with the next one
+            bool retry = !session->fresh && e.code() == ECOMM;
+            f->discard_session(session);
+            session = NULL;
+            if (!retry) {
+                throw;
+            }
+            gfal2_log(G_LOG_LEVEL_DEBUG, "reused gridftp session failed (%s), try another one", e.what());
+        }
+    }
 
     // Enable SPAS if configured and supported
     gboolean spasEnabled = gfal2_get_opt_boolean_with_default(f->get_gfal2_context(), GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_SPAS, FALSE);
@@ -93,6 +105,27 @@ GridFTPSessionHandler::GridFTPSessionHandler(GridFTPFactory* f, const std::strin
 }
 
 
+void GridFTPSessionHandler::request_features(const std::string &uri)
+{
+    struct timespec start, end, elapsed;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    GridFTPRequestState req(this);
+    globus_result_t result = globus_ftp_client_feat(&this->session->handle_ftp, (char*)uri.c_str(), &this->session->operation_attr_ftp,
+                           &this->session->ftp_features, globus_ftp_client_done_callback, &req);
+    gfal_globus_check_result(GFAL_GLOBUS_DONE_SCOPE, result);
+    req.wait(GFAL_GLOBUS_DONE_SCOPE);
+
+    // On a new session, this is the request that connects and authenticates
+    if (session->fresh) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        timespec_sub(&end, &start, &elapsed);
+        factory->record_handshake(elapsed.tv_sec + elapsed.tv_nsec / 1e9);
+        session->fresh = false;
+    }
+}
+
+
 GridFTPSessionHandler::~GridFTPSessionHandler()
 {
     try {
@@ -110,7 +143,7 @@ GridFTPSessionHandler::~GridFTPSessionHandler()
 
 
 GridFTPSession::GridFTPSession(gfal2_context_t context, const std::string& baseurl):
-        baseurl(baseurl), cred_id(NULL), pasv_plugin(NULL), context(context), params(NULL)
+        baseurl(baseurl), fresh(true), cred_id(NULL), pasv_plugin(NULL), context(context), params(NULL)
 {
     globus_result_t res;
 
@@ -421,7 +454,15 @@ GridFTPFactory* GridFTPSessionHandler::get_factory()
 }
 
 
-GridFTPFactory::GridFTPFactory(gfal2_context_t handle): gfal2_context(handle)
+static void gridftp_session_delete(GridFTPSession* session)
+{
+    gfal2_log(G_LOG_LEVEL_DEBUG, "destroy gridftp session for %s ...", session->baseurl.c_str());
+    delete session;
+}
+
+
+GridFTPFactory::GridFTPFactory(gfal2_context_t handle): gfal2_context(handle),
+        session_pool(gridftp_session_delete)
 {
     GError * tmp_err = NULL;
     session_reuse = gfal2_get_opt_boolean(gfal2_context, GRIDFTP_CONFIG_GROUP,
@@ -431,72 +472,26 @@ GridFTPFactory::GridFTPFactory(gfal2_context_t handle): gfal2_context(handle)
     if (tmp_err) {
         throw Gfal::CoreException(tmp_err);
     }
-    size_cache = 400;
-    globus_mutex_init(&mux_cache, NULL);
+    configure_pool();
 }
 
 
-void GridFTPFactory::clear_cache()
+void GridFTPFactory::configure_pool()
 {
-    globus_mutex_lock(&mux_cache);
-
-    gfal2_log(G_LOG_LEVEL_DEBUG, "gridftp session cache garbage collection ...");
-    std::multimap<std::string, GridFTPSession*>::iterator it;
-    for (it = session_cache.begin(); it != session_cache.end(); ++it) {
-        delete (*it).second;
-    }
-    session_cache.clear();
-    globus_mutex_unlock(&mux_cache);
-}
-
-
-void GridFTPFactory::recycle_session(GridFTPSession* session)
-{
-    globus_mutex_lock(&mux_cache);
-
-    if (session_cache.size() > size_cache) {
-        clear_cache();
-    }
-
-    gfal2_log(G_LOG_LEVEL_DEBUG, "insert gridftp session for %s in cache ...", session->baseurl.c_str());
-    session_cache.insert(std::pair<std::string, GridFTPSession*>(session->baseurl, session));
-    globus_mutex_unlock(&mux_cache);
-}
-
-
-// recycle a gridftp session object from cache if exist, return NULL else
-GridFTPSession* GridFTPFactory::get_recycled_handle(const std::string &baseurl)
-{
-    globus_mutex_lock(&mux_cache);
-
-    GridFTPSession* session = NULL;
-    // try to find a session explicitly associated with this handle
-    std::multimap<std::string, GridFTPSession*>::iterator it = session_cache.find(baseurl);
-
-    // if no session found, take a generic one
-    if (it == session_cache.end()) {
-        gfal2_log(G_LOG_LEVEL_DEBUG,
-                "no session associated with this baseurl, try find generic one .... ");
-        it = session_cache.begin();
-    }
-    if (it != session_cache.end()) {
-        gfal2_log(G_LOG_LEVEL_DEBUG,"gridftp session for: %s found in  cache !", baseurl.c_str());
-        session = (*it).second;
-        session_cache.erase(it);
-    }
-    else {
-        gfal2_log(G_LOG_LEVEL_DEBUG, "no session found in cache for %s!", baseurl.c_str());
-    }
-
-    globus_mutex_unlock(&mux_cache);
-    return session;
+    gint total = gfal2_get_opt_integer_with_default(gfal2_context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_SESSION_CACHE_SIZE, 400);
+    gint per_endpoint = gfal2_get_opt_integer_with_default(gfal2_context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_SESSION_CACHE_PER_ENDPOINT, 20);
+    gint idle_timeout = gfal2_get_opt_integer_with_default(gfal2_context, GRIDFTP_CONFIG_GROUP,
+            GRIDFTP_CONFIG_SESSION_IDLE_TIMEOUT, 300);
+    session_pool.configure(std::max(total, 0), std::max(per_endpoint, 0), std::max(idle_timeout, 0));
 }
 
 
 GridFTPFactory::~GridFTPFactory()
 {
     try {
-        clear_cache();
+        session_pool.clear();
     }
     catch (const std::exception & e) {
         gfal2_log(G_LOG_LEVEL_MESSAGE,
@@ -506,7 +501,18 @@ GridFTPFactory::~GridFTPFactory()
         gfal2_log(G_LOG_LEVEL_MESSAGE,
                 "Caught an unknown exception inside ~GridFTPFactory()!!");
     }
-    globus_mutex_destroy(&mux_cache);
+}
+
+
+void GridFTPFactory::record_handshake(double seconds)
+{
+    session_pool.record_handshake(seconds);
+}
+
+
+SessionPoolStats GridFTPFactory::get_pool_stats() const
+{
+    return session_pool.stats();
 }
 
 
@@ -626,20 +632,51 @@ GridFTPSession* GridFTPFactory::get_new_handle(const std::string &baseurl)
 }
 
 
+// Identify a set of credentials, so sessions authenticated with different ones are not reused
+static std::string gridftp_cred_signature(const char* ucert, const char* ukey,
+    const char *user, const char *passwd)
+{
+    std::stringstream signature;
+    signature << (ucert ? ucert : "") << '|' << (ukey ? ukey : "") << '|'
+              << (user ? user : "") << '|' << (passwd ? passwd : "");
+    // A renewed proxy keeps its path
+    struct stat st;
+    if (ucert && stat(ucert, &st) == 0) {
+        signature << '|' << st.st_mtime << '.' << st.st_size;
+    }
+    return signature.str();
+}
+
+
 GridFTPSession* GridFTPFactory::get_session(const std::string &url)
 {
     gchar *ucert = NULL, *ukey = NULL;
     gchar *user = NULL, *passwd = NULL;
     std::string baseurl = gfal_gridftp_get_credentials(gfal2_context, url, &ucert, &ukey, &user, &passwd);
+    std::string signature = gridftp_cred_signature(ucert, ukey, user, passwd);
 
-    GridFTPSession* session = NULL;
-    if ((session = get_recycled_handle(baseurl)) == NULL) {
-        session = get_new_handle(baseurl);
-        gfal_globus_set_credentials(ucert, ukey, user, passwd, &session->cred_id, &session->operation_attr_ftp);
+    GridFTPSession* session = session_pool.acquire(baseurl, [&signature](GridFTPSession* candidate) {
+        return candidate->cred_signature == signature;
+    });
+
+    if (session != NULL) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "gridftp session for: %s found in cache !", baseurl.c_str());
     }
-    else if (session->baseurl != baseurl) {
-        gfal_globus_set_credentials(ucert, ukey, user, passwd, &session->cred_id, &session->operation_attr_ftp);
-        session->baseurl = baseurl;
+    else {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "no session found in cache for %s!", baseurl.c_str());
+        try {
+            session = get_new_handle(baseurl);
+            gfal_globus_set_credentials(ucert, ukey, user, passwd, &session->cred_id, &session->operation_attr_ftp);
+            session->cred_signature = signature;
+        }
+        catch (...) {
+            delete session;
+            g_free(ucert);
+            g_free(ukey);
+            g_free(user);
+            g_free(passwd);
+            throw;
+        }
     }
 
     g_free(ucert);
@@ -655,11 +692,23 @@ void GridFTPFactory::release_session(GridFTPSession* session)
 {
     session_reuse = gfal2_get_opt_boolean_with_default(gfal2_context, GRIDFTP_CONFIG_GROUP, GRIDFTP_CONFIG_SESSION_REUSE, FALSE);
     if (session_reuse) {
-        recycle_session(session);
+        configure_pool();
+        gfal2_log(G_LOG_LEVEL_DEBUG, "insert gridftp session for %s in cache ...", session->baseurl.c_str());
+        session_pool.release(session->baseurl, session);
     }
     else {
-        gfal2_log(G_LOG_LEVEL_DEBUG, "destroy gridftp session for %s ...", session->baseurl.c_str());
-        delete session;
+        gridftp_session_delete(session);
+    }
+}
+
+
+void GridFTPFactory::discard_session(GridFTPSession* session)
+{
+    if (session->fresh) {
+        gridftp_session_delete(session);
+    }
+    else {
+        session_pool.discard(session);
     }
 }
 
@@ -863,6 +912,12 @@ void gfal_griftp_stream_read_done_callback(void *user_arg,
         // the same size, and there is enough data to fill it.
         // If that's the case, a second callback will be done with EOF, and we need
         // to get it, or waiting for the operation completion will block forever
+        // Data may also come in several chunks, so keep filling after what has been received
+        globus_size_t remaining = state->buffer_size - length;
+        if (remaining > 0) {
+            buffer += length;
+            state->buffer_size = remaining;
+        }
         globus_ftp_client_register_read(
                             handle,
                             buffer,
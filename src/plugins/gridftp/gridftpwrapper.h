@@ -24,6 +24,7 @@
 #include <gfal_api.h>
 #include <exceptions/gfalcoreexception.hpp>
 #include <time_utils.h>
+#include "gridftp_session_pool.h"
 
 #include <ctime>
 #include <algorithm>
@@ -102,6 +103,10 @@ public:
     ~GridFTPSession();
 
     std::string baseurl;
+    // identifies the credentials loaded into cred_id, so a change can be detected on reuse
+    std::string cred_signature;
+    // true until the first request on this session has completed
+    bool fresh;
 
     gss_cred_id_t cred_id;
     globus_ftp_client_handle_t handle_ftp;
@@ -156,6 +161,8 @@ public:
 
 private:
     GridFTPFactory* factory;
+
+    void request_features(const std::string &uri);
 };
 
 
@@ -172,20 +179,28 @@ public:
      **/
     void release_session(GridFTPSession* h);
 
+    /** Drop a session that can not be used anymore (i.e. broken connection)
+     **/
+    void discard_session(GridFTPSession* h);
+
+    /** Account for the time spent in the handshake of a new session
+     **/
+    void record_handshake(double seconds);
+
+    /** Counters of the session pool
+     **/
+    SessionPoolStats get_pool_stats() const;
+
     gfal2_context_t get_gfal2_context();
 
 private:
     gfal2_context_t gfal2_context;
     // session re-use management
     bool session_reuse;
-    unsigned int size_cache;
-    // session cache
-    std::multimap<std::string, GridFTPSession*> session_cache;
-    globus_mutex_t mux_cache;
-
-    void recycle_session(GridFTPSession* sess);
-    void clear_cache();
-    GridFTPSession* get_recycled_handle(const std::string &baseurl);
+    // idle sessions, per endpoint
+    SessionPool<GridFTPSession> session_pool;
+
+    void configure_pool();
     GridFTPSession* get_new_handle(const std::string &baseurl);
 };
 
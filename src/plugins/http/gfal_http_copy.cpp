@@ -28,8 +28,11 @@
 #include <cstdio>
 #include <cstring>
 #include <list>
+#include <memory>
 #include <sstream>
 #include "gfal_http_plugin.h"
+#include "gfal_http_parallel_reader.h"
+#include "gfal_http_s3_multipart.h"
 
 using CopyMode = HttpCopyMode::CopyMode;
 
@@ -584,18 +587,40 @@ struct HttpStreamProvider {
     dav_ssize_t read_instant;
     _gfalt_transfer_status perf;
     GError* stream_err;
+    // When set, the source is read through it instead of source_fd
+    ParallelSourceReader* parallel;
+    std::vector<size_t> stream_last_bytes;
 
     HttpStreamProvider(const char *source, const char *destination,
-                       gfal2_context_t context, int source_fd, gfalt_params_t params) :
+                       gfal2_context_t context, int source_fd, gfalt_params_t params,
+                       ParallelSourceReader* parallel = NULL) :
         source(source), destination(destination),
         context(context), params(params), source_fd(source_fd), start(time(NULL)),
-        last_update(start), read_instant(0), stream_err(NULL)
+        last_update(start), read_instant(0), stream_err(NULL), parallel(parallel)
     {
         memset(&perf, 0, sizeof(perf));
+        if (parallel) {
+            stream_last_bytes.resize(parallel->get_nstreams(), 0);
+        }
     }
 };
 
 
+// Report the throughput of each stream of a parallel read since the last update
+static void gfal_http_streamed_stream_perf(HttpStreamProvider* data, time_t elapsed)
+{
+    std::vector<size_t> bytes = data->parallel->stream_bytes();
+    time_t total_time = std::max<time_t>(data->perf.transfer_time, 1);
+
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        plugin_trigger_event(data->params, http_plugin_domain, GFAL_EVENT_SOURCE, GFAL_EVENT_STREAM_PERF,
+                             "stream=%zu bytes=%zu avg=%zu inst=%zu", i, bytes[i], bytes[i] / total_time,
+                             (bytes[i] - data->stream_last_bytes[i]) / elapsed);
+        data->stream_last_bytes[i] = bytes[i];
+    }
+}
+
+
 static dav_ssize_t gfal_http_streamed_provider(void *userdata,
         void *buffer, dav_size_t buflen)
 {
@@ -611,11 +636,18 @@ static dav_ssize_t gfal_http_streamed_provider(void *userdata,
         data->perf.instant_baudrate = 0;
         data->start = data->last_update = now;
 
-        if (gfal2_lseek(data->context, data->source_fd, 0, SEEK_SET, &error) < 0)
+        if (data->parallel) {
+            data->parallel->rewind();
+            std::fill(data->stream_last_bytes.begin(), data->stream_last_bytes.end(), 0);
+        }
+        else if (gfal2_lseek(data->context, data->source_fd, 0, SEEK_SET, &error) < 0)
             ret = -1;
     }
     else {
-        ret = gfal2_read(data->context, data->source_fd, buffer, buflen, &error);
+        if (data->parallel)
+            ret = data->parallel->read(buffer, buflen, &error);
+        else
+            ret = gfal2_read(data->context, data->source_fd, buffer, buflen, &error);
         if (ret > 0)
             data->read_instant += ret;
 
@@ -625,6 +657,9 @@ static dav_ssize_t gfal_http_streamed_provider(void *userdata,
             data->perf.average_baudrate = data->perf.bytes_transfered / data->perf.transfer_time;
             data->perf.instant_baudrate = data->read_instant / (now - data->last_update);
 
+            if (data->parallel)
+                gfal_http_streamed_stream_perf(data, now - data->last_update);
+
             data->last_update = now;
             data->read_instant = 0;
 
@@ -640,6 +675,44 @@ static dav_ssize_t gfal_http_streamed_provider(void *userdata,
 }
 
 
+// Feed the source to an S3 multipart upload, instead of a single PUT
+static void gfal_http_streamed_multipart(gfal2_context_t context, GfalHttpPluginData* davix,
+        const Davix::RequestParams& req_params, const std::string& resolved_dst,
+        HttpStreamProvider& provider, off_t size, GError** err)
+{
+    S3DavixBackend backend(davix->context, req_params, resolved_dst);
+    std::unique_ptr<S3MultipartUpload> upload(gfal_http_s3_multipart_new(context, backend, size));
+    std::vector<char> buffer(1024 * 1024);
+    GError* tmp_err = NULL;
+    dav_ssize_t ret;
+
+    while ((ret = gfal_http_streamed_provider(&provider, buffer.data(), buffer.size())) > 0) {
+        if (upload->write(buffer.data(), ret, &tmp_err) < 0)
+            break;
+    }
+
+    // Propagate the source error first, then the destination error
+    if (ret < 0) {
+        if (provider.stream_err != NULL) {
+            gfal2_set_error(err, http_plugin_domain, provider.stream_err->code, __func__, "%s (source)",
+                            provider.stream_err->message);
+        } else {
+            gfal2_set_error(err, http_plugin_domain, EIO, __func__, "Failed to read the source (source)");
+        }
+        g_clear_error(&tmp_err);
+        return;
+    }
+
+    if (tmp_err == NULL)
+        upload->finish(&tmp_err);
+
+    if (tmp_err != NULL) {
+        gfal2_set_error(err, http_plugin_domain, tmp_err->code, __func__, "%s (destination)", tmp_err->message);
+        g_error_free(tmp_err);
+    }
+}
+
+
 static int gfal_http_streamed_copy(gfal2_context_t context,
         GfalHttpPluginData* davix,
         const char* src, const char* dst,
@@ -656,24 +729,30 @@ static int gfal_http_streamed_copy(gfal2_context_t context,
         return -1;
     }
 
-    // Must reset the HTTP OPERATION_TIMEOUT to the transfer timeout
-    bool reset_operation_timeout = is_http_scheme(src);
+    // The source open must use the transfer timeout instead of the HTTP OPERATION_TIMEOUT
+    // Only this thread is affected, concurrent transfers sharing the context keep their own
     int transfer_timeout = static_cast<int>(gfalt_get_timeout(params, NULL));
-    int previous_timeout = 0;
-
-    if (reset_operation_timeout) {
-        previous_timeout = davix->get_operation_timeout();
-        davix->set_operation_timeout(transfer_timeout);
+    int source_fd = -1;
+
+    // With several streams, large sources are read with concurrent ranged reads
+    unsigned nbstreams = std::min(gfalt_get_nbstreams(params, NULL), 32u);
+    gint64 chunk_size = gfal2_get_opt_integer_with_default(context, "HTTP PLUGIN",
+                                                           HTTP_CONFIG_STREAMED_CHUNK_SIZE, 8 * 1024 * 1024);
+    std::unique_ptr<ParallelSourceReader> parallel;
+
+    if (nbstreams > 1 && chunk_size > 0 && src_stat.st_size >= 2 * chunk_size) {
+        gfal2_log(G_LOG_LEVEL_INFO, "Reading the source with %u streams", nbstreams);
+        parallel.reset(new ParallelSourceReader(context, src, src_stat.st_size, nbstreams, chunk_size,
+                                                is_http_scheme(src) ? transfer_timeout : 0));
+    } else if (is_http_scheme(src)) {
+        GfalHttpPluginData::ScopedOperationTimeout source_timeout(transfer_timeout);
         gfal2_log(G_LOG_LEVEL_DEBUG, "Source HTTP Open transfer timeout=%d", transfer_timeout);
+        source_fd = gfal2_open(context, src, O_RDONLY, &nested_err);
+    } else {
+        source_fd = gfal2_open(context, src, O_RDONLY, &nested_err);
     }
 
-    int source_fd = gfal2_open(context, src, O_RDONLY, &nested_err);
-
-    if (reset_operation_timeout) {
-        davix->set_operation_timeout(previous_timeout);
-    }
-
-    if (source_fd < 0) {
+    if (!parallel && source_fd < 0) {
         gfal2_propagate_prefixed_error(err, nested_err, __func__);
         return -1;
     }
@@ -710,31 +789,38 @@ static int gfal_http_streamed_copy(gfal2_context_t context,
     std::string resolved_dst = davix->resolved_url(dst);
     Davix::DavFile dest(davix->context, req_params, resolved_dst);
 
-    HttpStreamProvider provider(src, dst, context, source_fd, params);
+    HttpStreamProvider provider(src, dst, context, source_fd, params, parallel.get());
 
-    try {
-    	dest.put(&req_params, std::bind(&gfal_http_streamed_provider,&provider,
-        		  std::placeholders::_1, std::placeholders::_2), src_stat.st_size);
+    if (gfal_http_s3_multipart_enabled(context, dst)) {
+        gfal_http_streamed_multipart(context, davix, req_params, resolved_dst, provider, src_stat.st_size, err);
+        g_clear_error(&provider.stream_err);
+    } else {
+        try {
+            dest.put(&req_params, std::bind(&gfal_http_streamed_provider, &provider,
+                     std::placeholders::_1, std::placeholders::_2), src_stat.st_size);
 
-    } catch (Davix::DavixException& ex) {
-        GError* tmp_err = NULL;
+        } catch (Davix::DavixException& ex) {
+            GError* tmp_err = NULL;
 
-        // Propagate the source error first, then the destination error
-        if (provider.stream_err != NULL) {
-            tmp_err = provider.stream_err;
-        } else {
-            tmp_err = g_error_new(http_plugin_domain, ex.code(), "%s", ex.what());
-        }
+            // Propagate the source error first, then the destination error
+            if (provider.stream_err != NULL) {
+                tmp_err = provider.stream_err;
+            } else {
+                tmp_err = g_error_new(http_plugin_domain, ex.code(), "%s", ex.what());
+            }
 
-        gfal2_set_error(err, http_plugin_domain, tmp_err->code, __func__, "%s (%s)",
-                        tmp_err->message, (provider.stream_err) ? "source" : "destination");
-        g_clear_error(&tmp_err);
+            gfal2_set_error(err, http_plugin_domain, tmp_err->code, __func__, "%s (%s)",
+                            tmp_err->message, (provider.stream_err) ? "source" : "destination");
+            g_clear_error(&tmp_err);
+        }
     }
 
-    gfal2_close(context, source_fd, &nested_err);
-    // Throw away this error
-    if (nested_err)
-        g_error_free(nested_err);
+    if (source_fd >= 0) {
+        gfal2_close(context, source_fd, &nested_err);
+        // Throw away this error
+        if (nested_err)
+            g_error_free(nested_err);
+    }
 
     return *err == NULL ? 0 : -1;
 }
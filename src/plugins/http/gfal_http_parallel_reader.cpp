@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+
+#include "gfal_http_plugin.h"
+#include "gfal_http_parallel_reader.h"
+
+
+namespace {
+
+class GfalSource: public ParallelSourceReader::Source {
+public:
+    GfalSource(gfal2_context_t context, const char* url, int open_timeout):
+        context(context), url(url), open_timeout(open_timeout)
+    {
+    }
+
+    int open(unsigned, GError** err)
+    {
+        if (open_timeout > 0) {
+            GfalHttpPluginData::ScopedOperationTimeout timeout(open_timeout);
+            return gfal2_open(context, url.c_str(), O_RDONLY, err);
+        }
+        return gfal2_open(context, url.c_str(), O_RDONLY, err);
+    }
+
+    ssize_t pread(int fd, void* buffer, size_t count, off_t offset, GError** err)
+    {
+        return gfal2_pread(context, fd, buffer, count, offset, err);
+    }
+
+    void close(int fd)
+    {
+        gfal2_close(context, fd, NULL);
+    }
+
+private:
+    gfal2_context_t context;
+    std::string url;
+    int open_timeout;
+};
+
+}
+
+
+ParallelSourceReader::ParallelSourceReader(gfal2_context_t context, const char* source, off_t size,
+                                           unsigned nstreams, size_t chunk_size, int open_timeout):
+    gfal_source(new GfalSource(context, source, open_timeout)), source(*gfal_source), context(context),
+    size(size), nstreams(std::max(nstreams, 1u)), chunk_size(std::max<size_t>(chunk_size, 1)),
+    nchunks((size + this->chunk_size - 1) / this->chunk_size), window(2 * this->nstreams),
+    stop(false), error(NULL), next_chunk(0), current_chunk(0), current_offset(0),
+    bytes(this->nstreams, 0)
+{
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Reading %s with %u streams, in %zu chunks of %zu bytes",
+              source, this->nstreams, nchunks, this->chunk_size);
+    start();
+}
+
+
+ParallelSourceReader::ParallelSourceReader(Source& source, gfal2_context_t context, off_t size,
+                                           unsigned nstreams, size_t chunk_size):
+    source(source), context(context),
+    size(size), nstreams(std::max(nstreams, 1u)), chunk_size(std::max<size_t>(chunk_size, 1)),
+    nchunks((size + this->chunk_size - 1) / this->chunk_size), window(2 * this->nstreams),
+    stop(false), error(NULL), next_chunk(0), current_chunk(0), current_offset(0),
+    bytes(this->nstreams, 0)
+{
+    start();
+}
+
+
+ParallelSourceReader::~ParallelSourceReader()
+{
+    shutdown();
+    g_clear_error(&error);
+}
+
+
+void ParallelSourceReader::start()
+{
+    for (unsigned i = 0; i < nstreams; ++i) {
+        streams.emplace_back(&ParallelSourceReader::stream_loop, this, i);
+    }
+}
+
+
+void ParallelSourceReader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    changed.notify_all();
+    for (auto& stream: streams) {
+        stream.join();
+    }
+    streams.clear();
+}
+
+
+void ParallelSourceReader::stream_loop(unsigned index)
+{
+    GError* tmp_err = NULL;
+    int fd = source.open(index, &tmp_err);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (fd >= 0 && !stop && error == NULL) {
+        // Do not run too far ahead of the consumer
+        if (next_chunk >= nchunks) {
+            break;
+        }
+        if (next_chunk >= current_chunk + window) {
+            changed.wait(lock);
+            continue;
+        }
+
+        size_t chunk = next_chunk++;
+        off_t offset = static_cast<off_t>(chunk) * chunk_size;
+        size_t length = std::min<off_t>(chunk_size, size - offset);
+        lock.unlock();
+
+        std::vector<char> buffer(length);
+        size_t done = 0;
+        while (done < length) {
+            if (context && gfal2_is_canceled(context)) {
+                gfal2_set_error(&tmp_err, http_plugin_domain, ECANCELED, __func__, "Transfer canceled");
+                break;
+            }
+            ssize_t ret = source.pread(fd, buffer.data() + done, length - done, offset + done, &tmp_err);
+            if (ret < 0) {
+                break;
+            }
+            if (ret == 0) {
+                gfal2_set_error(&tmp_err, http_plugin_domain, EIO, __func__,
+                                "Unexpected end of file at %lld on stream %u",
+                                static_cast<long long>(offset + done), index);
+                break;
+            }
+            done += ret;
+        }
+
+        lock.lock();
+        if (tmp_err) {
+            break;
+        }
+        bytes[index] += length;
+        ready[chunk] = std::move(buffer);
+        changed.notify_all();
+    }
+
+    if (tmp_err) {
+        if (error == NULL) {
+            gfal2_propagate_prefixed_error_extended(&error, tmp_err, __func__, "stream %u: ", index);
+        }
+        else {
+            g_error_free(tmp_err);
+        }
+        changed.notify_all();
+    }
+    lock.unlock();
+
+    if (fd >= 0) {
+        source.close(fd);
+    }
+}
+
+
+ssize_t ParallelSourceReader::read(void* buffer, size_t count, GError** err)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        if (error != NULL) {
+            g_propagate_error(err, g_error_copy(error));
+            return -1;
+        }
+        if (current_chunk >= nchunks) {
+            return 0;
+        }
+
+        auto chunk = ready.find(current_chunk);
+        if (chunk == ready.end()) {
+            changed.wait(lock);
+            continue;
+        }
+
+        size_t n = std::min(count, chunk->second.size() - current_offset);
+        memcpy(buffer, chunk->second.data() + current_offset, n);
+        current_offset += n;
+
+        if (current_offset >= chunk->second.size()) {
+            ready.erase(chunk);
+            ++current_chunk;
+            current_offset = 0;
+            changed.notify_all();
+        }
+        return n;
+    }
+}
+
+
+void ParallelSourceReader::rewind()
+{
+    shutdown();
+
+    stop = false;
+    g_clear_error(&error);
+    next_chunk = current_chunk = current_offset = 0;
+    ready.clear();
+    std::fill(bytes.begin(), bytes.end(), 0);
+
+    start();
+}
+
+
+std::vector<size_t> ParallelSourceReader::stream_bytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
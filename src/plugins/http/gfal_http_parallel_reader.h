@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_PARALLEL_READER_H
+#define _GFAL_HTTP_PARALLEL_READER_H
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+#include <gfal_api.h>
+
+/**
+ * Reads a source with several concurrent streams, and hands out its content in order.
+ *
+ * The source is split in chunks. Each stream opens its own handle on the source,
+ * and reads with a ranged read (gfal2_pread by default) the next chunk nobody claimed yet. Chunks read ahead
+ * of the consumer wait in a reorder buffer, at most two per stream, so memory is bounded
+ * to 2 * nstreams * chunk_size whatever the file size.
+ */
+class ParallelSourceReader {
+public:
+    /// Access to the source. Called concurrently by the streams
+    class Source {
+    public:
+        virtual ~Source() {}
+
+        /// @return a handle for the stream, or -1 on error
+        virtual int open(unsigned stream, GError** err) = 0;
+        /// Same semantics as gfal2_pread
+        virtual ssize_t pread(int fd, void* buffer, size_t count, off_t offset, GError** err) = 0;
+        virtual void close(int fd) = 0;
+    };
+
+    /// Read the url through gfal2
+    /// @param open_timeout operation timeout for opening the source handles, 0 to keep the configured one
+    ParallelSourceReader(gfal2_context_t context, const char* source, off_t size,
+                         unsigned nstreams, size_t chunk_size, int open_timeout);
+
+    /// Read through the given source, which must outlive the reader
+    /// @param context used to check for cancellation, may be NULL
+    ParallelSourceReader(Source& source, gfal2_context_t context, off_t size,
+                         unsigned nstreams, size_t chunk_size);
+    ~ParallelSourceReader();
+
+    ParallelSourceReader(const ParallelSourceReader&) = delete;
+    ParallelSourceReader& operator=(const ParallelSourceReader&) = delete;
+
+    /// Copy the next bytes of the source into buffer
+    /// @return the number of bytes copied, 0 at the end of the source, -1 on error
+    ssize_t read(void* buffer, size_t count, GError** err);
+
+    /// Start over from the beginning of the source
+    void rewind();
+
+    /// Bytes read so far by each stream
+    std::vector<size_t> stream_bytes();
+
+    unsigned get_nstreams() const {
+        return nstreams;
+    }
+
+private:
+    std::unique_ptr<Source> gfal_source;
+    Source& source;
+    gfal2_context_t context;
+    off_t size;
+    unsigned nstreams;
+    size_t chunk_size;
+    size_t nchunks;
+    size_t window;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> streams;
+    bool stop;
+    GError* error;
+
+    /// Next chunk to be claimed by a stream
+    size_t next_chunk;
+    /// Chunk being consumed, and how much of it
+    size_t current_chunk;
+    size_t current_offset;
+    /// Chunks read, waiting to be consumed
+    std::map<size_t, std::vector<char>> ready;
+    std::vector<size_t> bytes;
+
+    void start();
+    void shutdown();
+    void stream_loop(unsigned index);
+};
+
+#endif // _GFAL_HTTP_PARALLEL_READER_H
@@ -27,6 +27,7 @@
 #include <list>
 #include <davix.hpp>
 #include <errno.h>
+#include <sys/stat.h>
 #include <json.h>
 #include <davix/utils/davix_gcloud_utils.hpp>
 #include <exceptions/gfalcoreexception.hpp>
@@ -228,18 +229,18 @@ char* GfalHttpPluginData::find_se_token(const Davix::Uri& uri, const OP& operati
 
     // Helper function to find a token in the Gfal HTTP internal token map
     auto find_in_token_map = [&](const char* token, const char* token_path, bool write_access) -> bool {
-        auto it = token_map.find(token);
+        bool token_write_access = false;
 
-        if (it == token_map.end()) {
+        if (!token_map.find(token, token_write_access)) {
             gfal2_log(G_LOG_LEVEL_DEBUG,
                       "(SEToken) Retrieved token not in token access map (path=%s) (assuming user-set)",
                       token_path);
             return true;
         }
 
-        if (it->second || (write_access == it->second)) {
+        if (token_write_access || (write_access == token_write_access)) {
             gfal2_log(G_LOG_LEVEL_DEBUG, "(SEToken) Found token in credential_map[%s] (access=%s) (needed=%s)",
-                      token_path, it->second ? "write" : "read", write_access ? "write" : "read");
+                      token_path, token_write_access ? "write" : "read", write_access ? "write" : "read");
             return true;
         }
 
@@ -302,6 +303,10 @@ char* GfalHttpPluginData::retrieve_and_store_se_token(const Davix::Uri& uri, con
     get_params_internal(params, uri);
     get_certificate(params, uri);
 
+    // Bounds the exchanges of the refresh thread too, which the plugin waits for when unloaded
+    struct timespec opTimeout{get_operation_timeout()};
+    params.setOperationTimeout(&opTimeout);
+
     bool write_access = writeFlagFromOperation(operation);
 
     // Get storage server
@@ -313,20 +318,33 @@ char* GfalHttpPluginData::retrieve_and_store_se_token(const Davix::Uri& uri, con
     }
     std::string storage = endpoint.str();
 
-    std::unique_ptr<TokenRetriever> retriever_chain;
-    retriever_chain.reset(new MacaroonRetriever());
-    retriever_chain->add(new MacaroonRetriever(storage));
-
-    TokenRetriever* retriever = retriever_chain.get();
-    while (retriever != NULL) {
-        try {
-            gfal_http_token_t http_token = retriever->retrieve_token(uri, params, write_access, validity);
-            token = strdup(http_token.token.c_str());
-            break;
-        } catch (const Gfal::CoreException& e) {
-            gfal2_log(G_LOG_LEVEL_INFO, "(SEToken) Error during token retrieval: %s", e.what());
-            retriever = retriever->next();
+    // Self-contained, as the token manager calls it again from its refresh thread
+    TokenManager::Exchange exchange = [uri, params, write_access, storage](unsigned validity) -> std::string {
+        std::unique_ptr<TokenRetriever> retriever_chain;
+        retriever_chain.reset(new MacaroonRetriever());
+        retriever_chain->add(new MacaroonRetriever(storage));
+
+        TokenRetriever* retriever = retriever_chain.get();
+        while (retriever != NULL) {
+            try {
+                return retriever->retrieve_token(uri, params, write_access, validity).token;
+            } catch (const Gfal::CoreException& e) {
+                gfal2_log(G_LOG_LEVEL_INFO, "(SEToken) Error during token retrieval: %s", e.what());
+                retriever = retriever->next();
+            }
         }
+        throw Gfal::CoreException(http_plugin_domain, EACCES, "No token retriever succeeded");
+    };
+
+    token_manager.set_refresh_margin(
+        gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", HTTP_CONFIG_TOKEN_REFRESH_MARGIN, 300));
+    token_manager.set_idle_limit(
+        gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", HTTP_CONFIG_TOKEN_REFRESH_IDLE, 900));
+
+    try {
+        token = strdup(token_manager.get(uri, write_access, validity, exchange).c_str());
+    } catch (const Gfal::CoreException&) {
+        token = NULL;
     }
 
     if (!token) {
@@ -345,7 +363,7 @@ char* GfalHttpPluginData::retrieve_and_store_se_token(const Davix::Uri& uri, con
     } else {
         gfal2_log(G_LOG_LEVEL_DEBUG, "(SEToken) Set bearer token in credential_map[%s] (access=%s) (validity=%u)",
                   uri.getString().c_str(), write_access ? "write" : "read" , validity);
-        token_map[token] = write_access;
+        token_map.set(token, write_access);
     }
 
     gfal2_cred_free(token_cred);
@@ -465,8 +483,9 @@ GfalHttpPluginData::retrieve_and_store_tape_endpoint(const std::string& endpoint
         return tape_endpoint_info{};
     }
 
-    tape_endpoint_map[endpoint] = tape_endpoint_info{sitename, tape_endpoint_uri, tape_endpoint_version};
-    return tape_endpoint_map[endpoint];
+    tape_endpoint_info_t info{sitename, tape_endpoint_uri, tape_endpoint_version};
+    tape_endpoint_map.set(endpoint, info);
+    return info;
 }
 
 std::string gfal_http_discover_tape_endpoint(GfalHttpPluginData* davix, const char* url, const char* method, GError** err)
@@ -486,20 +505,18 @@ std::string gfal_http_discover_tape_endpoint(GfalHttpPluginData* davix, const ch
         endpoint << ":" << uri.getPort();
     }
 
-    auto it = davix->tape_endpoint_map.find(endpoint.str());
+    GfalHttpPluginData::tape_endpoint_info_t info;
 
-    if (it == davix->tape_endpoint_map.end()) {
-        davix->retrieve_and_store_tape_endpoint(endpoint.str(), err);
+    if (!davix->tape_endpoint_map.find(endpoint.str(), info)) {
+        info = davix->retrieve_and_store_tape_endpoint(endpoint.str(), err);
 
         if (*err != NULL) {
             return "";
         }
-
-        it = davix->tape_endpoint_map.find(endpoint.str());
     }
 
     std::stringstream tape_endpoint;
-    tape_endpoint << it->second.uri;
+    tape_endpoint << info.uri;
 
     if (tape_endpoint.str().back() != '/') {
         tape_endpoint << "/";
@@ -521,7 +538,17 @@ bool GfalHttpPluginData::get_token(Davix::RequestParams& params, const Davix::Ur
 	    return false;
     }
 
-    gchar* token = find_se_token(uri, operation);
+    gchar* token = NULL;
+    std::string managed_token;
+
+    // Tokens issued by the SE for this path, or a parent
+    if (token_manager.find(uri, writeFlagFromOperation(operation), managed_token)) {
+        token = g_strdup(managed_token.c_str());
+    }
+
+    if (!token) {
+        token = find_se_token(uri, operation);
+    }
 
     if (!token) {
         // Attempt to obtain SE-issued token
@@ -785,6 +812,28 @@ void GfalHttpPluginData::get_credentials(Davix::RequestParams& params, const Dav
     }
 }
 
+// Davix logging is global, so it is set again before each request
+static void set_davix_log_options(gfal2_context_t handle)
+{
+    // Reset here the verbosity level
+    int davix_level = gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", "LOG_LEVEL", 0);
+
+    if (!davix_level)
+        davix_level = get_corresponding_davix_log_level();
+
+    davix_set_log_level(davix_level);
+
+    // Reset scope mask
+    int davix_scope_mask = Davix::getLogScope() & ~(DAVIX_LOG_SSL | DAVIX_LOG_SENSITIVE | DAVIX_LOG_BODY);
+    if (gfal2_get_opt_boolean_with_default(handle, "HTTP PLUGIN", "LOG_SENSITIVE", false)) {
+        davix_scope_mask |= (DAVIX_LOG_SSL | DAVIX_LOG_SENSITIVE);
+    }
+    if (gfal2_get_opt_boolean_with_default(handle, "HTTP PLUGIN", "LOG_CONTENT", false)) {
+        davix_scope_mask |= DAVIX_LOG_BODY;
+    }
+    Davix::setLogScope(davix_scope_mask);
+}
+
 void GfalHttpPluginData::get_params_internal(Davix::RequestParams& params, const Davix::Uri& uri)
 {
     if (uri.getProtocol().compare(0, 4, "http") == 0) {
@@ -821,23 +870,7 @@ void GfalHttpPluginData::get_params_internal(Davix::RequestParams& params, const
     gboolean keep_alive = gfal2_get_opt_boolean_with_default(handle, "HTTP PLUGIN", "KEEP_ALIVE", TRUE);
     params.setKeepAlive(keep_alive);
 
-    // Reset here the verbosity level
-    int davix_level = gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", "LOG_LEVEL", 0);
-
-    if (!davix_level)
-        davix_level = get_corresponding_davix_log_level();
-
-    davix_set_log_level(davix_level);
-
-    // Reset scope mask
-    int davix_scope_mask = Davix::getLogScope() & ~(DAVIX_LOG_SSL | DAVIX_LOG_SENSITIVE | DAVIX_LOG_BODY);
-    if (gfal2_get_opt_boolean_with_default(handle, "HTTP PLUGIN", "LOG_SENSITIVE", false)) {
-        davix_scope_mask |= (DAVIX_LOG_SSL | DAVIX_LOG_SENSITIVE);
-    }
-    if (gfal2_get_opt_boolean_with_default(handle, "HTTP PLUGIN", "LOG_CONTENT", false)) {
-        davix_scope_mask |= DAVIX_LOG_BODY;
-    }
-    Davix::setLogScope(davix_scope_mask);
+    set_davix_log_options(handle);
 
     // Avoid retries
     params.setOperationRetry(0);
@@ -929,25 +962,198 @@ void GfalHttpPluginData::get_tpc_params(Davix::RequestParams* req_params,
 
 }
 
+// How often the certificate of prepared request parameters is checked for changes on disk,
+// since a renewed proxy keeps its path
+static const time_t PARAMS_CERT_CHECK_INTERVAL = 60;
+
+static guint x509_generation(gfal2_context_t handle)
+{
+    return gfal2_cred_get_generation(handle, GFAL_CRED_X509_CERT) +
+           gfal2_cred_get_generation(handle, GFAL_CRED_X509_KEY);
+}
+
+// Modification time and size of the certificate
+static std::string cert_stamp(const std::string& cert)
+{
+    std::stringstream stamp;
+    struct stat st;
+    if (!cert.empty() && stat(cert.c_str(), &st) == 0) {
+        stamp << st.st_mtime << "." << st.st_size;
+    }
+    return stamp.str();
+}
+
+static void collect_x509_prefix(const char* url_prefix, const gfal2_cred_t* cred, void* user_data)
+{
+    auto prefixes = static_cast<std::vector<std::pair<std::string, std::string>>*>(user_data);
+    if (strcmp(cred->type, GFAL_CRED_X509_CERT) == 0 || strcmp(cred->type, GFAL_CRED_X509_KEY) == 0) {
+        prefixes->push_back(std::make_pair(std::string(cred->type), std::string(url_prefix)));
+    }
+}
+
+// Same rule as gfal2_cred_get: the prefix must match a directory in the url
+static bool x509_prefix_matches(const std::string& prefix, const std::string& url)
+{
+    if (prefix.empty()) {
+        return true;
+    }
+    if (url.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    return prefix.size() >= url.size() || prefix[prefix.size() - 1] == '/' || url[prefix.size()] == '/';
+}
+
+std::string GfalHttpPluginData::x509_prefix_key(const Davix::Uri& uri)
+{
+    std::lock_guard<std::mutex> lock(x509_prefixes_mutex);
+
+    guint generation = x509_generation(handle);
+    if (!x509_prefixes_valid || generation != x509_prefixes_generation) {
+        x509_prefixes.clear();
+        gfal2_cred_foreach(handle, collect_x509_prefix, &x509_prefixes);
+        x509_prefixes_generation = generation;
+        x509_prefixes_valid = true;
+    }
+
+    const std::string& url = uri.getString();
+    std::string cert_prefix, key_prefix;
+    for (auto it = x509_prefixes.begin(); it != x509_prefixes.end(); ++it) {
+        std::string& match = (it->first == GFAL_CRED_X509_CERT) ? cert_prefix : key_prefix;
+        if (it->second.size() > match.size() && x509_prefix_matches(it->second, url)) {
+            match = it->second;
+        }
+    }
+    return cert_prefix + "|" + key_prefix;
+}
+
+void GfalHttpPluginData::get_cached_params(Davix::RequestParams& params, const Davix::Uri& uri,
+                                           const OP& operation, const char* variant, int cache_size,
+                                           const std::function<void(Davix::RequestParams&)>& setup)
+{
+    // Endpoint, operation and the X509 credentials picked for the url. Bearer tokens are set
+    // per request, so changing them does not invalidate anything here
+    std::stringstream cache_key;
+    cache_key << uri.getProtocol() << "://" << uri.getHost() << ":" << uri.getPort()
+              << "|" << static_cast<int>(operation) << "|" << variant << "|" << x509_prefix_key(uri);
+    std::string key = cache_key.str();
+
+    guint generation = gfal2_get_config_generation(handle);
+    guint cred_generation = x509_generation(handle);
+    GLogLevelFlags log_level = gfal2_log_get_level();
+    time_t now = time(NULL);
+
+    cached_params entry;
+    if (params_cache.find(key, entry) && entry.generation == generation &&
+        entry.cred_generation == cred_generation && entry.log_level == log_level) {
+        bool valid = true;
+        if (now - entry.cert_checked >= PARAMS_CERT_CHECK_INTERVAL) {
+            valid = (cert_stamp(entry.cert) == entry.cert_stamp);
+            if (valid) {
+                entry.cert_checked = now;
+                params_cache.set(key, entry);
+            }
+        }
+        if (valid) {
+            params = entry.params;
+            set_davix_log_options(handle);
+            return;
+        }
+    }
+
+    setup(params);
+
+    // Bounded: start over rather than tracking usage
+    if (params_cache.size() >= static_cast<size_t>(cache_size)) {
+        params_cache.clear();
+    }
+
+    GError* error = NULL;
+    gchar* cert = gfal2_cred_get(handle, GFAL_CRED_X509_CERT, uri.getString().c_str(), NULL, &error);
+    g_clear_error(&error);
+
+    entry.generation = generation;
+    entry.cred_generation = cred_generation;
+    entry.log_level = log_level;
+    entry.cert = cert ? cert : "";
+    entry.cert_stamp = cert_stamp(entry.cert);
+    entry.cert_checked = now;
+    entry.params = params;
+    params_cache.set(key, entry);
+    g_free(cert);
+}
+
 void GfalHttpPluginData::get_params(Davix::RequestParams* req_params, const Davix::Uri& uri,
                                     const OP& operation)
 {
-    *req_params = reference_params;
+    int cache_size = gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", HTTP_CONFIG_PARAMS_CACHE_SIZE, 256);
+
+    if (cache_size <= 0) {
+        *req_params = reference_params;
+
+        get_params_internal(*req_params, uri);
+        get_credentials(*req_params, uri, operation);
+        return;
+    }
 
-    get_params_internal(*req_params, uri);
-    get_credentials(*req_params, uri, operation);
+    // Object stores and Reva take their credentials from the configuration only,
+    // so the parameters are fully determined by the endpoint
+    if (isCloudStorage(uri)) {
+        get_cached_params(*req_params, uri, operation, "full", cache_size,
+                          [this, &uri, &operation](Davix::RequestParams& params) {
+            params = reference_params;
+            get_params_internal(params, uri);
+            get_credentials(params, uri, operation);
+        });
+    }
+    // Bearer tokens depend on the path, so they are always looked up
+    else {
+        get_cached_params(*req_params, uri, operation, "base", cache_size,
+                          [this, &uri](Davix::RequestParams& params) {
+            params = reference_params;
+            get_params_internal(params, uri);
+            get_certificate(params, uri);
+        });
+
+        if (!get_token(*req_params, uri, operation, 180)) {
+            get_cached_params(*req_params, uri, operation, "fallback", cache_size,
+                              [this, &uri](Davix::RequestParams& params) {
+                params = reference_params;
+                get_params_internal(params, uri);
+                get_certificate(params, uri);
+                get_aws_params(params, uri);
+                get_gcloud_credentials(params, uri);
+                get_swift_params(params, uri);
+            });
+        }
+    }
+
+    // The operation timeout may be overridden per thread, it is never cached
+    struct timespec opTimeout{get_operation_timeout()};
+    req_params->setOperationTimeout(&opTimeout);
 }
 
+// Operation timeout forced on the calling thread, 0 if none
+static thread_local int thread_operation_timeout = 0;
+
 int GfalHttpPluginData::get_operation_timeout() const
 {
+    if (thread_operation_timeout > 0) {
+        return thread_operation_timeout;
+    }
     int global_timeout = gfal2_get_opt_integer_with_default(handle, CORE_CONFIG_GROUP,
                                                             CORE_CONFIG_NAMESPACE_TIMEOUT, 300);
     return gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", HTTP_CONFIG_OP_TIMEOUT, global_timeout);
 }
 
-void GfalHttpPluginData::set_operation_timeout(int timeout)
+GfalHttpPluginData::ScopedOperationTimeout::ScopedOperationTimeout(int timeout):
+    previous(thread_operation_timeout)
 {
-    gfal2_set_opt_integer(handle, "HTTP PLUGIN", HTTP_CONFIG_OP_TIMEOUT, timeout, NULL);
+    thread_operation_timeout = timeout;
+}
+
+GfalHttpPluginData::ScopedOperationTimeout::~ScopedOperationTimeout()
+{
+    thread_operation_timeout = previous;
 }
 
 void GfalHttpPluginData::resolve_and_store_url(const char* url)
@@ -958,7 +1164,7 @@ void GfalHttpPluginData::resolve_and_store_url(const char* url)
         char *url_tmp = resolve_dns_helper(url, "Resolved url");
 
         if (url_tmp) {
-            resolution_map[url] = url_tmp;
+            resolution_map.set(url, url_tmp);
             free(url_tmp);
         }
     }
@@ -966,15 +1172,62 @@ void GfalHttpPluginData::resolve_and_store_url(const char* url)
 
 std::string GfalHttpPluginData::resolved_url(const std::string& url)
 {
-    auto resolved = resolution_map.find(url);
+    std::string resolved;
 
-    if (resolved != resolution_map.end()) {
-        return resolved->second;
+    if (resolution_map.find(url, resolved)) {
+        return resolved;
     }
 
     return url;
 }
 
+static std::string capability_key(const Davix::Uri& uri)
+{
+    std::stringstream key;
+    key << uri.getProtocol() << "://" << uri.getHost() << ":" << uri.getPort();
+    return key.str();
+}
+
+GfalHttpPluginData::StatMethod GfalHttpPluginData::get_stat_method(const Davix::Uri& uri)
+{
+    std::string key = capability_key(uri);
+    endpoint_capabilities capabilities;
+
+    if (!capability_map.find(key, capabilities)) {
+        return StatMethod::UNKNOWN;
+    }
+    time_t now = time(NULL);
+    if (capabilities.expiration <= now) {
+        // Another thread may have refreshed the entry in the meantime
+        capability_map.erase_if(key, [now](const endpoint_capabilities& c) { return c.expiration <= now; });
+        return StatMethod::UNKNOWN;
+    }
+    return capabilities.stat_method;
+}
+
+void GfalHttpPluginData::set_stat_method(const Davix::Uri& uri, StatMethod method)
+{
+    int ttl = gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", HTTP_CONFIG_CAPABILITY_TTL, 300);
+    if (ttl <= 0) {
+        return;
+    }
+
+    endpoint_capabilities capabilities;
+    capabilities.stat_method = method;
+    capabilities.expiration = time(NULL) + ttl;
+    capability_map.set(capability_key(uri), capabilities);
+}
+
+bool GfalHttpPluginData::webdav_unsupported(const Davix::DavixError* daverr)
+{
+    // Davix reports 501 as not supported, other answers are only told apart by their code in the message
+    if (daverr->getStatus() == Davix::StatusCode::OperationNonSupported) {
+        return true;
+    }
+    const std::string& msg = daverr->getErrMsg();
+    return msg.find("HTTP 405") != std::string::npos || msg.find("HTTP 501") != std::string::npos;
+}
+
 static void log_davix2gfal(void* userdata, int msg_level, const char* msg)
 {
     GLogLevelFlags gfal_level = G_LOG_LEVEL_MESSAGE;
@@ -995,7 +1248,8 @@ static void log_davix2gfal(void* userdata, int msg_level, const char* msg)
 
 GfalHttpPluginData::GfalHttpPluginData(gfal2_context_t handle):
     context(), posix(&context), handle(handle), reference_params(),
-    token_map(), tape_endpoint_map()
+    token_map(), tape_endpoint_map(), resolution_map(), capability_map(), params_cache(),
+    x509_prefixes_generation(0), x509_prefixes_valid(false)
 {
     davix_set_log_handler(log_davix2gfal, NULL);
     int davix_level = gfal2_get_opt_integer_with_default(handle, "HTTP PLUGIN", "LOG_LEVEL", 0);
@@ -1038,16 +1292,21 @@ void gfal_http_delete(plugin_handle plugin_data)
 }
 
 
+static const char* const gfal_http_url_schemes[] = {
+    "http", "https", "dav", "davs", "s3", "s3s", "gcloud", "gclouds", "swift", "swifts",
+    "http+3rd", "https+3rd", "dav+3rd", "davs+3rd", "cs3", "cs3s", NULL
+};
+
+
 static gboolean gfal_http_check_url(plugin_handle plugin_data, const char* url,
                                     plugin_mode operation, GError** err)
 {
     switch(operation){
-    	case GFAL_PLUGIN_QOS_CHECK_CLASSES:
-    	case GFAL_PLUGIN_CHECK_FILE_QOS:
-    	case GFAL_PLUGIN_CHECK_QOS_AVAILABLE_TRANSITIONS:
-    	case GFAL_PLUGIN_CHECK_TARGET_QOS:
-    	case GFAL_PLUGIN_CHANGE_OBJECT_QOS:
-    		return true;
+        case GFAL_PLUGIN_QOS_CHECK_CLASSES:
+        case GFAL_PLUGIN_CHECK_FILE_QOS:
+        case GFAL_PLUGIN_CHECK_QOS_AVAILABLE_TRANSITIONS:
+        case GFAL_PLUGIN_CHECK_TARGET_QOS:
+        case GFAL_PLUGIN_CHANGE_OBJECT_QOS:
         case GFAL_PLUGIN_ACCESS:
         case GFAL_PLUGIN_OPEN:
         case GFAL_PLUGIN_STAT:
@@ -1221,6 +1480,7 @@ extern "C" gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError
 
     // Bind metadata
     http_plugin.check_plugin_url = &gfal_http_check_url;
+    http_plugin.url_schemes = gfal_http_url_schemes;
     http_plugin.getName = &gfal_http_get_name;
     http_plugin.priority = GFAL_PLUGIN_PRIORITY_DATA
     ;
@@ -1228,6 +1488,7 @@ extern "C" gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError
     http_plugin.plugin_delete = &gfal_http_delete;
 
     http_plugin.statG = &gfal_http_stat;
+    http_plugin.stat_listG = &gfal_http_stat_list;
     http_plugin.accessG = &gfal_http_access;
     http_plugin.mkdirpG = &gfal_http_mkdirpG;
     http_plugin.unlinkG = &gfal_http_unlinkG;
@@ -1237,10 +1498,13 @@ extern "C" gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError
     http_plugin.readdirG = &gfal_http_readdir;
     http_plugin.readdirppG = &gfal_http_readdirpp;
     http_plugin.closedirG = &gfal_http_closedir;
+    http_plugin.list_treeG = &gfal_http_list_tree;
 
     // Bind IO
     http_plugin.openG = &gfal_http_fopen;
     http_plugin.readG = &gfal_http_fread;
+    http_plugin.preadG = &gfal_http_fpread;
+    http_plugin.readvG = &gfal_http_freadv;
     http_plugin.writeG = &gfal_http_fwrite;
     http_plugin.lseekG = &gfal_http_fseek;
     http_plugin.closeG = &gfal_http_fclose;
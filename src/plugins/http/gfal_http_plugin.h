@@ -21,15 +21,33 @@
 #ifndef _GFAL_HTTP_PLUGIN_H
 #define _GFAL_HTTP_PLUGIN_H
 
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <gfal_plugins_api.h>
 #include <davix.hpp>
 
 #include "gfal_http_plugin_token.h"
 #include "gfal_http_plugin_copy.h"
+#include "gfal_http_sharded_map.h"
+#include "gfal_http_tape_index.h"
+#include "gfal_http_token_manager.h"
 
 #define HTTP_CONFIG_OP_TIMEOUT     "OPERATION_TIMEOUT"
+#define HTTP_CONFIG_CAPABILITY_TTL "CAPABILITY_CACHE_TTL"
+#define HTTP_CONFIG_STREAMING_LISTING "STREAMING_LISTING"
+#define HTTP_CONFIG_PARAMS_CACHE_SIZE "PARAMS_CACHE_SIZE"
+#define HTTP_CONFIG_TOKEN_REFRESH_MARGIN "TOKEN_REFRESH_MARGIN"
+#define HTTP_CONFIG_TOKEN_REFRESH_IDLE "TOKEN_REFRESH_IDLE"
+#define HTTP_CONFIG_TAPE_POLL_CACHE_TTL "TAPE_POLL_CACHE_TTL"
+#define HTTP_CONFIG_STREAMED_CHUNK_SIZE "STREAMED_COPY_CHUNK_SIZE"
+#define HTTP_CONFIG_S3_MULTIPART "S3_MULTIPART_UPLOAD"
+#define HTTP_CONFIG_S3_PART_SIZE "S3_MULTIPART_PART_SIZE"
+#define HTTP_CONFIG_S3_CONCURRENCY "S3_MULTIPART_CONCURRENCY"
+#define HTTP_CONFIG_S3_RETRIES "S3_MULTIPART_RETRIES"
 
 class GfalHttpPluginData {
 public:
@@ -68,8 +86,36 @@ public:
     // This function uses the internal DNS Alias map
     std::string resolved_url(const std::string& url);
 
+    // Operation timeout for the requests prepared by the calling thread
     int get_operation_timeout() const;
-    void set_operation_timeout(int timeout);
+
+    // Override the operation timeout of the requests prepared by the calling thread, while in scope.
+    // The shared configuration is left untouched, so other threads are not affected
+    class ScopedOperationTimeout {
+    public:
+        explicit ScopedOperationTimeout(int timeout);
+        ~ScopedOperationTimeout();
+    private:
+        int previous;
+    };
+
+    /// Protocol known to work for stat on an endpoint
+    enum class StatMethod {
+        UNKNOWN,
+        WEBDAV,
+        HTTP
+    };
+
+    // Returns the stat method learnt for the endpoint (scheme, host, port) of the uri,
+    // or UNKNOWN if nothing is known, or the entry expired
+    StatMethod get_stat_method(const Davix::Uri& uri);
+
+    // Remember which stat method worked for the endpoint of the uri, for CAPABILITY_CACHE_TTL seconds
+    void set_stat_method(const Davix::Uri& uri, StatMethod method);
+
+    // Whether a failed PROPFIND means the endpoint does not do WebDav (405 or 501),
+    // rather than a failure of the request itself
+    static bool webdav_unsupported(const Davix::DavixError* daverr);
 
     friend ssize_t gfal_http_token_retrieve(plugin_handle plugin_data, const char* url, const char* issuer,
                                             gboolean write_access, unsigned validity, const char* const* activities,
@@ -89,6 +135,9 @@ public:
     friend ssize_t gfal_http_getxattr_internal(plugin_handle plugin_data, const char* url, const char *key,
                                                char* buff, size_t s_buff, GError** err);
 
+    friend int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                                                const char* token, GError** errors);
+
 private:
     /// Tape REST API endpoint info struct
     typedef struct tape_endpoint_info {
@@ -99,9 +148,37 @@ private:
         tape_endpoint_info() = default;
     } tape_endpoint_info_t;
 
-    typedef std::map<std::string, bool> TokenAccessMap;
-    typedef std::map<std::string, tape_endpoint_info_t> TapeEndpointMap;
-    typedef std::map<std::string, std::string> DNSResolutionMap;
+    typedef ShardedMap<std::string, bool> TokenAccessMap;
+    typedef ShardedMap<std::string, tape_endpoint_info_t> TapeEndpointMap;
+    typedef ShardedMap<std::string, std::string> DNSResolutionMap;
+
+    /// What an endpoint is known to support, and until when
+    struct endpoint_capabilities {
+        StatMethod stat_method;
+        time_t expiration;
+    };
+    typedef ShardedMap<std::string, endpoint_capabilities> EndpointCapabilityMap;
+
+    /// Request parameters prepared for an endpoint, valid while the context configuration,
+    /// the X509 credentials and the certificate file are unchanged
+    struct cached_params {
+        guint generation;
+        guint cred_generation;
+        GLogLevelFlags log_level;
+        /// certificate the parameters were prepared with, its modification time and size, and when it was last checked
+        std::string cert;
+        std::string cert_stamp;
+        time_t cert_checked;
+        Davix::RequestParams params;
+    };
+    typedef ShardedMap<std::string, cached_params> RequestParamsCache;
+
+    /// Files of a stage request, as last polled
+    struct tape_poll_result {
+        time_t expiration;
+        std::shared_ptr<const TapeFileIndex> files;
+    };
+    typedef ShardedMap<std::string, tape_poll_result> TapePollCache;
 
     /// baseline Davix Request Parameters
     Davix::RequestParams reference_params;
@@ -109,14 +186,38 @@ private:
     TokenAccessMap token_map;
     /// token retriever object (can be chained)
     std::unique_ptr<TokenRetriever> token_retriever_chain;
+    /// SE-issued tokens, indexed by path and refreshed before they expire
+    TokenManager token_manager;
     /// map a url with a tape endpoint info struct
     TapeEndpointMap tape_endpoint_map;
     /// map an initial DNS alias URL to it's resolved URL
     DNSResolutionMap resolution_map;
+    /// map an endpoint (scheme://host:port) with what it is known to support
+    EndpointCapabilityMap capability_map;
+    /// map (endpoint, operation, client certificate) with the request parameters prepared for them
+    RequestParamsCache params_cache;
+    /// map a stage request URL with its polled files, so polling several subsets costs one request
+    TapePollCache tape_poll_cache;
+    /// URL prefixes with an X509 certificate or key set, as of x509_prefixes_generation
+    std::vector<std::pair<std::string, std::string>> x509_prefixes;
+    guint x509_prefixes_generation;
+    bool x509_prefixes_valid;
+    std::mutex x509_prefixes_mutex;
+
+    // Prefixes of the X509 certificate and key used for the url, identifying the client certificate
+    // without looking the credentials up
+    std::string x509_prefix_key(const Davix::Uri& uri);
 
     // Set up general request parameters
     void get_params_internal(Davix::RequestParams& params, const Davix::Uri& uri);
 
+    // Request parameters for the endpoint of the uri, taken from params_cache or built by setup
+    // when missing or outdated. Everything setup does must depend only on the endpoint, the
+    // operation and the client certificate
+    void get_cached_params(Davix::RequestParams& params, const Davix::Uri& uri, const OP& operation,
+                           const char* variant, int cache_size,
+                           const std::function<void(Davix::RequestParams&)>& setup);
+
     // Obtain credentials for a given Uri and set those credentials in the Davix request parameters.
     // @param operation the HTTP operation to be performed
     // @param token_validity requested lifetime of the token in minutes
@@ -222,6 +323,9 @@ std::string gfal_http_discover_tape_endpoint(GfalHttpPluginData* davix, const ch
 // METADATA OPERATIONS
 int gfal_http_stat(plugin_handle plugin_data, const char* url, struct stat* buf, GError** err);
 
+int gfal_http_stat_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                        struct stat* stats, GError** errors);
+
 int gfal_http_rename(plugin_handle plugin_data, const char* oldurl, const char* newurl, GError** err);
 
 int gfal_http_access(plugin_handle plugin_data, const char* url, int mode, GError** err);
@@ -240,11 +344,18 @@ struct dirent* gfal_http_readdirpp(plugin_handle plugin_data, gfal_file_handle d
 
 int gfal_http_closedir(plugin_handle plugin_data, gfal_file_handle dir_desc, GError** err);
 
+int gfal_http_list_tree(plugin_handle plugin_data, const char* url, gfal2_tree_entry_cb callback,
+                        void* user_data, GError** err);
+
 // IO
 gfal_file_handle gfal_http_fopen(plugin_handle plugin_data, const char* url, int flag, mode_t mode, GError** err);
 
 ssize_t gfal_http_fread(plugin_handle, gfal_file_handle fd, void* buff, size_t count, GError** err);
 
+ssize_t gfal_http_fpread(plugin_handle, gfal_file_handle fd, void* buff, size_t count, off_t offset, GError** err);
+
+ssize_t gfal_http_freadv(plugin_handle, gfal_file_handle fd, gfal2_iovec_t* vector, int count, GError** err);
+
 ssize_t gfal_http_fwrite(plugin_handle, gfal_file_handle fd, const void* buff, size_t count, GError** err);
 
 int gfal_http_fclose(plugin_handle, gfal_file_handle fd, GError ** err);
@@ -20,16 +20,35 @@
 
 #include <cstring>
 #include <glib.h>
+#include <memory>
 #include <unistd.h>
+#include <vector>
 #include "gfal_http_plugin.h"
+#include "gfal_http_s3_multipart.h"
 
 
 struct GfalHTTPFD {
     Davix::RequestParams req_params;
     DAVIX_FD* davix_fd;
+    // Set instead of davix_fd for S3 objects opened for writing
+    std::unique_ptr<S3DavixBackend> s3_backend;
+    std::unique_ptr<S3MultipartUpload> multipart;
+
+    GfalHTTPFD(): davix_fd(NULL) {}
 };
 
 
+// Handles of multipart uploads can only be written and closed
+static bool gfal_http_is_upload(GfalHTTPFD* dfd, GError** err, const char* func)
+{
+    if (dfd->multipart) {
+        gfal2_set_error(err, http_plugin_domain, EBADF, func, "The file is open for an upload in parts");
+        return true;
+    }
+    return false;
+}
+
+
 
 gfal_file_handle gfal_http_fopen(plugin_handle plugin_data, const char* url, int flag, mode_t mode,
         GError** err)
@@ -59,6 +78,13 @@ gfal_file_handle gfal_http_fopen(plugin_handle plugin_data, const char* url, int
 
     // DMC-1348: Use resolved URLs for data operations
     std::string resolved_url = davix->resolved_url(stripped_url);
+
+    if ((flag & O_WRONLY) && gfal_http_s3_multipart_enabled(davix->handle, url)) {
+        fd->s3_backend.reset(new S3DavixBackend(davix->context, fd->req_params, resolved_url));
+        fd->multipart.reset(gfal_http_s3_multipart_new(davix->handle, *fd->s3_backend, -1));
+        return gfal_file_handle_new(gfal_http_get_name(), fd);
+    }
+
     fd->davix_fd = davix->posix.open(&fd->req_params, resolved_url, flag, &daverr);
 
     if (fd->davix_fd == NULL) {
@@ -79,6 +105,10 @@ ssize_t gfal_http_fread(plugin_handle plugin_data, gfal_file_handle fd, void* bu
     Davix::DavixError* daverr = NULL;
     GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
 
+    if (gfal_http_is_upload(dfd, err, __func__)) {
+        return -1;
+    }
+
     ssize_t reads = davix->posix.read(dfd->davix_fd, buff, count, &daverr);
     if (reads < 0) {
         davix2gliberr(daverr, err, __func__);
@@ -90,6 +120,68 @@ ssize_t gfal_http_fread(plugin_handle plugin_data, gfal_file_handle fd, void* bu
 
 
 
+// Positional reads do not touch the file offset, so they do not need the handle lock
+ssize_t gfal_http_fpread(plugin_handle plugin_data, gfal_file_handle fd, void* buff, size_t count,
+        off_t offset, GError** err)
+{
+    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    Davix::DavixError* daverr = NULL;
+    GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
+
+    if (gfal_http_is_upload(dfd, err, __func__)) {
+        return -1;
+    }
+
+    ssize_t reads = davix->posix.pread(dfd->davix_fd, buff, count, static_cast<dav_off_t>(offset), &daverr);
+    if (reads < 0) {
+        davix2gliberr(daverr, err, __func__);
+        Davix::DavixError::clearError(&daverr);
+    }
+
+    return reads;
+}
+
+
+
+// Davix merges the chunks into as few multi-range requests as the server accepts
+ssize_t gfal_http_freadv(plugin_handle plugin_data, gfal_file_handle fd, gfal2_iovec_t* vector, int count,
+        GError** err)
+{
+    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    Davix::DavixError* daverr = NULL;
+    GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
+
+    if (gfal_http_is_upload(dfd, err, __func__)) {
+        return -1;
+    }
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    std::vector<Davix::DavIOVecInput> input(count);
+    std::vector<Davix::DavIOVecOuput> output(count);
+    for (int i = 0; i < count; ++i) {
+        input[i].diov_buffer = vector[i].buffer;
+        input[i].diov_offset = static_cast<dav_off_t>(vector[i].offset);
+        input[i].diov_size = vector[i].size;
+    }
+
+    ssize_t reads = davix->posix.preadVec(dfd->davix_fd, input.data(), output.data(), count, &daverr);
+    if (reads < 0) {
+        davix2gliberr(daverr, err, __func__);
+        Davix::DavixError::clearError(&daverr);
+        return -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        vector[i].nbytes = output[i].diov_size;
+    }
+    return reads;
+}
+
+
+
 ssize_t gfal_http_fwrite(plugin_handle plugin_data, gfal_file_handle fd, const void* buff,
         size_t count, GError** err)
 {
@@ -97,6 +189,10 @@ ssize_t gfal_http_fwrite(plugin_handle plugin_data, gfal_file_handle fd, const v
     Davix::DavixError* daverr = NULL;
     GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
 
+    if (dfd->multipart) {
+        return dfd->multipart->write(buff, count, err);
+    }
+
     ssize_t writes = davix->posix.write(dfd->davix_fd, buff, count, &daverr);
     if (writes < 0) {
         davix2gliberr(daverr, err, __func__);
@@ -115,12 +211,16 @@ int gfal_http_fclose(plugin_handle plugin_data, gfal_file_handle fd, GError ** e
     GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
     int ret = 0;
 
-    if (davix->posix.close(dfd->davix_fd, &daverr) != 0) {
+    if (dfd->multipart) {
+        ret = dfd->multipart->finish(err);
+    }
+    else if (davix->posix.close(dfd->davix_fd, &daverr) != 0) {
         davix2gliberr(daverr, err, __func__);
         Davix::DavixError::clearError(&daverr);
         ret = -1;
     }
 
+    delete dfd;
     gfal_file_handle_delete(fd);
 
     return ret;
@@ -135,6 +235,10 @@ off_t gfal_http_fseek(plugin_handle plugin_data, gfal_file_handle fd, off_t offs
     Davix::DavixError* daverr = NULL;
     GfalHTTPFD* dfd = (GfalHTTPFD*) gfal_file_handle_get_fdesc(fd);
 
+    if (gfal_http_is_upload(dfd, err, __func__)) {
+        return -1;
+    }
+
     off_t newOffset = static_cast<off_t>(davix->posix.lseek64(dfd->davix_fd,
             static_cast<dav_off_t>(offset), whence, &daverr));
     if (newOffset < 0) {
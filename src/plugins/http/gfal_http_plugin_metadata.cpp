@@ -18,41 +18,59 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cerrno>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <glib.h>
 #include <unistd.h>
+#include <exceptions/gfalcoreexception.hpp>
 #include "gfal_http_plugin.h"
+#include "gfal_http_propfind.h"
 
 
 
-int gfal_http_stat(plugin_handle plugin_data, const char* url,
-                   struct stat* buf, GError** err)
+static int gfal_http_stat_internal(GfalHttpPluginData* davix, const char* stripped_url,
+                                   Davix::RequestParams& req_params, struct stat* buf, GError** err)
 {
     Davix::StatInfo info;
-    char stripped_url[GFAL_URL_MAX_LEN];
-    strip_3rd_from_url(url, stripped_url, sizeof(stripped_url));
-    if(buf==NULL){
-        gfal2_set_error(err, http_plugin_domain, EINVAL, __func__, "Invalid stat argument");
-        return -1;
-    }
-
-    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
     Davix::DavixError* daverr = NULL;
-    Davix::RequestParams req_params;
-    davix->get_params(&req_params, Davix::Uri(stripped_url), GfalHttpPluginData::OP::HEAD);
+    Davix::Uri uri(stripped_url);
 
     // Attempt stat over WebDav first, then fallback to HTTP
+    // Once an endpoint is known to support one or the other, go straight for it
+    GfalHttpPluginData::StatMethod stat_method = GfalHttpPluginData::StatMethod::UNKNOWN;
+    bool webdav_unsupported = false;
     if (req_params.getProtocol() == Davix::RequestProtocol::Http) {
+      stat_method = davix->get_stat_method(uri);
+    }
+
+    if (req_params.getProtocol() == Davix::RequestProtocol::Http &&
+        stat_method != GfalHttpPluginData::StatMethod::HTTP) {
       gfal2_log(G_LOG_LEVEL_DEBUG, "Identified stat over HTTP protocol. Attempting stat over WebDav first");
       req_params.setProtocol(Davix::RequestProtocol::Webdav);
       Davix::StatInfo statInfo;
 
       if (davix->posix.stat64(&req_params, stripped_url, &statInfo, &daverr) != 0) {
+        if (stat_method == GfalHttpPluginData::StatMethod::WEBDAV) {
+          // The endpoint speaks WebDav, so this is a genuine failure
+          davix2gliberr(daverr, err, __func__);
+          Davix::DavixError::clearError(&daverr);
+          return -1;
+        }
         gfal2_log(G_LOG_LEVEL_MESSAGE, "Stat over WebDav failed with error: %s. Will fallback to HTTP protocol", daverr->getErrMsg().c_str());
+        webdav_unsupported = GfalHttpPluginData::webdav_unsupported(daverr);
         Davix::DavixError::clearError(&daverr);
         req_params.setProtocol(Davix::RequestProtocol::Http);
       } else {
+        if (stat_method == GfalHttpPluginData::StatMethod::UNKNOWN) {
+          davix->set_stat_method(uri, GfalHttpPluginData::StatMethod::WEBDAV);
+        }
         statInfo.toPosixStat(*buf);
         return 0;
       }
@@ -63,12 +81,100 @@ int gfal_http_stat(plugin_handle plugin_data, const char* url,
         Davix::DavixError::clearError(&daverr);
         return -1;
     }
+    if (webdav_unsupported && stat_method == GfalHttpPluginData::StatMethod::UNKNOWN) {
+        // The endpoint refused PROPFIND, but plain HTTP works.
+        // Other WebDav failures, i.e. a missing file, tell nothing about the endpoint
+        davix->set_stat_method(uri, GfalHttpPluginData::StatMethod::HTTP);
+    }
     info.toPosixStat(*buf);
     return 0;
 }
 
 
 
+int gfal_http_stat(plugin_handle plugin_data, const char* url,
+                   struct stat* buf, GError** err)
+{
+    char stripped_url[GFAL_URL_MAX_LEN];
+    strip_3rd_from_url(url, stripped_url, sizeof(stripped_url));
+    if(buf==NULL){
+        gfal2_set_error(err, http_plugin_domain, EINVAL, __func__, "Invalid stat argument");
+        return -1;
+    }
+
+    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    Davix::RequestParams req_params;
+    davix->get_params(&req_params, Davix::Uri(stripped_url), GfalHttpPluginData::OP::HEAD);
+
+    return gfal_http_stat_internal(davix, stripped_url, req_params, buf, err);
+}
+
+
+
+// The urls are shared between a bounded number of threads, so that many requests are in flight at once,
+// on the connections of the Davix session pool
+int gfal_http_stat_list(plugin_handle plugin_data, int nbfiles, const char* const* urls,
+                        struct stat* stats, GError** errors)
+{
+    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    int concurrency = gfal2_get_opt_integer_with_default(davix->handle, "HTTP PLUGIN",
+                                                         "STAT_LIST_CONCURRENCY", 8);
+    concurrency = std::max(1, std::min(concurrency, nbfiles));
+
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    // Request parameters may store credentials in the context, which is not thread-safe,
+    // so they are set up one at a time
+    std::mutex params_mutex;
+
+    auto worker = [&]() {
+        int i;
+        while ((i = next++) < nbfiles) {
+            if (gfal2_is_canceled(davix->handle)) {
+                gfal2_set_error(&errors[i], http_plugin_domain, ECANCELED, __func__, "Operation canceled");
+                failed = true;
+                continue;
+            }
+
+            char stripped_url[GFAL_URL_MAX_LEN];
+            strip_3rd_from_url(urls[i], stripped_url, sizeof(stripped_url));
+
+            Davix::RequestParams req_params;
+            {
+                std::lock_guard<std::mutex> lock(params_mutex);
+                davix->get_params(&req_params, Davix::Uri(stripped_url), GfalHttpPluginData::OP::HEAD);
+            }
+            if (gfal_http_stat_internal(davix, stripped_url, req_params, &stats[i], &errors[i]) != 0) {
+                failed = true;
+            }
+        }
+    };
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Bulk stat of %d urls with %d requests in flight", nbfiles, concurrency);
+
+    std::vector<std::thread> threads;
+    threads.reserve(concurrency - 1);
+    for (int i = 1; i < concurrency; ++i) {
+        try {
+            threads.emplace_back(worker);
+        }
+        catch (const std::system_error& e) {
+            // The urls are pulled from a shared counter, so fewer threads still stat all of them
+            gfal2_log(G_LOG_LEVEL_WARNING, "Bulk stat continues with %zu requests in flight: %s",
+                      threads.size() + 1, e.what());
+            break;
+        }
+    }
+    worker();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    return failed ? -1 : 0;
+}
+
+
+
 int gfal_http_mkdirpG(plugin_handle plugin_data, const char* url, mode_t mode, gboolean rec_flag, GError** err)
 {
     char stripped_url[GFAL_URL_MAX_LEN];
@@ -265,6 +371,83 @@ int gfal_http_access(plugin_handle plugin_data, const char* url, int mode, GErro
 
 
 
+// Directory handle, either backed by Davix, or by a streamed PROPFIND
+struct GfalHttpDir {
+    DAVIX_DIR* davix_dir;
+    std::unique_ptr<Davix::HttpRequest> request;
+    PropfindStreamParser parser;
+    // Decoded path of the listed directory, entries are named relative to it
+    std::string base_path;
+    // Buffer for reading the answer
+    std::vector<char> block;
+    bool eof;
+    struct dirent de;
+
+    GfalHttpDir(): davix_dir(NULL), eof(false) {
+        memset(&de, 0, sizeof(de));
+    }
+};
+
+
+static const char* propfind_body =
+    "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
+    "<D:propfind xmlns:D=\"DAV:\"><D:prop>"
+    "<D:resourcetype/><D:getcontentlength/><D:getlastmodified/>"
+    "</D:prop></D:propfind>";
+
+
+// Send the PROPFIND, and leave the answer to be read as the listing goes
+static GfalHttpDir* gfal_http_opendir_streaming(GfalHttpPluginData* davix, const char* stripped_url,
+                                                bool recursive, GError** err)
+{
+    Davix::DavixError* daverr = NULL;
+    Davix::Uri uri(stripped_url);
+    Davix::RequestParams req_params;
+    davix->get_params(&req_params, uri);
+
+    std::unique_ptr<GfalHttpDir> dir(new GfalHttpDir());
+    dir->base_path = PropfindStreamParser::decode_path(uri.getPath());
+    if (dir->base_path.empty() || dir->base_path.back() != '/') {
+        dir->base_path.push_back('/');
+    }
+    dir->block.resize(65536);
+    dir->request.reset(new Davix::HttpRequest(davix->context, uri, &daverr));
+    if (daverr) {
+        davix2gliberr(daverr, err, __func__);
+        Davix::DavixError::clearError(&daverr);
+        return NULL;
+    }
+    dir->request->setParameters(req_params);
+    dir->request->setRequestMethod("PROPFIND");
+    dir->request->addHeaderField("Depth", recursive ? "infinity" : "1");
+    dir->request->addHeaderField("Content-Type", "application/xml; charset=utf-8");
+    dir->request->setRequestBody(propfind_body);
+
+    if (dir->request->beginRequest(&daverr) != 0) {
+        davix2gliberr(daverr, err, __func__);
+        Davix::DavixError::clearError(&daverr);
+        return NULL;
+    }
+
+    int code = dir->request->getRequestCode();
+    if (code != 207) {
+        if (recursive && code == 403) {
+            gfal2_set_error(err, http_plugin_domain, EOPNOTSUPP, __func__,
+                            "The endpoint refuses PROPFIND with Depth: infinity");
+        }
+        else if (code == 200) {
+            gfal2_set_error(err, http_plugin_domain, ENOTDIR, __func__,
+                            "%s is not a directory, or the endpoint does not support WebDav", stripped_url);
+        }
+        else {
+            http2gliberr(err, code, __func__, "Could not list the directory: ");
+        }
+        return NULL;
+    }
+    return dir.release();
+}
+
+
 gfal_file_handle gfal_http_opendir(plugin_handle plugin_data, const char* url,
                                    GError** err)
 {
@@ -274,35 +457,98 @@ gfal_file_handle gfal_http_opendir(plugin_handle plugin_data, const char* url,
     GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
     Davix::DavixError* daverr = NULL;
 
+    bool streaming = gfal2_get_opt_boolean_with_default(davix->handle, "HTTP PLUGIN",
+                                                        HTTP_CONFIG_STREAMING_LISTING, FALSE);
+
+    // Object stores (S3, GCloud, Swift) are not listed with PROPFIND, leave those to Davix
+    std::string protocol = Davix::Uri(stripped_url).getProtocol();
+    if (streaming && (protocol.compare(0, 4, "http") == 0 || protocol.compare(0, 3, "dav") == 0)) {
+        GfalHttpDir* dir = gfal_http_opendir_streaming(davix, stripped_url, false, err);
+        if (dir == NULL) {
+            return NULL;
+        }
+        return gfal_file_handle_new2(gfal_http_get_name(), dir, NULL, url);
+    }
+
     Davix::RequestParams req_params;
     davix->get_params(&req_params, Davix::Uri(stripped_url));
 
-    DAVIX_DIR* dir = davix->posix.opendirpp(&req_params, stripped_url, &daverr);
-    if (dir == NULL) {
+    DAVIX_DIR* davix_dir = davix->posix.opendirpp(&req_params, stripped_url, &daverr);
+    if (davix_dir == NULL) {
         davix2gliberr(daverr, err, __func__);
         Davix::DavixError::clearError(&daverr);
         return NULL;
     }
+    GfalHttpDir* dir = new GfalHttpDir();
+    dir->davix_dir = davix_dir;
     return gfal_file_handle_new2(gfal_http_get_name(), dir, NULL, url);
 }
 
 
+// Next entry of a streamed listing, reading more of the answer when needed
+// Return 1 and fill entry and name, 0 at the end of the listing, -1 on error
+static int gfal_http_next_entry(GfalHttpDir* dir, PropfindEntry& entry, std::string& name, GError** err)
+{
+    try {
+        while (true) {
+            while (dir->parser.next(entry)) {
+                if (PropfindStreamParser::entry_name(dir->base_path, entry.path, &name)) {
+                    return 1;
+                }
+            }
+
+            if (dir->eof) {
+                return 0;
+            }
+
+            Davix::DavixError* daverr = NULL;
+            dav_ssize_t read = dir->request->readBlock(dir->block.data(), dir->block.size(), &daverr);
+            if (read < 0) {
+                davix2gliberr(daverr, err, __func__);
+                Davix::DavixError::clearError(&daverr);
+                return -1;
+            }
+            if (read == 0) {
+                dir->eof = true;
+                dir->request->endRequest(NULL);
+            }
+            else {
+                dir->parser.feed(dir->block.data(), read);
+            }
+        }
+    }
+    catch (const Gfal::CoreException& e) {
+        gfal2_set_error(err, e.domain(), e.code(), __func__, "%s", e.what());
+    }
+    return -1;
+}
+
+
+static struct dirent* gfal_http_readdir_streaming(GfalHttpDir* dir, struct stat* st, GError** err)
+{
+    PropfindEntry entry;
+    std::string name;
+
+    if (gfal_http_next_entry(dir, entry, name, err) <= 0) {
+        return NULL;
+    }
+    if (name.size() >= sizeof(dir->de.d_name)) {
+        gfal2_set_error(err, http_plugin_domain, ENAMETOOLONG, __func__,
+                        "Entry name too long: %s", name.c_str());
+        return NULL;
+    }
+    g_strlcpy(dir->de.d_name, name.c_str(), sizeof(dir->de.d_name));
+    dir->de.d_type = S_ISDIR(entry.st.st_mode) ? DT_DIR : DT_REG;
+    *st = entry.st;
+    return &dir->de;
+}
+
 
 struct dirent* gfal_http_readdir(plugin_handle plugin_data,
         gfal_file_handle dir_desc, GError** err)
 {
-    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
-    Davix::DavixError* daverr = NULL;
-
-    daverr = NULL;
     struct stat _;
-    struct dirent* de = davix->posix.readdirpp((DAVIX_DIR*)gfal_file_handle_get_fdesc(dir_desc),
-                                             &_, &daverr);
-    if (de == NULL && daverr != NULL) {
-        davix2gliberr(daverr, err, __func__);
-        Davix::DavixError::clearError(&daverr);
-    }
-    return de;
+    return gfal_http_readdirpp(plugin_data, dir_desc, &_, err);
 }
 
 
@@ -311,11 +557,14 @@ struct dirent* gfal_http_readdirpp(plugin_handle plugin_data,
         gfal_file_handle dir_desc, struct stat* st, GError** err)
 {
     GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    GfalHttpDir* dir = static_cast<GfalHttpDir*>(gfal_file_handle_get_fdesc(dir_desc));
     Davix::DavixError* daverr = NULL;
 
-    daverr = NULL;
-    struct dirent* de = davix->posix.readdirpp((DAVIX_DIR*)gfal_file_handle_get_fdesc(dir_desc),
-                                               st, &daverr);
+    if (dir->request) {
+        return gfal_http_readdir_streaming(dir, st, err);
+    }
+
+    struct dirent* de = davix->posix.readdirpp(dir->davix_dir, st, &daverr);
     if (de == NULL && daverr != NULL) {
         davix2gliberr(daverr, err, __func__);
         Davix::DavixError::clearError(&daverr);
@@ -324,17 +573,57 @@ struct dirent* gfal_http_readdirpp(plugin_handle plugin_data,
 }
 
 
+int gfal_http_list_tree(plugin_handle plugin_data, const char* url, gfal2_tree_entry_cb callback,
+                        void* user_data, GError** err)
+{
+    char stripped_url[GFAL_URL_MAX_LEN];
+    strip_3rd_from_url(url, stripped_url, sizeof(stripped_url));
+
+    // Only WebDav can do a Depth: infinity PROPFIND
+    std::string protocol = Davix::Uri(stripped_url).getProtocol();
+    if (protocol.compare(0, 4, "http") != 0 && protocol.compare(0, 3, "dav") != 0) {
+        gfal2_set_error(err, http_plugin_domain, EOPNOTSUPP, __func__,
+                        "Recursive listing is not supported for %s", protocol.c_str());
+        return -1;
+    }
+
+    GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    std::unique_ptr<GfalHttpDir> dir(gfal_http_opendir_streaming(davix, stripped_url, true, err));
+    if (!dir) {
+        return -1;
+    }
+
+    PropfindEntry entry;
+    std::string name;
+    gfal2_tree_entry_t tree_entry;
+    int ret;
+
+    while ((ret = gfal_http_next_entry(dir.get(), entry, name, err)) > 0) {
+        tree_entry.path = name.c_str();
+        tree_entry.st = entry.st;
+        if (callback(&tree_entry, user_data) != 0) {
+            gfal2_set_error(err, http_plugin_domain, ECANCELED, __func__,
+                            "Recursive listing stopped by the callback");
+            return -1;
+        }
+    }
+    return ret;
+}
+
+
 int gfal_http_closedir(plugin_handle plugin_data, gfal_file_handle dir_desc, GError** err)
 {
     GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
+    GfalHttpDir* dir = static_cast<GfalHttpDir*>(gfal_file_handle_get_fdesc(dir_desc));
     Davix::DavixError* daverr = NULL;
     int ret = 0;
 
-    if (davix->posix.closedir((DAVIX_DIR*) gfal_file_handle_get_fdesc(dir_desc), &daverr) != 0) {
+    if (dir->davix_dir && davix->posix.closedir(dir->davix_dir, &daverr) != 0) {
         davix2gliberr(daverr, err, __func__);
         Davix::DavixError::clearError(&daverr);
         ret = -1;
     }
+    delete dir;
     gfal_file_handle_delete(dir_desc);
     return ret;
 }
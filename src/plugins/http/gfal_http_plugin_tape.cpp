@@ -15,7 +15,9 @@
  */
 
 #include <cstring>
+#include <ctime>
 #include <sstream>
+#include <vector>
 #include <json.h>
 
 #include "uri/gfal2_parsing.h"
@@ -111,46 +113,79 @@ namespace tape_rest_api {
         g_error_free(tmp_err);
     }
 
-    // Run through the full response and identify the JSON item corresponding to our path
-    // Very inefficient O(N^2) complexity but avoids complicated data structures (tape polling is time permissive)
-    struct json_object* polling_get_item_by_path(struct json_object* response, const std::string& surl) {
-        const int len = json_object_array_length(response);
-        for (int i = 0; i < len; i++) {
-            auto item = json_object_array_get_idx(response, i);
-
-            if (item != NULL) {
-                struct json_object* item_path = 0;
-                json_object_object_get_ex(item, "path", &item_path);
-                std::string path = item_path ? json_object_get_string(item_path) : "";
+    // Run the request, and parse its JSON answer as it arrives
+    // @return the document, owned by the caller, or NULL with err set
+    struct json_object* stream_json_response(Davix::HttpRequest& request, const char* what, GError** err) {
+        Davix::DavixError* reqerr = NULL;
 
-                if (!path.empty()) {
-                    std::string cpath = collapse_slashes(path);
-                    std::string csurl = collapse_slashes(surl);
+        if (request.beginRequest(&reqerr)) {
+            gfal2_set_error(err, http_plugin_domain, davix2errno(reqerr->getStatus()), __func__,
+                            "[Tape REST API] %s call failed: %s", what, reqerr->getErrMsg().c_str());
+            Davix::DavixError::clearError(&reqerr);
+            return NULL;
+        }
 
-                    if (cpath == csurl) {
-                        return item;
-                    }
-                }
+        const int code = request.getRequestCode();
+        std::vector<char> block(64 * 1024);
+        JsonStreamParser parser;
+        std::string error_body;
+        size_t total = 0;
+        bool malformed = false;
+        dav_ssize_t read;
+
+        while (!malformed && (read = request.readBlock(block.data(), block.size(), &reqerr)) > 0) {
+            total += read;
+            if (code != 200) {
+                // Only the beginning of an error body is worth reporting
+                error_body.append(block.data(), std::min<size_t>(read, 1024 - std::min<size_t>(error_body.size(), 1024)));
+            } else {
+                malformed = !parser.feed(block.data(), read);
             }
         }
 
-        return NULL;
+        if (!malformed && read < 0) {
+            gfal2_set_error(err, http_plugin_domain, davix2errno(reqerr->getStatus()), __func__,
+                            "[Tape REST API] %s call failed: %s", what, reqerr->getErrMsg().c_str());
+            Davix::DavixError::clearError(&reqerr);
+            request.endRequest(NULL);
+            return NULL;
+        }
+        request.endRequest(NULL);
+
+        if (code != 200) {
+            gfal2_set_error(err, http_plugin_domain, EINVAL, __func__,
+                            "[Tape REST API] %s call failed: HTTP %d: %s", what, code, error_body.c_str());
+            return NULL;
+        }
+
+        if (total == 0) {
+            gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__,
+                            "[Tape REST API] Response with no data");
+            return NULL;
+        }
+
+        struct json_object* response = parser.finish();
+
+        if (!response) {
+            gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__,
+                            "[Tape REST API] Malformed served response");
+        }
+
+        return response;
     }
 
-    std::string get_archiveinfo(plugin_handle plugin_data, int nbfiles, const char* const* urls, GError** err)
+    // Send "POST /archiveinfo" for the given files
+    // @return the files of the answer, or NULL with err set
+    std::shared_ptr<const TapeFileIndex> get_archiveinfo(plugin_handle plugin_data, int nbfiles,
+                                                         const char* const* urls, GError** err)
     {
-        GError* tmp_err = NULL;
         GfalHttpPluginData* davix = gfal_http_get_plugin_context(plugin_data);
-        std::string tapeEndpoint = gfal_http_discover_tape_endpoint(davix, urls[0],"/archiveinfo",
-                                                                    &tmp_err);
+        std::string tapeEndpoint = gfal_http_discover_tape_endpoint(davix, urls[0],"/archiveinfo", err);
 
-        if (tmp_err != NULL) {
-            *err = g_error_copy(tmp_err);
-            g_error_free(tmp_err);
-            return "";
+        if (*err != NULL) {
+            return NULL;
         }
 
-        // Construct and send "POST /archiveinfo" request
         Davix::DavixError* reqerr = NULL;
         Davix::Uri uri(tapeEndpoint);
         Davix::RequestParams params;
@@ -161,35 +196,20 @@ namespace tape_rest_api {
         request.setParameters(params);
         request.setRequestBody(tape_rest_api::list_files_body(nbfiles, urls));
 
-        if (request.executeRequest(&reqerr)) {
-            gfal2_set_error(err, http_plugin_domain, davix2errno(reqerr->getStatus()), __func__,
-                            "[Tape REST API] Archive polling call failed: %s", reqerr->getErrMsg().c_str());
-            Davix::DavixError::clearError(&reqerr);
-            return "";
-        }
+        struct json_object* json_response = stream_json_response(request, "Archive polling", err);
 
-        if (request.getRequestCode() != 200) {
-            gfal2_set_error(err, http_plugin_domain, EINVAL, __func__,
-                            "[Tape REST API] Archive polling call failed: %s: %s",
-                            reqerr->getErrMsg().c_str(), request.getAnswerContent());
-            Davix::DavixError::clearError(&reqerr);
-            return "";
+        if (!json_response) {
+            return NULL;
         }
 
-        std::string content = request.getAnswerContent();
-
-        if (content.empty()) {
-            gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__,
-                            "[Tape REST API] Response with no data");
-            return "";
-        }
-
-        return content;
+        std::shared_ptr<const TapeFileIndex> files = std::make_shared<TapeFileIndex>(json_response);
+        json_object_put(json_response);
+        return files;
     }
 
     // Get locality field from "/archiveinfo" response
     // On failed request, sets the "err" object
-    file_locality_t get_file_locality(struct json_object* file, const std::string& path, GError** err) {
+    file_locality_t get_file_locality(const TapeFileStatus* file, const std::string& path, GError** err) {
         file_locality_t locality{false, false};
 
         if (file == NULL) {
@@ -198,27 +218,19 @@ namespace tape_rest_api {
             return locality;
         }
 
-        // Check if "error" attribute exists
-        struct json_object *file_error_text = 0;
-        bool foundError = json_object_object_get_ex(file, "error", &file_error_text);
-
-        if (foundError) {
-            std::string error_text = json_object_get_string(file_error_text);
-            gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__, "[Tape REST API] %s", error_text.c_str());
+        if (file->has_error) {
+            gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__, "[Tape REST API] %s", file->error.c_str());
             return locality;
         }
 
         // Retrieve "locality" attribute
-        struct json_object *file_locality = 0;
-        bool localityExist = json_object_object_get_ex(file, "locality", &file_locality);
-
-        if (!localityExist) {
+        if (!file->has_locality) {
             gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__,
                             "[Tape REST API] Locality attribute missing");
             return locality;
         }
 
-        std::string locality_text = json_object_get_string(file_locality);
+        const std::string& locality_text = file->locality;
 
         if (locality_text == "TAPE") {
             locality.on_tape = true;
@@ -266,26 +278,24 @@ ssize_t gfal_http_getxattr_internal(plugin_handle plugin_data, const char* url,
         endpoint << ":" << uri.getPort();
     }
 
-    auto it = davix->tape_endpoint_map.find(endpoint.str());
+    GfalHttpPluginData::tape_endpoint_info_t info;
 
-    if (it == davix->tape_endpoint_map.end()) {
-        davix->retrieve_and_store_tape_endpoint(endpoint.str(), &tmp_err);
+    if (!davix->tape_endpoint_map.find(endpoint.str(), info)) {
+        info = davix->retrieve_and_store_tape_endpoint(endpoint.str(), &tmp_err);
 
         if (tmp_err != NULL) {
             *err = g_error_copy(tmp_err);
             g_clear_error(&tmp_err);
             return -1;
         }
-
-        it = davix->tape_endpoint_map.find(endpoint.str());
     }
 
     if (strcmp(key, GFAL_XATTR_TAPE_API_VERSION) == 0) {
-        strncpy(buff, it->second.version.c_str(), s_buff);
+        strncpy(buff, info.version.c_str(), s_buff);
     } else if (strcmp(key, GFAL_XATTR_TAPE_API_URI) == 0) {
-        strncpy(buff, it->second.uri.c_str(), s_buff);
+        strncpy(buff, info.uri.c_str(), s_buff);
     } else if (strcmp(key, GFAL_XATTR_TAPE_API_SITENAME) == 0) {
-        strncpy(buff, it->second.sitename.c_str(), s_buff);
+        strncpy(buff, info.sitename.c_str(), s_buff);
     } else {
         gfal2_set_error(err, http_plugin_domain, ENODATA, __func__,
                         "Failed to get the xattr \"%s\" (No data available)", key);
@@ -529,79 +539,81 @@ int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, con
         return -1;
     }
 
-    // Construct and send "GET /stage/<token>" request
-    Davix::DavixError* reqerr = NULL;
-    Davix::Uri uri(tapeEndpoint);
-    Davix::RequestParams params;
-
-    GetRequest request(davix->context, uri, &reqerr);
-    davix->get_params(&params, uri, GfalHttpPluginData::OP::TAPE);
-    request.setParameters(params);
+    // Subsets of the same request polled in a row share a single answer
+    std::shared_ptr<const TapeFileIndex> files;
+    GfalHttpPluginData::tape_poll_result cached;
+    int cache_ttl = gfal2_get_opt_integer_with_default(davix->handle, "HTTP PLUGIN",
+                                                       HTTP_CONFIG_TAPE_POLL_CACHE_TTL, 5);
+    time_t now = time(NULL);
 
-    if (request.executeRequest(&reqerr)) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, davix2errno(reqerr->getStatus()), __func__,
-                        "[Tape REST API] Stage pooling call failed: %s", reqerr->getErrMsg().c_str());
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        Davix::DavixError::clearError(&reqerr);
-        return -1;
+    if (cache_ttl > 0 && davix->tape_poll_cache.find(tapeEndpoint, cached) && cached.expiration > now) {
+        gfal2_log(G_LOG_LEVEL_DEBUG, "[Tape REST API] Reusing the poll answer of request %s", token);
+        files = cached.files;
     }
+    else {
+        // Construct and send "GET /stage/<token>" request
+        Davix::DavixError* reqerr = NULL;
+        Davix::Uri uri(tapeEndpoint);
+        Davix::RequestParams params;
 
-    if (request.getRequestCode() != 200) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, EINVAL, __func__,
-                        "[Tape REST API] Stage call failed: %s: %s)",
-                        reqerr->getErrMsg().c_str(), request.getAnswerContent());
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        Davix::DavixError::clearError(&reqerr);
-        return -1;
-    }
+        GetRequest request(davix->context, uri, &reqerr);
+        davix->get_params(&params, uri, GfalHttpPluginData::OP::TAPE);
+        request.setParameters(params);
 
-    std::string content = std::string(request.getAnswerContent());
+        struct json_object* json_response = tape_rest_api::stream_json_response(request, "Stage polling", &tmp_err);
 
-    if (content.empty()) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Response with no data");
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
-    }
+        if (!json_response) {
+            tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
+            return -1;
+        }
 
-    struct json_object* json_response = json_tokener_parse(content.c_str());
+        // Check if "id" attribute exists
+        struct json_object* id = 0;
+        bool foundId = json_object_object_get_ex(json_response, "id", &id);
+        std::string reqid = foundId ? json_object_get_string(id) : "";
 
-    if (!json_response) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Malformed served response");
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
-    }
+        // Check if "files" attribute exists
+        struct json_object* json_files = 0;
+        bool foundFiles = json_object_object_get_ex(json_response, "files", &json_files);
 
-    // Check if "id" attribute exists
-    struct json_object* id = 0;
-    bool foundId = json_object_object_get_ex(json_response, "id", &id);
-    std::string reqid = foundId ? json_object_get_string(id) : "";
+        if (foundFiles) {
+            files = std::make_shared<TapeFileIndex>(json_files);
+        }
 
-    // Check if "request_id" attribute matches
-    if (reqid.empty()) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Request ID missing from polling response (expected id=%s)", token);
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
-    }
+        // Free the top JSON object
+        json_object_put(json_response);
 
-    if (reqid != token) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Request ID mismatch. Expected id=%s but received id=%s", token, reqid.c_str());
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
-    }
+        // Check if "request_id" attribute matches
+        if (reqid.empty()) {
+            gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
+                            "[Tape REST API] Request ID missing from polling response (expected id=%s)", token);
+            tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
+            return -1;
+        }
+
+        if (reqid != token) {
+            gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
+                            "[Tape REST API] Request ID mismatch. Expected id=%s but received id=%s", token, reqid.c_str());
+            tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
+            return -1;
+        }
 
-    // Check if "files" attribute exists
-    struct json_object* files = 0;
-    bool foundFiles = json_object_object_get_ex(json_response, "files", &files);
+        if (!foundFiles) {
+            gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
+                            "[Tape REST API] Files attribute missing from server poll response");
+            tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
+            return -1;
+        }
 
-    if (!foundFiles) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Files attribute missing from server poll response");
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
+        if (cache_ttl > 0) {
+            // Stale entries are only overwritten, so drop everything once in a while
+            if (davix->tape_poll_cache.size() >= 1024) {
+                davix->tape_poll_cache.clear();
+            }
+            cached.expiration = now + cache_ttl;
+            cached.files = files;
+            davix->tape_poll_cache.set(tapeEndpoint, cached);
+        }
     }
 
     // Iterate over the "files" list
@@ -610,7 +622,7 @@ int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, con
 
     for (int i = 0; i < nbfiles; ++i) {
         std::string path = Davix::Uri(urls[i]).getPath();
-        struct json_object* file = tape_rest_api::polling_get_item_by_path(files, path);
+        const TapeFileStatus* file = files->find(path);
 
         if (file == NULL) {
             error_count++;
@@ -620,26 +632,16 @@ int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, con
         }
 
         // Check if "error" attribute exists
-        struct json_object* file_error_text = 0;
-        bool foundError = json_object_object_get_ex(file, "error", &file_error_text);
-
-        if (foundError) {
+        if (file->has_error) {
             error_count++;
-            std::string error_text = json_object_get_string(file_error_text);
             gfal2_set_error(&errors[i], http_plugin_domain, ENOMSG, __func__,
-                            "[Tape REST API] %s", error_text.c_str());
+                            "[Tape REST API] %s", file->error.c_str());
             continue;
         }
 
         // Retrieve "onDisk" attribute
-        struct json_object* file_on_disk = 0;
-        bool foundOnDisk = json_object_object_get_ex(file, "onDisk", &file_on_disk);
-
-        if (foundOnDisk) {
-            std::string disk = json_object_get_string(file_on_disk);
-            std::transform(disk.begin(), disk.end(), disk.begin(), tolower);
-
-            if (disk == "true") {
+        if (file->has_on_disk) {
+            if (file->on_disk) {
                 online_count++;
                 continue;
             } else {
@@ -650,17 +652,14 @@ int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, con
         }
 
         // Retrieve "state" attribute
-        struct json_object* file_state = 0;
-        bool foundState = json_object_object_get_ex(file, "state", &file_state);
-
-        if (!foundState) {
+        if (!file->has_state) {
             error_count++;
             gfal2_set_error(&errors[i], http_plugin_domain, ENOMSG, __func__,
                             "[Tape REST API] State and onDisk attributes missing");
             continue;
         }
 
-        std::string state = json_object_get_string(file_state);
+        const std::string& state = file->state;
 
         if (state == "COMPLETED") {
             online_count++;
@@ -683,9 +682,6 @@ int gfal_http_bring_online_poll_list(plugin_handle plugin_data, int nbfiles, con
         }
     }
 
-    // Free the top JSON object
-    json_object_put(json_response);
-
     // All files are on disk: return 1
     if (online_count == nbfiles) {
         return 1;
@@ -709,28 +705,15 @@ ssize_t gfal_http_status_getxattr(plugin_handle plugin_data, const char* url, ch
 {
     GError* tmp_err = NULL;
     const char* const urls[1] = {url};
-    std::string content = tape_rest_api::get_archiveinfo(plugin_data, 1, urls, &tmp_err);
-
-    if (tmp_err != NULL) {
-        *err = g_error_copy(tmp_err);
-        g_error_free(tmp_err);
-        return -1;
-    }
-
-    struct json_object* json_response = json_tokener_parse(content.c_str());
+    std::shared_ptr<const TapeFileIndex> files = tape_rest_api::get_archiveinfo(plugin_data, 1, urls, &tmp_err);
 
-    if (!json_response) {
-        gfal2_set_error(err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Malformed server response");
+    if (!files) {
+        *err = tmp_err;
         return -1;
     }
 
     std::string path = Uri(url).getPath();
-    struct json_object* file = tape_rest_api::polling_get_item_by_path(json_response, path);
-    tape_rest_api::file_locality_t locality = tape_rest_api::get_file_locality(file, path, &tmp_err);
-
-    // Free the top JSON object
-    json_object_put(json_response);
+    tape_rest_api::file_locality_t locality = tape_rest_api::get_file_locality(files->find(path), path, &tmp_err);
 
     if (tmp_err != NULL) {
         *err = g_error_copy(tmp_err);
@@ -776,18 +759,9 @@ int gfal_http_archive_poll_list(plugin_handle plugin_data, int nbfiles, const ch
     }
 
     GError* tmp_err = NULL;
-    std::string content = tape_rest_api::get_archiveinfo(plugin_data, nbfiles, urls, &tmp_err);
-
-    if (tmp_err != NULL) {
-        tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
-        return -1;
-    }
-
-    struct json_object* json_response = json_tokener_parse(content.c_str());
+    std::shared_ptr<const TapeFileIndex> files = tape_rest_api::get_archiveinfo(plugin_data, nbfiles, urls, &tmp_err);
 
-    if (!json_response) {
-        gfal2_set_error(&tmp_err, http_plugin_domain, ENOMSG, __func__,
-                        "[Tape REST API] Malformed server response");
+    if (!files) {
         tape_rest_api::copyErrors(tmp_err, nbfiles, errors);
         return -1;
     }
@@ -798,8 +772,7 @@ int gfal_http_archive_poll_list(plugin_handle plugin_data, int nbfiles, const ch
 
     for (int i = 0; i < nbfiles; ++i) {
         std::string path = Davix::Uri(urls[i]).getPath();
-        struct json_object* file = tape_rest_api::polling_get_item_by_path(json_response, path);
-        auto locality = tape_rest_api::get_file_locality(file, path, &tmp_err);
+        auto locality = tape_rest_api::get_file_locality(files->find(path), path, &tmp_err);
 
         if (tmp_err != NULL) {
             errors[i] = g_error_copy(tmp_err);
@@ -816,9 +789,6 @@ int gfal_http_archive_poll_list(plugin_handle plugin_data, int nbfiles, const ch
         }
     }
 
-    // Free the top JSON object
-    json_object_put(json_response);
-
     // All files are on tape: return 1
     if (ontape_count == nbfiles) {
         return 1;
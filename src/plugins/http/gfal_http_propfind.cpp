@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <glib.h>
+
+#include <exceptions/gfalcoreexception.hpp>
+#include "gfal_http_propfind.h"
+
+extern GQuark http_plugin_domain;
+
+
+// Local name of the tag starting at pos (just after '<' or '</'), and where the name ends
+static std::string tag_local_name(const std::string& xml, size_t pos, size_t end, size_t* name_end)
+{
+    size_t stop = pos;
+    size_t colon = std::string::npos;
+    while (stop < end && !isspace(static_cast<unsigned char>(xml[stop])) && xml[stop] != '>' && xml[stop] != '/') {
+        if (xml[stop] == ':' && colon == std::string::npos) {
+            colon = stop;
+        }
+        ++stop;
+    }
+    *name_end = stop;
+    if (colon != std::string::npos) {
+        pos = colon + 1;
+    }
+    return xml.substr(pos, stop - pos);
+}
+
+
+// Find the first element with the given local name within [begin, end)
+// On success, content_begin/content_end delimit its content, and element_end points after it
+static bool find_element(const std::string& xml, const char* local_name, size_t begin, size_t end,
+    size_t* content_begin, size_t* content_end, size_t* element_end)
+{
+    size_t pos = begin;
+    while ((pos = xml.find('<', pos)) != std::string::npos && pos < end) {
+        if (xml[pos + 1] == '/' || xml[pos + 1] == '?' || xml[pos + 1] == '!') {
+            ++pos;
+            continue;
+        }
+        size_t name_end;
+        std::string name = tag_local_name(xml, pos + 1, end, &name_end);
+        size_t tag_end = xml.find('>', name_end);
+        if (tag_end == std::string::npos || tag_end >= end) {
+            return false;
+        }
+        if (name != local_name) {
+            pos = tag_end;
+            continue;
+        }
+        // Self closing
+        if (xml[tag_end - 1] == '/') {
+            *content_begin = *content_end = tag_end + 1;
+            *element_end = tag_end + 1;
+            return true;
+        }
+        std::string closing = "</" + xml.substr(pos + 1, name_end - pos - 1);
+        size_t close = xml.find(closing, tag_end);
+        while (close != std::string::npos && close < end) {
+            size_t after = close + closing.size();
+            while (after < end && isspace(static_cast<unsigned char>(xml[after])))
+                ++after;
+            if (after < end && xml[after] == '>') {
+                *content_begin = tag_end + 1;
+                *content_end = close;
+                *element_end = after + 1;
+                return true;
+            }
+            close = xml.find(closing, after);
+        }
+        return false;
+    }
+    return false;
+}
+
+
+static std::string element_text(const std::string& xml, const char* local_name, size_t begin, size_t end)
+{
+    size_t content_begin, content_end, element_end;
+    if (!find_element(xml, local_name, begin, end, &content_begin, &content_end, &element_end)) {
+        return std::string();
+    }
+    std::string text = xml.substr(content_begin, content_end - content_begin);
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(first, last - first + 1);
+}
+
+
+static time_t parse_http_date(const std::string& date)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S", &tm) == NULL) {
+        return 0;
+    }
+    return timegm(&tm);
+}
+
+
+PropfindStreamParser::PropfindStreamParser(size_t max_response_size):
+    buffer(), consumed(0), max_response_size(max_response_size)
+{
+}
+
+
+void PropfindStreamParser::feed(const char* data, size_t len)
+{
+    // Drop what has been parsed already, so the buffer does not grow with the listing
+    if (consumed > 0 && consumed >= buffer.size() / 2) {
+        buffer.erase(0, consumed);
+        consumed = 0;
+    }
+    buffer.append(data, len);
+    if (buffer.size() - consumed > max_response_size + len) {
+        throw Gfal::CoreException(http_plugin_domain, EFBIG, "PROPFIND response entry too big");
+    }
+}
+
+
+bool PropfindStreamParser::next(PropfindEntry& entry)
+{
+    size_t content_begin, content_end, element_end;
+    if (!find_element(buffer, "response", consumed, buffer.size(), &content_begin, &content_end, &element_end)) {
+        return false;
+    }
+    consumed = element_end;
+
+    entry.path = decode_href(element_text(buffer, "href", content_begin, content_end));
+    memset(&entry.st, 0, sizeof(entry.st));
+    entry.st.st_mode = S_IFREG | 0644;
+    entry.st.st_nlink = 1;
+
+    // Only the properties of the propstat with a 200 status are valid
+    size_t pos = content_begin;
+    size_t propstat_begin, propstat_end, propstat_element_end;
+    while (find_element(buffer, "propstat", pos, content_end, &propstat_begin, &propstat_end, &propstat_element_end)) {
+        pos = propstat_element_end;
+        std::string status = element_text(buffer, "status", propstat_begin, propstat_end);
+        if (status.find(" 200") == std::string::npos) {
+            continue;
+        }
+
+        size_t type_begin, type_end, type_element_end;
+        if (find_element(buffer, "resourcetype", propstat_begin, propstat_end, &type_begin, &type_end, &type_element_end)) {
+            size_t c1, c2, c3;
+            if (find_element(buffer, "collection", type_begin, type_end, &c1, &c2, &c3)) {
+                entry.st.st_mode = S_IFDIR | 0755;
+            }
+        }
+        std::string length = element_text(buffer, "getcontentlength", propstat_begin, propstat_end);
+        if (!length.empty()) {
+            entry.st.st_size = strtoll(length.c_str(), NULL, 10);
+        }
+        std::string modified = element_text(buffer, "getlastmodified", propstat_begin, propstat_end);
+        if (!modified.empty()) {
+            entry.st.st_mtime = entry.st.st_ctime = entry.st.st_atime = parse_http_date(modified);
+        }
+    }
+    return true;
+}
+
+
+size_t PropfindStreamParser::pending() const
+{
+    return buffer.size() - consumed;
+}
+
+
+std::string PropfindStreamParser::decode_href(const std::string& href)
+{
+    static const struct {
+        const char* entity;
+        char value;
+    } entities[] = {{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+
+    std::string path;
+    size_t start = 0;
+    size_t scheme = href.find("://");
+    if (scheme != std::string::npos) {
+        start = href.find('/', scheme + 3);
+        if (start == std::string::npos) {
+            return "/";
+        }
+    }
+
+    for (size_t i = start; i < href.size(); ++i) {
+        if (href[i] == '&') {
+            bool decoded = false;
+            for (size_t e = 0; e < sizeof(entities) / sizeof(entities[0]); ++e) {
+                if (href.compare(i, strlen(entities[e].entity), entities[e].entity) == 0) {
+                    path.push_back(entities[e].value);
+                    i += strlen(entities[e].entity) - 1;
+                    decoded = true;
+                    break;
+                }
+            }
+            if (!decoded) {
+                path.push_back('&');
+            }
+        }
+        else {
+            path.push_back(href[i]);
+        }
+    }
+    return decode_path(path);
+}
+
+
+std::string PropfindStreamParser::decode_path(const std::string& encoded)
+{
+    std::string path;
+    path.reserve(encoded.size());
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        char c = encoded[i];
+        if (c == '%' && i + 2 < encoded.size() &&
+            isxdigit(static_cast<unsigned char>(encoded[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(encoded[i + 2]))) {
+            c = static_cast<char>(strtol(encoded.substr(i + 1, 2).c_str(), NULL, 16));
+            i += 2;
+        }
+        if (c == '/' && !path.empty() && path.back() == '/') {
+            continue;
+        }
+        path.push_back(c);
+    }
+    return path;
+}
+
+
+bool PropfindStreamParser::entry_name(const std::string& base_path, const std::string& entry_path,
+    std::string* name)
+{
+    std::string path = entry_path;
+    if (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+    // The listed directory itself is part of the answer
+    if (path.size() <= base_path.size() || path.compare(0, base_path.size(), base_path) != 0) {
+        return false;
+    }
+    *name = path.substr(base_path.size());
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_PROPFIND_H
+#define _GFAL_HTTP_PROPFIND_H
+
+#include <string>
+#include <sys/stat.h>
+
+/**
+ * One <response> of a WebDAV multistatus
+ */
+struct PropfindEntry {
+    /// decoded path of the resource, without scheme nor host
+    std::string path;
+    /// metadata found in the successful propstat
+    struct stat st;
+};
+
+/**
+ * Incremental parser of a PROPFIND multistatus answer.
+ *
+ * The body is fed as it arrives, and each <response> element is extracted as soon as it is
+ * complete, so only the response being parsed is kept in memory, whatever the number of entries.
+ * Namespace prefixes are ignored, only local names are matched.
+ */
+class PropfindStreamParser {
+public:
+    /// @param max_response_size maximum size of a single <response> element
+    explicit PropfindStreamParser(size_t max_response_size = 1 << 20);
+
+    /// Append a chunk of the body
+    /// Throws Gfal::CoreException if a response element grows beyond max_response_size
+    void feed(const char* data, size_t len);
+
+    /// Extract the next complete response
+    /// @return false if more data is needed
+    bool next(PropfindEntry& entry);
+
+    /// Number of bytes buffered and not parsed yet
+    size_t pending() const;
+
+    /// Percent and XML entity decoding of an href, and removal of scheme://host
+    /// Consecutive slashes are collapsed, as done by decode_path
+    static std::string decode_href(const std::string& href);
+
+    /// Percent decoding of a path, collapsing consecutive slashes
+    static std::string decode_path(const std::string& path);
+
+    /// Name of an entry relative to the listed directory base_path, which must be
+    /// decoded with decode_path and end with a slash.
+    /// @return false if the entry is not below base_path, i.e. the directory itself
+    static bool entry_name(const std::string& base_path, const std::string& entry_path, std::string* name);
+
+private:
+    std::string buffer;
+    size_t consumed;
+    size_t max_response_size;
+};
+
+#endif // _GFAL_HTTP_PROPFIND_H
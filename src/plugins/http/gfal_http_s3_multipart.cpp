@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include <exceptions/gfalcoreexception.hpp>
+#include "gfal_http_plugin.h"
+#include "gfal_http_s3_multipart.h"
+
+
+const size_t S3MultipartUpload::MIN_PART_SIZE;
+const unsigned S3MultipartUpload::MAX_PARTS;
+
+
+size_t S3MultipartUpload::part_size_for(size_t part_size, off_t total_size)
+{
+    part_size = std::max(part_size, MIN_PART_SIZE);
+    if (total_size > 0) {
+        size_t needed = (static_cast<size_t>(total_size) + MAX_PARTS - 1) / MAX_PARTS;
+        part_size = std::max(part_size, needed);
+    }
+    return part_size;
+}
+
+
+S3MultipartUpload::S3MultipartUpload(Backend& backend, gfal2_context_t context, size_t part_size,
+                                     unsigned concurrency, unsigned retries, unsigned retry_delay_ms):
+    backend(backend), context(context), part_size(std::max<size_t>(part_size, 1)),
+    concurrency(std::max(concurrency, 1u)), retries(retries), retry_delay_ms(retry_delay_ms),
+    part_count(0), completed(false), aborted(false),
+    in_flight(0), stop(false), error(NULL), uploaded(0)
+{
+}
+
+
+S3MultipartUpload::~S3MultipartUpload()
+{
+    abort();
+    g_clear_error(&error);
+}
+
+
+bool S3MultipartUpload::is_canceled() const
+{
+    return context != NULL && gfal2_is_canceled(context);
+}
+
+
+ssize_t S3MultipartUpload::write(const void* buffer, size_t count, GError** err)
+{
+    const char* data = static_cast<const char*>(buffer);
+    size_t left = count;
+
+    if (completed || aborted) {
+        gfal2_set_error(err, http_plugin_domain, EBADF, __func__, "The upload is already over");
+        return -1;
+    }
+
+    while (left > 0) {
+        // A full part is only sent once more data comes, so an object of
+        // exactly one part can still go as a single PUT
+        if (current.size() >= part_size && flush(err) < 0) {
+            return -1;
+        }
+        if (current.capacity() < part_size) {
+            current.reserve(part_size);
+        }
+        size_t n = std::min(left, part_size - current.size());
+        current.insert(current.end(), data, data + n);
+        data += n;
+        left -= n;
+    }
+    return count;
+}
+
+
+int S3MultipartUpload::flush(GError** err)
+{
+    if (is_canceled()) {
+        gfal2_set_error(err, http_plugin_domain, ECANCELED, __func__, "Upload canceled");
+        return -1;
+    }
+
+    if (upload_id.empty()) {
+        try {
+            upload_id = backend.initiate();
+        }
+        catch (const Gfal::CoreException& e) {
+            gfal2_set_error(err, e.domain(), e.code(), __func__,
+                            "Could not initiate the multipart upload: %s", e.what());
+            return -1;
+        }
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Multipart upload %s started, parts of %zu bytes, %u at a time",
+                  upload_id.c_str(), part_size, concurrency);
+        for (unsigned i = 0; i < concurrency; ++i) {
+            workers.emplace_back(&S3MultipartUpload::worker_loop, this);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (error == NULL && queue.size() + in_flight >= concurrency) {
+        changed.wait(lock);
+    }
+    if (error != NULL) {
+        g_propagate_error(err, g_error_copy(error));
+        return -1;
+    }
+
+    Part part;
+    part.number = ++part_count;
+    part.data.swap(current);
+    queue.push_back(std::move(part));
+    changed.notify_all();
+    return 0;
+}
+
+
+void S3MultipartUpload::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        while (queue.empty() && !stop) {
+            changed.wait(lock);
+        }
+        if (queue.empty()) {
+            break;
+        }
+
+        Part part = std::move(queue.front());
+        queue.pop_front();
+        // Once a part failed for good, the rest is only drained
+        if (error != NULL) {
+            changed.notify_all();
+            continue;
+        }
+        ++in_flight;
+        lock.unlock();
+
+        GError* tmp_err = NULL;
+        std::string etag = upload_with_retries(part, &tmp_err);
+
+        lock.lock();
+        --in_flight;
+        if (tmp_err) {
+            if (error == NULL) {
+                error = tmp_err;
+            }
+            else {
+                g_error_free(tmp_err);
+            }
+        }
+        else {
+            etags[part.number] = etag;
+            uploaded += part.data.size();
+        }
+        changed.notify_all();
+    }
+}
+
+
+std::string S3MultipartUpload::upload_with_retries(const Part& part, GError** err)
+{
+    for (unsigned attempt = 0; ; ++attempt) {
+        if (is_canceled()) {
+            gfal2_set_error(err, http_plugin_domain, ECANCELED, __func__, "Upload canceled");
+            return std::string();
+        }
+        try {
+            return backend.upload_part(upload_id, part.number, part.data.data(), part.data.size());
+        }
+        catch (const Gfal::CoreException& e) {
+            if (attempt >= retries) {
+                gfal2_set_error(err, e.domain(), e.code(), __func__,
+                                "Part %u failed after %u attempts: %s", part.number, attempt + 1, e.what());
+                return std::string();
+            }
+            gfal2_log(G_LOG_LEVEL_WARNING, "Part %u failed (attempt %u of %u), retrying: %s",
+                      part.number, attempt + 1, retries + 1, e.what());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms * (attempt + 1)));
+    }
+}
+
+
+void S3MultipartUpload::stop_workers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    changed.notify_all();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+
+int S3MultipartUpload::finish(GError** err)
+{
+    if (completed || aborted) {
+        gfal2_set_error(err, http_plugin_domain, EBADF, __func__, "The upload is already over");
+        return -1;
+    }
+
+    if (upload_id.empty()) {
+        try {
+            backend.put(current.data(), current.size());
+        }
+        catch (const Gfal::CoreException& e) {
+            gfal2_set_error(err, e.domain(), e.code(), __func__, "Upload failed: %s", e.what());
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        uploaded += current.size();
+        completed = true;
+        return 0;
+    }
+
+    if (!current.empty() && flush(err) < 0) {
+        abort();
+        return -1;
+    }
+    stop_workers();
+
+    if (error != NULL) {
+        g_propagate_error(err, g_error_copy(error));
+        abort();
+        return -1;
+    }
+
+    std::vector<std::string> ordered;
+    ordered.reserve(etags.size());
+    for (auto& etag: etags) {
+        ordered.push_back(etag.second);
+    }
+
+    try {
+        backend.complete(upload_id, ordered);
+    }
+    catch (const Gfal::CoreException& e) {
+        gfal2_set_error(err, e.domain(), e.code(), __func__,
+                        "Could not complete the multipart upload: %s", e.what());
+        abort();
+        return -1;
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Multipart upload %s completed with %u parts", upload_id.c_str(), part_count);
+    completed = true;
+    return 0;
+}
+
+
+void S3MultipartUpload::abort()
+{
+    stop_workers();
+
+    if (upload_id.empty() || completed || aborted) {
+        return;
+    }
+    aborted = true;
+
+    try {
+        backend.abort(upload_id);
+        gfal2_log(G_LOG_LEVEL_DEBUG, "Multipart upload %s aborted", upload_id.c_str());
+    }
+    catch (const Gfal::CoreException& e) {
+        gfal2_log(G_LOG_LEVEL_WARNING, "Could not abort the multipart upload %s, its parts may be left behind: %s",
+                  upload_id.c_str(), e.what());
+    }
+}
+
+
+size_t S3MultipartUpload::bytes_uploaded() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return uploaded;
+}
+
+
+static std::string s3_escape(const std::string& value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string escaped;
+
+    for (unsigned char c: value) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            escaped += c;
+        }
+        else {
+            escaped += '%';
+            escaped += hex[c >> 4];
+            escaped += hex[c & 0x0F];
+        }
+    }
+    return escaped;
+}
+
+
+// Run the request, and turn both transport errors and unexpected status codes into exceptions
+static void s3_execute(Davix::HttpRequest& request, const char* what, int expected)
+{
+    Davix::DavixError* daverr = NULL;
+    GError* tmp_err = NULL;
+
+    if (request.executeRequest(&daverr)) {
+        davix2gliberr(daverr, &tmp_err, what);
+        Davix::DavixError::clearError(&daverr);
+    }
+    else if (request.getRequestCode() != expected) {
+        http2gliberr(&tmp_err, request.getRequestCode(), what, "Unexpected answer from the S3 endpoint");
+    }
+
+    if (tmp_err) {
+        Gfal::CoreException e(tmp_err);
+        g_error_free(tmp_err);
+        throw e;
+    }
+}
+
+
+S3DavixBackend::S3DavixBackend(Davix::Context& context, const Davix::RequestParams& params,
+                               const std::string& url):
+    context(context), params(params), url(url)
+{
+    this->params.setProtocol(Davix::RequestProtocol::AwsS3);
+}
+
+
+std::string S3DavixBackend::url_with_query(const std::string& query) const
+{
+    return url + (url.find('?') == std::string::npos ? "?" : "&") + query;
+}
+
+
+void S3DavixBackend::put(const char* data, size_t size)
+{
+    Davix::DavixError* daverr = NULL;
+    Davix::PutRequest request(context, Davix::Uri(url), &daverr);
+    request.setParameters(params);
+    request.setRequestBody(data, size);
+    s3_execute(request, __func__, 200);
+}
+
+
+std::string S3DavixBackend::initiate()
+{
+    Davix::DavixError* daverr = NULL;
+    Davix::PostRequest request(context, Davix::Uri(url_with_query("uploads")), &daverr);
+    request.setParameters(params);
+    s3_execute(request, __func__, 200);
+
+    const char* content = request.getAnswerContent();
+    std::string answer(content ? content : "");
+    size_t begin = answer.find("<UploadId>");
+    size_t end = answer.find("</UploadId>");
+    if (begin == std::string::npos || end == std::string::npos || end <= begin) {
+        throw Gfal::CoreException(http_plugin_domain, ENOMSG, "No UploadId in the answer to the initiate request");
+    }
+    begin += strlen("<UploadId>");
+    return answer.substr(begin, end - begin);
+}
+
+
+std::string S3DavixBackend::upload_part(const std::string& upload_id, unsigned part_number,
+                                        const char* data, size_t size)
+{
+    std::ostringstream query;
+    query << "partNumber=" << part_number << "&uploadId=" << s3_escape(upload_id);
+
+    Davix::DavixError* daverr = NULL;
+    Davix::PutRequest request(context, Davix::Uri(url_with_query(query.str())), &daverr);
+    request.setParameters(params);
+    request.setRequestBody(data, size);
+    s3_execute(request, __func__, 200);
+
+    std::string etag;
+    if (!request.getAnswerHeader("ETag", etag) || etag.empty()) {
+        throw Gfal::CoreException(http_plugin_domain, ENOMSG, "No ETag in the answer to the part upload");
+    }
+    return etag;
+}
+
+
+void S3DavixBackend::complete(const std::string& upload_id, const std::vector<std::string>& etags)
+{
+    std::ostringstream body;
+    body << "<CompleteMultipartUpload>";
+    for (size_t i = 0; i < etags.size(); ++i) {
+        body << "<Part><PartNumber>" << (i + 1) << "</PartNumber><ETag>" << etags[i] << "</ETag></Part>";
+    }
+    body << "</CompleteMultipartUpload>";
+
+    Davix::DavixError* daverr = NULL;
+    Davix::PostRequest request(context, Davix::Uri(url_with_query("uploadId=" + s3_escape(upload_id))), &daverr);
+    request.setParameters(params);
+    request.setRequestBody(body.str());
+    s3_execute(request, __func__, 200);
+
+    // The completion can fail after the 200 status was sent
+    const char* content = request.getAnswerContent();
+    if (content && strstr(content, "<Error>") != NULL) {
+        throw Gfal::CoreException(http_plugin_domain, EIO,
+                                  std::string("The multipart upload could not be completed: ") + content);
+    }
+}
+
+
+void S3DavixBackend::abort(const std::string& upload_id)
+{
+    Davix::DavixError* daverr = NULL;
+    Davix::DeleteRequest request(context, Davix::Uri(url_with_query("uploadId=" + s3_escape(upload_id))), &daverr);
+    request.setParameters(params);
+    s3_execute(request, __func__, 204);
+}
+
+
+bool gfal_http_s3_multipart_enabled(gfal2_context_t context, const char* url)
+{
+    if (strncmp("s3:", url, 3) != 0 && strncmp("s3s:", url, 4) != 0) {
+        return false;
+    }
+    return gfal2_get_opt_boolean_with_default(context, "HTTP PLUGIN", HTTP_CONFIG_S3_MULTIPART, TRUE);
+}
+
+
+S3MultipartUpload* gfal_http_s3_multipart_new(gfal2_context_t context, S3MultipartUpload::Backend& backend, off_t size)
+{
+    gint64 part_size = gfal2_get_opt_integer_with_default(context, "HTTP PLUGIN",
+                                                          HTTP_CONFIG_S3_PART_SIZE, 16 * 1024 * 1024);
+    int concurrency = gfal2_get_opt_integer_with_default(context, "HTTP PLUGIN", HTTP_CONFIG_S3_CONCURRENCY, 4);
+    int retries = gfal2_get_opt_integer_with_default(context, "HTTP PLUGIN", HTTP_CONFIG_S3_RETRIES, 3);
+
+    return new S3MultipartUpload(backend, context,
+                                 S3MultipartUpload::part_size_for(std::max<gint64>(part_size, 0), size),
+                                 std::max(concurrency, 1), std::max(retries, 0));
+}
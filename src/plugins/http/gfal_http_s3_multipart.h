@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_S3_MULTIPART_H
+#define _GFAL_HTTP_S3_MULTIPART_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+#include <davix.hpp>
+#include <gfal_api.h>
+
+/**
+ * Uploads an object with the S3 multipart upload protocol.
+ *
+ * Written data is cut in parts of part_size bytes, and up to concurrency parts
+ * are uploaded at the same time, each retried on its own. Memory is bounded to
+ * (concurrency + 1) * part_size. An object that fits in a single part is sent
+ * with a plain PUT instead, when finished.
+ * The upload is aborted if it is not finished successfully.
+ */
+class S3MultipartUpload {
+public:
+    /// Performs the S3 requests. Failures are thrown as Gfal::CoreException
+    class Backend {
+    public:
+        virtual ~Backend() {}
+
+        /// Upload the whole object with a single request
+        virtual void put(const char* data, size_t size) = 0;
+        /// @return the upload id
+        virtual std::string initiate() = 0;
+        /// @return the ETag of the part
+        virtual std::string upload_part(const std::string& upload_id, unsigned part_number,
+                                        const char* data, size_t size) = 0;
+        virtual void complete(const std::string& upload_id, const std::vector<std::string>& etags) = 0;
+        virtual void abort(const std::string& upload_id) = 0;
+    };
+
+    /// S3 refuses smaller parts, except for the last one
+    static const size_t MIN_PART_SIZE = 5 * 1024 * 1024;
+    /// S3 refuses uploads with more parts
+    static const unsigned MAX_PARTS = 10000;
+
+    /// Part size to use for an object of total_size bytes (negative if unknown),
+    /// so that it fits in MAX_PARTS
+    static size_t part_size_for(size_t part_size, off_t total_size);
+
+    /// @param context used to check for cancellation, may be NULL
+    S3MultipartUpload(Backend& backend, gfal2_context_t context, size_t part_size,
+                      unsigned concurrency, unsigned retries, unsigned retry_delay_ms = 1000);
+    ~S3MultipartUpload();
+
+    S3MultipartUpload(const S3MultipartUpload&) = delete;
+    S3MultipartUpload& operator=(const S3MultipartUpload&) = delete;
+
+    /// Append count bytes to the object. Blocks while all the upload slots are busy
+    /// @return count, or -1 on error
+    ssize_t write(const void* buffer, size_t count, GError** err);
+
+    /// Upload what is left and complete the upload
+    int finish(GError** err);
+
+    /// Give up, and discard the parts already uploaded
+    void abort();
+
+    /// Bytes acknowledged by the server so far
+    size_t bytes_uploaded() const;
+
+    /// True once the object is being uploaded in parts
+    bool is_multipart() const {
+        return !upload_id.empty();
+    }
+
+private:
+    struct Part {
+        unsigned number;
+        std::vector<char> data;
+    };
+
+    Backend& backend;
+    gfal2_context_t context;
+    size_t part_size;
+    unsigned concurrency;
+    unsigned retries;
+    unsigned retry_delay_ms;
+
+    std::string upload_id;
+    /// Part being filled by write
+    std::vector<char> current;
+    unsigned part_count;
+    bool completed;
+    bool aborted;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> workers;
+    std::deque<Part> queue;
+    unsigned in_flight;
+    bool stop;
+    GError* error;
+    std::map<unsigned, std::string> etags;
+    size_t uploaded;
+
+    bool is_canceled() const;
+    int flush(GError** err);
+    void stop_workers();
+    void worker_loop();
+    std::string upload_with_retries(const Part& part, GError** err);
+};
+
+/// S3 requests done with Davix, with the signing parameters of the object URL
+class S3DavixBackend: public S3MultipartUpload::Backend {
+public:
+    S3DavixBackend(Davix::Context& context, const Davix::RequestParams& params, const std::string& url);
+
+    void put(const char* data, size_t size);
+    std::string initiate();
+    std::string upload_part(const std::string& upload_id, unsigned part_number, const char* data, size_t size);
+    void complete(const std::string& upload_id, const std::vector<std::string>& etags);
+    void abort(const std::string& upload_id);
+
+private:
+    Davix::Context& context;
+    Davix::RequestParams params;
+    std::string url;
+
+    std::string url_with_query(const std::string& query) const;
+};
+
+/// True if writes to url should go through S3MultipartUpload
+bool gfal_http_s3_multipart_enabled(gfal2_context_t context, const char* url);
+
+/// New multipart upload of an object of size bytes (negative if unknown), configured from the context
+S3MultipartUpload* gfal_http_s3_multipart_new(gfal2_context_t context, S3MultipartUpload::Backend& backend, off_t size);
+
+#endif // _GFAL_HTTP_S3_MULTIPART_H
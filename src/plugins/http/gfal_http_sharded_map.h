@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_SHARDED_MAP_H
+#define _GFAL_HTTP_SHARDED_MAP_H
+
+#include <functional>
+#include <map>
+#include <pthread.h>
+
+/**
+ * Map safe to share between threads.
+ *
+ * Keys are spread over N shards, each with its own map and reader-writer lock,
+ * so lookups run concurrently, and writers only block the shard they modify.
+ * Values are returned by copy, never by reference, as they may be replaced by another thread.
+ */
+template <typename K, typename V, size_t N = 16>
+class ShardedMap {
+public:
+    ShardedMap() {
+        for (size_t i = 0; i < N; ++i) {
+            pthread_rwlock_init(&shards[i].lock, NULL);
+        }
+    }
+
+    ~ShardedMap() {
+        for (size_t i = 0; i < N; ++i) {
+            pthread_rwlock_destroy(&shards[i].lock);
+        }
+    }
+
+    ShardedMap(const ShardedMap&) = delete;
+    ShardedMap& operator=(const ShardedMap&) = delete;
+
+    /// Copy into value the entry for key
+    /// @return false if there is none
+    bool find(const K& key, V& value) const {
+        const Shard& shard = shard_for(key);
+        ReadLock lock(shard.lock);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    /// Insert or replace the entry for key
+    void set(const K& key, const V& value) {
+        Shard& shard = shard_for(key);
+        WriteLock lock(shard.lock);
+        shard.map[key] = value;
+    }
+
+    /// Remove the entry for key
+    /// @return true if there was one
+    bool erase(const K& key) {
+        Shard& shard = shard_for(key);
+        WriteLock lock(shard.lock);
+        return shard.map.erase(key) > 0;
+    }
+
+    /// Remove the entry for key if pred returns true for it.
+    /// The test and the removal are atomic
+    /// @return true if the entry was removed
+    bool erase_if(const K& key, const std::function<bool(const V&)>& pred) {
+        Shard& shard = shard_for(key);
+        WriteLock lock(shard.lock);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end() || !pred(it->second)) {
+            return false;
+        }
+        shard.map.erase(it);
+        return true;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < N; ++i) {
+            ReadLock lock(shards[i].lock);
+            total += shards[i].map.size();
+        }
+        return total;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < N; ++i) {
+            WriteLock lock(shards[i].lock);
+            shards[i].map.clear();
+        }
+    }
+
+private:
+    struct Shard {
+        mutable pthread_rwlock_t lock;
+        std::map<K, V> map;
+    };
+
+    struct ReadLock {
+        pthread_rwlock_t& lock;
+        explicit ReadLock(pthread_rwlock_t& l): lock(l) { pthread_rwlock_rdlock(&lock); }
+        ~ReadLock() { pthread_rwlock_unlock(&lock); }
+    };
+
+    struct WriteLock {
+        pthread_rwlock_t& lock;
+        explicit WriteLock(pthread_rwlock_t& l): lock(l) { pthread_rwlock_wrlock(&lock); }
+        ~WriteLock() { pthread_rwlock_unlock(&lock); }
+    };
+
+    Shard shards[N];
+
+    Shard& shard_for(const K& key) {
+        return shards[std::hash<K>()(key) % N];
+    }
+
+    const Shard& shard_for(const K& key) const {
+        return shards[std::hash<K>()(key) % N];
+    }
+};
+
+#endif // _GFAL_HTTP_SHARDED_MAP_H
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) CERN 2022
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <json.h>
+#include <glib.h>
+
+#include "uri/gfal2_parsing.h"
+#include "gfal_http_tape_index.h"
+
+
+static std::string collapse_path(const char* path)
+{
+    char* collapsed_ptr = gfal2_path_collapse_slashes(path);
+    std::string collapsed(collapsed_ptr);
+    g_free(collapsed_ptr);
+    return collapsed;
+}
+
+
+static bool get_string_attribute(struct json_object* item, const char* key, std::string& value)
+{
+    struct json_object* attribute = NULL;
+    if (!json_object_object_get_ex(item, key, &attribute)) {
+        return false;
+    }
+    const char* str = json_object_get_string(attribute);
+    value = str ? str : "";
+    return true;
+}
+
+
+TapeFileIndex::TapeFileIndex(struct json_object* files)
+{
+    if (files == NULL || !json_object_is_type(files, json_type_array)) {
+        return;
+    }
+
+    const int len = json_object_array_length(files);
+    this->files.reserve(len);
+
+    for (int i = 0; i < len; ++i) {
+        struct json_object* item = json_object_array_get_idx(files, i);
+        std::string path;
+
+        if (item == NULL || !get_string_attribute(item, "path", path) || path.empty()) {
+            continue;
+        }
+
+        TapeFileStatus status;
+        status.has_error = get_string_attribute(item, "error", status.error);
+        status.has_state = get_string_attribute(item, "state", status.state);
+        status.has_locality = get_string_attribute(item, "locality", status.locality);
+
+        std::string on_disk;
+        status.has_on_disk = get_string_attribute(item, "onDisk", on_disk);
+        std::transform(on_disk.begin(), on_disk.end(), on_disk.begin(), ::tolower);
+        status.on_disk = (on_disk == "true");
+
+        // On duplicates, the first item wins, as with the former linear search
+        this->files.emplace(collapse_path(path.c_str()), std::move(status));
+    }
+}
+
+
+const TapeFileStatus* TapeFileIndex::find(const std::string& path) const
+{
+    auto it = files.find(collapse_path(path.c_str()));
+    if (it == files.end()) {
+        return NULL;
+    }
+    return &it->second;
+}
+
+
+JsonStreamParser::JsonStreamParser(): tokener(json_tokener_new()), root(NULL), failed(false)
+{
+}
+
+
+JsonStreamParser::~JsonStreamParser()
+{
+    json_object_put(root);
+    json_tokener_free(tokener);
+}
+
+
+bool JsonStreamParser::feed(const char* data, size_t len)
+{
+    while (!failed && root == NULL && len > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(len, INT_MAX));
+        root = json_tokener_parse_ex(tokener, data, chunk);
+
+        if (root == NULL && json_tokener_get_error(tokener) != json_tokener_continue) {
+            failed = true;
+        }
+        data += chunk;
+        len -= chunk;
+    }
+    // Anything after the document is ignored
+    return !failed;
+}
+
+
+struct json_object* JsonStreamParser::finish()
+{
+    struct json_object* result = root;
+    root = NULL;
+    return result;
+}
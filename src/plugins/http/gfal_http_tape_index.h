@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) CERN 2022
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_TAPE_INDEX_H
+#define _GFAL_HTTP_TAPE_INDEX_H
+
+#include <string>
+#include <unordered_map>
+
+struct json_object;
+struct json_tokener;
+
+/**
+ * What a Tape REST API response says about one file
+ */
+struct TapeFileStatus {
+    bool has_error;
+    std::string error;
+    /// "onDisk" attribute of a stage request
+    bool has_on_disk;
+    bool on_disk;
+    /// "state" attribute of a stage request
+    bool has_state;
+    std::string state;
+    /// "locality" attribute of an archiveinfo answer
+    bool has_locality;
+    std::string locality;
+
+    TapeFileStatus(): has_error(false), has_on_disk(false), on_disk(false),
+                      has_state(false), has_locality(false) {}
+};
+
+/**
+ * Files of a Tape REST API response, indexed by path.
+ *
+ * Built once per response, so looking up n files costs O(n) instead of rescanning
+ * the whole array for each of them. Holds plain copies of the attributes, so it
+ * outlives the JSON document and can be shared between threads.
+ */
+class TapeFileIndex {
+public:
+    /// Index the items of a JSON array of files, by their "path" with slashes collapsed.
+    /// Items without a path are skipped
+    explicit TapeFileIndex(struct json_object* files);
+
+    /// @return the status of the file, or NULL if the response does not mention it
+    const TapeFileStatus* find(const std::string& path) const;
+
+    size_t size() const {
+        return files.size();
+    }
+
+private:
+    std::unordered_map<std::string, TapeFileStatus> files;
+};
+
+/**
+ * Incremental JSON parser, fed with a response body as it arrives,
+ * so the body never needs to be held in memory as a whole.
+ */
+class JsonStreamParser {
+public:
+    JsonStreamParser();
+    ~JsonStreamParser();
+
+    JsonStreamParser(const JsonStreamParser&) = delete;
+    JsonStreamParser& operator=(const JsonStreamParser&) = delete;
+
+    /// Append a chunk of the body
+    /// @return false if the document is malformed
+    bool feed(const char* data, size_t len);
+
+    /// @return the parsed document, owned by the caller, or NULL if it is incomplete or malformed
+    struct json_object* finish();
+
+private:
+    struct json_tokener* tokener;
+    struct json_object* root;
+    bool failed;
+};
+
+#endif // _GFAL_HTTP_TAPE_INDEX_H
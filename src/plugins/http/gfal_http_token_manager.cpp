@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <glib.h>
+
+#include <gfal_api.h>
+#include "gfal_http_token_manager.h"
+
+// Delay before retrying a failed background refresh
+static const time_t REFRESH_RETRY_DELAY = 30;
+// Longest sleep of the refresh thread
+static const time_t REFRESH_MAX_SLEEP = 60;
+
+
+TokenManager::TokenManager():
+    refresh_margin(0), idle_limit(0), count(0), clock([] { return time(NULL); }), stop(false)
+{
+}
+
+
+TokenManager::~TokenManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    changed.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+
+time_t TokenManager::margin_for(const Entry& entry) const
+{
+    return std::min(refresh_margin, (entry.expiration - entry.issued) / 2);
+}
+
+
+bool TokenManager::usable(const Entry& entry, time_t now) const
+{
+    return entry.expiration > now && entry.expiration - now > margin_for(entry) / 2;
+}
+
+
+std::string TokenManager::endpoint_of(const Davix::Uri& uri)
+{
+    std::stringstream endpoint;
+    endpoint << uri.getProtocol() << "://" << uri.getHost() << ":" << uri.getPort();
+    return endpoint.str();
+}
+
+
+std::vector<std::string> TokenManager::components_of(const Davix::Uri& uri)
+{
+    std::vector<std::string> components;
+    const std::string& path = uri.getPath();
+    size_t begin = 0;
+
+    while (begin < path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end > begin) {
+            components.push_back(path.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return components;
+}
+
+
+bool TokenManager::find_locked(const std::string& endpoint, const std::vector<std::string>& components,
+                               bool write_access, time_t now, std::string& token)
+{
+    auto root = roots.find(endpoint);
+    if (root == roots.end()) {
+        return false;
+    }
+
+    // The token issued for the deepest path is the most restricted one, prefer it
+    Entry* found = NULL;
+    Node* node = &root->second;
+    size_t depth = 0;
+
+    while (true) {
+        if (node->write && usable(*node->write, now)) {
+            found = node->write.get();
+        }
+        else if (!write_access && node->read && usable(*node->read, now)) {
+            found = node->read.get();
+        }
+
+        if (depth == components.size()) {
+            break;
+        }
+        auto child = node->children.find(components[depth]);
+        if (child == node->children.end()) {
+            break;
+        }
+        node = child->second.get();
+        ++depth;
+    }
+
+    if (found) {
+        found->last_used = now;
+        token = found->token;
+        return true;
+    }
+    return false;
+}
+
+
+TokenManager::Node& TokenManager::node_for(const std::string& endpoint, const std::vector<std::string>& components)
+{
+    Node* node = &roots[endpoint];
+    for (auto component = components.begin(); component != components.end(); ++component) {
+        std::unique_ptr<Node>& child = node->children[*component];
+        if (!child) {
+            child.reset(new Node());
+        }
+        node = child.get();
+    }
+    return *node;
+}
+
+
+void TokenManager::store_locked(const std::string& endpoint, const std::vector<std::string>& components,
+                                bool write_access, const std::string& token, unsigned validity,
+                                const Exchange& exchange, bool used)
+{
+    Node& node = node_for(endpoint, components);
+    std::unique_ptr<Entry>& entry = write_access ? node.write : node.read;
+    time_t now = clock();
+
+    if (!entry) {
+        entry.reset(new Entry());
+        entry->last_used = now;
+        ++count;
+    }
+    if (used) {
+        entry->last_used = now;
+    }
+
+    entry->token = token;
+    entry->issued = now;
+    entry->expiration = now + validity * 60;
+    entry->next_attempt = now;
+    entry->validity = validity;
+    entry->exchange = exchange;
+
+    if (refresh_margin > 0 && !refresher.joinable()) {
+        refresher = std::thread(&TokenManager::refresh_loop, this);
+    }
+    changed.notify_all();
+}
+
+
+bool TokenManager::find(const Davix::Uri& uri, bool write_access, std::string& token)
+{
+    std::string endpoint = endpoint_of(uri);
+    std::vector<std::string> components = components_of(uri);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return find_locked(endpoint, components, write_access, clock(), token);
+}
+
+
+std::string TokenManager::get(const Davix::Uri& uri, bool write_access, unsigned validity,
+                              const Exchange& exchange)
+{
+    std::string endpoint = endpoint_of(uri);
+    std::vector<std::string> components = components_of(uri);
+    std::string key = endpoint + uri.getPath() + (write_access ? "#w" : "#r");
+    std::string token;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Wait for an exchange already running for the same path
+    while (in_flight.count(key) > 0) {
+        changed.wait(lock);
+    }
+    if (find_locked(endpoint, components, write_access, clock(), token)) {
+        return token;
+    }
+
+    in_flight.insert(key);
+    lock.unlock();
+
+    try {
+        token = exchange(validity);
+    }
+    catch (...) {
+        lock.lock();
+        in_flight.erase(key);
+        changed.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    in_flight.erase(key);
+    store_locked(endpoint, components, write_access, token, validity, exchange, true);
+    return token;
+}
+
+
+void TokenManager::set_refresh_margin(time_t margin)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    refresh_margin = std::max<time_t>(margin, 0);
+    changed.notify_all();
+}
+
+
+void TokenManager::set_idle_limit(time_t idle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    idle_limit = std::max<time_t>(idle, 0);
+    changed.notify_all();
+}
+
+
+void TokenManager::set_clock(const Clock& clock)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->clock = clock;
+    changed.notify_all();
+}
+
+
+size_t TokenManager::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+
+void TokenManager::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    roots.clear();
+    count = 0;
+}
+
+
+void TokenManager::collect_due(Node& node, const std::string& endpoint, std::vector<std::string>& components,
+                               time_t now, std::vector<Due>& due, time_t& next_wake)
+{
+    std::unique_ptr<Entry>* entries[] = {&node.read, &node.write};
+
+    for (int i = 0; i < 2; ++i) {
+        std::unique_ptr<Entry>& entry = *entries[i];
+        if (!entry) {
+            continue;
+        }
+
+        bool idle = idle_limit > 0 && now - entry->last_used > idle_limit;
+        if (entry->expiration <= now || idle) {
+            entry.reset();
+            --count;
+            continue;
+        }
+
+        time_t refresh_at = std::max(entry->expiration - margin_for(*entry), entry->next_attempt);
+        bool refreshable = refresh_margin > 0 && entry->expiration > entry->issued;
+        if (refreshable && refresh_at <= now) {
+            due.push_back(Due{endpoint, components, i == 1, entry->validity, entry->exchange});
+            entry->next_attempt = now + REFRESH_RETRY_DELAY;
+        }
+        else if (refreshable) {
+            next_wake = std::min(next_wake, refresh_at);
+        }
+        if (idle_limit > 0) {
+            next_wake = std::min(next_wake, entry->last_used + idle_limit + 1);
+        }
+    }
+
+    for (auto child = node.children.begin(); child != node.children.end();) {
+        components.push_back(child->first);
+        collect_due(*child->second, endpoint, components, now, due, next_wake);
+        components.pop_back();
+
+        Node& child_node = *child->second;
+        if (!child_node.read && !child_node.write && child_node.children.empty()) {
+            child = node.children.erase(child);
+        }
+        else {
+            ++child;
+        }
+    }
+}
+
+
+void TokenManager::refresh_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stop) {
+        time_t now = clock();
+        time_t next_wake = now + REFRESH_MAX_SLEEP;
+        std::vector<Due> due;
+
+        for (auto root = roots.begin(); root != roots.end(); ++root) {
+            std::vector<std::string> components;
+            collect_due(root->second, root->first, components, now, due, next_wake);
+        }
+
+        if (due.empty()) {
+            changed.wait_for(lock, std::chrono::seconds(next_wake - now));
+            continue;
+        }
+
+        // Exchanges are slow, do not hold the lock meanwhile.
+        // Stop between exchanges, so the destructor waits for one at most
+        lock.unlock();
+        for (auto it = due.begin(); it != due.end(); ++it) {
+            try {
+                std::string token = it->exchange(it->validity);
+                lock.lock();
+                store_locked(it->endpoint, it->components, it->write_access, token, it->validity, it->exchange,
+                             false);
+                lock.unlock();
+                std::string path;
+                for (auto component = it->components.begin(); component != it->components.end(); ++component) {
+                    path += "/" + *component;
+                }
+                gfal2_log(G_LOG_LEVEL_DEBUG, "(SEToken) Refreshed %s token for %s%s",
+                          it->write_access ? "write" : "read", it->endpoint.c_str(), path.c_str());
+            }
+            // Whatever went wrong, the token is retried later, and the thread must go on
+            catch (const std::exception& e) {
+                gfal2_log(G_LOG_LEVEL_INFO, "(SEToken) Background token refresh failed: %s", e.what());
+            }
+            catch (...) {
+                gfal2_log(G_LOG_LEVEL_INFO, "(SEToken) Background token refresh failed: unknown error");
+            }
+
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            bool stopping = stop;
+            lock.unlock();
+            if (stopping) {
+                break;
+            }
+        }
+        lock.lock();
+    }
+}
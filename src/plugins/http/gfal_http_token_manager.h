@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GFAL_HTTP_TOKEN_MANAGER_H
+#define _GFAL_HTTP_TOKEN_MANAGER_H
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ctime>
+
+#include <davix.hpp>
+
+/**
+ * Keeps the SE-issued tokens of the HTTP plugin.
+ *
+ * Tokens are indexed by endpoint and path components, so finding the token of a path,
+ * or of one of its parents, costs as many steps as the path is deep.
+ * Concurrent requests for the same path share a single token exchange, and tokens
+ * about to expire are exchanged again in the background, before a request needs them.
+ * Only tokens used recently are refreshed, idle ones are dropped.
+ */
+class TokenManager {
+public:
+    /// Obtain a new token valid for the given minutes. Throws Gfal::CoreException on failure.
+    /// Called from the refresh thread too, so it must not use the gfal2 context
+    typedef std::function<std::string(unsigned validity)> Exchange;
+
+    /// Source of the current time
+    typedef std::function<time_t()> Clock;
+
+    TokenManager();
+    /// Waits for the background refresh to stop, which may be running one exchange
+    ~TokenManager();
+
+    TokenManager(const TokenManager&) = delete;
+    TokenManager& operator=(const TokenManager&) = delete;
+
+    /// Find a token for uri, or a parent path, still valid for longer than half the refresh margin,
+    /// so the background refresh has the other half to complete before requests stop using it.
+    /// A write token is good for read access too
+    bool find(const Davix::Uri& uri, bool write_access, std::string& token);
+
+    /// Same as find, otherwise obtain a token through exchange and store it.
+    /// Concurrent calls for the same path and access wait for the first one to exchange
+    std::string get(const Davix::Uri& uri, bool write_access, unsigned validity, const Exchange& exchange);
+
+    /// Tokens whose remaining lifetime goes below margin seconds are exchanged again in the background.
+    /// 0 disables the background refresh
+    void set_refresh_margin(time_t margin);
+
+    /// Tokens not used for idle seconds are dropped rather than refreshed.
+    /// 0 keeps them until they expire
+    void set_idle_limit(time_t idle);
+
+    /// Replace the source of the current time, for testing.
+    /// Wakes up the background refresh, so it sees the new time
+    void set_clock(const Clock& clock);
+
+    /// Number of tokens held
+    size_t size();
+
+    void clear();
+
+private:
+    struct Entry {
+        std::string token;
+        time_t issued;
+        time_t expiration;
+        // Next time a refresh may be attempted, pushed back after a failure
+        time_t next_attempt;
+        // Last time the token was handed out
+        time_t last_used;
+        unsigned validity;
+        Exchange exchange;
+    };
+
+    struct Node {
+        std::map<std::string, std::unique_ptr<Node>> children;
+        // Tokens issued for exactly this path, by access
+        std::unique_ptr<Entry> read;
+        std::unique_ptr<Entry> write;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::string, Node> roots;
+    std::set<std::string> in_flight;
+    time_t refresh_margin;
+    time_t idle_limit;
+    size_t count;
+    Clock clock;
+
+    std::thread refresher;
+    bool stop;
+
+    // Refresh margin of an entry, never more than half its lifetime
+    time_t margin_for(const Entry& entry) const;
+
+    // Whether the entry can be handed out at now
+    bool usable(const Entry& entry, time_t now) const;
+
+    static std::string endpoint_of(const Davix::Uri& uri);
+    static std::vector<std::string> components_of(const Davix::Uri& uri);
+
+    // Deepest usable token along the path, marked as used. Must be called with the mutex held
+    bool find_locked(const std::string& endpoint, const std::vector<std::string>& components,
+                     bool write_access, time_t now, std::string& token);
+
+    // Node for the path, created if needed. Must be called with the mutex held
+    Node& node_for(const std::string& endpoint, const std::vector<std::string>& components);
+
+    // Store a token for the path. A background refresh does not count as a use.
+    // Must be called with the mutex held
+    void store_locked(const std::string& endpoint, const std::vector<std::string>& components, bool write_access,
+                      const std::string& token, unsigned validity, const Exchange& exchange, bool used);
+
+    /// Token due for a refresh
+    struct Due {
+        std::string endpoint;
+        std::vector<std::string> components;
+        bool write_access;
+        unsigned validity;
+        Exchange exchange;
+    };
+
+    // Collect the entries under node due for a refresh, drop the expired and idle ones,
+    // and lower next_wake to the next refresh or eviction time. Must be called with the mutex held
+    void collect_due(Node& node, const std::string& endpoint, std::vector<std::string>& components,
+                     time_t now, std::vector<Due>& due, time_t& next_wake);
+
+    void refresh_loop();
+};
+
+#endif // _GFAL_HTTP_TOKEN_MANAGER_H
@@ -40,6 +40,9 @@
 
 
 static gboolean init_thread = FALSE;
+
+static const char* const lfc_url_schemes[] = {"lfn", "lfc", "guid", NULL};
+
 pthread_mutex_t m_lfcinit = PTHREAD_MUTEX_INITIALIZER;
 
 typedef struct _lfc_opendir_handle {
@@ -1027,6 +1030,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     lfc_plugin.plugin_data = (void *) ops;
     lfc_plugin.priority = GFAL_PLUGIN_PRIORITY_CATALOG;
     lfc_plugin.check_plugin_url = &gfal_lfc_check_lfn_url;
+    lfc_plugin.url_schemes = lfc_url_schemes;
     lfc_plugin.plugin_delete = &lfc_destroyG;
     lfc_plugin.accessG = &lfc_accessG;
     lfc_plugin.chmodG = &lfc_chmodG;
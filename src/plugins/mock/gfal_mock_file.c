@@ -54,10 +54,10 @@ gfal_file_handle gfal_plugin_mock_open(plugin_handle plugin_data, const char *ur
     fd->url = url;
     fd->size = st.st_size;
     fd->offset = 0;
-    if (flag == O_RDONLY) {
+    if ((flag & O_ACCMODE) == O_RDONLY) {
         fd->fd = open("/dev/urandom", O_RDONLY);
     }
-    else if (flag == O_WRONLY) {
+    else if ((flag & O_ACCMODE) == O_WRONLY) {
         fd->fd = open("/dev/null", O_WRONLY);
     }
     else {
@@ -85,6 +85,12 @@ ssize_t gfal_plugin_mock_read(plugin_handle plugin_data, gfal_file_handle fd, vo
         sleep(wait);
     }
 
+    gfal_plugin_mock_get_value(mfd->url, "read_wait_ms", arg_buffer, sizeof(arg_buffer));
+    wait = gfal_plugin_mock_get_int_from_str(arg_buffer);
+    if (wait > 0) {
+        usleep(wait * 1000);
+    }
+
     gfal_plugin_mock_get_value(mfd->url, "read_errno", arg_buffer, sizeof(arg_buffer));
     int errcode = gfal_plugin_mock_get_int_from_str(arg_buffer);
     if (errcode > 0) {
@@ -116,6 +122,13 @@ ssize_t gfal_plugin_mock_write(plugin_handle plugin_data, gfal_file_handle fd, c
     GError **err)
 {
     MockFile *mfd = gfal_file_handle_get_fdesc(fd);
+    char arg_buffer[64] = {0};
+
+    gfal_plugin_mock_get_value(mfd->url, "write_wait_ms", arg_buffer, sizeof(arg_buffer));
+    int wait = gfal_plugin_mock_get_int_from_str(arg_buffer);
+    if (wait > 0) {
+        usleep(wait * 1000);
+    }
 
     off_t nwrite = write(mfd->fd, buff, count);
     if (nwrite < 0) {
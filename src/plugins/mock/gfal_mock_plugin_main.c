@@ -31,6 +31,9 @@ GQuark gfal2_get_plugin_mock_quark()
 }
 
 
+static const char* const mock_url_schemes[] = {"mock", NULL};
+
+
 static gboolean is_mock_uri(const char *src)
 {
     return strncmp(src, "mock:", 5) == 0;
@@ -195,6 +198,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     mock_plugin.plugin_data = mdata;
     mock_plugin.plugin_delete = gfal_plugin_mock_delete;
     mock_plugin.check_plugin_url = &gfal_mock_check_url;
+    mock_plugin.url_schemes = mock_url_schemes;
     mock_plugin.getName = &gfal_mock_plugin_getName;
 
     mock_plugin.statG = &gfal_plugin_mock_stat;
@@ -30,6 +30,8 @@ gboolean gfal_rfio_internal_check_url(gfal_plugin_rfio_handle rh, const char* su
 const char* gfal_rfio_getName();
 void gfal_rfio_destroyG(plugin_handle handle);
 
+static const char* const rfio_url_schemes[] = {"rfio", NULL};
+
 
 int gfal_rfio_regex_compile(regex_t * rex, GError** err){
 	int ret = regcomp(rex, "^rfio://([:alnum:]|-|/|.|_)+$",REG_ICASE | REG_EXTENDED);
@@ -57,6 +59,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError** err){
 	gfal_rfio_regex_compile(&h->rex, err);
 	rfio_plugin.plugin_data = (void*) h;
 	rfio_plugin.check_plugin_url = &gfal_rfio_check_url;
+	rfio_plugin.url_schemes = rfio_url_schemes;
 	rfio_plugin.getName= &gfal_rfio_getName;
 	rfio_plugin.plugin_delete= &gfal_rfio_destroyG;
 	rfio_plugin.openG= &gfal_rfio_openG;
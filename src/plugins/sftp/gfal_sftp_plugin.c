@@ -23,6 +23,9 @@ GQuark gfal2_get_plugin_sftp_quark()
 }
 
 
+static const char* const sftp_url_schemes[] = {"sftp", NULL};
+
+
 static gboolean is_sftp_uri(const char *src)
 {
     return strncmp(src, "sftp:", 5) == 0;
@@ -78,6 +81,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t context, GError **err)
     sftp_plugin.plugin_data = data;
     sftp_plugin.plugin_delete = gfal_plugin_sftp_delete;
     sftp_plugin.check_plugin_url = &gfal_sftp_check_url;
+    sftp_plugin.url_schemes = sftp_url_schemes;
     sftp_plugin.getName = &gfal_sftp_plugin_get_name;
 
     sftp_plugin.statG = &gfal_sftp_stat;
@@ -95,6 +95,9 @@ const char *gfal_srm_getName()
 }
 
 
+static const char* const srm_url_schemes[] = {"srm", NULL};
+
+
 int gfal_checker_compile(gfal_srmv2_opt *opts, GError **err)
 {
     int ret = regcomp(&opts->rexurl, "^srm://([:alnum:]|-|/|.|_)+$",
@@ -223,6 +226,7 @@ gfal_plugin_interface gfal_plugin_init(gfal2_context_t handle, GError **err)
     gfal_srm_opt_initG(opts, handle);
     srm_plugin.plugin_data = (void *) opts;
     srm_plugin.check_plugin_url = &gfal_srm_check_url;
+    srm_plugin.url_schemes = srm_url_schemes;
     srm_plugin.plugin_delete = &gfal_srm_destroyG;
     srm_plugin.accessG = &gfal_srm_accessG;
     srm_plugin.mkdirpG = &gfal_srm_mkdirG;
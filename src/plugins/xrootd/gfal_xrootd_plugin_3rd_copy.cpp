@@ -217,6 +217,8 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
     gfalt_checksum_mode_t checksumMode = gfalt_get_checksum(params,
         _checksumType, sizeof(_checksumType),
         _checksumValue, sizeof(_checksumValue), NULL);
+    // INLINE only matters for streamed copies
+    checksumMode = (gfalt_checksum_mode_t)(checksumMode & GFALT_CHECKSUM_BOTH);
 
     XrdCl::CopyProcess copy_process;
     std::vector<XrdCl::PropertyList> results;
@@ -279,19 +281,7 @@ int gfal_xrootd_3rd_copy_bulk(plugin_handle plugin_data,
             std::string sChecksumType = predefined_checksum_type_to_lower(checksumType);
             std::string sChecksumValue(checksumValue);
             std::transform(sChecksumValue.begin(), sChecksumValue.end(), sChecksumValue.begin(), ::tolower);
-            std::string sChecksumMode = "none";
-
-            switch (checksumMode) {
-                case GFALT_CHECKSUM_BOTH:
-                    sChecksumMode = "end2end";
-                    break;
-                case GFALT_CHECKSUM_TARGET:
-                    sChecksumMode = "target";
-                    break;
-                case GFALT_CHECKSUM_SOURCE:
-                    sChecksumMode = "source";
-                    break;
-            }
+            std::string sChecksumMode = checksum_mode_to_xrootd(checksumMode);
 
             gfal2_log(G_LOG_LEVEL_DEBUG, "Predefined Checksum Mode: %s", sChecksumMode.c_str());
             gfal2_log(G_LOG_LEVEL_DEBUG, "Predefined Checksum Type: %s", sChecksumType.c_str());
@@ -18,14 +18,19 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
+#include <vector>
 #include <sys/stat.h>
 
 // This header provides all the required functions except chmod
 #include <XrdPosix/XrdPosixXrootd.hh>
 
+// For vector reads
+#include <XrdOuc/XrdOucIOVec.hh>
+
 // This header is required for chmod
 #include <XrdCl/XrdClFileSystem.hh>
 
@@ -149,6 +154,140 @@ off_t gfal_xrootd_lseekG(plugin_handle handle, gfal_file_handle fd,
 }
 
 
+ssize_t gfal_xrootd_preadG(plugin_handle handle, gfal_file_handle fd, void *buff,
+        size_t count, off_t offset, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+    ssize_t l = XrdPosixXrootd::Pread(*fdesc, buff, count, offset);
+    if (l < 0) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Failed while reading from file");
+        return -1;
+    }
+    return l;
+}
+
+
+ssize_t gfal_xrootd_pwriteG(plugin_handle handle, gfal_file_handle fd,
+        const void *buff, size_t count, off_t offset, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+    ssize_t l = XrdPosixXrootd::Pwrite(*fdesc, buff, count, offset);
+    if (l < 0) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Failed while writing to file");
+        return -1;
+    }
+    return l;
+}
+
+
+// Limits of a single kXR_readv request
+static const size_t XROOTD_READV_MAX_CHUNKS = 1024;
+static const size_t XROOTD_READV_MAX_CHUNK_SIZE = 2097136;
+
+
+// Read the chunks one by one
+static ssize_t gfal_xrootd_preadv(int fdesc, gfal2_iovec_t* vector,
+        const std::vector<int>& chunks, GError ** err)
+{
+    ssize_t total = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        gfal2_iovec_t& chunk = vector[chunks[i]];
+        chunk.nbytes = XrdPosixXrootd::Pread(fdesc, chunk.buffer, chunk.size, chunk.offset);
+        if (chunk.nbytes < 0) {
+            gfal2_xrootd_set_error(err, errno, __func__, "Failed while reading from file");
+            return -1;
+        }
+        total += chunk.nbytes;
+    }
+    return total;
+}
+
+
+// Read the chunks with a single kXR_readv.
+// The request fails if any chunk goes past the end of the file, so then
+// the chunks are read one by one to find out how much each of them has.
+static ssize_t gfal_xrootd_vread(int fdesc, gfal2_iovec_t* vector,
+        const std::vector<int>& chunks, GError ** err)
+{
+    std::vector<XrdOucIOVec> request(chunks.size());
+    ssize_t expected = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const gfal2_iovec_t& chunk = vector[chunks[i]];
+        request[i].offset = chunk.offset;
+        request[i].size = chunk.size;
+        request[i].info = 0;
+        request[i].data = static_cast<char*>(chunk.buffer);
+        expected += chunk.size;
+    }
+
+    ssize_t l = XrdPosixXrootd::VRead(fdesc, request.data(), request.size());
+    if (l == expected) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            vector[chunks[i]].nbytes = vector[chunks[i]].size;
+        }
+        return l;
+    }
+
+    gfal2_log(G_LOG_LEVEL_DEBUG, "Vector read of %d chunks returned %lld instead of %lld, reading them one by one",
+        (int)chunks.size(), (long long)l, (long long)expected);
+    return gfal_xrootd_preadv(fdesc, vector, chunks, err);
+}
+
+
+ssize_t gfal_xrootd_readvG(plugin_handle handle, gfal_file_handle fd,
+        gfal2_iovec_t* vector, int count, GError ** err)
+{
+    int * fdesc = (int*) (gfal_file_handle_get_fdesc(fd));
+    if (!fdesc) {
+        gfal2_xrootd_set_error(err, errno, __func__, "Bad file handle");
+        return -1;
+    }
+
+    // Chunks too big for kXR_readv are read on their own
+    std::vector<int> batch, single;
+    batch.reserve(std::min<size_t>(count, XROOTD_READV_MAX_CHUNKS));
+
+    ssize_t total = 0, l;
+    for (int i = 0; i < count; ++i) {
+        if (vector[i].size == 0) {
+            vector[i].nbytes = 0;
+            continue;
+        }
+        if (vector[i].size > XROOTD_READV_MAX_CHUNK_SIZE) {
+            single.push_back(i);
+            continue;
+        }
+        batch.push_back(i);
+        if (batch.size() == XROOTD_READV_MAX_CHUNKS) {
+            if ((l = gfal_xrootd_vread(*fdesc, vector, batch, err)) < 0)
+                return -1;
+            total += l;
+            batch.clear();
+        }
+    }
+
+    if (!batch.empty()) {
+        if ((l = gfal_xrootd_vread(*fdesc, vector, batch, err)) < 0)
+            return -1;
+        total += l;
+    }
+    if (!single.empty()) {
+        if ((l = gfal_xrootd_preadv(*fdesc, vector, single, err)) < 0)
+            return -1;
+        total += l;
+    }
+    return total;
+}
+
+
 int gfal_xrootd_closeG(plugin_handle handle, gfal_file_handle fd, GError ** err)
 {
     int r = 0;
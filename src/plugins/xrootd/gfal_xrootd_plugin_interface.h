@@ -42,6 +42,12 @@ ssize_t gfal_xrootd_writeG(plugin_handle handle, gfal_file_handle fd, const void
 
 off_t gfal_xrootd_lseekG(plugin_handle handle, gfal_file_handle fd, off_t offset, int whence, GError **err);
 
+ssize_t gfal_xrootd_preadG(plugin_handle handle, gfal_file_handle fd, void *buff, size_t count, off_t offset, GError ** err);
+
+ssize_t gfal_xrootd_pwriteG(plugin_handle handle, gfal_file_handle fd, const void *buff, size_t count, off_t offset, GError ** err);
+
+ssize_t gfal_xrootd_readvG(plugin_handle handle, gfal_file_handle fd, gfal2_iovec_t* vector, int count, GError ** err);
+
 int gfal_xrootd_closeG(plugin_handle handle, gfal_file_handle fd, GError ** err);
 
 int gfal_xrootd_mkdirpG(plugin_handle plugin_data, const char *url, mode_t mode, gboolean pflag, GError **err);
@@ -229,6 +229,21 @@ std::string predefined_checksum_type_to_lower(const std::string& type)
 }
 
 
+std::string checksum_mode_to_xrootd(gfalt_checksum_mode_t mode)
+{
+    switch (mode & GFALT_CHECKSUM_BOTH) {
+        case GFALT_CHECKSUM_BOTH:
+            return "end2end";
+        case GFALT_CHECKSUM_TARGET:
+            return "target";
+        case GFALT_CHECKSUM_SOURCE:
+            return "source";
+        default:
+            return "none";
+    }
+}
+
+
 bool json_obj_to_bool(struct json_object *boolobj)
 {
   if( !boolobj ) return false;
@@ -44,6 +44,10 @@ std::string prepare_url(gfal2_context_t context, const char *url);
 /// @note adler32, crc32, md5
 std::string predefined_checksum_type_to_lower(const std::string& type);
 
+/// Map a gfal2 checksum mode to the XrdCl copy checkSumMode property
+/// @note GFALT_CHECKSUM_INLINE is ignored, it only applies to streamed copies
+std::string checksum_mode_to_xrootd(gfalt_checksum_mode_t mode);
+
 /// Parse a JSON object into a boolean value
 bool json_obj_to_bool(struct json_object *boolobj);
 
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Vectorized checksum kernels, used by checksum_stream.c depending on the CPU features
+// Only available on x86 with a compiler able to target a specific ISA per function
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define GFAL2_CHECKSUM_X86 1
+
+int gfal2_cpu_has_ssse3(void);
+int gfal2_cpu_has_sse42(void);
+int gfal2_cpu_has_pclmul(void);
+int gfal2_cpu_has_avx2(void);
+
+uint32_t gfal2_adler32_ssse3(uint32_t adler, const unsigned char *buf, size_t len);
+uint32_t gfal2_adler32_avx2(uint32_t adler, const unsigned char *buf, size_t len);
+
+// crc is the running checksum, as returned by zlib crc32
+uint32_t gfal2_crc32_pclmul(uint32_t crc, const unsigned char *buf, size_t len);
+
+// crc is the running checksum, pre and post conditioning are done by the caller
+uint32_t gfal2_crc32c_sse42(uint32_t crc, const unsigned char *buf, size_t len);
+
+#endif
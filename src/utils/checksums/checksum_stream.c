@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include "checksums.h"
+#include "checksum_simd.h"
+
+
+typedef enum {
+    GFAL_CHECKSUM_STREAM_ADLER32,
+    GFAL_CHECKSUM_STREAM_CRC32,
+    GFAL_CHECKSUM_STREAM_CRC32C,
+    GFAL_CHECKSUM_STREAM_MD5
+} gfal2_checksum_stream_type;
+
+typedef uint32_t (*gfal2_checksum_update_func)(uint32_t value, const unsigned char *buf, size_t len);
+
+
+struct gfal2_checksum_stream {
+    gfal2_checksum_stream_type type;
+    gfal2_checksum_update_func update;
+    uint32_t value;
+    GFAL_MD5_CTX md5;
+};
+
+
+static uint32_t adler32_generic(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    // zlib takes an uInt
+    while (len > 0) {
+        uInt chunk = (len > (1u << 30)) ? (1u << 30) : (uInt) len;
+        adler = adler32(adler, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+    return adler;
+}
+
+
+static uint32_t crc32_generic(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    while (len > 0) {
+        uInt chunk = (len > (1u << 30)) ? (1u << 30) : (uInt) len;
+        crc = crc32(crc, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+    return crc;
+}
+
+
+// Castagnoli polynomial, reflected
+static uint32_t crc32c_table[256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_table_init(void)
+{
+    uint32_t i, j;
+    for (i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (j = 0; j < 8; ++j)
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : (c >> 1);
+        crc32c_table[i] = c;
+    }
+}
+
+
+static uint32_t crc32c_generic(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    pthread_once(&crc32c_table_once, crc32c_table_init);
+    while (len--)
+        crc = crc32c_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+
+gfal2_checksum_isa_t gfal2_checksum_isa_detect(void)
+{
+#ifdef GFAL2_CHECKSUM_X86
+    if (gfal2_cpu_has_avx2() && gfal2_cpu_has_sse42() && gfal2_cpu_has_pclmul())
+        return GFAL2_CHECKSUM_ISA_AVX2;
+    if (gfal2_cpu_has_ssse3() && gfal2_cpu_has_sse42() && gfal2_cpu_has_pclmul())
+        return GFAL2_CHECKSUM_ISA_SSE42;
+#endif
+    return GFAL2_CHECKSUM_ISA_GENERIC;
+}
+
+
+const char* gfal2_checksum_isa_name(gfal2_checksum_isa_t isa)
+{
+    switch (isa) {
+        case GFAL2_CHECKSUM_ISA_AVX2:
+            return "avx2";
+        case GFAL2_CHECKSUM_ISA_SSE42:
+            return "sse4.2";
+        default:
+            return "generic";
+    }
+}
+
+
+static gfal2_checksum_isa_t detected_isa = GFAL2_CHECKSUM_ISA_GENERIC;
+static pthread_once_t detected_isa_once = PTHREAD_ONCE_INIT;
+
+static void detect_isa(void)
+{
+    detected_isa = gfal2_checksum_isa_detect();
+}
+
+
+static gfal2_checksum_update_func select_update(gfal2_checksum_stream_type type, gfal2_checksum_isa_t isa)
+{
+    switch (type) {
+        case GFAL_CHECKSUM_STREAM_ADLER32:
+#ifdef GFAL2_CHECKSUM_X86
+            if (isa >= GFAL2_CHECKSUM_ISA_AVX2)
+                return gfal2_adler32_avx2;
+            if (isa >= GFAL2_CHECKSUM_ISA_SSE42)
+                return gfal2_adler32_ssse3;
+#endif
+            return adler32_generic;
+        case GFAL_CHECKSUM_STREAM_CRC32:
+#ifdef GFAL2_CHECKSUM_X86
+            if (isa >= GFAL2_CHECKSUM_ISA_SSE42)
+                return gfal2_crc32_pclmul;
+#endif
+            return crc32_generic;
+        case GFAL_CHECKSUM_STREAM_CRC32C:
+#ifdef GFAL2_CHECKSUM_X86
+            if (isa >= GFAL2_CHECKSUM_ISA_SSE42)
+                return gfal2_crc32c_sse42;
+#endif
+            return crc32c_generic;
+        default:
+            return NULL;
+    }
+}
+
+
+gfal2_checksum_stream_t* gfal2_checksum_stream_new_isa(const char *type, gfal2_checksum_isa_t isa)
+{
+    // never go beyond what the CPU supports
+    pthread_once(&detected_isa_once, detect_isa);
+    if (isa > detected_isa)
+        isa = detected_isa;
+
+    gfal2_checksum_stream_t *stream = calloc(1, sizeof(gfal2_checksum_stream_t));
+
+    if (strcasecmp(type, "adler32") == 0) {
+        stream->type = GFAL_CHECKSUM_STREAM_ADLER32;
+        stream->value = adler32(0L, Z_NULL, 0);
+    }
+    else if (strcasecmp(type, "crc32") == 0) {
+        stream->type = GFAL_CHECKSUM_STREAM_CRC32;
+        stream->value = crc32(0L, Z_NULL, 0);
+    }
+    else if (strcasecmp(type, "crc32c") == 0) {
+        stream->type = GFAL_CHECKSUM_STREAM_CRC32C;
+        stream->value = 0xFFFFFFFF;
+    }
+    else if (strcasecmp(type, "md5") == 0) {
+        stream->type = GFAL_CHECKSUM_STREAM_MD5;
+        gfal2_md5_init(&stream->md5);
+    }
+    else {
+        free(stream);
+        return NULL;
+    }
+    stream->update = select_update(stream->type, isa);
+    return stream;
+}
+
+
+gfal2_checksum_stream_t* gfal2_checksum_stream_new(const char *type)
+{
+    return gfal2_checksum_stream_new_isa(type, GFAL2_CHECKSUM_ISA_AVX2);
+}
+
+
+void gfal2_checksum_stream_update(gfal2_checksum_stream_t *stream, const void *data, size_t size)
+{
+    if (stream->type == GFAL_CHECKSUM_STREAM_MD5) {
+        gfal2_md5_update(&stream->md5, data, (unsigned long) size);
+    }
+    else {
+        stream->value = stream->update(stream->value, (const unsigned char*) data, size);
+    }
+}
+
+
+int gfal2_checksum_stream_final(gfal2_checksum_stream_t *stream, char *result, size_t result_size)
+{
+    unsigned char md5[16];
+
+    switch (stream->type) {
+        case GFAL_CHECKSUM_STREAM_ADLER32:
+            snprintf(result, result_size, "%08x", stream->value);
+            break;
+        case GFAL_CHECKSUM_STREAM_CRC32:
+            snprintf(result, result_size, "%u", stream->value);
+            break;
+        case GFAL_CHECKSUM_STREAM_CRC32C:
+            snprintf(result, result_size, "%08x", ~stream->value);
+            break;
+        case GFAL_CHECKSUM_STREAM_MD5:
+            if (result_size < 33)
+                return -1;
+            gfal2_md5_final(md5, &stream->md5);
+            gfal2_md5_to_hex_string(md5, result, sizeof(md5));
+            break;
+    }
+    return 0;
+}
+
+
+void gfal2_checksum_stream_free(gfal2_checksum_stream_t *stream)
+{
+    free(stream);
+}
+
+
+/*
+ * Combination of two CRCs, based on the zlib implementation: the CRC of the first part is
+ * extended by next_length zero bytes, applying the operator in GF(2) by repeated squaring
+ */
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1)
+            sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+    int n;
+    for (n = 0; n < 32; n++)
+        square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+
+static uint32_t crc_combine(uint32_t poly, uint32_t crc1, uint32_t crc2, unsigned long long len2)
+{
+    uint32_t even[32], odd[32], row;
+    int n;
+
+    if (len2 == 0)
+        return crc1;
+
+    // operator for one zero bit
+    odd[0] = poly;
+    row = 1;
+    for (n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    // two zero bits, then four
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+
+    // apply len2 zero bytes to crc1, the first square puts the operator for one zero byte in even
+    do {
+        gf2_matrix_square(even, odd);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0)
+            break;
+        gf2_matrix_square(odd, even);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+
+int gfal2_checksum_stream_can_combine(const gfal2_checksum_stream_t *stream)
+{
+    return stream->type != GFAL_CHECKSUM_STREAM_MD5;
+}
+
+
+int gfal2_checksum_stream_combine(gfal2_checksum_stream_t *stream, const gfal2_checksum_stream_t *next,
+    unsigned long long next_length)
+{
+    if (stream->type != next->type || !gfal2_checksum_stream_can_combine(stream))
+        return -1;
+
+    switch (stream->type) {
+        case GFAL_CHECKSUM_STREAM_ADLER32:
+            stream->value = adler32_combine64(stream->value, next->value, (z_off64_t) next_length);
+            break;
+        case GFAL_CHECKSUM_STREAM_CRC32:
+            stream->value = crc_combine(0xEDB88320, stream->value, next->value, next_length);
+            break;
+        case GFAL_CHECKSUM_STREAM_CRC32C:
+            // the running value is not conditioned yet
+            stream->value = ~crc_combine(0x82F63B78, ~stream->value, ~next->value, next_length);
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
@@ -54,6 +54,63 @@ void gfal2_md5_final(unsigned char *result, GFAL_MD5_CTX *ctx);
 
 void gfal2_md5_to_hex_string(const unsigned char *bytes, char *hex, size_t hex_size);
 
+
+// incremental checksum calculation, for any of the supported algorithms
+
+typedef struct gfal2_checksum_stream gfal2_checksum_stream_t;
+
+/**
+ * Instruction sets the checksum implementations can use
+ * GFAL2_CHECKSUM_ISA_SSE42 covers SSSE3 adler32, PCLMULQDQ crc32 and SSE4.2 crc32c
+ */
+typedef enum {
+    GFAL2_CHECKSUM_ISA_GENERIC = 0,
+    GFAL2_CHECKSUM_ISA_SSE42,
+    GFAL2_CHECKSUM_ISA_AVX2
+} gfal2_checksum_isa_t;
+
+/**
+ * Return the best instruction set supported by this CPU
+ */
+gfal2_checksum_isa_t gfal2_checksum_isa_detect(void);
+
+const char* gfal2_checksum_isa_name(gfal2_checksum_isa_t isa);
+
+/**
+ * Start a new checksum calculation, using the best implementation for this CPU
+ * Supported types are ADLER32, CRC32, CRC32C and MD5 (case insensitive)
+ * Return NULL if the type is not supported
+ */
+gfal2_checksum_stream_t* gfal2_checksum_stream_new(const char *type);
+
+/**
+ * Same as gfal2_checksum_stream_new, but do not use anything beyond the given instruction set
+ */
+gfal2_checksum_stream_t* gfal2_checksum_stream_new_isa(const char *type, gfal2_checksum_isa_t isa);
+
+void gfal2_checksum_stream_update(gfal2_checksum_stream_t *stream, const void *data, size_t size);
+
+/**
+ * Write the checksum into result, formatted as the file plugin does
+ * Return 0 on success, -1 if the buffer is too short
+ */
+int gfal2_checksum_stream_final(gfal2_checksum_stream_t *stream, char *result, size_t result_size);
+
+void gfal2_checksum_stream_free(gfal2_checksum_stream_t *stream);
+
+/**
+ * Return 1 if partial checksums of this type can be combined (ADLER32, CRC32 and CRC32C)
+ */
+int gfal2_checksum_stream_can_combine(const gfal2_checksum_stream_t *stream);
+
+/**
+ * Append to stream the data checksummed by next, which is next_length bytes long
+ * Both must be of the same type. next is left untouched.
+ * Return 0 on success, -1 if the checksum type can not be combined
+ */
+int gfal2_checksum_stream_combine(gfal2_checksum_stream_t *stream, const gfal2_checksum_stream_t *next,
+    unsigned long long next_length);
+
 #ifdef __cplusplus
 }
 #endif
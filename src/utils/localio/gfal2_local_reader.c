@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gfal2_local_reader.h"
+
+#define DIRECT_IO_ALIGNMENT 4096
+
+
+struct gfal2_local_reader {
+    int fd;
+    gfal2_local_reader_mode_t mode;
+    off_t offset, end;
+    size_t window;
+
+    // mmap mode, current mapping
+    void* map;
+    size_t map_size;
+
+    // direct and read modes
+    void* buffer;
+};
+
+
+static int local_reader_alloc_buffer(gfal2_local_reader_t* reader)
+{
+    int ret = posix_memalign(&reader->buffer, DIRECT_IO_ALIGNMENT, reader->window);
+    if (ret != 0) {
+        reader->buffer = NULL;
+        errno = ret;
+        return -1;
+    }
+    return 0;
+}
+
+
+gfal2_local_reader_t* gfal2_local_reader_open(const char* path, off_t offset, size_t length,
+    size_t window, off_t direct_io_threshold)
+{
+    struct stat st;
+    const long page_size = sysconf(_SC_PAGESIZE);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    gfal2_local_reader_t* reader = calloc(1, sizeof(gfal2_local_reader_t));
+    reader->fd = fd;
+    reader->offset = offset;
+    reader->end = st.st_size;
+    if (length > 0 && offset + (off_t)length < st.st_size)
+        reader->end = offset + length;
+    // mapping windows must be page aligned, and O_DIRECT transfers block aligned
+    reader->window = ((window + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT) * DIRECT_IO_ALIGNMENT;
+    if (reader->window % page_size != 0)
+        reader->window = ((reader->window / page_size) + 1) * page_size;
+
+    reader->mode = GFAL2_LOCAL_READER_MMAP;
+    if (!S_ISREG(st.st_mode)) {
+        reader->mode = GFAL2_LOCAL_READER_READ;
+    }
+#ifdef O_DIRECT
+    else if (direct_io_threshold > 0 && st.st_size >= direct_io_threshold && offset % DIRECT_IO_ALIGNMENT == 0) {
+        int direct_fd = open(path, O_RDONLY | O_DIRECT);
+        // some file systems do not support O_DIRECT
+        if (direct_fd >= 0) {
+            close(reader->fd);
+            reader->fd = direct_fd;
+            reader->mode = GFAL2_LOCAL_READER_DIRECT;
+        }
+    }
+#endif
+
+    if (reader->mode != GFAL2_LOCAL_READER_MMAP && local_reader_alloc_buffer(reader) < 0) {
+        gfal2_local_reader_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+
+// Keep reading the same descriptor through the page cache
+static int local_reader_disable_direct(gfal2_local_reader_t* reader)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(reader->fd, F_GETFL);
+    if (flags < 0 || fcntl(reader->fd, F_SETFL, flags & ~O_DIRECT) < 0)
+        return -1;
+#endif
+    reader->mode = GFAL2_LOCAL_READER_READ;
+    return 0;
+}
+
+
+static ssize_t local_reader_next_mmap(gfal2_local_reader_t* reader, const void** data)
+{
+    const long page_size = sysconf(_SC_PAGESIZE);
+    struct stat st;
+
+    if (reader->map) {
+        munmap(reader->map, reader->map_size);
+        reader->map = NULL;
+    }
+
+    const off_t map_offset = (reader->offset / page_size) * page_size;
+    const size_t skip = reader->offset - map_offset;
+    size_t available = reader->window - skip;
+    if ((off_t)available > reader->end - reader->offset)
+        available = reader->end - reader->offset;
+
+    // touching a mapped page past the end of the file raises SIGBUS, so make sure it did not shrink.
+    // This does not cover a truncation while the window is mapped, see the header
+    if (fstat(reader->fd, &st) < 0)
+        return -1;
+    if (st.st_size < reader->offset + (off_t)available) {
+        errno = EIO;
+        return -1;
+    }
+
+    reader->map_size = skip + available;
+    reader->map = mmap(NULL, reader->map_size, PROT_READ, MAP_PRIVATE, reader->fd, map_offset);
+    if (reader->map == MAP_FAILED) {
+        // keep going with plain reads
+        reader->map = NULL;
+        if (local_reader_alloc_buffer(reader) < 0)
+            return -1;
+        reader->mode = GFAL2_LOCAL_READER_READ;
+        return gfal2_local_reader_next(reader, data);
+    }
+    madvise(reader->map, reader->map_size, MADV_SEQUENTIAL);
+    madvise(reader->map, reader->map_size, MADV_WILLNEED);
+
+    *data = (const char*)reader->map + skip;
+    reader->offset += available;
+    return available;
+}
+
+
+static ssize_t local_reader_next_read(gfal2_local_reader_t* reader, const void** data)
+{
+    size_t count = reader->window;
+    // O_DIRECT needs a block aligned size, even if the end of the file comes before
+    if (reader->mode != GFAL2_LOCAL_READER_DIRECT && (off_t)count > reader->end - reader->offset)
+        count = reader->end - reader->offset;
+
+    ssize_t ret;
+    do {
+        ret = pread(reader->fd, reader->buffer, count, reader->offset);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0 && errno == EINVAL && reader->mode == GFAL2_LOCAL_READER_DIRECT) {
+        // the file system wants a stricter alignment
+        if (local_reader_disable_direct(reader) < 0)
+            return -1;
+        return local_reader_next_read(reader, data);
+    }
+    if (ret < 0)
+        return -1;
+    // the range is not over, so the file shrank
+    if (ret == 0) {
+        errno = EIO;
+        return -1;
+    }
+    if (ret > reader->end - reader->offset) {
+        ret = reader->end - reader->offset;
+    }
+    else if (reader->mode == GFAL2_LOCAL_READER_DIRECT && ret < reader->end - reader->offset && (size_t)ret < count) {
+        // a short read leaves the offset unaligned for the next O_DIRECT read
+        if (local_reader_disable_direct(reader) < 0)
+            return -1;
+    }
+
+    *data = reader->buffer;
+    reader->offset += ret;
+    return ret;
+}
+
+
+ssize_t gfal2_local_reader_next(gfal2_local_reader_t* reader, const void** data)
+{
+    if (reader->offset >= reader->end)
+        return 0;
+    if (reader->mode == GFAL2_LOCAL_READER_MMAP)
+        return local_reader_next_mmap(reader, data);
+    return local_reader_next_read(reader, data);
+}
+
+
+gfal2_local_reader_mode_t gfal2_local_reader_get_mode(const gfal2_local_reader_t* reader)
+{
+    return reader->mode;
+}
+
+
+const char* gfal2_local_reader_mode_name(gfal2_local_reader_mode_t mode)
+{
+    switch (mode) {
+        case GFAL2_LOCAL_READER_MMAP:
+            return "mmap";
+        case GFAL2_LOCAL_READER_DIRECT:
+            return "direct";
+        default:
+            return "read";
+    }
+}
+
+
+void gfal2_local_reader_close(gfal2_local_reader_t* reader)
+{
+    if (reader == NULL)
+        return;
+    if (reader->map)
+        munmap(reader->map, reader->map_size);
+    free(reader->buffer);
+    close(reader->fd);
+    free(reader);
+}
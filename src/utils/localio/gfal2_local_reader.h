@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Sequential reader over a range of a local file, which avoids copying the data
+ * into an intermediate buffer when possible.
+ * Files smaller than the direct io threshold are mapped in memory, one window at a time;
+ * bigger files are read with O_DIRECT into an aligned buffer, so they do not evict
+ * the page cache. If neither is possible, or O_DIRECT returns a short read,
+ * it falls back to plain reads.
+ *
+ * The mapping is not safe for files that are truncated while they are read: the size is
+ * checked before mapping each window, but a truncation after that raises SIGBUS.
+ * Only use it on files that do not change meanwhile.
+ */
+typedef struct gfal2_local_reader gfal2_local_reader_t;
+
+typedef enum {
+    GFAL2_LOCAL_READER_MMAP,
+    GFAL2_LOCAL_READER_DIRECT,
+    GFAL2_LOCAL_READER_READ
+} gfal2_local_reader_mode_t;
+
+/*
+ * Open path for reading length bytes from offset. If length is 0, read up to the end of the file.
+ * window is the maximum size returned by each gfal2_local_reader_next.
+ * direct_io_threshold is the file size from which O_DIRECT is used, 0 never uses it.
+ * Returns NULL and sets errno on failure.
+ */
+gfal2_local_reader_t* gfal2_local_reader_open(const char* path, off_t offset, size_t length,
+    size_t window, off_t direct_io_threshold);
+
+/*
+ * Point data to the next bytes of the range
+ * The data is valid until the next call, and must not be modified.
+ * Returns the number of bytes available, 0 at the end of the range, -1 and sets errno on failure.
+ * errno is EIO if the file shrinks before the end of the range.
+ */
+ssize_t gfal2_local_reader_next(gfal2_local_reader_t* reader, const void** data);
+
+gfal2_local_reader_mode_t gfal2_local_reader_get_mode(const gfal2_local_reader_t* reader);
+
+const char* gfal2_local_reader_mode_name(gfal2_local_reader_mode_t mode);
+
+void gfal2_local_reader_close(gfal2_local_reader_t* reader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,6 +10,9 @@ SET(TEST_ENVIRONMENT "PRODUCTION"
 
 ## Global environment
 SET(ftp_prefix "ftp://mirror.switch.ch/mirror/centos/")
+# Local xrootd server, i.e. started with "xrootd -p 1094 /tmp"
+SET(root_prefix_local "root://localhost:1094//tmp/gfal2-tests"
+        CACHE STRING "Base url on a local xrootd server")
 
 IF(TEST_ENVIRONMENT STREQUAL "TESTBED_RC")
 
@@ -88,8 +91,10 @@ IF(PLUGIN_FILE)
         test_checksum_simple("FILE_MD5" ${file_prefix} MD5)
         test_checksum_simple("FILE_ADLER32" ${file_prefix} ADLER32)
         test_checksum_simple("FILE_CRC32" ${file_prefix} CRC32)
+        test_copy_file_full("FILE_TO_FILE" ${file_prefix} ${file_prefix})
 
         gfal_test_posix("FILE" ${file_prefix})
+        test_rw_positional("FILE" ${file_prefix})
 ENDIF(PLUGIN_FILE)
 
 IF(PLUGIN_SRM)
@@ -258,6 +263,7 @@ IF(PLUGIN_XROOTD)
     test_rwt_seq("XROOTD_EOS_single" ${root_prefix_eos} 1 10)
     test_rwt_seek("XROOTD_DPM" ${root_prefix_dpm} 100 4560)
     test_rwt_seek("XROOTD_EOS" ${root_prefix_eos} 100 4560)
+    test_rw_positional("XROOTD_LOCAL" ${root_prefix_local})
 
     test_space("XROOTD_DPM" ${root_prefix_dpm})
     #test_space fails on EOS, to check
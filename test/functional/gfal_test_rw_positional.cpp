@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <gfal_api.h>
+#include <common/gfal_lib_test.h>
+#include <common/gfal_gtest_asserts.h>
+#include <utils/exceptions/gerror_to_cpp.h>
+#include <fcntl.h>
+#include <list>
+#include <thread>
+#include <vector>
+
+//
+// Positional reads and writes, vector reads, and concurrent reads on a single descriptor
+//   gfal_test_rw_positional root://localhost//tmp/gfal2-tests
+//
+
+static const size_t FILE_SIZE = 1024 * 1024 + 123;
+
+
+static char expected_byte(off_t offset)
+{
+    return static_cast<char>((offset * 7) % 251);
+}
+
+
+class PositionalTest: public testing::Test {
+public:
+    static const char* root;
+    std::list<std::string> filesToClean;
+    gfal2_context_t context;
+
+    PositionalTest() {
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        Gfal::gerror_to_cpp(&error);
+    }
+
+    ~PositionalTest() {
+        gfal2_context_free(context);
+    }
+
+    void TearDown() {
+        for (std::list<std::string>::iterator i = filesToClean.begin(); i != filesToClean.end(); ++i) {
+            GError *error = NULL;
+            gfal2_unlink(context, i->c_str(), &error);
+            g_clear_error(&error);
+        }
+        filesToClean.clear();
+    }
+
+    std::string GenerateUrl() {
+        char file[2048];
+        generate_random_uri(root, "test_positional", file, sizeof(file));
+        filesToClean.push_back(file);
+        return file;
+    }
+
+    // Write FILE_SIZE bytes with a known pattern
+    std::string GenerateFile() {
+        GError *error = NULL;
+        std::string url = GenerateUrl();
+
+        std::vector<char> data(FILE_SIZE);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = expected_byte(i);
+        }
+
+        int fd = gfal2_open(context, url.c_str(), O_WRONLY | O_CREAT, &error);
+        EXPECT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+        ssize_t ret = gfal2_write(context, fd, data.data(), data.size(), &error);
+        EXPECT_EQ(data.size(), ret);
+        g_clear_error(&error);
+        gfal2_close(context, fd, NULL);
+        return url;
+    }
+
+    bool CheckContent(const char* buffer, size_t size, off_t offset) {
+        for (size_t i = 0; i < size; ++i) {
+            if (buffer[i] != expected_byte(offset + i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+const char *PositionalTest::root;
+
+
+TEST_F(PositionalTest, PRead)
+{
+    GError *error = NULL;
+    std::string url = GenerateFile();
+
+    int fd = gfal2_open(context, url.c_str(), O_RDONLY, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    char buffer[4096];
+    const off_t offsets[] = {0, 4096, 12345, 500000, 4, 1024 * 1024};
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+        ssize_t ret = gfal2_pread(context, fd, buffer, sizeof(buffer), offsets[i], &error);
+        ASSERT_EQ(sizeof(buffer), ret);
+        EXPECT_TRUE(CheckContent(buffer, ret, offsets[i])) << "at " << offsets[i];
+    }
+
+    // Short read at the end of the file
+    ssize_t ret = gfal2_pread(context, fd, buffer, sizeof(buffer), FILE_SIZE - 100, &error);
+    ASSERT_EQ(100, ret);
+    EXPECT_TRUE(CheckContent(buffer, ret, FILE_SIZE - 100));
+
+    // pread must not move the file position
+    ret = gfal2_read(context, fd, buffer, 10, &error);
+    ASSERT_EQ(10, ret);
+    EXPECT_TRUE(CheckContent(buffer, ret, 0));
+
+    gfal2_close(context, fd, NULL);
+}
+
+
+TEST_F(PositionalTest, PWrite)
+{
+    GError *error = NULL;
+    std::string url = GenerateUrl();
+
+    int fd = gfal2_open(context, url.c_str(), O_WRONLY | O_CREAT, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    // Write the blocks in reverse order
+    const size_t block = 4096, nblocks = 16;
+    std::vector<char> data(block);
+    for (size_t i = nblocks; i > 0; --i) {
+        off_t offset = (i - 1) * block;
+        for (size_t j = 0; j < block; ++j) {
+            data[j] = expected_byte(offset + j);
+        }
+        ssize_t ret = gfal2_pwrite(context, fd, data.data(), block, offset, &error);
+        ASSERT_EQ(block, ret);
+    }
+    gfal2_close(context, fd, NULL);
+
+    fd = gfal2_open(context, url.c_str(), O_RDONLY, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    std::vector<char> read_buffer(block * nblocks + 1);
+    size_t total = 0;
+    ssize_t ret;
+    while ((ret = gfal2_read(context, fd, read_buffer.data() + total, read_buffer.size() - total, &error)) > 0) {
+        total += ret;
+    }
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(block * nblocks, total);
+    EXPECT_TRUE(CheckContent(read_buffer.data(), total, 0));
+
+    gfal2_close(context, fd, NULL);
+}
+
+
+TEST_F(PositionalTest, ReadV)
+{
+    GError *error = NULL;
+    std::string url = GenerateFile();
+
+    int fd = gfal2_open(context, url.c_str(), O_RDONLY, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    const int nchunks = 64;
+    std::vector<gfal2_iovec_t> vector(nchunks);
+    std::vector<std::vector<char> > buffers(nchunks);
+    for (int i = 0; i < nchunks; ++i) {
+        buffers[i].resize(1000 + i * 10);
+        vector[i].offset = (i * 104729) % (FILE_SIZE - buffers[i].size());
+        vector[i].size = buffers[i].size();
+        vector[i].buffer = buffers[i].data();
+        vector[i].nbytes = -1;
+    }
+
+    ssize_t expected = 0;
+    for (int i = 0; i < nchunks; ++i) {
+        expected += vector[i].size;
+    }
+
+    ssize_t ret = gfal2_readv(context, fd, vector.data(), nchunks, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, ret, error);
+    ASSERT_EQ(expected, ret);
+    for (int i = 0; i < nchunks; ++i) {
+        ASSERT_EQ(vector[i].size, vector[i].nbytes);
+        EXPECT_TRUE(CheckContent(buffers[i].data(), vector[i].nbytes, vector[i].offset)) << "chunk " << i;
+    }
+
+    gfal2_close(context, fd, NULL);
+}
+
+
+TEST_F(PositionalTest, ReadVPastEnd)
+{
+    GError *error = NULL;
+    std::string url = GenerateFile();
+
+    int fd = gfal2_open(context, url.c_str(), O_RDONLY, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    char first[512], last[512];
+    gfal2_iovec_t vector[2];
+    vector[0].offset = 0;
+    vector[0].size = sizeof(first);
+    vector[0].buffer = first;
+    vector[1].offset = FILE_SIZE - 12;
+    vector[1].size = sizeof(last);
+    vector[1].buffer = last;
+
+    ssize_t ret = gfal2_readv(context, fd, vector, 2, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, ret, error);
+    ASSERT_EQ(sizeof(first) + 12, ret);
+    EXPECT_EQ(sizeof(first), vector[0].nbytes);
+    EXPECT_EQ(12, vector[1].nbytes);
+    EXPECT_TRUE(CheckContent(first, vector[0].nbytes, 0));
+    EXPECT_TRUE(CheckContent(last, vector[1].nbytes, FILE_SIZE - 12));
+
+    gfal2_close(context, fd, NULL);
+}
+
+
+TEST_F(PositionalTest, ConcurrentPRead)
+{
+    GError *error = NULL;
+    std::string url = GenerateFile();
+
+    int fd = gfal2_open(context, url.c_str(), O_RDONLY, &error);
+    ASSERT_PRED_FORMAT2(AssertGfalSuccess, fd, error);
+
+    const int nthreads = 16, nreads = 100;
+    std::vector<int> failures(nthreads, 0);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < nthreads; ++t) {
+        threads.push_back(std::thread([this, fd, t, &failures]() {
+            char buffer[4096];
+            for (int i = 0; i < nreads; ++i) {
+                GError *tmp_err = NULL;
+                off_t offset = ((t * nreads + i) * 7919L) % (FILE_SIZE - sizeof(buffer));
+                ssize_t ret = gfal2_pread(context, fd, buffer, sizeof(buffer), offset, &tmp_err);
+                if (ret != sizeof(buffer) || !CheckContent(buffer, ret, offset)) {
+                    ++failures[t];
+                }
+                g_clear_error(&tmp_err);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    for (int t = 0; t < nthreads; ++t) {
+        EXPECT_EQ(0, failures[t]) << "thread " << t;
+    }
+
+    gfal2_close(context, fd, NULL);
+}
+
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    if (argc < 2) {
+        printf("Missing base url\n");
+        printf("\t%s [options] root://host/base/path/\n", argv[0]);
+        return 1;
+    }
+
+    PositionalTest::root = argv[1];
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <checksums/checksums.h>
+
+//
+// Measure the throughput of each checksum algorithm, for each instruction set
+// supported by this CPU
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void run_checksum(const char* type, gfal2_checksum_isa_t isa,
+        const unsigned char* buffer, size_t size, int iterations)
+{
+    char result[64];
+    int i;
+
+    gfal2_checksum_stream_t* stream = gfal2_checksum_stream_new_isa(type, isa);
+    double start = bench_now();
+    for (i = 0; i < iterations; ++i) {
+        gfal2_checksum_stream_update(stream, buffer, size);
+    }
+    gfal2_checksum_stream_final(stream, result, sizeof(result));
+    double elapsed = bench_now() - start;
+    gfal2_checksum_stream_free(stream);
+
+    printf("%-8s %-8s %8.2f GB/s\n", type, gfal2_checksum_isa_name(isa),
+           ((double)size * iterations) / elapsed / 1e9);
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* types[] = {"ADLER32", "CRC32", "CRC32C", "MD5"};
+    size_t size = 64 << 20;
+    int iterations = 8;
+    size_t i;
+    int isa;
+
+    if (argc > 1)
+        size = strtoull(argv[1], NULL, 10);
+    if (argc > 2)
+        iterations = atoi(argv[2]);
+
+    unsigned char* buffer = malloc(size);
+    for (i = 0; i < size; ++i) {
+        buffer[i] = rand() & 0xFF;
+    }
+
+    printf("Detected instruction set: %s\n", gfal2_checksum_isa_name(gfal2_checksum_isa_detect()));
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        for (isa = GFAL2_CHECKSUM_ISA_GENERIC; isa <= (int)gfal2_checksum_isa_detect(); ++isa) {
+            run_checksum(types[i], (gfal2_checksum_isa_t)isa, buffer, size, iterations);
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <gfal_api.h>
+#include <common/gfal_file_handler_container.h>
+
+//
+// Measure the throughput of gfal_file_handle_bind on a shared descriptor
+// table, from 1 up to 128 concurrent threads
+//
+
+#define BENCH_MAX_THREADS 128
+
+typedef struct {
+    gfal_file_handle_container container;
+    int* fds;
+    int n_fds;
+    long iterations;
+    long errors;
+} bench_args;
+
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void* bench_bind(void* data)
+{
+    bench_args* args = (bench_args*)data;
+    long i;
+    for (i = 0; i < args->iterations; ++i) {
+        if (gfal_file_handle_bind(args->container, args->fds[i % args->n_fds], NULL) == NULL)
+            ++args->errors;
+    }
+    return NULL;
+}
+
+
+static int run_bind(gfal_file_handle_container container, int* fds, int n_fds,
+        int n_threads, long iterations)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    bench_args args[BENCH_MAX_THREADS];
+    long errors = 0;
+    int i;
+
+    double start = bench_now();
+    for (i = 0; i < n_threads; ++i) {
+        args[i].container = container;
+        args[i].fds = fds;
+        args[i].n_fds = n_fds;
+        args[i].iterations = iterations;
+        args[i].errors = 0;
+        pthread_create(&threads[i], NULL, bench_bind, &args[i]);
+    }
+    for (i = 0; i < n_threads; ++i) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%4d threads: %14.0f binds/s\n", n_threads, (n_threads * iterations) / elapsed);
+    if (errors) {
+        printf(" %ld binds failed\n", errors);
+        return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    long iterations = 1000000;
+    int n_fds = 1024;
+    int i, n_threads;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            n_fds = atoi(argv[++i]);
+        }
+        else {
+            printf(" Usage %s [-n iterations per thread] [-f open descriptors]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    gfal_file_handle_container container = gfal_file_descriptor_handle_create(NULL);
+    int* fds = g_new0(int, n_fds);
+    for (i = 0; i < n_fds; ++i) {
+        GError* tmp_err = NULL;
+        fds[i] = gfal_add_new_file_desc(container, GINT_TO_POINTER(i + 1), &tmp_err);
+        if (fds[i] == 0) {
+            printf(" can not register descriptor %d : %s.\n", i, tmp_err->message);
+            return -1;
+        }
+    }
+
+    int ret = 0;
+    for (n_threads = 1; n_threads <= BENCH_MAX_THREADS && ret == 0; n_threads *= 2) {
+        ret = run_bind(container, fds, n_fds, n_threads, iterations);
+    }
+
+    g_free(fds);
+    gfal_file_descriptor_handle_destroy(container);
+    return ret;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <gfal_api.h>
+
+//
+// Measure how the checksum of a local file scales with the number of threads
+//   gfal2_bench_file_checksum file:///data/50G ADLER32
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int run_checksum(gfal2_context_t handle, const char* url, const char* type, off_t size, int threads)
+{
+    GError* tmp_err = NULL;
+    char checksum[64];
+
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "CHECKSUM_THREADS", threads, NULL);
+
+    double start = bench_now();
+    int ret = gfal2_checksum(handle, url, type, 0, 0, checksum, sizeof(checksum), &tmp_err);
+    double elapsed = bench_now() - start;
+
+    if (ret != 0) {
+        printf(" checksum failed %d : %s.\n", tmp_err->code, tmp_err->message);
+        g_error_free(tmp_err);
+        return -1;
+    }
+    printf("%-8s %3d threads: %8.2f GB/s (%s)\n", type, threads, size / elapsed / 1e9, checksum);
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* tmp_err = NULL;
+    struct stat st;
+
+    if (argc < 2) {
+        printf(" Usage %s url [checksum type] [max threads]\n", argv[0]);
+        return 1;
+    }
+    const char* type = (argc > 2) ? argv[2] : "ADLER32";
+    int max_threads = (argc > 3) ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal2_context_t handle = gfal2_context_new(&tmp_err);
+    if (handle == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    if (gfal2_stat(handle, argv[1], &st, &tmp_err) != 0) {
+        printf(" can not stat %s %d : %s.\n", argv[1], tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    int threads, ret = 0;
+    for (threads = 1; threads <= max_threads && ret == 0; threads *= 2) {
+        ret = run_checksum(handle, argv[1], type, st.st_size, threads);
+    }
+
+    gfal2_context_free(handle);
+    return ret;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+#include "plugins/gridftp/gridftp_parsing.h"
+#include "plugins/gridftp/gridftp_dir_reader/GridFTPLineScanner.h"
+
+//
+// Compare the previous MLSD line splitting (4 KiB streambuf, getline, trim and strdup per entry)
+// with the chunked in place scanner, over a recorded MLSD stream, or a generated one
+//   gfal2_bench_gridftp_mlsd [recorded.mlsd] [-n entries] [-o record.mlsd]
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static std::string generate_mlsd(long entries)
+{
+    std::string out;
+    char line[512];
+    for (long i = 0; i < entries; ++i) {
+        if (i % 50 == 0) {
+            snprintf(line, sizeof(line),
+                "Type=dir;Modify=20230412101530;Perm=cpmdfle;UNIX.mode=0755;UNIX.owner=atlas;"
+                "UNIX.group=zp;Unique=fd00-%lx; directory_%07ld\r\n", i, i);
+        }
+        else {
+            snprintf(line, sizeof(line),
+                "Type=file;Modify=20230412101530;Size=%ld;Perm=adfrw;UNIX.mode=0644;"
+                "UNIX.owner=atlas;UNIX.group=zp;Unique=fd00-%lx; DAOD_PHYS.%08ld._%06ld.pool.root.1\r\n",
+                (i * 7919) % 4000000000L, i, i * 13, i);
+        }
+        out.append(line);
+    }
+    return out;
+}
+
+
+// What the dir readers did before
+class MemoryStreamBuffer: public std::streambuf {
+    const std::string& data;
+    size_t offset;
+    char buffer[4096];
+
+    ssize_t fetch_more() {
+        size_t n = std::min(sizeof(buffer) - 1, data.size() - offset);
+        memcpy(buffer, data.data() + offset, n);
+        offset += n;
+        this->setg(buffer, buffer, buffer + n);
+        return n;
+    }
+
+public:
+    MemoryStreamBuffer(const std::string& data): data(data), offset(0) {
+        fetch_more();
+    }
+
+    int_type underflow() {
+        if (fetch_more() <= 0)
+            return traits_type::eof();
+        return *buffer;
+    }
+};
+
+
+static std::string& trim(std::string& str)
+{
+    size_t i = 0;
+    while (i < str.length() && isspace(str[i]))
+        ++i;
+    str = str.substr(i);
+    int j = str.length() - 1;
+    while (j >= 0 && isspace(str[j]))
+        --j;
+    str = str.substr(0, j + 1);
+    return str;
+}
+
+
+static long run_streambuf(const std::string& data, bool parse)
+{
+    MemoryStreamBuffer stream_buffer(data);
+    struct stat st;
+    char name[256];
+    long count = 0;
+    while (true) {
+        std::string line;
+        std::istream in(&stream_buffer);
+        if (!std::getline(in, line) || trim(line).empty())
+            break;
+        char* unparsed = strdup(line.c_str());
+        if (parse && parse_mlst_line(unparsed, &st, name, sizeof(name)) != GLOBUS_SUCCESS) {
+            free(unparsed);
+            return -1;
+        }
+        free(unparsed);
+        ++count;
+    }
+    return count;
+}
+
+
+static long run_scanner(const std::string& data, bool parse)
+{
+    // globus hands over the data in chunks of about this size
+    const size_t chunk_size = 65536;
+    size_t offset = 0;
+    GridFTPLineScanner scanner([&data, &offset, chunk_size](char* buffer, size_t size) -> ssize_t {
+        size_t n = std::min(std::min(size, chunk_size), data.size() - offset);
+        memcpy(buffer, data.data() + offset, n);
+        offset += n;
+        return n;
+    });
+    struct stat st;
+    char name[256];
+    long count = 0;
+    size_t length;
+    char* line;
+    while ((line = scanner.next_line(&length)) != NULL && length > 0) {
+        if (parse && parse_mlst_line(line, &st, name, sizeof(name)) != GLOBUS_SUCCESS)
+            return -1;
+        ++count;
+    }
+    return count;
+}
+
+
+static int run(const char* name, long (*fn)(const std::string&, bool), const std::string& data, bool parse)
+{
+    double start = bench_now();
+    long count = fn(data, parse);
+    double elapsed = bench_now() - start;
+    if (count < 0) {
+        printf(" %s: parsing failed\n", name);
+        return -1;
+    }
+    printf("%-10s %-6s %8ld entries in %7.3f s: %12.0f entries/s %8.2f MiB/s\n", name,
+           parse ? "parse" : "split", count, elapsed, count / elapsed,
+           data.size() / elapsed / (1024 * 1024));
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    long entries = 1000000;
+    const char* recorded = NULL;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            entries = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if (argv[i][0] == '-') {
+            printf(" Usage %s [recorded.mlsd] [-n entries] [-o record.mlsd]\n", argv[0]);
+            return 1;
+        }
+        else {
+            recorded = argv[i];
+        }
+    }
+
+    std::string data;
+    if (recorded) {
+        std::ifstream in(recorded, std::ios::binary);
+        if (!in.good()) {
+            printf(" can not open %s\n", recorded);
+            return -1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        data = buffer.str();
+    }
+    else {
+        data = generate_mlsd(entries);
+    }
+    if (output) {
+        std::ofstream(output, std::ios::binary) << data;
+    }
+    printf("MLSD stream of %.2f MiB\n", data.size() / (1024.0 * 1024));
+
+    for (int parse = 0; parse < 2; ++parse) {
+        if (run("streambuf", run_streambuf, data, parse) != 0 ||
+            run("scanner", run_scanner, data, parse) != 0)
+            return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfal_api.h>
+
+//
+// Measure gfal2_pread over gsiftp with and without the pread block cache,
+// for sequential, random and repeated access patterns
+//   gfal2_bench_gridftp_pread gsiftp://localhost/tmp/100M [-n reads] [-s read size]
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+enum access_pattern_t {
+    ACCESS_SEQUENTIAL, ACCESS_RANDOM, ACCESS_HOT_SET
+};
+
+static const char* access_pattern_names[] = {"sequential", "random", "hot set"};
+
+
+static off_t next_offset(enum access_pattern_t pattern, long i, size_t read_size, off_t file_size)
+{
+    off_t slots = file_size / read_size;
+    if (slots <= 0)
+        return 0;
+    switch (pattern) {
+        case ACCESS_SEQUENTIAL:
+            return (i % slots) * read_size;
+        case ACCESS_RANDOM:
+            return (random() % slots) * read_size;
+        case ACCESS_HOT_SET:
+        default:
+            // a handful of small records, read over and over
+            return (random() % (slots < 16 ? slots : 16)) * read_size;
+    }
+}
+
+
+static int run_pattern(gfal2_context_t handle, const char* url, enum access_pattern_t pattern,
+        gboolean cache, long iterations, size_t read_size, off_t file_size)
+{
+    GError* tmp_err = NULL;
+    char* buffer = malloc(read_size);
+    long i;
+
+    gfal2_set_opt_boolean(handle, "GRIDFTP PLUGIN", "PREAD_CACHE", cache, NULL);
+
+    int fd = gfal2_open(handle, url, O_RDONLY, &tmp_err);
+    if (fd < 0) {
+        printf(" can not open %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        free(buffer);
+        return -1;
+    }
+
+    srandom(42);
+    size_t total = 0;
+    double start = bench_now();
+    for (i = 0; i < iterations; ++i) {
+        off_t offset = next_offset(pattern, i, read_size, file_size);
+        ssize_t ret = gfal2_pread(handle, fd, buffer, read_size, offset, &tmp_err);
+        if (ret < 0) {
+            printf(" pread failed %d : %s.\n", tmp_err->code, tmp_err->message);
+            gfal2_close(handle, fd, NULL);
+            free(buffer);
+            return -1;
+        }
+        total += ret;
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%-10s %-8s %8zu bytes: %10.1f preads/s %8.2f MiB/s\n", access_pattern_names[pattern],
+           cache ? "cached" : "uncached", read_size, iterations / elapsed,
+           total / elapsed / (1024 * 1024));
+
+    gfal2_close(handle, fd, NULL);
+    free(buffer);
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* tmp_err = NULL;
+    struct stat st;
+    long iterations = 1000;
+    size_t read_size = 4096;
+    const char* url = NULL;
+    int i;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            read_size = atol(argv[++i]);
+        }
+        else {
+            url = argv[i];
+        }
+    }
+    if (url == NULL || read_size == 0) {
+        printf(" Usage %s gsiftp://host/path [-n reads] [-s read size]\n", argv[0]);
+        return 1;
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal2_context_t handle = gfal2_context_new(&tmp_err);
+    if (handle == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    if (gfal2_stat(handle, url, &st, &tmp_err) != 0) {
+        printf(" can not stat %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    int ret = 0;
+    enum access_pattern_t pattern;
+    for (pattern = ACCESS_SEQUENTIAL; pattern <= ACCESS_HOT_SET && ret == 0; ++pattern) {
+        ret = run_pattern(handle, url, pattern, FALSE, iterations, read_size, st.st_size);
+        if (ret == 0)
+            ret = run_pattern(handle, url, pattern, TRUE, iterations, read_size, st.st_size);
+    }
+
+    gfal2_context_free(handle);
+    return ret;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <gfal_api.h>
+
+#define __GFAL2_H_INSIDE__
+#include <common/gfal_plugin.h>
+#undef __GFAL2_H_INSIDE__
+
+#include <davix.hpp>
+#include "plugins/http/gfal_http_plugin.h"
+
+//
+// Measure how many request parameters per second GfalHttpPluginData::get_params prepares,
+// with and without the parameters cache
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int run_get_params(const char* url, const char* token, long iterations, int cache_size)
+{
+    GError* tmp_err = NULL;
+    gfal2_context_t handle;
+
+    if ((handle = gfal2_context_new(&tmp_err)) == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    // No network round trip while measuring
+    gfal2_set_opt_boolean(handle, "HTTP PLUGIN", "RETRIEVE_BEARER_TOKEN", FALSE, NULL);
+    gfal2_set_opt_integer(handle, "HTTP PLUGIN", HTTP_CONFIG_PARAMS_CACHE_SIZE, cache_size, NULL);
+
+    if (token) {
+        gfal2_cred_t* cred = gfal2_cred_new(GFAL_CRED_BEARER, token);
+        gfal2_cred_set(handle, url, cred, NULL);
+        gfal2_cred_free(cred);
+    }
+
+    gfal_plugin_interface* p = gfal_find_plugin(handle, url, GFAL_PLUGIN_STAT, &tmp_err);
+    if (p == NULL) {
+        printf(" no plugin for %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    GfalHttpPluginData* davix = static_cast<GfalHttpPluginData*>(gfal_get_plugin_handle(p));
+    Davix::Uri uri(url);
+
+    double start = bench_now();
+    for (long i = 0; i < iterations; ++i) {
+        Davix::RequestParams params;
+        davix->get_params(&params, uri, GfalHttpPluginData::OP::READ);
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%-10s %-50s %12.0f calls/s\n", cache_size > 0 ? "cached" : "uncached", url, iterations / elapsed);
+
+    gfal2_context_free(handle);
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf(" Usage %s [url]... [-n iterations] [-t bearer token]\n", argv[0]);
+        return 1;
+    }
+
+    long iterations = 100000;
+    const char* token = NULL;
+    int i;
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            token = argv[++i];
+        }
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "-t") == 0) {
+            ++i;
+            continue;
+        }
+        if (run_get_params(argv[i], token, iterations, 0) != 0 ||
+            run_get_params(argv[i], token, iterations, 256) != 0)
+            return -1;
+    }
+    return 0;
+}
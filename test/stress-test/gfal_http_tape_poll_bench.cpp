@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) CERN 2022
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <json.h>
+#include <glib.h>
+
+#include "uri/gfal2_parsing.h"
+#include "plugins/http/gfal_http_tape_index.h"
+
+//
+// Measure the handling of a Tape REST API stage poll answer with many files:
+// parsing it in blocks, indexing it, and looking up every file,
+// against a linear scan of the files array for each looked up file
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static std::string file_path(long i)
+{
+    std::ostringstream path;
+    path << "/eos/experiment//data/run" << (i / 1000) << "/file" << i << ".root";
+    return path.str();
+}
+
+
+static std::string synthetic_response(long nfiles)
+{
+    std::ostringstream body;
+    body << "{\"id\": \"bench-request\", \"createdAt\": 1650000000, \"files\": [";
+    for (long i = 0; i < nfiles; ++i) {
+        if (i != 0) {
+            body << ", ";
+        }
+        body << "{\"path\": \"" << file_path(i) << "\", \"onDisk\": " << ((i % 3) ? "false" : "true")
+             << ", \"state\": \"" << ((i % 3) ? "STARTED" : "COMPLETED") << "\"}";
+    }
+    body << "]}";
+    return body.str();
+}
+
+
+static std::string collapse(const std::string& path)
+{
+    char* collapsed = gfal2_path_collapse_slashes(path.c_str());
+    std::string result(collapsed);
+    g_free(collapsed);
+    return result;
+}
+
+
+// What the polling did before the index: rescan the array, collapsing both paths for each item
+static struct json_object* linear_lookup(struct json_object* files, const std::string& surl)
+{
+    const int len = json_object_array_length(files);
+    for (int i = 0; i < len; i++) {
+        struct json_object* item = json_object_array_get_idx(files, i);
+        struct json_object* item_path = 0;
+        json_object_object_get_ex(item, "path", &item_path);
+        std::string path = item_path ? json_object_get_string(item_path) : "";
+        if (!path.empty() && collapse(path) == collapse(surl)) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+
+int main(int argc, char** argv)
+{
+    long nfiles = 100000;
+    long linear_samples = 200;
+    int i;
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            nfiles = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            linear_samples = atol(argv[++i]);
+        }
+        else {
+            printf(" Usage %s [-n files] [-s linear scan samples]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::string body = synthetic_response(nfiles);
+    printf("%ld files, %zu bytes of JSON\n", nfiles, body.size());
+
+    double start = bench_now();
+    JsonStreamParser parser;
+    for (size_t offset = 0; offset < body.size(); offset += 64 * 1024) {
+        parser.feed(body.data() + offset, std::min<size_t>(64 * 1024, body.size() - offset));
+    }
+    struct json_object* response = parser.finish();
+    double parse_time = bench_now() - start;
+    if (!response) {
+        printf(" the synthetic response could not be parsed\n");
+        return -1;
+    }
+
+    struct json_object* files = NULL;
+    json_object_object_get_ex(response, "files", &files);
+
+    start = bench_now();
+    TapeFileIndex index(files);
+    double index_time = bench_now() - start;
+
+    start = bench_now();
+    long online = 0;
+    for (long f = 0; f < nfiles; ++f) {
+        const TapeFileStatus* status = index.find(file_path(f));
+        if (status && status->on_disk) {
+            ++online;
+        }
+    }
+    double lookup_time = bench_now() - start;
+
+    printf("%-24s %10.3f s\n", "streamed parse", parse_time);
+    printf("%-24s %10.3f s\n", "index build", index_time);
+    printf("%-24s %10.3f s (%ld online)\n", "indexed lookups", lookup_time, online);
+
+    if (linear_samples > 0) {
+        start = bench_now();
+        long found = 0;
+        for (long s = 0; s < linear_samples; ++s) {
+            // Spread the samples over the array, so the average scan length is representative
+            if (linear_lookup(files, file_path((s * nfiles) / linear_samples)) != NULL) {
+                ++found;
+            }
+        }
+        double per_lookup = (bench_now() - start) / linear_samples;
+        printf("%-24s %10.3f s (extrapolated from %ld lookups, %ld found)\n", "linear scan lookups",
+               per_lookup * nfiles, linear_samples, found);
+    }
+
+    json_object_put(response);
+    return 0;
+}
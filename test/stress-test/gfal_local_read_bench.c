@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <gfal_api.h>
+#include <transfer/gfal_transfer_internal.h>
+
+//
+// Compare buffered reads, mmap and O_DIRECT for local files, with a cold and a warm page cache
+// The checksum of the source is computed, and, if a destination is given, it is copied too
+//   gfal2_bench_local_read file:///data/10G [ADLER32] [file:///scratch/dst]
+// Dropping the page cache only works for clean pages, so the file should not have been just written
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+struct read_mode_t {
+    const char* name;
+    gboolean mmap;
+    gint64 direct_io_min_size;
+};
+
+static const struct read_mode_t read_modes[] = {
+    {"read",   FALSE, 0},
+    {"mmap",   TRUE,  0},
+    {"direct", TRUE,  1},
+};
+
+
+static int drop_page_cache(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return ret;
+}
+
+
+static void warm_page_cache(const char* path)
+{
+    char buffer[1 << 20];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    while (read(fd, buffer, sizeof(buffer)) > 0);
+    close(fd);
+}
+
+
+static int run_mode(gfal2_context_t handle, const struct read_mode_t* mode, gboolean cold,
+        const char* src, const char* type, const char* dst, off_t size)
+{
+    GError* tmp_err = NULL;
+    char checksum[64];
+
+    gfal2_set_opt_boolean(handle, CORE_CONFIG_GROUP, "LOCAL_READ_MMAP", mode->mmap, NULL);
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "LOCAL_READ_DIRECT_IO_MIN_SIZE",
+            mode->direct_io_min_size, NULL);
+
+    if (cold)
+        drop_page_cache(src + 7);
+    else
+        warm_page_cache(src + 7);
+
+    double start = bench_now();
+    int ret = gfal2_checksum(handle, src, type, 0, 0, checksum, sizeof(checksum), &tmp_err);
+    double elapsed = bench_now() - start;
+    if (ret != 0) {
+        printf(" checksum failed %d : %s.\n", tmp_err->code, tmp_err->message);
+        g_error_free(tmp_err);
+        return -1;
+    }
+    printf("%-6s %-4s checksum: %8.2f MiB/s (%s)\n", mode->name, cold ? "cold" : "warm",
+           size / elapsed / (1024 * 1024), checksum);
+
+    if (dst == NULL)
+        return 0;
+
+    gfalt_params_t params = gfalt_params_handle_new(NULL);
+    gfalt_set_replace_existing_file(params, TRUE, NULL);
+    gfalt_set_timeout(params, 3600, NULL);
+
+    if (cold)
+        drop_page_cache(src + 7);
+
+    start = bench_now();
+    ret = perform_local_copy(handle, params, src, dst, &tmp_err);
+    elapsed = bench_now() - start;
+    gfalt_params_handle_delete(params, NULL);
+
+    if (ret != 0) {
+        printf(" copy failed %d : %s.\n", tmp_err->code, tmp_err->message);
+        g_error_free(tmp_err);
+        return -1;
+    }
+    printf("%-6s %-4s copy:     %8.2f MiB/s\n", mode->name, cold ? "cold" : "warm",
+           size / elapsed / (1024 * 1024));
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* tmp_err = NULL;
+    struct stat st;
+
+    if (argc < 2 || strncmp(argv[1], "file://", 7) != 0) {
+        printf(" Usage %s file://path [checksum type] [destination]\n", argv[0]);
+        return 1;
+    }
+    const char* type = (argc > 2) ? argv[2] : "ADLER32";
+    const char* dst = (argc > 3) ? argv[3] : NULL;
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal2_context_t handle = gfal2_context_new(&tmp_err);
+    if (handle == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    if (gfal2_stat(handle, argv[1], &st, &tmp_err) != 0) {
+        printf(" can not stat %s %d : %s.\n", argv[1], tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    // the checksum is done by a single thread, so only the read path differs
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "CHECKSUM_THREADS", 1, NULL);
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "COPY_PARALLEL_WORKERS", 1, NULL);
+
+    size_t i;
+    int ret = 0;
+    for (i = 0; i < sizeof(read_modes) / sizeof(read_modes[0]) && ret == 0; ++i) {
+        ret = run_mode(handle, &read_modes[i], TRUE, argv[1], type, dst, st.st_size);
+        if (ret == 0)
+            ret = run_mode(handle, &read_modes[i], FALSE, argv[1], type, dst, st.st_size);
+    }
+
+    gfal2_context_free(handle);
+    return ret;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfal_api.h>
+#include <gfal_plugins_api.h>
+#include <common/gfal_plugin.h>
+
+//
+// Measure how many plugin resolutions per second gfal_find_plugin does,
+// with and without the plugin dispatch cache
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int run_dispatch(const char* url, long iterations, gboolean use_cache)
+{
+    GError* tmp_err = NULL;
+    gfal2_context_t handle;
+    long i;
+
+    if ((handle = gfal2_context_new(&tmp_err)) == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    gfal2_set_opt_boolean(handle, CORE_CONFIG_GROUP, "PLUGIN_DISPATCH_CACHE", use_cache, NULL);
+
+    // reload the plugins, so the cache setting is picked up
+    gfal_plugins_delete(handle, NULL);
+    if (gfal_plugins_instance(handle, &tmp_err) <= 0) {
+        printf(" can not load the plugins: %s.\n", tmp_err ? tmp_err->message : "none found");
+        return -1;
+    }
+
+    gfal_plugin_interface* p = gfal_find_plugin(handle, url, GFAL_PLUGIN_STAT, &tmp_err);
+    if (p == NULL) {
+        printf(" no plugin for %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    double start = bench_now();
+    for (i = 0; i < iterations; ++i) {
+        gfal_find_plugin(handle, url, GFAL_PLUGIN_STAT, NULL);
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%-10s %-40s %s: %12.0f calls/s\n", use_cache ? "cached" : "uncached",
+           url, p->getName(), iterations / elapsed);
+
+    gfal2_context_free(handle);
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf(" Usage %s [url]... [-n iterations]\n", argv[0]);
+        return 1;
+    }
+
+    long iterations = 1000000;
+    int i;
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        }
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0) {
+            ++i;
+            continue;
+        }
+        if (run_dispatch(argv[i], iterations, FALSE) != 0 ||
+            run_dispatch(argv[i], iterations, TRUE) != 0)
+            return -1;
+    }
+    return 0;
+}
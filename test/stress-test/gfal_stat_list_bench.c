@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <gfal_api.h>
+
+//
+// Compare gfal2_stat called in a loop with gfal2_stat_list
+// By default, a minimal HTTP server with an artificial latency is started on localhost,
+// so the latency of each request dominates, as it does against a remote storage
+//   gfal2_bench_stat_list [-n files] [-l latency ms] [-c concurrency] [-u base url]
+//
+
+static int server_latency_ms = 20;
+
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Serve the requests of one connection, with keep alive
+// PROPFIND is refused, so the client falls back to HEAD, as with a plain HTTP object store
+static void* server_connection(void* data)
+{
+    int fd = (int)(long)data;
+    char buffer[8192];
+    size_t used = 0;
+
+    while (1) {
+        ssize_t ret = recv(fd, buffer + used, sizeof(buffer) - used - 1, 0);
+        if (ret <= 0)
+            break;
+        used += ret;
+        buffer[used] = '\0';
+
+        char* end;
+        while ((end = strstr(buffer, "\r\n\r\n")) != NULL) {
+            size_t header_len = end + 4 - buffer;
+            size_t body_len = 0;
+            char* content_length = strcasestr(buffer, "Content-Length:");
+            if (content_length && content_length < end)
+                body_len = atol(content_length + 15);
+            if (used < header_len + body_len)
+                break;
+
+            usleep(server_latency_ms * 1000);
+
+            const char* response;
+            if (strncmp(buffer, "HEAD", 4) == 0) {
+                response = "HTTP/1.1 200 OK\r\nContent-Length: 1048576\r\n"
+                    "Last-Modified: Mon, 01 Jan 2018 00:00:00 GMT\r\n\r\n";
+            }
+            else {
+                response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n";
+            }
+            if (send(fd, response, strlen(response), MSG_NOSIGNAL) < 0) {
+                close(fd);
+                return NULL;
+            }
+
+            used -= header_len + body_len;
+            memmove(buffer, buffer + header_len + body_len, used);
+            buffer[used] = '\0';
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+
+static void* server_accept(void* data)
+{
+    int server_fd = (int)(long)data;
+    while (1) {
+        int fd = accept(server_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        pthread_t thread;
+        pthread_create(&thread, NULL, server_connection, (void*)(long)fd);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+
+static int server_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addr_len) < 0) {
+        perror("Can not start the test server");
+        return -1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_accept, (void*)(long)fd);
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* tmp_err = NULL;
+    int nfiles = 1000, concurrency = 8, i;
+    const char* base_url = NULL;
+    char local_url[64];
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nfiles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            server_latency_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            concurrency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+            base_url = argv[++i];
+        else {
+            printf(" Usage %s [-n files] [-l latency ms] [-c concurrency] [-u base url]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (base_url == NULL) {
+        int port = server_start();
+        if (port < 0)
+            return -1;
+        snprintf(local_url, sizeof(local_url), "http://127.0.0.1:%d/bench", port);
+        base_url = local_url;
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal2_context_t handle = gfal2_context_new(&tmp_err);
+    if (handle == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    gfal2_set_opt_integer(handle, "HTTP PLUGIN", "STAT_LIST_CONCURRENCY", concurrency, NULL);
+
+    char** urls = g_new0(char*, nfiles);
+    struct stat* stats = g_new0(struct stat, nfiles);
+    GError** errors = g_new0(GError*, nfiles);
+    for (i = 0; i < nfiles; ++i) {
+        urls[i] = g_strdup_printf("%s/file%d", base_url, i);
+    }
+
+    // Warm up, so the connections and the endpoint capabilities are known for both
+    struct stat st;
+    if (gfal2_stat(handle, urls[0], &st, &tmp_err) != 0) {
+        printf(" can not stat %s %d : %s.\n", urls[0], tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    double start = bench_now();
+    for (i = 0; i < nfiles; ++i) {
+        if (gfal2_stat(handle, urls[i], &st, &tmp_err) != 0) {
+            printf(" stat failed %d : %s.\n", tmp_err->code, tmp_err->message);
+            return -1;
+        }
+    }
+    double elapsed = bench_now() - start;
+    printf("gfal2_stat      : %8.0f stat/s (%.2f s)\n", nfiles / elapsed, elapsed);
+
+    start = bench_now();
+    int ret = gfal2_stat_list(handle, nfiles, (const char* const*)urls, stats, errors);
+    elapsed = bench_now() - start;
+    printf("gfal2_stat_list : %8.0f stat/s (%.2f s, %d in flight)\n", nfiles / elapsed, elapsed, concurrency);
+
+    for (i = 0; i < nfiles; ++i) {
+        if (errors[i]) {
+            if (ret == 0)
+                printf(" unreported error!\n");
+            printf(" stat failed for %s %d : %s.\n", urls[i], errors[i]->code, errors[i]->message);
+            g_error_free(errors[i]);
+            ret = -1;
+        }
+        g_free(urls[i]);
+    }
+    g_free(urls);
+    g_free(stats);
+    g_free(errors);
+
+    gfal2_context_free(handle);
+    return ret;
+}
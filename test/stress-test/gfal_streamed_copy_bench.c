@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfal_api.h>
+#include <transfer/gfal_transfer_internal.h>
+
+//
+// Measure the streamed copy throughput for several pipeline depths, or
+// for several number of parallel workers (-w)
+// Latency can be injected using the mock plugin, i.e.
+//   gfal2_bench_streamed_copy "mock://host/src?size=268435456&read_wait_ms=20" "mock://host/dst?write_wait_ms=20"
+//   gfal2_bench_streamed_copy file:///nvme0/src file:///nvme1/dst -w 1 2 4 8 16
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int run_copy(const char* src, const char* dst, int depth, int workers)
+{
+    GError* tmp_err = NULL;
+    gfal2_context_t handle;
+    struct stat st;
+
+    if ((handle = gfal2_context_new(&tmp_err)) == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "COPY_PIPELINE_DEPTH", depth, NULL);
+    gfal2_set_opt_integer(handle, CORE_CONFIG_GROUP, "COPY_PARALLEL_WORKERS", workers, NULL);
+
+    if (gfal2_stat(handle, src, &st, &tmp_err) != 0) {
+        printf(" can not stat the source %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    gfalt_params_t params = gfalt_params_handle_new(NULL);
+    gfalt_set_replace_existing_file(params, TRUE, NULL);
+    gfalt_set_timeout(params, 3600, NULL);
+
+    double start = bench_now();
+    int ret = perform_local_copy(handle, params, src, dst, &tmp_err);
+    double elapsed = bench_now() - start;
+
+    if (ret != 0) {
+        printf(" copy failed %d : %s.\n", tmp_err->code, tmp_err->message);
+    }
+    else {
+        printf("depth %2d, workers %2d: %10.2f MiB/s (%.2f s)\n", depth, workers,
+               st.st_size / elapsed / (1024 * 1024), elapsed);
+    }
+
+    gfalt_params_handle_delete(params, NULL);
+    gfal2_context_free(handle);
+    return ret;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        printf(" Usage %s src dst [depth]...\n", argv[0]);
+        printf("       %s src dst -w [workers]...\n", argv[0]);
+        return 1;
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    int first = 3;
+    gboolean vary_workers = (argc > 3 && strcmp(argv[3], "-w") == 0);
+    if (vary_workers)
+        ++first;
+
+    if (argc == first) {
+        const int values[] = {1, 2, 4, 8};
+        size_t i;
+        for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+            if (run_copy(argv[1], argv[2], vary_workers ? 1 : values[i], vary_workers ? values[i] : 1) != 0)
+                return -1;
+        }
+    }
+    else {
+        int i;
+        for (i = first; i < argc; ++i) {
+            int value = atoi(argv[i]);
+            if (run_copy(argv[1], argv[2], vary_workers ? 1 : value, vary_workers ? value : 1) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
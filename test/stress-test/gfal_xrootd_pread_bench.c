@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gfal_api.h>
+
+//
+// Measure small random reads over a single descriptor shared by many threads:
+// with gfal2_pread, with lseek + read serialized by a lock (what the core does for
+// plugins without pread), and with gfal2_readv batches
+//   gfal2_bench_xrootd_pread root://localhost//tmp/100M [-n reads per thread] [-t threads] [-s read size] [-v chunks per readv]
+//
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+enum read_mode_t {
+    READ_PREAD, READ_SEEK, READ_READV
+};
+
+static const char* read_mode_names[] = {"pread", "seek+read", "readv"};
+
+
+struct bench_shared_t {
+    gfal2_context_t handle;
+    int fd;
+    enum read_mode_t mode;
+    long iterations;
+    size_t read_size;
+    int chunks;
+    off_t file_size;
+    pthread_mutex_t seek_lock;
+};
+
+
+struct bench_thread_t {
+    struct bench_shared_t* shared;
+    pthread_t thread;
+    unsigned int seed;
+    size_t total;
+    int failed;
+};
+
+
+static off_t random_offset(struct bench_thread_t* self)
+{
+    off_t slots = self->shared->file_size / self->shared->read_size;
+    if (slots <= 0)
+        return 0;
+    return (rand_r(&self->seed) % slots) * self->shared->read_size;
+}
+
+
+static void* bench_thread(void* arg)
+{
+    struct bench_thread_t* self = (struct bench_thread_t*)arg;
+    struct bench_shared_t* shared = self->shared;
+    GError* tmp_err = NULL;
+    char* buffer = malloc(shared->read_size * shared->chunks);
+    gfal2_iovec_t* vector = calloc(shared->chunks, sizeof(gfal2_iovec_t));
+    long i;
+    int c;
+
+    for (i = 0; i < shared->iterations && !self->failed; ++i) {
+        ssize_t ret;
+        switch (shared->mode) {
+            case READ_PREAD:
+                ret = gfal2_pread(shared->handle, shared->fd, buffer, shared->read_size,
+                    random_offset(self), &tmp_err);
+                break;
+            case READ_SEEK:
+                pthread_mutex_lock(&shared->seek_lock);
+                ret = gfal2_lseek(shared->handle, shared->fd, random_offset(self), SEEK_SET, &tmp_err);
+                if (ret >= 0)
+                    ret = gfal2_read(shared->handle, shared->fd, buffer, shared->read_size, &tmp_err);
+                pthread_mutex_unlock(&shared->seek_lock);
+                break;
+            case READ_READV:
+            default:
+                for (c = 0; c < shared->chunks; ++c) {
+                    vector[c].offset = random_offset(self);
+                    vector[c].size = shared->read_size;
+                    vector[c].buffer = buffer + c * shared->read_size;
+                }
+                ret = gfal2_readv(shared->handle, shared->fd, vector, shared->chunks, &tmp_err);
+                break;
+        }
+        if (ret < 0) {
+            printf(" %s failed %d : %s.\n", read_mode_names[shared->mode], tmp_err->code, tmp_err->message);
+            g_clear_error(&tmp_err);
+            self->failed = 1;
+        }
+        else {
+            self->total += ret;
+        }
+    }
+
+    free(vector);
+    free(buffer);
+    return NULL;
+}
+
+
+static int run_mode(gfal2_context_t handle, const char* url, enum read_mode_t mode, int nthreads,
+        long iterations, size_t read_size, int chunks, off_t file_size)
+{
+    GError* tmp_err = NULL;
+    struct bench_shared_t shared;
+    int i, failed = 0;
+
+    shared.handle = handle;
+    shared.mode = mode;
+    shared.iterations = iterations;
+    shared.read_size = read_size;
+    shared.chunks = (mode == READ_READV) ? chunks : 1;
+    shared.file_size = file_size;
+    pthread_mutex_init(&shared.seek_lock, NULL);
+
+    shared.fd = gfal2_open(handle, url, O_RDONLY, &tmp_err);
+    if (shared.fd < 0) {
+        printf(" can not open %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    struct bench_thread_t* threads = calloc(nthreads, sizeof(struct bench_thread_t));
+    double start = bench_now();
+    for (i = 0; i < nthreads; ++i) {
+        threads[i].shared = &shared;
+        threads[i].seed = 42 + i;
+        pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]);
+    }
+
+    size_t total = 0;
+    for (i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i].thread, NULL);
+        total += threads[i].total;
+        failed |= threads[i].failed;
+    }
+    double elapsed = bench_now() - start;
+
+    long calls = nthreads * iterations;
+    printf("%-10s %3d threads %8zu bytes x %4d: %10.1f calls/s %10.1f reads/s %8.2f MiB/s\n",
+           read_mode_names[mode], nthreads, read_size, shared.chunks, calls / elapsed,
+           calls * shared.chunks / elapsed, total / elapsed / (1024 * 1024));
+
+    gfal2_close(handle, shared.fd, NULL);
+    pthread_mutex_destroy(&shared.seek_lock);
+    free(threads);
+    return failed ? -1 : 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    GError* tmp_err = NULL;
+    struct stat st;
+    long iterations = 1000;
+    int nthreads = 32, chunks = 16;
+    size_t read_size = 4096;
+    const char* url = NULL;
+    int i;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            read_size = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            chunks = atoi(argv[++i]);
+        }
+        else {
+            url = argv[i];
+        }
+    }
+    if (url == NULL || read_size == 0 || nthreads <= 0 || chunks <= 0) {
+        printf(" Usage %s root://host/path [-n reads per thread] [-t threads] [-s read size] [-v chunks per readv]\n",
+               argv[0]);
+        return 1;
+    }
+
+    gfal2_log_set_level(G_LOG_LEVEL_WARNING);
+
+    gfal2_context_t handle = gfal2_context_new(&tmp_err);
+    if (handle == NULL) {
+        printf(" bad initialization %d : %s.\n", tmp_err->code, tmp_err->message);
+        return -1;
+    }
+    if (gfal2_stat(handle, url, &st, &tmp_err) != 0) {
+        printf(" can not stat %s %d : %s.\n", url, tmp_err->code, tmp_err->message);
+        return -1;
+    }
+
+    int ret = 0;
+    enum read_mode_t mode;
+    for (mode = READ_PREAD; mode <= READ_READV && ret == 0; ++mode) {
+        ret = run_mode(handle, url, mode, nthreads, iterations, read_size, chunks, st.st_size);
+    }
+
+    gfal2_context_free(handle);
+    return ret;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <checksums/checksums.h>
+
+
+static std::string computeChecksum(const char* type, gfal2_checksum_isa_t isa,
+    const unsigned char* data, size_t size, size_t step)
+{
+    char result[64];
+    gfal2_checksum_stream_t* stream = gfal2_checksum_stream_new_isa(type, isa);
+    EXPECT_NE((void*)NULL, stream);
+    for (size_t done = 0; done < size; done += step) {
+        gfal2_checksum_stream_update(stream, data + done, std::min(step, size - done));
+    }
+    gfal2_checksum_stream_final(stream, result, sizeof(result));
+    gfal2_checksum_stream_free(stream);
+    return result;
+}
+
+
+TEST(ChecksumTest, KnownValues)
+{
+    const unsigned char* data = reinterpret_cast<const unsigned char*>("123456789");
+
+    EXPECT_EQ("091e01de", computeChecksum("ADLER32", GFAL2_CHECKSUM_ISA_GENERIC, data, 9, 9));
+    EXPECT_EQ("3421780262", computeChecksum("CRC32", GFAL2_CHECKSUM_ISA_GENERIC, data, 9, 9));
+    EXPECT_EQ("e3069283", computeChecksum("CRC32C", GFAL2_CHECKSUM_ISA_GENERIC, data, 9, 9));
+    EXPECT_EQ("25f9e794323b453885f5181f1b624d0b", computeChecksum("MD5", GFAL2_CHECKSUM_ISA_GENERIC, data, 9, 9));
+}
+
+
+TEST(ChecksumTest, Unsupported)
+{
+    EXPECT_EQ(NULL, gfal2_checksum_stream_new("SHA1"));
+}
+
+// The vectorized implementations must match the generic one, whatever the size,
+// the alignment and the way the data is split
+TEST(ChecksumTest, AllIsaMatch)
+{
+    const char* types[] = {"ADLER32", "CRC32", "CRC32C", "MD5"};
+    std::vector<unsigned char> data(1 << 20);
+    srand(42);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = rand() & 0xFF;
+    }
+
+    const size_t sizes[] = {0, 1, 15, 16, 63, 64, 65, 1000, 5552 * 2 + 3, data.size() - 1};
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            const unsigned char* begin = data.data() + (sizes[s] < data.size() ? 1 : 0);
+            std::string expected = computeChecksum(types[t], GFAL2_CHECKSUM_ISA_GENERIC, begin, sizes[s], sizes[s] + 1);
+            for (int isa = GFAL2_CHECKSUM_ISA_SSE42; isa <= GFAL2_CHECKSUM_ISA_AVX2; ++isa) {
+                EXPECT_EQ(expected, computeChecksum(types[t], (gfal2_checksum_isa_t)isa, begin, sizes[s], 4093))
+                    << types[t] << " " << gfal2_checksum_isa_name((gfal2_checksum_isa_t)isa) << " " << sizes[s];
+            }
+        }
+    }
+}
+
+
+TEST(ChecksumTest, Combine)
+{
+    const char* types[] = {"ADLER32", "CRC32", "CRC32C"};
+    std::vector<unsigned char> data(100003);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = rand() & 0xFF;
+    }
+
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+        std::string expected = computeChecksum(types[t], GFAL2_CHECKSUM_ISA_AVX2, data.data(), data.size(), data.size());
+
+        const size_t cuts[] = {0, 1, 4096, data.size() - 1, data.size()};
+        for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); ++c) {
+            gfal2_checksum_stream_t* first = gfal2_checksum_stream_new(types[t]);
+            gfal2_checksum_stream_t* second = gfal2_checksum_stream_new(types[t]);
+            gfal2_checksum_stream_update(first, data.data(), cuts[c]);
+            gfal2_checksum_stream_update(second, data.data() + cuts[c], data.size() - cuts[c]);
+            ASSERT_EQ(0, gfal2_checksum_stream_combine(first, second, data.size() - cuts[c]));
+
+            char result[64];
+            gfal2_checksum_stream_final(first, result, sizeof(result));
+            EXPECT_EQ(expected, result) << types[t] << " " << cuts[c];
+            gfal2_checksum_stream_free(first);
+            gfal2_checksum_stream_free(second);
+        }
+    }
+
+    gfal2_checksum_stream_t* md5 = gfal2_checksum_stream_new("MD5");
+    EXPECT_EQ(0, gfal2_checksum_stream_can_combine(md5));
+    EXPECT_EQ(-1, gfal2_checksum_stream_combine(md5, md5, 0));
+    gfal2_checksum_stream_free(md5);
+}
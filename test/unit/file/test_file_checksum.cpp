@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <gfal_api.h>
+#include <checksums/checksums.h>
+#include <utils/exceptions/gerror_to_cpp.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C" {
+#include "plugins/file/gfal_file_plugin.h"
+}
+
+
+// Checksums of a local file, split between as many threads as CHECKSUM_THREADS says,
+// must match the checksum of the same content computed serially
+class FileChecksumTest: public testing::Test {
+protected:
+    gfal2_context_t context;
+    std::string path;
+    std::vector<unsigned char> content;
+
+public:
+    FileChecksumTest() {
+        GError* error = NULL;
+        context = gfal2_context_new(&error);
+        Gfal::gerror_to_cpp(&error);
+
+        char tmpl[] = "/tmp/gfal2_file_checksum_XXXXXX";
+        int fd = mkstemp(tmpl);
+        EXPECT_GE(fd, 0);
+        path = tmpl;
+
+        // Big enough to be split in several chunks, and not a multiple of the chunk size
+        content.resize(9 * (1 << 20) + 12345);
+        for (size_t i = 0; i < content.size(); ++i) {
+            content[i] = static_cast<unsigned char>((i * 31) % 253);
+        }
+        EXPECT_EQ(static_cast<ssize_t>(content.size()), write(fd, content.data(), content.size()));
+        close(fd);
+    }
+
+    ~FileChecksumTest() {
+        unlink(path.c_str());
+        gfal2_context_free(context);
+    }
+
+    std::string serial(const char* type, off_t offset, size_t length) {
+        char result[64];
+        gfal2_checksum_stream_t* stream = gfal2_checksum_stream_new(type);
+        gfal2_checksum_stream_update(stream, content.data() + offset, length);
+        gfal2_checksum_stream_final(stream, result, sizeof(result));
+        gfal2_checksum_stream_free(stream);
+        return result;
+    }
+
+    std::string calc(const char* type, int threads, off_t offset, size_t length) {
+        char result[64] = {0};
+        GError* error = NULL;
+        gfal2_set_opt_integer(context, "CORE", "CHECKSUM_THREADS", threads, NULL);
+        std::string url = "file://" + path;
+        int ret = gfal_plugin_filechecksum_calc(context, url.c_str(), type, result, sizeof(result),
+            offset, length, &error);
+        EXPECT_EQ(0, ret);
+        EXPECT_EQ(NULL, error);
+        g_clear_error(&error);
+        return result;
+    }
+};
+
+
+TEST_F(FileChecksumTest, MappedThreads)
+{
+    // The local reader does not go through the plugin loader, so it covers the serial case too
+    gfal2_set_opt_boolean(context, "CORE", "LOCAL_READ_MMAP", TRUE, NULL);
+    const std::string expected = serial("ADLER32", 0, content.size());
+
+    EXPECT_EQ(expected, calc("ADLER32", 0, 0, 0));
+    EXPECT_EQ(expected, calc("ADLER32", -3, 0, 0));
+    EXPECT_EQ(expected, calc("ADLER32", 1, 0, 0));
+    EXPECT_EQ(expected, calc("ADLER32", 4, 0, 0));
+}
+
+
+TEST_F(FileChecksumTest, ReadThreads)
+{
+    gfal2_set_opt_boolean(context, "CORE", "LOCAL_READ_MMAP", FALSE, NULL);
+    EXPECT_EQ(serial("ADLER32", 0, content.size()), calc("ADLER32", 4, 0, 0));
+    EXPECT_EQ(serial("CRC32C", 0, content.size()), calc("CRC32C", 3, 0, 0));
+}
+
+
+TEST_F(FileChecksumTest, PartialRange)
+{
+    gfal2_set_opt_boolean(context, "CORE", "LOCAL_READ_MMAP", TRUE, NULL);
+    const off_t offset = 4097;
+    const size_t length = 8 * (1 << 20) + 3;
+    const std::string expected = serial("ADLER32", offset, length);
+
+    EXPECT_EQ(expected, calc("ADLER32", 0, offset, length));
+    EXPECT_EQ(expected, calc("ADLER32", 1, offset, length));
+    EXPECT_EQ(expected, calc("ADLER32", 4, offset, length));
+}
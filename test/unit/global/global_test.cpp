@@ -21,6 +21,10 @@
 #include <gfal_api.h>
 #include <gfal_plugins_api.h>
 #include <gtest/gtest.h>
+#include <common/gfal_file_handler_container.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
 
 
 TEST(gfalGlobal, testLogLevel)
@@ -46,6 +50,63 @@ TEST(gfalGlobal, testLoad)
 }
 
 
+TEST(gfalGlobal, fileDescriptorTable)
+{
+    GError *tmp_err = NULL;
+    gfal_file_handle_container c = gfal_file_descriptor_handle_create(NULL);
+
+    int fd = gfal_add_new_file_desc(c, GINT_TO_POINTER(1), &tmp_err);
+    ASSERT_NE(0, fd);
+    ASSERT_EQ(GINT_TO_POINTER(1), gfal_file_handle_bind(c, fd, &tmp_err));
+    ASSERT_TRUE(gfal_remove_file_desc(c, fd, &tmp_err));
+
+    // the previous descriptor must not resolve to the new handle
+    int fd2 = gfal_add_new_file_desc(c, GINT_TO_POINTER(2), &tmp_err);
+    ASSERT_NE(0, fd2);
+    ASSERT_NE(fd, fd2);
+    ASSERT_EQ(NULL, gfal_file_handle_bind(c, fd, &tmp_err));
+    ASSERT_NE((void*)NULL, tmp_err);
+    ASSERT_EQ(EBADF, tmp_err->code);
+    g_clear_error(&tmp_err);
+
+    ASSERT_FALSE(gfal_remove_file_desc(c, fd, &tmp_err));
+    ASSERT_EQ(EBADF, tmp_err->code);
+    g_clear_error(&tmp_err);
+
+    ASSERT_EQ(GINT_TO_POINTER(2), gfal_file_handle_bind(c, fd2, &tmp_err));
+    ASSERT_EQ(NULL, gfal_file_handle_bind(c, 0x7FFFFFFF, &tmp_err));
+    g_clear_error(&tmp_err);
+
+    gfal_file_descriptor_handle_destroy(c);
+}
+
+
+TEST(gfalGlobal, fileDescriptorReuseDelay)
+{
+    GError *tmp_err = NULL;
+    gfal_file_handle_container c = gfal_file_descriptor_handle_create(NULL);
+
+    int fd = gfal_add_new_file_desc(c, GINT_TO_POINTER(1), &tmp_err);
+    ASSERT_TRUE(gfal_remove_file_desc(c, fd, &tmp_err));
+
+    // a released slot waits for GFAL_FD_REUSE_DELAY others before being reused
+    int i, reused_at = -1;
+    for (i = 0; i <= GFAL_FD_REUSE_DELAY && reused_at < 0; ++i) {
+        int other = gfal_add_new_file_desc(c, GINT_TO_POINTER(2), &tmp_err);
+        ASSERT_NE(0, other);
+        if ((other & GFAL_FD_SLOT_MASK) == (fd & GFAL_FD_SLOT_MASK)) {
+            reused_at = i;
+        }
+        ASSERT_TRUE(gfal_remove_file_desc(c, other, &tmp_err));
+    }
+    EXPECT_EQ(GFAL_FD_REUSE_DELAY, reused_at);
+    EXPECT_EQ(NULL, gfal_file_handle_bind(c, fd, &tmp_err));
+    g_clear_error(&tmp_err);
+
+    gfal_file_descriptor_handle_destroy(c);
+}
+
+
 static const char *test_plugin_get_name(void)
 {
     return "TEST PLUGIN";
@@ -100,3 +161,316 @@ TEST(gfalGlobal, registerPlugin)
 
     gfal2_context_free(c);
 }
+
+
+static int test_plugin_check_calls = 0;
+static const char* const test_plugin_schemes[] = {"test", NULL};
+
+
+static gboolean test_plugin_url_counted(plugin_handle plugin_data, const char *url,
+    plugin_mode operation, GError **err)
+{
+    ++test_plugin_check_calls;
+    return test_plugin_url(plugin_data, url, operation, err);
+}
+
+
+static const char *test_plugin_override_get_name(void)
+{
+    return "TEST PLUGIN OVERRIDE";
+}
+
+
+static int test_plugin_override_stat(plugin_handle plugin_data, const char *url, struct stat *buf, GError **err)
+{
+    buf->st_mode = 54321;
+    return 0;
+}
+
+
+TEST(gfalGlobal, pluginDispatchCache)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url_counted;
+    test_plugin.statG = test_plugin_stat;
+    test_plugin.url_schemes = test_plugin_schemes;
+
+    int ret = gfal2_register_plugin(c, &test_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    // Once cached, only the owner plugin validates the url
+    struct stat st;
+    for (int i = 0; i < 3; ++i) {
+        test_plugin_check_calls = 0;
+        ret = gfal2_stat(c, "test://blah", &st, &tmp_err);
+        ASSERT_EQ(0, ret);
+        ASSERT_EQ(12345, st.st_mode);
+        ASSERT_EQ(1, test_plugin_check_calls);
+    }
+
+    // Other operations on the same scheme are not resolved from the cache
+    ret = gfal2_access(c, "test://blah", R_OK, &tmp_err);
+    ASSERT_EQ(-1, ret);
+    ASSERT_NE((void *) NULL, tmp_err);
+    ASSERT_EQ(EPROTONOSUPPORT, tmp_err->code);
+    g_clear_error(&tmp_err);
+
+    // Registering a new plugin must invalidate the cached resolution
+    gfal_plugin_interface override_plugin;
+    memset(&override_plugin, 0, sizeof(override_plugin));
+
+    override_plugin.priority = GFAL_PLUGIN_PRIORITY_CACHE;
+    override_plugin.getName = test_plugin_override_get_name;
+    override_plugin.check_plugin_url = test_plugin_url;
+    override_plugin.statG = test_plugin_override_stat;
+    override_plugin.url_schemes = test_plugin_schemes;
+
+    ret = gfal2_register_plugin(c, &override_plugin, &tmp_err);
+    ASSERT_EQ(0, ret);
+
+    ret = gfal2_stat(c, "test://blah", &st, &tmp_err);
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(54321, st.st_mode);
+
+    gfal2_context_free(c);
+}
+
+
+static gboolean test_plugin_url_open(plugin_handle plugin_data, const char *url,
+    plugin_mode operation, GError **err)
+{
+    return strncmp(url, "test://", 7) == 0 && operation == GFAL_PLUGIN_OPEN;
+}
+
+
+static gfal_file_handle test_plugin_open(plugin_handle plugin_data, const char *url, int flag,
+    mode_t mode, GError **err)
+{
+    return gfal_file_handle_new(test_plugin_get_name(), NULL);
+}
+
+
+static int test_plugin_close(plugin_handle plugin_data, gfal_file_handle fd, GError **err)
+{
+    gfal_file_handle_delete(fd);
+    return 0;
+}
+
+
+// The content of the file is the low byte of the offset, and it is 1000 bytes long
+static ssize_t test_plugin_pread(plugin_handle plugin_data, gfal_file_handle fd, void *buff, size_t count,
+    off_t offset, GError **err)
+{
+    size_t i;
+    for (i = 0; i < count && offset + (off_t)i < 1000; ++i) {
+        ((unsigned char*)buff)[i] = (unsigned char)(offset + i);
+    }
+    return i;
+}
+
+
+static int test_plugin_readv_calls = 0;
+
+static ssize_t test_plugin_readv(plugin_handle plugin_data, gfal_file_handle fd, gfal2_iovec_t *vector,
+    int count, GError **err)
+{
+    ++test_plugin_readv_calls;
+    ssize_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        vector[i].nbytes = test_plugin_pread(plugin_data, fd, vector[i].buffer, vector[i].size,
+            vector[i].offset, err);
+        total += vector[i].nbytes;
+    }
+    return total;
+}
+
+
+static void test_readv(gfal2_context_t c)
+{
+    GError *tmp_err = NULL;
+    unsigned char buffers[3][64];
+    gfal2_iovec_t vector[3] = {
+        {10, 20, buffers[0], -1},
+        {500, 64, buffers[1], -1},
+        {980, 64, buffers[2], -1},
+    };
+
+    int fd = gfal2_open(c, "test://blah", O_RDONLY, &tmp_err);
+    ASSERT_GT(fd, 0);
+
+    ssize_t ret = gfal2_readv(c, fd, vector, 3, &tmp_err);
+    ASSERT_EQ(20 + 64 + 20, ret);
+    ASSERT_EQ(NULL, tmp_err);
+
+    ASSERT_EQ(20, vector[0].nbytes);
+    ASSERT_EQ(64, vector[1].nbytes);
+    ASSERT_EQ(20, vector[2].nbytes);
+    for (int i = 0; i < 3; ++i) {
+        for (ssize_t j = 0; j < vector[i].nbytes; ++j) {
+            ASSERT_EQ((unsigned char)(vector[i].offset + j), buffers[i][j]);
+        }
+    }
+
+    ASSERT_EQ(0, gfal2_close(c, fd, &tmp_err));
+}
+
+
+TEST(gfalGlobal, readv)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url_open;
+    test_plugin.openG = test_plugin_open;
+    test_plugin.closeG = test_plugin_close;
+    test_plugin.preadG = test_plugin_pread;
+
+    ASSERT_EQ(0, gfal2_register_plugin(c, &test_plugin, &tmp_err));
+
+    // Without readvG, each chunk is read with preadG
+    test_readv(c);
+    gfal2_context_free(c);
+
+    // With readvG, the whole vector is given to the plugin
+    c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+    test_plugin.readvG = test_plugin_readv;
+    ASSERT_EQ(0, gfal2_register_plugin(c, &test_plugin, &tmp_err));
+
+    test_plugin_readv_calls = 0;
+    test_readv(c);
+    ASSERT_EQ(1, test_plugin_readv_calls);
+    gfal2_context_free(c);
+}
+
+
+TEST(gfalGlobal, statListFallback)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url;
+    test_plugin.statG = test_plugin_stat;
+
+    ASSERT_EQ(0, gfal2_register_plugin(c, &test_plugin, &tmp_err));
+
+    // Without stat_listG, each url is given to its own plugin
+    const char *urls[] = {"test://first", "unknown://second", "test://third"};
+    struct stat stats[3];
+    GError *errors[3] = {NULL, NULL, NULL};
+
+    ASSERT_EQ(-1, gfal2_stat_list(c, 3, urls, stats, errors));
+
+    ASSERT_EQ(NULL, errors[0]);
+    ASSERT_EQ(12345, stats[0].st_mode);
+    ASSERT_NE((void *) NULL, errors[1]);
+    ASSERT_EQ(EPROTONOSUPPORT, errors[1]->code);
+    ASSERT_EQ(NULL, errors[2]);
+    ASSERT_EQ(12345, stats[2].st_mode);
+
+    g_clear_error(&errors[1]);
+    gfal2_context_free(c);
+}
+
+
+static gboolean test_plugin_url_dir(plugin_handle plugin_data, const char *url,
+    plugin_mode operation, GError **err)
+{
+    return strncmp(url, "test://", 7) == 0 && operation == GFAL_PLUGIN_OPENDIR;
+}
+
+
+static int test_plugin_list_tree(plugin_handle plugin_data, const char *url, gfal2_tree_entry_cb callback,
+    void *user_data, GError **err)
+{
+    const char *paths[] = {"a", "a/b", "a/b/c"};
+    gfal2_tree_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+
+    for (int i = 0; i < 3; ++i) {
+        entry.path = paths[i];
+        entry.st.st_mode = (i < 2) ? S_IFDIR : S_IFREG;
+        if (callback(&entry, user_data) != 0) {
+            g_set_error(err, g_quark_from_static_string("test"), ECANCELED, "Stopped");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+static int test_tree_collect(const gfal2_tree_entry_t *entry, void *user_data)
+{
+    std::vector<std::string> *paths = static_cast<std::vector<std::string>*>(user_data);
+    paths->push_back(entry->path);
+    return 0;
+}
+
+
+static int test_tree_stop(const gfal2_tree_entry_t *entry, void *user_data)
+{
+    ++*static_cast<int*>(user_data);
+    return 1;
+}
+
+
+TEST(gfalGlobal, listTree)
+{
+    GError *tmp_err = NULL;
+    gfal2_context_t c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+
+    gfal_plugin_interface test_plugin;
+    memset(&test_plugin, 0, sizeof(test_plugin));
+
+    test_plugin.getName = test_plugin_get_name;
+    test_plugin.check_plugin_url = test_plugin_url_dir;
+
+    ASSERT_EQ(0, gfal2_register_plugin(c, &test_plugin, &tmp_err));
+
+    // Without list_treeG, the caller is told to walk the tree itself
+    std::vector<std::string> paths;
+    ASSERT_EQ(-1, gfal2_list_tree(c, "test://dir", test_tree_collect, &paths, &tmp_err));
+    ASSERT_NE((void *) NULL, tmp_err);
+    ASSERT_EQ(EPROTONOSUPPORT, tmp_err->code);
+    ASSERT_TRUE(paths.empty());
+    g_clear_error(&tmp_err);
+    gfal2_context_free(c);
+
+    c = gfal2_context_new(&tmp_err);
+    ASSERT_NE((void *) NULL, c);
+    test_plugin.list_treeG = test_plugin_list_tree;
+    ASSERT_EQ(0, gfal2_register_plugin(c, &test_plugin, &tmp_err));
+
+    ASSERT_EQ(0, gfal2_list_tree(c, "test://dir", test_tree_collect, &paths, &tmp_err));
+    ASSERT_EQ(NULL, tmp_err);
+    ASSERT_EQ(3, paths.size());
+    ASSERT_EQ("a/b/c", paths[2]);
+
+    // The callback can stop the listing
+    int calls = 0;
+    ASSERT_EQ(-1, gfal2_list_tree(c, "test://dir", test_tree_stop, &calls, &tmp_err));
+    ASSERT_NE((void *) NULL, tmp_err);
+    ASSERT_EQ(ECANCELED, tmp_err->code);
+    ASSERT_EQ(1, calls);
+    g_clear_error(&tmp_err);
+
+    gfal2_context_free(c);
+}
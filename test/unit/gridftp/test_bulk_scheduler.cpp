@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <set>
+
+#include "plugins/gridftp/gridftp_bulk_scheduler.h"
+
+
+TEST(BulkSchedulerTest, PipelinesPerGroup)
+{
+    GridFTPBulkScheduler scheduler(4, 3);
+    for (size_t i = 0; i < 10; ++i) {
+        scheduler.add("a => b", i);
+    }
+    scheduler.add("a => c", 10);
+
+    ASSERT_EQ(5, scheduler.build());
+    EXPECT_EQ("a => b", scheduler.key(0));
+    EXPECT_EQ("a => b", scheduler.key(3));
+    EXPECT_EQ("a => c", scheduler.key(4));
+}
+
+
+TEST(BulkSchedulerTest, SharedQueue)
+{
+    GridFTPBulkScheduler scheduler(2, 3);
+    for (size_t i = 0; i < 5; ++i) {
+        scheduler.add("a => b", i);
+    }
+    ASSERT_EQ(2, scheduler.build());
+
+    std::set<size_t> given;
+    size_t pair;
+    // Pipeline 0 goes faster than pipeline 1
+    ASSERT_TRUE(scheduler.next(0, &pair));
+    given.insert(pair);
+    ASSERT_TRUE(scheduler.next(1, &pair));
+    given.insert(pair);
+    while (scheduler.next(0, &pair)) {
+        given.insert(pair);
+    }
+    EXPECT_FALSE(scheduler.next(1, &pair));
+    EXPECT_EQ(5, given.size());
+
+    GridFTPBulkScheduler::Outcome outcome = scheduler.finish(0, true);
+    EXPECT_EQ(4, outcome.done.size());
+    EXPECT_FALSE(outcome.failed);
+    outcome = scheduler.finish(1, true);
+    EXPECT_EQ(1, outcome.done.size());
+    EXPECT_TRUE(scheduler.orphans().empty());
+}
+
+
+TEST(BulkSchedulerTest, FailureBlamesCurrentPair)
+{
+    GridFTPBulkScheduler scheduler(1, 3);
+    for (size_t i = 0; i < 5; ++i) {
+        scheduler.add("a => b", i);
+    }
+    ASSERT_EQ(1, scheduler.build());
+
+    size_t pair;
+    scheduler.next(0, &pair);
+    scheduler.begin(0);
+    scheduler.next(0, &pair);
+    scheduler.begin(0);
+    scheduler.next(0, &pair);
+    scheduler.next(0, &pair);
+
+    // Failed while transferring the second pair
+    GridFTPBulkScheduler::Outcome outcome = scheduler.finish(0, false);
+    ASSERT_EQ(1, outcome.done.size());
+    EXPECT_EQ(0, outcome.done[0]);
+    EXPECT_TRUE(outcome.failed);
+    EXPECT_EQ(1, outcome.failed_pair);
+    EXPECT_FALSE(outcome.retired);
+
+    // Pairs not started go back in order
+    ASSERT_TRUE(scheduler.next(0, &pair));
+    EXPECT_EQ(2, pair);
+    ASSERT_TRUE(scheduler.next(0, &pair));
+    EXPECT_EQ(3, pair);
+    ASSERT_TRUE(scheduler.next(0, &pair));
+    EXPECT_EQ(4, pair);
+}
+
+
+TEST(BulkSchedulerTest, RetireAfterRepeatedFailures)
+{
+    GridFTPBulkScheduler scheduler(2, 2);
+    for (size_t i = 0; i < 10; ++i) {
+        scheduler.add("a => b", i);
+    }
+    ASSERT_EQ(2, scheduler.build());
+
+    size_t pair;
+    GridFTPBulkScheduler::Outcome outcome;
+
+    // Pipeline 0 fails straight away, twice
+    scheduler.next(0, &pair);
+    outcome = scheduler.finish(0, false);
+    EXPECT_TRUE(outcome.failed);
+    EXPECT_FALSE(outcome.retired);
+    scheduler.next(0, &pair);
+    outcome = scheduler.finish(0, false);
+    EXPECT_TRUE(outcome.retired);
+    EXPECT_TRUE(scheduler.retired(0));
+    EXPECT_FALSE(scheduler.next(0, &pair));
+
+    // The other pipeline keeps going, and nothing is orphaned
+    EXPECT_TRUE(scheduler.orphans().empty());
+    size_t count = 0;
+    while (scheduler.next(1, &pair)) {
+        scheduler.begin(1);
+        ++count;
+    }
+    EXPECT_EQ(8, count);
+    outcome = scheduler.finish(1, true);
+    EXPECT_EQ(8, outcome.done.size());
+}
+
+
+TEST(BulkSchedulerTest, ProgressResetsFailures)
+{
+    GridFTPBulkScheduler scheduler(1, 2);
+    for (size_t i = 0; i < 10; ++i) {
+        scheduler.add("a => b", i);
+    }
+    ASSERT_EQ(1, scheduler.build());
+
+    size_t pair;
+    scheduler.next(0, &pair);
+    EXPECT_FALSE(scheduler.finish(0, false).retired);
+
+    // Transfers one, fails on the second: counts as a first failure
+    scheduler.next(0, &pair);
+    scheduler.begin(0);
+    scheduler.next(0, &pair);
+    scheduler.begin(0);
+    EXPECT_FALSE(scheduler.finish(0, false).retired);
+
+    scheduler.next(0, &pair);
+    EXPECT_TRUE(scheduler.finish(0, false).retired);
+}
+
+
+TEST(BulkSchedulerTest, OrphansWhenAllRetired)
+{
+    GridFTPBulkScheduler scheduler(2, 1);
+    for (size_t i = 0; i < 5; ++i) {
+        scheduler.add("a => b", i);
+    }
+    scheduler.add("c => d", 5);
+    ASSERT_EQ(3, scheduler.build());
+
+    size_t pair;
+    scheduler.next(0, &pair);
+    scheduler.finish(0, false);
+    scheduler.retire(1);
+
+    std::vector<size_t> orphans = scheduler.orphans();
+    EXPECT_EQ(4, orphans.size());
+    EXPECT_EQ(0, std::count(orphans.begin(), orphans.end(), 5));
+    EXPECT_TRUE(scheduler.orphans().empty());
+
+    // The other group is unaffected
+    ASSERT_TRUE(scheduler.next(2, &pair));
+    EXPECT_EQ(5, pair);
+}
+
+
+TEST(BulkSchedulerTest, NoLimit)
+{
+    GridFTPBulkScheduler scheduler(1, 0);
+    for (size_t i = 0; i < 5; ++i) {
+        scheduler.add("a => b", i);
+    }
+    ASSERT_EQ(1, scheduler.build());
+
+    size_t pair;
+    for (size_t i = 0; i < 5; ++i) {
+        ASSERT_TRUE(scheduler.next(0, &pair));
+        GridFTPBulkScheduler::Outcome outcome = scheduler.finish(0, false);
+        EXPECT_EQ(i, outcome.failed_pair);
+        EXPECT_FALSE(outcome.retired);
+    }
+    EXPECT_FALSE(scheduler.next(0, &pair));
+}
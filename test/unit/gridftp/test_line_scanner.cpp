@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "plugins/gridftp/gridftp_dir_reader/GridFTPLineScanner.h"
+
+
+// Serve the data in chunks of at most chunk_size bytes
+static GridFTPLineScanner::Reader chunked_reader(const std::string& data, size_t chunk_size)
+{
+    std::shared_ptr<size_t> offset = std::make_shared<size_t>(0);
+    return [data, chunk_size, offset](char* buffer, size_t size) -> ssize_t {
+        size_t n = std::min(std::min(size, chunk_size), data.size() - *offset);
+        memcpy(buffer, data.data() + *offset, n);
+        *offset += n;
+        return n;
+    };
+}
+
+
+static std::vector<std::string> scan_all(const std::string& data, size_t chunk_size, size_t buffer_size)
+{
+    GridFTPLineScanner scanner(chunked_reader(data, chunk_size), buffer_size);
+    std::vector<std::string> lines;
+    char* line;
+    size_t length;
+    while ((line = scanner.next_line(&length)) != NULL) {
+        EXPECT_EQ(strlen(line), length);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+
+TEST(GridFTPLineScanner, Lines)
+{
+    std::string data = "type=file;size=10; a.txt\r\ntype=dir; b\r\n  padded  \n\nlast";
+    std::vector<std::string> expected = {
+        "type=file;size=10; a.txt", "type=dir; b", "padded", "", "last"
+    };
+
+    // Chunks and buffers smaller than a line must not make a difference
+    for (size_t chunk = 1; chunk <= data.size(); ++chunk) {
+        for (size_t buffer : {2, 7, 64, 4096}) {
+            EXPECT_EQ(expected, scan_all(data, chunk, buffer)) << chunk << " " << buffer;
+        }
+    }
+}
+
+
+TEST(GridFTPLineScanner, Empty)
+{
+    EXPECT_TRUE(scan_all("", 10, 10).empty());
+    EXPECT_EQ(std::vector<std::string>{""}, scan_all("\n", 10, 10));
+}
+
+
+TEST(GridFTPLineScanner, InPlace)
+{
+    GridFTPLineScanner scanner(chunked_reader("abc def\nghi\n", 100), 100);
+    char* line = scanner.next_line();
+    ASSERT_STREQ("abc def", line);
+    // The line belongs to the caller until the next call
+    line[3] = '\0';
+    EXPECT_STREQ("abc", line);
+    EXPECT_STREQ("ghi", scanner.next_line());
+    EXPECT_EQ(NULL, scanner.next_line());
+    EXPECT_EQ(NULL, scanner.next_line());
+}
+
+
+TEST(GridFTPLineScanner, ReadErrors)
+{
+    GridFTPLineScanner scanner([](char*, size_t) -> ssize_t {
+        throw std::runtime_error("connection lost");
+    });
+    EXPECT_THROW(scanner.fill(), std::runtime_error);
+}
+
+
+TEST(GridFTPLineScanner, ManyLines)
+{
+    std::string data;
+    for (int i = 0; i < 10000; ++i) {
+        data += "type=file;size=" + std::to_string(i) + "; file" + std::to_string(i) + "\r\n";
+    }
+    std::vector<std::string> lines = scan_all(data, 4093, 1024);
+    ASSERT_EQ(10000, lines.size());
+    EXPECT_EQ("type=file;size=9999; file9999", lines.back());
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "plugins/gridftp/gridftp_read_cache.h"
+
+
+class ReadCacheTest: public testing::Test {
+public:
+    std::vector<char> file;
+    std::vector<std::pair<off_t, size_t>> requests;
+    bool fail;
+
+    ReadCacheTest(): fail(false)
+    {
+        file.resize(10000);
+        for (size_t i = 0; i < file.size(); ++i) {
+            file[i] = static_cast<char>(i * 7 + i / 251);
+        }
+    }
+
+    GridFTPReadCache::Fetcher fetcher()
+    {
+        return [this](char* buffer, size_t size, off_t offset) -> ssize_t {
+            if (fail) {
+                throw std::runtime_error("fetch failed");
+            }
+            requests.push_back(std::make_pair(offset, size));
+            if ((size_t)offset >= file.size()) {
+                return 0;
+            }
+            size_t n = std::min(size, file.size() - offset);
+            memcpy(buffer, file.data() + offset, n);
+            return n;
+        };
+    }
+
+    void expect_read(GridFTPReadCache& cache, off_t offset, size_t count)
+    {
+        std::vector<char> buffer(count);
+        ssize_t expected = std::max<ssize_t>(0, std::min<ssize_t>(count, file.size() - offset));
+        ASSERT_EQ(expected, cache.pread(buffer.data(), count, offset));
+        ASSERT_EQ(0, memcmp(buffer.data(), file.data() + offset, expected));
+    }
+};
+
+
+TEST_F(ReadCacheTest, RepeatedSmallReads)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 4, 0);
+    for (int i = 0; i < 10; ++i) {
+        expect_read(cache, 1200, 100);
+        expect_read(cache, 1010, 50);
+    }
+    ASSERT_EQ(1, requests.size());
+    EXPECT_EQ(1000, requests[0].first);
+    EXPECT_EQ(1000, requests[0].second);
+
+    GridFTPReadCache::Stats stats = cache.get_stats();
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(19, stats.hits);
+}
+
+
+TEST_F(ReadCacheTest, CoalesceAdjacentBlocks)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 8, 0);
+    // Spans three blocks, fetched with a single request
+    expect_read(cache, 900, 1200);
+    ASSERT_EQ(1, requests.size());
+    EXPECT_EQ(0, requests[0].first);
+    EXPECT_EQ(3000, requests[0].second);
+
+    // The middle block is cached, so only the edges are fetched
+    cache.invalidate();
+    requests.clear();
+    expect_read(cache, 1500, 10);
+    expect_read(cache, 500, 3000);
+    ASSERT_EQ(3, requests.size());
+    EXPECT_EQ(0, requests[1].first);
+    EXPECT_EQ(1000, requests[1].second);
+    EXPECT_EQ(2000, requests[2].first);
+    EXPECT_EQ(2000, requests[2].second);
+}
+
+
+TEST_F(ReadCacheTest, SequentialReadAhead)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 8, 4);
+    for (off_t offset = 0; offset < 10000; offset += 250) {
+        expect_read(cache, offset, 250);
+    }
+    // The window grows 1, 2, 4, 4...
+    EXPECT_LE(requests.size(), 4);
+    EXPECT_EQ(10000, cache.get_stats().fetched);
+}
+
+
+TEST_F(ReadCacheTest, RandomAccessNoReadAhead)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 8, 4);
+    expect_read(cache, 5000, 10);
+    expect_read(cache, 2000, 10);
+    expect_read(cache, 7000, 10);
+    ASSERT_EQ(3, requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        EXPECT_EQ(1000, requests[i].second);
+    }
+}
+
+
+TEST_F(ReadCacheTest, EndOfFile)
+{
+    GridFTPReadCache cache(fetcher(), 3000, 8, 4);
+    expect_read(cache, 9500, 1000);
+    expect_read(cache, 9000, 1000);
+    expect_read(cache, 10000, 10);
+    expect_read(cache, 20000, 10);
+    // The size is known after the first short fetch
+    EXPECT_EQ(1, requests.size());
+}
+
+
+TEST_F(ReadCacheTest, LargeReadsBypass)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 4, 2);
+    expect_read(cache, 100, 2500);
+    ASSERT_EQ(1, requests.size());
+    EXPECT_EQ(100, requests[0].first);
+    EXPECT_EQ(2500, requests[0].second);
+    EXPECT_EQ(0, cache.get_stats().misses);
+}
+
+
+TEST_F(ReadCacheTest, BoundedCache)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 2, 0);
+    expect_read(cache, 0, 10);
+    expect_read(cache, 5000, 10);
+    expect_read(cache, 9000, 10);
+    expect_read(cache, 0, 10);
+    EXPECT_EQ(4, requests.size());
+}
+
+
+TEST_F(ReadCacheTest, Invalidate)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 4, 0);
+    expect_read(cache, 0, 10);
+    file[5] = 'x';
+    cache.invalidate();
+    expect_read(cache, 0, 10);
+    EXPECT_EQ(2, requests.size());
+}
+
+
+TEST_F(ReadCacheTest, FetchError)
+{
+    GridFTPReadCache cache(fetcher(), 1000, 4, 0);
+    fail = true;
+    char buffer[10];
+    EXPECT_THROW(cache.pread(buffer, sizeof(buffer), 0), std::runtime_error);
+    fail = false;
+    expect_read(cache, 0, 10);
+}
+
+
+TEST_F(ReadCacheTest, RandomAgainstFile)
+{
+    GridFTPReadCache cache(fetcher(), 512, 6, 3);
+    srand(42);
+    for (int i = 0; i < 2000; ++i) {
+        off_t offset = rand() % 11000;
+        size_t count = rand() % 2000 + 1;
+        expect_read(cache, offset, count);
+    }
+}
+
+
+// A fetch blocked on the network must not hold back the reads served from the cache
+TEST_F(ReadCacheTest, HitsDuringFetch)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool blocked = false, release = false;
+    GridFTPReadCache::Fetcher plain = fetcher();
+
+    GridFTPReadCache cache([&](char* buffer, size_t size, off_t offset) -> ssize_t {
+        if (offset == 5000) {
+            std::unique_lock<std::mutex> lock(mutex);
+            blocked = true;
+            cond.notify_all();
+            cond.wait(lock, [&] { return release; });
+        }
+        return plain(buffer, size, offset);
+    }, 1000, 8, 0);
+
+    expect_read(cache, 0, 10);
+
+    std::future<void> slow = std::async(std::launch::async, [&] {
+        expect_read(cache, 5000, 10);
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cond.wait_for(lock, std::chrono::seconds(10), [&] { return blocked; }));
+    }
+
+    std::future<void> hit = std::async(std::launch::async, [&] {
+        expect_read(cache, 100, 10);
+    });
+    EXPECT_EQ(std::future_status::ready, hit.wait_for(std::chrono::seconds(10)));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        cond.notify_all();
+    }
+    slow.get();
+    hit.get();
+    EXPECT_EQ(2, requests.size());
+}
+
+
+// Data fetched before an invalidation is returned, but not kept
+TEST_F(ReadCacheTest, InvalidateDuringFetch)
+{
+    GridFTPReadCache::Fetcher plain = fetcher();
+    GridFTPReadCache* cache_ptr = NULL;
+
+    GridFTPReadCache cache([&](char* buffer, size_t size, off_t offset) -> ssize_t {
+        ssize_t ret = plain(buffer, size, offset);
+        if (requests.size() == 1) {
+            cache_ptr->invalidate();
+        }
+        return ret;
+    }, 1000, 8, 0);
+    cache_ptr = &cache;
+
+    expect_read(cache, 0, 10);
+    expect_read(cache, 0, 10);
+    EXPECT_EQ(2, requests.size());
+    expect_read(cache, 0, 10);
+    EXPECT_EQ(2, requests.size());
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+
+#include "plugins/gridftp/gridftp_session_pool.h"
+
+
+struct FakeSession {
+    std::string endpoint;
+    bool healthy;
+
+    FakeSession(const std::string& endpoint): endpoint(endpoint), healthy(true) {}
+};
+
+
+class SessionPoolTest: public testing::Test {
+public:
+    std::set<FakeSession*> destroyed;
+    time_t now;
+    SessionPool<FakeSession> pool;
+
+    SessionPoolTest(): now(1000),
+        pool([this](FakeSession* s) { destroyed.insert(s); delete s; },
+             [this]() { return now; })
+    {
+        pool.configure(4, 2, 60);
+    }
+
+    FakeSession* acquire(const std::string& endpoint)
+    {
+        return pool.acquire(endpoint, [](FakeSession* s) { return s->healthy; });
+    }
+};
+
+
+TEST_F(SessionPoolTest, ReuseSameEndpoint)
+{
+    FakeSession* a = new FakeSession("gsiftp://a:2811");
+    pool.release(a->endpoint, a);
+
+    EXPECT_EQ(NULL, acquire("gsiftp://b:2811"));
+    EXPECT_EQ(a, acquire("gsiftp://a:2811"));
+    EXPECT_EQ(NULL, acquire("gsiftp://a:2811"));
+
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(2, stats.misses);
+    EXPECT_EQ(0, stats.idle);
+    delete a;
+}
+
+
+TEST_F(SessionPoolTest, MostRecentFirst)
+{
+    FakeSession* a1 = new FakeSession("a");
+    FakeSession* a2 = new FakeSession("a");
+    pool.release("a", a1);
+    pool.release("a", a2);
+
+    EXPECT_EQ(a2, acquire("a"));
+    EXPECT_EQ(a1, acquire("a"));
+    delete a1;
+    delete a2;
+}
+
+
+TEST_F(SessionPoolTest, PerEndpointCap)
+{
+    FakeSession* a1 = new FakeSession("a");
+    FakeSession* a2 = new FakeSession("a");
+    FakeSession* a3 = new FakeSession("a");
+    FakeSession* b1 = new FakeSession("b");
+    pool.release("b", b1);
+    pool.release("a", a1);
+    pool.release("a", a2);
+    pool.release("a", a3);
+
+    // Only the oldest session of the endpoint goes, other endpoints are untouched
+    EXPECT_EQ(1, destroyed.size());
+    EXPECT_EQ(1, destroyed.count(a1));
+
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(1, stats.evictions);
+    EXPECT_EQ(3, stats.idle);
+    EXPECT_EQ(2, stats.endpoints);
+}
+
+
+TEST_F(SessionPoolTest, GlobalLRU)
+{
+    FakeSession* a = new FakeSession("a");
+    FakeSession* b = new FakeSession("b");
+    FakeSession* c = new FakeSession("c");
+    FakeSession* d = new FakeSession("d");
+    FakeSession* e = new FakeSession("e");
+    pool.release("a", a);
+    pool.release("b", b);
+    pool.release("c", c);
+    pool.release("d", d);
+    pool.release("e", e);
+
+    // The total cap evicts a single session, the least recently released one
+    EXPECT_EQ(1, destroyed.size());
+    EXPECT_EQ(1, destroyed.count(a));
+    EXPECT_EQ(4, pool.stats().idle);
+    EXPECT_EQ(NULL, acquire("a"));
+    EXPECT_EQ(b, acquire("b"));
+    delete b;
+}
+
+
+TEST_F(SessionPoolTest, IdleExpiry)
+{
+    FakeSession* a = new FakeSession("a");
+    FakeSession* b = new FakeSession("b");
+    pool.release("a", a);
+    now += 30;
+    pool.release("b", b);
+    now += 40;
+
+    EXPECT_EQ(NULL, acquire("a"));
+    EXPECT_EQ(1, destroyed.count(a));
+    EXPECT_EQ(b, acquire("b"));
+    EXPECT_EQ(1, pool.stats().expirations);
+    delete b;
+}
+
+
+TEST_F(SessionPoolTest, HealthCheck)
+{
+    FakeSession* a1 = new FakeSession("a");
+    FakeSession* a2 = new FakeSession("a");
+    pool.release("a", a1);
+    pool.release("a", a2);
+    a2->healthy = false;
+
+    // The unhealthy one is dropped, and the next candidate is tried
+    EXPECT_EQ(a1, acquire("a"));
+    EXPECT_EQ(1, destroyed.count(a2));
+
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(1, stats.unhealthy);
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(0, stats.misses);
+
+    pool.discard(a1);
+    EXPECT_EQ(2, pool.stats().unhealthy);
+}
+
+
+TEST_F(SessionPoolTest, Reconfigure)
+{
+    pool.release("a", new FakeSession("a"));
+    pool.release("a", new FakeSession("a"));
+    pool.release("b", new FakeSession("b"));
+
+    pool.configure(0, 1, 0);
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(2, stats.idle);
+    EXPECT_EQ(1, stats.evictions);
+
+    // No expiration when disabled
+    now += 3600;
+    pool.expire();
+    EXPECT_EQ(2, pool.stats().idle);
+
+    pool.clear();
+    EXPECT_EQ(0, pool.stats().idle);
+    EXPECT_EQ(3, destroyed.size());
+}
+
+
+TEST_F(SessionPoolTest, Handshakes)
+{
+    pool.record_handshake(0.5);
+    pool.record_handshake(0.25);
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(2, stats.handshakes);
+    EXPECT_DOUBLE_EQ(0.75, stats.handshake_time);
+}
+
+
+TEST(SessionPoolConcurrency, ParallelAcquireRelease)
+{
+    SessionPool<FakeSession> pool([](FakeSession* s) { delete s; });
+    pool.configure(16, 4, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&pool, t]() {
+            std::string endpoint = "endpoint" + std::to_string(t % 3);
+            for (int i = 0; i < 1000; ++i) {
+                FakeSession* s = pool.acquire(endpoint);
+                if (s == NULL) {
+                    s = new FakeSession(endpoint);
+                }
+                ASSERT_EQ(endpoint, s->endpoint);
+                pool.release(endpoint, s);
+            }
+        });
+    }
+    for (auto i = threads.begin(); i != threads.end(); ++i) {
+        i->join();
+    }
+
+    SessionPoolStats stats = pool.stats();
+    EXPECT_EQ(8000, stats.hits + stats.misses);
+    EXPECT_LE(stats.idle, 12);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gfal_api.h>
+#include <gtest/gtest.h>
+#include <utils/exceptions/gerror_to_cpp.h>
+#include <unistd.h>
+
+#define __GFAL2_H_INSIDE__
+#include <common/gfal_plugin.h>
+#undef __GFAL2_H_INSIDE__
+
+#include <davix.hpp>
+#include "plugins/http/gfal_http_plugin.h"
+
+
+class CapabilityCacheTest: public testing::Test {
+public:
+    CapabilityCacheTest() {
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        Gfal::gerror_to_cpp(&error);
+
+        gfal_plugin_interface* p = gfal_find_plugin(context, "https://", GFAL_PLUGIN_STAT, &error);
+        Gfal::gerror_to_cpp(&error);
+        httpData = static_cast<GfalHttpPluginData*>(gfal_get_plugin_handle(p));
+    }
+
+    virtual ~CapabilityCacheTest() {
+        gfal2_context_free(context);
+    }
+
+    void setTTL(int ttl) {
+        gfal2_set_opt_integer(context, "HTTP PLUGIN", HTTP_CONFIG_CAPABILITY_TTL, ttl, NULL);
+    }
+
+protected:
+    using StatMethod = GfalHttpPluginData::StatMethod;
+
+    gfal2_context_t context;
+    GfalHttpPluginData* httpData;
+};
+
+
+TEST_F(CapabilityCacheTest, UnknownEndpoint)
+{
+    setTTL(300);
+    ASSERT_EQ(StatMethod::UNKNOWN, httpData->get_stat_method(Davix::Uri("https://unknown.cern.ch:443/path")));
+}
+
+
+TEST_F(CapabilityCacheTest, SameEndpoint)
+{
+    setTTL(300);
+    httpData->set_stat_method(Davix::Uri("https://webdav.cern.ch:443/path/file"), StatMethod::WEBDAV);
+    httpData->set_stat_method(Davix::Uri("https://s3.cern.ch:443/bucket/file"), StatMethod::HTTP);
+
+    // Any path of the endpoint is resolved from the cache
+    ASSERT_EQ(StatMethod::WEBDAV, httpData->get_stat_method(Davix::Uri("https://webdav.cern.ch:443/other")));
+    ASSERT_EQ(StatMethod::HTTP, httpData->get_stat_method(Davix::Uri("https://s3.cern.ch:443/bucket/other")));
+}
+
+
+TEST_F(CapabilityCacheTest, DifferentEndpoint)
+{
+    setTTL(300);
+    httpData->set_stat_method(Davix::Uri("https://endpoint.cern.ch:443/path"), StatMethod::HTTP);
+
+    // Different port, or different scheme, is a different endpoint
+    ASSERT_EQ(StatMethod::UNKNOWN, httpData->get_stat_method(Davix::Uri("https://endpoint.cern.ch:8443/path")));
+    ASSERT_EQ(StatMethod::UNKNOWN, httpData->get_stat_method(Davix::Uri("http://endpoint.cern.ch:443/path")));
+}
+
+
+TEST_F(CapabilityCacheTest, Disabled)
+{
+    setTTL(0);
+    httpData->set_stat_method(Davix::Uri("https://disabled.cern.ch:443/path"), StatMethod::WEBDAV);
+    ASSERT_EQ(StatMethod::UNKNOWN, httpData->get_stat_method(Davix::Uri("https://disabled.cern.ch:443/path")));
+}
+
+
+TEST_F(CapabilityCacheTest, Expired)
+{
+    setTTL(1);
+    httpData->set_stat_method(Davix::Uri("https://expired.cern.ch:443/path"), StatMethod::WEBDAV);
+    ASSERT_EQ(StatMethod::WEBDAV, httpData->get_stat_method(Davix::Uri("https://expired.cern.ch:443/path")));
+    sleep(2);
+    ASSERT_EQ(StatMethod::UNKNOWN, httpData->get_stat_method(Davix::Uri("https://expired.cern.ch:443/path")));
+}
+
+
+TEST_F(CapabilityCacheTest, WebdavUnsupported)
+{
+    // Only a refused PROPFIND says the endpoint is plain HTTP
+    Davix::DavixError not_implemented("test", Davix::StatusCode::OperationNonSupported, "HTTP 501 : Not Implemented");
+    Davix::DavixError not_allowed("test", Davix::StatusCode::PermissionRefused, "HTTP 405 : Method Not Allowed");
+    Davix::DavixError not_found("test", Davix::StatusCode::FileNotFound, "HTTP 404 : File not found");
+    Davix::DavixError denied("test", Davix::StatusCode::PermissionRefused, "HTTP 403 : Permission refused");
+    Davix::DavixError timeout("test", Davix::StatusCode::OperationTimeout, "Operation timed out");
+
+    EXPECT_TRUE(GfalHttpPluginData::webdav_unsupported(&not_implemented));
+    EXPECT_TRUE(GfalHttpPluginData::webdav_unsupported(&not_allowed));
+    EXPECT_FALSE(GfalHttpPluginData::webdav_unsupported(&not_found));
+    EXPECT_FALSE(GfalHttpPluginData::webdav_unsupported(&denied));
+    EXPECT_FALSE(GfalHttpPluginData::webdav_unsupported(&timeout));
+}
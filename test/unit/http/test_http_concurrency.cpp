@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gfal_api.h>
+#include <gtest/gtest.h>
+#include <utils/exceptions/gerror_to_cpp.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define __GFAL2_H_INSIDE__
+#include <common/gfal_plugin.h>
+#undef __GFAL2_H_INSIDE__
+
+#include <davix.hpp>
+#include "plugins/http/gfal_http_plugin.h"
+
+// Hammer the shared state of the HTTP plugin from several threads.
+// Meant to be run on a build configured with -DENABLE_TSAN=TRUE, where any data race fails the test
+
+static const int THREADS = 8;
+static const int ITERATIONS = 20000;
+
+
+TEST(ShardedMapTest, ConcurrentReadWrite)
+{
+    ShardedMap<std::string, int> map;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&map, t]() {
+            for (int i = 0; i < ITERATIONS; ++i) {
+                std::string key = std::to_string(i % 512);
+                map.set(key, i);
+
+                int value = -1;
+                if (map.find(key, value)) {
+                    ASSERT_GE(value, 0);
+                }
+                if (i % 7 == t) {
+                    map.erase_if(key, [](const int& v) { return v % 2 == 0; });
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(map.size(), 512u);
+    map.clear();
+    EXPECT_EQ(0u, map.size());
+}
+
+
+class HttpConcurrencyTest: public testing::Test {
+public:
+    HttpConcurrencyTest() {
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        Gfal::gerror_to_cpp(&error);
+
+        gfal_plugin_interface* p = gfal_find_plugin(context, "https://", GFAL_PLUGIN_STAT, &error);
+        Gfal::gerror_to_cpp(&error);
+        httpData = static_cast<GfalHttpPluginData*>(gfal_get_plugin_handle(p));
+    }
+
+    virtual ~HttpConcurrencyTest() {
+        gfal2_context_free(context);
+    }
+
+protected:
+    gfal2_context_t context;
+    GfalHttpPluginData* httpData;
+};
+
+
+TEST_F(HttpConcurrencyTest, CapabilityCache)
+{
+    using StatMethod = GfalHttpPluginData::StatMethod;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([this, t]() {
+            for (int i = 0; i < ITERATIONS / 10; ++i) {
+                Davix::Uri uri("davs://host" + std::to_string(i % 64) + ".cern.ch/path");
+                httpData->set_stat_method(uri, (i + t) % 2 ? StatMethod::WEBDAV : StatMethod::HTTP);
+                ASSERT_NE(StatMethod::UNKNOWN, httpData->get_stat_method(uri));
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
+
+
+TEST_F(HttpConcurrencyTest, ResolvedUrl)
+{
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([this]() {
+            for (int i = 0; i < ITERATIONS / 10; ++i) {
+                std::string url = "https://host" + std::to_string(i % 64) + ".cern.ch/file";
+                ASSERT_EQ(url, httpData->resolved_url(url));
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
+
+
+TEST_F(HttpConcurrencyTest, ScopedOperationTimeout)
+{
+    GError* error = NULL;
+    gfal2_set_opt_integer(context, "HTTP PLUGIN", HTTP_CONFIG_OP_TIMEOUT, 42, &error);
+    Gfal::gerror_to_cpp(&error);
+
+    std::atomic<bool> mismatch(false);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([this, t, &mismatch]() {
+            for (int i = 0; i < ITERATIONS / 10; ++i) {
+                int timeout = 100 + t;
+                GfalHttpPluginData::ScopedOperationTimeout scoped(timeout);
+
+                Davix::RequestParams params;
+                httpData->get_params(&params, Davix::Uri("https://example.cern.ch/file"));
+                if (params.getOperationTimeout()->tv_sec != timeout) {
+                    mismatch = true;
+                }
+            }
+            // Out of scope, back to the configuration
+            if (httpData->get_operation_timeout() != 42) {
+                mismatch = true;
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    EXPECT_FALSE(mismatch);
+    EXPECT_EQ(42, gfal2_get_opt_integer_with_default(context, "HTTP PLUGIN", HTTP_CONFIG_OP_TIMEOUT, 0));
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "plugins/http/gfal_http_parallel_reader.h"
+
+
+static char expected_byte(off_t offset)
+{
+    return static_cast<char>((offset * 7) % 251);
+}
+
+
+// Serves a generated content, with a delay per chunk, and fails the chunks it is told to
+class FakeSource: public ParallelSourceReader::Source {
+public:
+    std::mutex mutex;
+    off_t size;
+    size_t chunk_size;
+    std::map<off_t, int> delays_ms;
+    std::set<off_t> failures;
+    // Offset and size of the reads, in completion order
+    std::vector<std::pair<off_t, size_t>> completed;
+    int opens = 0, closes = 0;
+
+    FakeSource(off_t size, size_t chunk_size): size(size), chunk_size(chunk_size) {}
+
+    int open(unsigned stream, GError**) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++opens;
+        return static_cast<int>(stream);
+    }
+
+    ssize_t pread(int, void* buffer, size_t count, off_t offset, GError** err) {
+        int delay = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto d = delays_ms.find(offset / chunk_size);
+            if (d != delays_ms.end()) {
+                delay = d->second;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failures.count(offset / chunk_size)) {
+            g_set_error(err, g_quark_from_static_string("test"), EIO, "Injected failure at %lld",
+                        static_cast<long long>(offset));
+            return -1;
+        }
+        if (offset >= size) {
+            return 0;
+        }
+        count = std::min<off_t>(count, size - offset);
+        for (size_t i = 0; i < count; ++i) {
+            static_cast<char*>(buffer)[i] = expected_byte(offset + i);
+        }
+        completed.push_back(std::make_pair(offset, count));
+        return count;
+    }
+
+    void close(int) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++closes;
+    }
+};
+
+
+// Read everything, checking the content is handed out in order
+static off_t read_all(ParallelSourceReader& reader, size_t buffer_size)
+{
+    std::vector<char> buffer(buffer_size);
+    off_t total = 0;
+    ssize_t ret;
+    GError* error = NULL;
+
+    while ((ret = reader.read(buffer.data(), buffer.size(), &error)) > 0) {
+        for (ssize_t i = 0; i < ret; ++i) {
+            if (buffer[i] != expected_byte(total + i)) {
+                ADD_FAILURE() << "Unexpected content at " << total + i;
+                return -1;
+            }
+        }
+        total += ret;
+    }
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(nullptr, error);
+    g_clear_error(&error);
+    return total;
+}
+
+
+TEST(ParallelReaderTest, OutOfOrder)
+{
+    FakeSource source(10 * 1000, 1000);
+    // The first chunk is the slowest
+    source.delays_ms[0] = 200;
+
+    {
+        ParallelSourceReader reader(source, NULL, source.size, 4, 1000);
+        EXPECT_EQ(source.size, read_all(reader, 4096));
+
+        std::vector<size_t> bytes = reader.stream_bytes();
+        size_t total = 0;
+        for (auto b: bytes) {
+            total += b;
+        }
+        EXPECT_EQ(source.size, total);
+    }
+
+    // The other streams went on while the first chunk was delayed, up to the reorder window
+    ASSERT_EQ(10, source.completed.size());
+    size_t first_at = 0;
+    while (source.completed[first_at].first != 0) {
+        ++first_at;
+    }
+    EXPECT_GE(first_at, 3);
+    EXPECT_EQ(4, source.opens);
+    EXPECT_EQ(4, source.closes);
+}
+
+
+TEST(ParallelReaderTest, ShortLastChunk)
+{
+    FakeSource source(10 * 1000 + 123, 1000);
+    ParallelSourceReader reader(source, NULL, source.size, 3, 1000);
+
+    // A buffer size unrelated to the chunks
+    EXPECT_EQ(source.size, read_all(reader, 777));
+
+    std::lock_guard<std::mutex> lock(source.mutex);
+    ASSERT_EQ(11, source.completed.size());
+    bool last_seen = false;
+    for (auto& c: source.completed) {
+        if (c.first == 10000) {
+            EXPECT_EQ(123, c.second);
+            last_seen = true;
+        }
+        else {
+            EXPECT_EQ(1000, c.second);
+        }
+    }
+    EXPECT_TRUE(last_seen);
+}
+
+
+TEST(ParallelReaderTest, ErrorAbortsStreams)
+{
+    const int nchunks = 200;
+    FakeSource source(nchunks * 1000, 1000);
+    for (int i = 0; i < nchunks; ++i) {
+        source.delays_ms[i] = 5;
+    }
+    source.failures.insert(5);
+
+    {
+        ParallelSourceReader reader(source, NULL, source.size, 4, 1000);
+
+        std::vector<char> buffer(1000);
+        GError* error = NULL;
+        ssize_t ret;
+        while ((ret = reader.read(buffer.data(), buffer.size(), &error)) > 0) {
+        }
+        ASSERT_EQ(-1, ret);
+        ASSERT_NE(nullptr, error);
+        EXPECT_EQ(EIO, error->code);
+        g_clear_error(&error);
+
+        // Errors stick
+        ret = reader.read(buffer.data(), buffer.size(), &error);
+        EXPECT_EQ(-1, ret);
+        g_clear_error(&error);
+    }
+
+    // The other streams stopped claiming chunks, at most a window ahead of the failed one
+    EXPECT_LT(source.completed.size(), 5 + 2 * 4 + 4);
+    EXPECT_EQ(source.opens, source.closes);
+}
+
+
+TEST(ParallelReaderTest, Rewind)
+{
+    FakeSource source(5 * 1000 + 1, 1000);
+    ParallelSourceReader reader(source, NULL, source.size, 2, 1000);
+
+    std::vector<char> buffer(1500);
+    ASSERT_EQ(1000, reader.read(buffer.data(), buffer.size(), NULL));
+
+    reader.rewind();
+    EXPECT_EQ(source.size, read_all(reader, 1500));
+}
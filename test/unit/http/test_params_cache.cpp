@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gfal_api.h>
+#include <gtest/gtest.h>
+#include <utils/exceptions/gerror_to_cpp.h>
+
+#define __GFAL2_H_INSIDE__
+#include <common/gfal_plugin.h>
+#undef __GFAL2_H_INSIDE__
+
+#include <davix.hpp>
+#include "plugins/http/gfal_http_plugin.h"
+
+
+class ParamsCacheTest: public testing::Test {
+public:
+    ParamsCacheTest() {
+        GError *error = NULL;
+        context = gfal2_context_new(&error);
+        Gfal::gerror_to_cpp(&error);
+
+        gfal_plugin_interface* p = gfal_find_plugin(context, "https://", GFAL_PLUGIN_STAT, &error);
+        Gfal::gerror_to_cpp(&error);
+        httpData = static_cast<GfalHttpPluginData*>(gfal_get_plugin_handle(p));
+
+        gfal2_set_opt_boolean(context, "HTTP PLUGIN", "RETRIEVE_BEARER_TOKEN", FALSE, NULL);
+    }
+
+    virtual ~ParamsCacheTest() {
+        gfal2_context_free(context);
+    }
+
+protected:
+    gfal2_context_t context;
+    GfalHttpPluginData* httpData;
+
+    std::string getHeader(const char* url, const char* name) {
+        Davix::RequestParams params;
+        httpData->get_params(&params, Davix::Uri(url));
+
+        const Davix::HeaderVec& headers = params.getHeaders();
+        for (auto it = headers.begin(); it != headers.end(); ++it) {
+            if (strcasecmp(it->first.c_str(), name) == 0) {
+                return it->second;
+            }
+        }
+        return "";
+    }
+
+    void setToken(const char* prefix, const char* token) {
+        gfal2_cred_t* cred = gfal2_cred_new(GFAL_CRED_BEARER, token);
+        gfal2_cred_set(context, prefix, cred, NULL);
+        gfal2_cred_free(cred);
+    }
+};
+
+
+TEST_F(ParamsCacheTest, ConfigChange)
+{
+    const char* url = "https://example.cern.ch/path/file";
+    const char* first[] = {"X-Custom: first", NULL};
+    const char* second[] = {"X-Custom: second", NULL};
+
+    gfal2_set_opt_string_list(context, "HTTP PLUGIN", "HEADERS", first, 1, NULL);
+    ASSERT_EQ("first", getHeader(url, "X-Custom"));
+    ASSERT_EQ("first", getHeader(url, "X-Custom"));
+
+    gfal2_set_opt_string_list(context, "HTTP PLUGIN", "HEADERS", second, 1, NULL);
+    ASSERT_EQ("second", getHeader(url, "X-Custom"));
+}
+
+
+TEST_F(ParamsCacheTest, GenerationBumped)
+{
+    guint generation = gfal2_get_config_generation(context);
+    gfal2_set_opt_integer(context, "HTTP PLUGIN", "OPERATION_TIMEOUT", 10, NULL);
+    ASSERT_NE(generation, gfal2_get_config_generation(context));
+
+    // Credentials have their own counters, so per-file tokens do not outdate everything else
+    generation = gfal2_get_config_generation(context);
+    guint bearer_generation = gfal2_cred_get_generation(context, GFAL_CRED_BEARER);
+    guint cert_generation = gfal2_cred_get_generation(context, GFAL_CRED_X509_CERT);
+    setToken("https://example.cern.ch/", "token");
+    ASSERT_EQ(generation, gfal2_get_config_generation(context));
+    ASSERT_NE(bearer_generation, gfal2_cred_get_generation(context, GFAL_CRED_BEARER));
+    ASSERT_EQ(cert_generation, gfal2_cred_get_generation(context, GFAL_CRED_X509_CERT));
+
+    bearer_generation = gfal2_cred_get_generation(context, GFAL_CRED_BEARER);
+    gfal2_cred_del(context, GFAL_CRED_BEARER, "https://example.cern.ch/", NULL);
+    ASSERT_NE(bearer_generation, gfal2_cred_get_generation(context, GFAL_CRED_BEARER));
+}
+
+
+TEST_F(ParamsCacheTest, X509Prefix)
+{
+    gfal2_cred_t* cert = gfal2_cred_new(GFAL_CRED_X509_CERT, "/tmp/cert_a.pem");
+    gfal2_cred_set(context, "https://example.cern.ch/path/a", cert, NULL);
+    gfal2_cred_free(cert);
+
+    ASSERT_EQ("https://example.cern.ch/path/a|",
+              httpData->x509_prefix_key(Davix::Uri("https://example.cern.ch/path/a/file")));
+    ASSERT_EQ("|", httpData->x509_prefix_key(Davix::Uri("https://example.cern.ch/path/ab/file")));
+
+    // A new credential is picked up, without anything else changing
+    cert = gfal2_cred_new(GFAL_CRED_X509_CERT, "/tmp/cert_b.pem");
+    gfal2_cred_set(context, "https://example.cern.ch/path/a/b/", cert, NULL);
+    gfal2_cred_free(cert);
+
+    ASSERT_EQ("https://example.cern.ch/path/a/b/|",
+              httpData->x509_prefix_key(Davix::Uri("https://example.cern.ch/path/a/b/file")));
+    ASSERT_EQ("https://example.cern.ch/path/a|",
+              httpData->x509_prefix_key(Davix::Uri("https://example.cern.ch/path/a/c/file")));
+}
+
+
+TEST_F(ParamsCacheTest, TokenPerPath)
+{
+    setToken("https://example.cern.ch/path/a/", "token_a");
+    setToken("https://example.cern.ch/path/b/", "token_b");
+
+    ASSERT_EQ("Bearer token_a", getHeader("https://example.cern.ch/path/a/file", "Authorization"));
+    ASSERT_EQ("Bearer token_b", getHeader("https://example.cern.ch/path/b/file", "Authorization"));
+    ASSERT_EQ("Bearer token_a", getHeader("https://example.cern.ch/path/a/file", "Authorization"));
+    ASSERT_EQ("", getHeader("https://example.cern.ch/path/c/file", "Authorization"));
+}
+
+
+TEST_F(ParamsCacheTest, PerThreadTimeout)
+{
+    gfal2_set_opt_integer(context, "HTTP PLUGIN", "OPERATION_TIMEOUT", 10, NULL);
+
+    Davix::RequestParams params;
+    httpData->get_params(&params, Davix::Uri("https://example.cern.ch/file"));
+    ASSERT_EQ(10, params.getOperationTimeout()->tv_sec);
+
+    GfalHttpPluginData::ScopedOperationTimeout timeout(60);
+    httpData->get_params(&params, Davix::Uri("https://example.cern.ch/file"));
+    ASSERT_EQ(60, params.getOperationTimeout()->tv_sec);
+}
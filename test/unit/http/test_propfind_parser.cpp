@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+#include <exceptions/gfalcoreexception.hpp>
+
+#include "plugins/http/gfal_http_propfind.h"
+
+
+static const char* multistatus_begin =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<d:multistatus xmlns:d=\"DAV:\">\n";
+
+static const char* multistatus_end = "</d:multistatus>\n";
+
+
+static std::string make_response(const std::string& href, bool collection, long long size)
+{
+    std::string resp = "<d:response><d:href>" + href + "</d:href><d:propstat><d:prop>";
+    if (collection) {
+        resp += "<d:resourcetype><d:collection/></d:resourcetype>";
+    }
+    else {
+        resp += "<d:resourcetype/><d:getcontentlength>" + std::to_string(size) + "</d:getcontentlength>";
+    }
+    resp += "<d:getlastmodified>Tue, 15 Nov 1994 12:45:26 GMT</d:getlastmodified>"
+            "</d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat>"
+            "<d:propstat><d:prop><d:quota/></d:prop><d:status>HTTP/1.1 404 Not Found</d:status></d:propstat>"
+            "</d:response>\n";
+    return resp;
+}
+
+
+TEST(PropfindParser, SingleChunk)
+{
+    std::string body = multistatus_begin;
+    body += make_response("/dir/", true, 0);
+    body += make_response("/dir/file%20a", false, 1024);
+    body += make_response("https://host:443/dir/sub/", true, 0);
+    body += multistatus_end;
+
+    PropfindStreamParser parser;
+    parser.feed(body.c_str(), body.size());
+
+    PropfindEntry entry;
+    ASSERT_TRUE(parser.next(entry));
+    EXPECT_EQ("/dir/", entry.path);
+    EXPECT_TRUE(S_ISDIR(entry.st.st_mode));
+
+    ASSERT_TRUE(parser.next(entry));
+    EXPECT_EQ("/dir/file a", entry.path);
+    EXPECT_TRUE(S_ISREG(entry.st.st_mode));
+    EXPECT_EQ(1024, entry.st.st_size);
+    EXPECT_EQ(784903526, entry.st.st_mtime);
+
+    ASSERT_TRUE(parser.next(entry));
+    EXPECT_EQ("/dir/sub/", entry.path);
+    EXPECT_TRUE(S_ISDIR(entry.st.st_mode));
+
+    EXPECT_FALSE(parser.next(entry));
+}
+
+
+TEST(PropfindParser, ByteByByte)
+{
+    std::string body = multistatus_begin;
+    for (int i = 0; i < 10; ++i) {
+        body += make_response("/dir/f" + std::to_string(i), false, i);
+    }
+    body += multistatus_end;
+
+    PropfindStreamParser parser;
+    PropfindEntry entry;
+    int count = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        parser.feed(&body[i], 1);
+        while (parser.next(entry)) {
+            EXPECT_EQ("/dir/f" + std::to_string(count), entry.path);
+            EXPECT_EQ(count, entry.st.st_size);
+            ++count;
+        }
+    }
+    EXPECT_EQ(10, count);
+}
+
+
+TEST(PropfindParser, BoundedMemory)
+{
+    PropfindStreamParser parser(4096);
+    PropfindEntry entry;
+
+    std::string begin = multistatus_begin;
+    parser.feed(begin.c_str(), begin.size());
+
+    std::string response = make_response("/dir/file", false, 42);
+    for (int i = 0; i < 100000; ++i) {
+        parser.feed(response.c_str(), response.size());
+        ASSERT_TRUE(parser.next(entry));
+        ASSERT_LT(parser.pending(), 4096);
+    }
+}
+
+
+TEST(PropfindParser, ResponseTooBig)
+{
+    PropfindStreamParser parser(1024);
+    std::string begin = std::string(multistatus_begin) + "<d:response><d:href>/";
+    parser.feed(begin.c_str(), begin.size());
+
+    std::string garbage(512, 'a');
+    EXPECT_THROW({
+        for (int i = 0; i < 10; ++i) {
+            parser.feed(garbage.c_str(), garbage.size());
+        }
+    }, Gfal::CoreException);
+}
+
+
+TEST(PropfindParser, DecodeHref)
+{
+    EXPECT_EQ("/a&b/c d", PropfindStreamParser::decode_href("/a&amp;b/c%20d"));
+    EXPECT_EQ("/path", PropfindStreamParser::decode_href("davs://host.cern.ch:443/path"));
+    EXPECT_EQ("/", PropfindStreamParser::decode_href("https://host.cern.ch"));
+    EXPECT_EQ("/100%", PropfindStreamParser::decode_href("/100%"));
+}
+
+
+TEST(PropfindParser, DecodeCollapsesSlashes)
+{
+    EXPECT_EQ("/a/b/", PropfindStreamParser::decode_path("//a///b/"));
+    EXPECT_EQ("/a b/c/", PropfindStreamParser::decode_path("/a%20b//c/"));
+    EXPECT_EQ("/a/b", PropfindStreamParser::decode_href("https://host.cern.ch//a//b"));
+}
+
+
+TEST(PropfindParser, EntryNameEncodedBase)
+{
+    // What the directory listing does with the url path and the hrefs
+    std::string base = PropfindStreamParser::decode_path("/data//my%20dir/");
+    ASSERT_EQ("/data/my dir/", base);
+
+    std::string begin = multistatus_begin;
+    std::string body = begin +
+        make_response("/data/my%20dir/", true, 0) +
+        make_response("/data//my%20dir/file%201", false, 42) +
+        make_response("/data/my%20dir/sub/", true, 0) +
+        multistatus_end;
+
+    PropfindStreamParser parser;
+    parser.feed(body.c_str(), body.size());
+
+    PropfindEntry entry;
+    std::string name;
+    std::vector<std::string> names;
+    while (parser.next(entry)) {
+        if (PropfindStreamParser::entry_name(base, entry.path, &name)) {
+            names.push_back(name);
+        }
+    }
+    ASSERT_EQ(2, names.size());
+    EXPECT_EQ("file 1", names[0]);
+    EXPECT_EQ("sub", names[1]);
+
+    EXPECT_FALSE(PropfindStreamParser::entry_name(base, "/data/other", &name));
+}
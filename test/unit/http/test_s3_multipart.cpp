@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <exceptions/gfalcoreexception.hpp>
+#include "plugins/http/gfal_http_plugin.h"
+#include "plugins/http/gfal_http_s3_multipart.h"
+
+
+// Records the calls, and fails the parts it is told to
+class FakeBackend: public S3MultipartUpload::Backend {
+public:
+    std::mutex mutex;
+    std::string object;
+    std::map<unsigned, std::string> parts;
+    std::map<unsigned, int> failures;
+    std::vector<std::string> completed_etags;
+    int puts = 0, initiates = 0, aborts = 0, attempts = 0;
+    unsigned running = 0, max_running = 0;
+
+    void put(const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++puts;
+        object.assign(data, size);
+    }
+
+    std::string initiate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++initiates;
+        return "upload-1";
+    }
+
+    std::string upload_part(const std::string& upload_id, unsigned part_number, const char* data, size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            EXPECT_EQ("upload-1", upload_id);
+            ++attempts;
+            max_running = std::max(max_running, ++running);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        --running;
+        auto failure = failures.find(part_number);
+        if (failure != failures.end() && failure->second != 0) {
+            if (failure->second > 0) {
+                --failure->second;
+            }
+            throw Gfal::CoreException(http_plugin_domain, EIO, "Injected failure");
+        }
+        parts[part_number].assign(data, size);
+        return "etag-" + std::to_string(part_number);
+    }
+
+    void complete(const std::string& upload_id, const std::vector<std::string>& etags) {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed_etags = etags;
+        for (auto& part: parts) {
+            object += part.second;
+        }
+    }
+
+    void abort(const std::string& upload_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++aborts;
+    }
+};
+
+
+static std::string make_payload(size_t size)
+{
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<char>('a' + (i * 7) % 26);
+    }
+    return payload;
+}
+
+
+static void write_in_pieces(S3MultipartUpload& upload, const std::string& payload, size_t piece)
+{
+    for (size_t offset = 0; offset < payload.size(); offset += piece) {
+        size_t n = std::min(piece, payload.size() - offset);
+        GError* err = NULL;
+        ASSERT_EQ(static_cast<ssize_t>(n), upload.write(payload.data() + offset, n, &err));
+        ASSERT_EQ(NULL, err);
+    }
+}
+
+
+TEST(S3MultipartTest, PartSizeFor)
+{
+    EXPECT_EQ(S3MultipartUpload::MIN_PART_SIZE, S3MultipartUpload::part_size_for(1024, -1));
+    EXPECT_EQ(64u << 20, S3MultipartUpload::part_size_for(64 << 20, 1 << 30));
+    // 1 TB does not fit in 10000 parts of 64 MB
+    off_t huge = 1LL << 40;
+    size_t part_size = S3MultipartUpload::part_size_for(64 << 20, huge);
+    EXPECT_LE(huge, static_cast<off_t>(part_size) * S3MultipartUpload::MAX_PARTS);
+}
+
+
+TEST(S3MultipartTest, SinglePart)
+{
+    FakeBackend backend;
+    std::string payload = make_payload(1000);
+    GError* err = NULL;
+    {
+        S3MultipartUpload upload(backend, NULL, 1000, 4, 0, 0);
+        write_in_pieces(upload, payload, 300);
+        ASSERT_EQ(0, upload.finish(&err));
+        EXPECT_FALSE(upload.is_multipart());
+        EXPECT_EQ(payload.size(), upload.bytes_uploaded());
+    }
+    EXPECT_EQ(1, backend.puts);
+    EXPECT_EQ(0, backend.initiates);
+    EXPECT_EQ(0, backend.aborts);
+    EXPECT_EQ(payload, backend.object);
+}
+
+
+TEST(S3MultipartTest, PartsInOrder)
+{
+    FakeBackend backend;
+    std::string payload = make_payload(10 * 1000 + 123);
+    GError* err = NULL;
+    {
+        S3MultipartUpload upload(backend, NULL, 1000, 4, 0, 0);
+        write_in_pieces(upload, payload, 333);
+        ASSERT_EQ(0, upload.finish(&err));
+        EXPECT_TRUE(upload.is_multipart());
+        EXPECT_EQ(payload.size(), upload.bytes_uploaded());
+    }
+    EXPECT_EQ(0, backend.puts);
+    EXPECT_EQ(1, backend.initiates);
+    EXPECT_EQ(0, backend.aborts);
+    ASSERT_EQ(11u, backend.completed_etags.size());
+    for (size_t i = 0; i < backend.completed_etags.size(); ++i) {
+        EXPECT_EQ("etag-" + std::to_string(i + 1), backend.completed_etags[i]);
+    }
+    EXPECT_EQ(payload, backend.object);
+    EXPECT_LE(backend.max_running, 4u);
+}
+
+
+TEST(S3MultipartTest, RetryPart)
+{
+    FakeBackend backend;
+    backend.failures[2] = 2;
+    std::string payload = make_payload(3000);
+    GError* err = NULL;
+    {
+        S3MultipartUpload upload(backend, NULL, 1000, 2, 2, 0);
+        write_in_pieces(upload, payload, 1000);
+        ASSERT_EQ(0, upload.finish(&err));
+    }
+    EXPECT_EQ(5, backend.attempts);
+    EXPECT_EQ(0, backend.aborts);
+    EXPECT_EQ(payload, backend.object);
+}
+
+
+TEST(S3MultipartTest, FailedPartAborts)
+{
+    FakeBackend backend;
+    backend.failures[2] = -1;
+    std::string payload = make_payload(20 * 1000);
+    GError* err = NULL;
+    {
+        S3MultipartUpload upload(backend, NULL, 1000, 2, 1, 0);
+        for (size_t offset = 0; offset < payload.size() && err == NULL; offset += 1000) {
+            upload.write(payload.data() + offset, 1000, &err);
+        }
+        if (err == NULL) {
+            EXPECT_EQ(-1, upload.finish(&err));
+        }
+        ASSERT_NE(nullptr, err);
+        EXPECT_EQ(EIO, err->code);
+        g_clear_error(&err);
+    }
+    EXPECT_EQ(1, backend.aborts);
+    EXPECT_TRUE(backend.completed_etags.empty());
+}
+
+
+TEST(S3MultipartTest, AbortOnDestruction)
+{
+    FakeBackend backend;
+    std::string payload = make_payload(5000);
+    {
+        S3MultipartUpload upload(backend, NULL, 1000, 2, 0, 0);
+        write_in_pieces(upload, payload, 1000);
+    }
+    EXPECT_EQ(1, backend.initiates);
+    EXPECT_EQ(1, backend.aborts);
+    EXPECT_TRUE(backend.completed_etags.empty());
+}
+
+
+// Minimal S3-compatible server, enough for the multipart protocol
+class S3StandIn {
+public:
+    std::mutex mutex;
+    std::map<std::string, std::string> objects;
+    std::map<std::string, std::map<unsigned, std::string>> uploads;
+    std::set<std::string> aborted;
+    unsigned failing_part = 0;
+
+    S3StandIn(): stop(false), next_upload(0) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        listen(listener, 16);
+
+        socklen_t len = sizeof(addr);
+        getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        acceptor = std::thread(&S3StandIn::accept_loop, this);
+    }
+
+    ~S3StandIn() {
+        stop = true;
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        acceptor.join();
+        for (auto& connection: connections) {
+            connection.join();
+        }
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+private:
+    int listener;
+    int port;
+    volatile bool stop;
+    unsigned next_upload;
+    std::thread acceptor;
+    std::vector<std::thread> connections;
+
+    void accept_loop() {
+        while (!stop) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) {
+                break;
+            }
+            connections.emplace_back(&S3StandIn::serve, this, fd);
+        }
+    }
+
+    static std::string query_param(const std::string& query, const std::string& key) {
+        std::istringstream params(query);
+        std::string param;
+        while (std::getline(params, param, '&')) {
+            if (param.compare(0, key.size() + 1, key + "=") == 0) {
+                return param.substr(key.size() + 1);
+            }
+        }
+        return std::string();
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[65536];
+
+        while (true) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+
+            std::string head = buffer.substr(0, header_end);
+            buffer.erase(0, header_end + 4);
+
+            std::istringstream lines(head);
+            std::string method, target, line;
+            lines >> method >> target;
+            size_t content_length = 0;
+            while (std::getline(lines, line)) {
+                if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) {
+                    content_length = strtoul(line.c_str() + 15, NULL, 10);
+                }
+                else if (strncasecmp(line.c_str(), "Expect: 100-continue", 20) == 0) {
+                    const char* cont = "HTTP/1.1 100 Continue\r\n\r\n";
+                    send(fd, cont, strlen(cont), MSG_NOSIGNAL);
+                }
+            }
+
+            while (buffer.size() < content_length) {
+                ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+            std::string body = buffer.substr(0, content_length);
+            buffer.erase(0, content_length);
+
+            std::string path = target.substr(0, target.find('?'));
+            std::string query = target.find('?') == std::string::npos ? "" : target.substr(target.find('?') + 1);
+
+            std::string extra, answer;
+            int code = handle(method, path, query, body, extra, answer);
+
+            std::ostringstream response;
+            response << "HTTP/1.1 " << code << " Stand-in\r\n" << extra
+                     << "Content-Length: " << answer.size() << "\r\n\r\n" << answer;
+            std::string raw = response.str();
+            send(fd, raw.data(), raw.size(), MSG_NOSIGNAL);
+        }
+    }
+
+    int handle(const std::string& method, const std::string& path, const std::string& query,
+               const std::string& body, std::string& extra, std::string& answer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string upload_id = query_param(query, "uploadId");
+
+        if (method == "POST" && query == "uploads") {
+            upload_id = "id-" + std::to_string(++next_upload);
+            uploads[upload_id];
+            answer = "<InitiateMultipartUploadResult><UploadId>" + upload_id + "</UploadId></InitiateMultipartUploadResult>";
+            return 200;
+        }
+        if (method == "PUT" && !upload_id.empty()) {
+            unsigned part = strtoul(query_param(query, "partNumber").c_str(), NULL, 10);
+            if (part == failing_part || uploads.find(upload_id) == uploads.end()) {
+                return 500;
+            }
+            uploads[upload_id][part] = body;
+            extra = "ETag: \"part-" + std::to_string(part) + "\"\r\n";
+            return 200;
+        }
+        if (method == "POST" && !upload_id.empty()) {
+            std::string object;
+            unsigned number = 0;
+            for (auto& part: uploads[upload_id]) {
+                if (part.first != ++number || body.find("\"part-" + std::to_string(number) + "\"") == std::string::npos) {
+                    answer = "<Error><Code>InvalidPart</Code></Error>";
+                    return 400;
+                }
+                object += part.second;
+            }
+            objects[path] = object;
+            uploads.erase(upload_id);
+            answer = "<CompleteMultipartUploadResult/>";
+            return 200;
+        }
+        if (method == "DELETE" && !upload_id.empty()) {
+            uploads.erase(upload_id);
+            aborted.insert(upload_id);
+            return 204;
+        }
+        if (method == "PUT") {
+            objects[path] = body;
+            return 200;
+        }
+        return 405;
+    }
+};
+
+
+static Davix::RequestParams stand_in_params()
+{
+    Davix::RequestParams params;
+    params.setProtocol(Davix::RequestProtocol::AwsS3);
+    params.setAwsAuthorizationKeys("secret", "access");
+    params.setAwsAlternate(true);
+    return params;
+}
+
+
+TEST(S3MultipartTest, StandInServer)
+{
+    S3StandIn server;
+    Davix::Context context;
+    S3DavixBackend backend(context, stand_in_params(), server.url("/bucket/object"));
+    std::string payload = make_payload(64 * 1024 + 17);
+    GError* err = NULL;
+
+    S3MultipartUpload upload(backend, NULL, 8 * 1024, 3, 1, 0);
+    write_in_pieces(upload, payload, 5000);
+    ASSERT_EQ(0, upload.finish(&err)) << err->message;
+
+    EXPECT_EQ(payload, server.objects["/bucket/object"]);
+    EXPECT_TRUE(server.uploads.empty());
+    EXPECT_TRUE(server.aborted.empty());
+}
+
+
+TEST(S3MultipartTest, StandInServerSmallObject)
+{
+    S3StandIn server;
+    Davix::Context context;
+    S3DavixBackend backend(context, stand_in_params(), server.url("/bucket/small"));
+    std::string payload = make_payload(100);
+    GError* err = NULL;
+
+    S3MultipartUpload upload(backend, NULL, 8 * 1024, 3, 1, 0);
+    write_in_pieces(upload, payload, 100);
+    ASSERT_EQ(0, upload.finish(&err)) << err->message;
+
+    EXPECT_EQ(payload, server.objects["/bucket/small"]);
+    EXPECT_TRUE(server.aborted.empty());
+}
+
+
+TEST(S3MultipartTest, StandInServerAbort)
+{
+    S3StandIn server;
+    server.failing_part = 3;
+    Davix::Context context;
+    S3DavixBackend backend(context, stand_in_params(), server.url("/bucket/broken"));
+    std::string payload = make_payload(64 * 1024);
+    GError* err = NULL;
+
+    S3MultipartUpload upload(backend, NULL, 8 * 1024, 2, 1, 0);
+    for (size_t offset = 0; offset < payload.size() && err == NULL; offset += 8 * 1024) {
+        upload.write(payload.data() + offset, 8 * 1024, &err);
+    }
+    if (err == NULL) {
+        EXPECT_EQ(-1, upload.finish(&err));
+    }
+    ASSERT_NE(nullptr, err);
+    g_clear_error(&err);
+
+    EXPECT_EQ(0u, server.objects.count("/bucket/broken"));
+    EXPECT_EQ(1u, server.aborted.size());
+    EXPECT_TRUE(server.uploads.empty());
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) CERN 2022
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <json.h>
+
+#include "plugins/http/gfal_http_tape_index.h"
+
+
+static struct json_object* parse_in_pieces(const std::string& body, size_t piece)
+{
+    JsonStreamParser parser;
+    for (size_t offset = 0; offset < body.size(); offset += piece) {
+        if (!parser.feed(body.data() + offset, std::min(piece, body.size() - offset))) {
+            return NULL;
+        }
+    }
+    return parser.finish();
+}
+
+
+static const char* stage_response =
+    "{\"id\": \"req-1\", \"files\": ["
+    "{\"path\": \"/eos/data//file1\", \"onDisk\": true},"
+    "{\"path\": \"/eos/data/file2\", \"onDisk\": \"False\", \"state\": \"STARTED\"},"
+    "{\"path\": \"/eos/data/file3\", \"state\": \"FAILED\"},"
+    "{\"path\": \"/eos/data/file4\", \"error\": \"No such file\"},"
+    "{\"path\": \"/eos/data/file1\", \"onDisk\": false},"
+    "{\"onDisk\": true}"
+    "]}";
+
+
+TEST(TapeIndexTest, StreamedParse)
+{
+    std::string body(stage_response);
+
+    for (size_t piece: {1, 7, 64, 4096}) {
+        struct json_object* response = parse_in_pieces(body, piece);
+        ASSERT_NE(nullptr, response) << "piece=" << piece;
+
+        struct json_object* id = NULL;
+        ASSERT_TRUE(json_object_object_get_ex(response, "id", &id));
+        EXPECT_STREQ("req-1", json_object_get_string(id));
+        json_object_put(response);
+    }
+}
+
+
+TEST(TapeIndexTest, Malformed)
+{
+    EXPECT_EQ(nullptr, parse_in_pieces("{\"id\": \"req-1\", \"files\": [}", 4));
+    // Truncated answer
+    EXPECT_EQ(nullptr, parse_in_pieces("{\"id\": \"req-1\", \"files\": [", 4));
+}
+
+
+TEST(TapeIndexTest, Lookup)
+{
+    struct json_object* response = parse_in_pieces(stage_response, 16);
+    ASSERT_NE(nullptr, response);
+    struct json_object* files = NULL;
+    ASSERT_TRUE(json_object_object_get_ex(response, "files", &files));
+
+    TapeFileIndex index(files);
+    json_object_put(response);
+
+    // Items without path are skipped, duplicates keep the first one
+    EXPECT_EQ(4u, index.size());
+
+    const TapeFileStatus* file1 = index.find("/eos//data/file1");
+    ASSERT_NE(nullptr, file1);
+    EXPECT_TRUE(file1->has_on_disk);
+    EXPECT_TRUE(file1->on_disk);
+    EXPECT_FALSE(file1->has_state);
+
+    const TapeFileStatus* file2 = index.find("/eos/data/file2");
+    ASSERT_NE(nullptr, file2);
+    EXPECT_TRUE(file2->has_on_disk);
+    EXPECT_FALSE(file2->on_disk);
+    EXPECT_EQ("STARTED", file2->state);
+
+    const TapeFileStatus* file3 = index.find("/eos/data/file3");
+    ASSERT_NE(nullptr, file3);
+    EXPECT_FALSE(file3->has_on_disk);
+    EXPECT_EQ("FAILED", file3->state);
+
+    const TapeFileStatus* file4 = index.find("/eos/data/file4");
+    ASSERT_NE(nullptr, file4);
+    EXPECT_TRUE(file4->has_error);
+    EXPECT_EQ("No such file", file4->error);
+
+    EXPECT_EQ(nullptr, index.find("/eos/data/file5"));
+    EXPECT_EQ(nullptr, index.find("/eos/data"));
+}
+
+
+TEST(TapeIndexTest, ArchiveInfo)
+{
+    struct json_object* response = parse_in_pieces(
+        "[{\"path\": \"/tape/a\", \"locality\": \"DISK_AND_TAPE\"}, {\"path\": \"/tape/b\", \"error\": \"lost\"}]", 10);
+    ASSERT_NE(nullptr, response);
+
+    TapeFileIndex index(response);
+    json_object_put(response);
+
+    const TapeFileStatus* a = index.find("/tape/a");
+    ASSERT_NE(nullptr, a);
+    EXPECT_TRUE(a->has_locality);
+    EXPECT_EQ("DISK_AND_TAPE", a->locality);
+
+    const TapeFileStatus* b = index.find("/tape/b");
+    ASSERT_NE(nullptr, b);
+    EXPECT_TRUE(b->has_error);
+    EXPECT_FALSE(b->has_locality);
+}
+
+
+TEST(TapeIndexTest, NotAnArray)
+{
+    struct json_object* response = parse_in_pieces("{\"files\": {}}", 100);
+    ASSERT_NE(nullptr, response);
+    TapeFileIndex index(response);
+    EXPECT_EQ(0u, index.size());
+    json_object_put(response);
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Copyright (c) Members of the EMI Collaboration. 2010-2013
+ *  See  http://www.eu-emi.eu/partners for details on the copyright
+ *  holders.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <exceptions/gfalcoreexception.hpp>
+#include "plugins/http/gfal_http_token_manager.h"
+
+
+static TokenManager::Exchange fixed_exchange(const std::string& token, std::atomic<int>* calls)
+{
+    return [token, calls](unsigned) -> std::string {
+        ++(*calls);
+        return token;
+    };
+}
+
+
+TEST(TokenManagerTest, ParentPath)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    manager.get(Davix::Uri("davs://example.cern.ch/path/dir/"), false, 60, fixed_exchange("dir", &calls));
+
+    ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/path/dir/file"), false, token));
+    EXPECT_EQ("dir", token);
+    ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/path/dir/sub/file"), false, token));
+    EXPECT_EQ("dir", token);
+
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://example.cern.ch/path/other"), false, token));
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://example.cern.ch/path/directory"), false, token));
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://other.cern.ch/path/dir/file"), false, token));
+    EXPECT_EQ(1, calls);
+}
+
+
+TEST(TokenManagerTest, DeepestWins)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    // Once the parent has a token, it is reused for the children, so start with the child
+    manager.get(Davix::Uri("davs://example.cern.ch/path/dir/"), false, 60, fixed_exchange("child", &calls));
+    manager.get(Davix::Uri("davs://example.cern.ch/path/"), false, 60, fixed_exchange("parent", &calls));
+
+    ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/path/dir/file"), false, token));
+    EXPECT_EQ("child", token);
+    ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/path/file"), false, token));
+    EXPECT_EQ("parent", token);
+    EXPECT_EQ(2u, manager.size());
+}
+
+
+TEST(TokenManagerTest, AccessMode)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    manager.get(Davix::Uri("davs://example.cern.ch/read/"), false, 60, fixed_exchange("read", &calls));
+    manager.get(Davix::Uri("davs://example.cern.ch/write/"), true, 60, fixed_exchange("write", &calls));
+
+    // A read token is no good for writing
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://example.cern.ch/read/file"), true, token));
+    // A write token is good for reading
+    ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/write/file"), false, token));
+    EXPECT_EQ("write", token);
+}
+
+
+TEST(TokenManagerTest, Coalesce)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+    std::vector<std::thread> threads;
+
+    auto slow_exchange = [&calls](unsigned) -> std::string {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return "token";
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&manager, &slow_exchange]() {
+            EXPECT_EQ("token", manager.get(Davix::Uri("davs://example.cern.ch/path/file"), false, 60, slow_exchange));
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(1, calls);
+}
+
+
+TEST(TokenManagerTest, ExchangeFailure)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+
+    auto failing_exchange = [](unsigned) -> std::string {
+        throw Gfal::CoreException(0, EACCES, "denied");
+    };
+
+    EXPECT_THROW(manager.get(Davix::Uri("davs://example.cern.ch/file"), false, 60, failing_exchange),
+                 Gfal::CoreException);
+    // A failure does not block the next attempt
+    EXPECT_EQ("token", manager.get(Davix::Uri("davs://example.cern.ch/file"), false, 60,
+                                   fixed_exchange("token", &calls)));
+    EXPECT_EQ(1u, manager.size());
+}
+
+
+TEST(TokenManagerTest, ExpiringSoon)
+{
+    TokenManager manager;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    // With a 1 minute lifetime, the margin is capped at 30 seconds, so the token is still usable
+    manager.set_refresh_margin(3600);
+    manager.get(Davix::Uri("davs://example.cern.ch/file"), false, 1, fixed_exchange("token", &calls));
+    EXPECT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/file"), false, token));
+
+    // Expired tokens are never handed out
+    manager.get(Davix::Uri("davs://example.cern.ch/expired"), false, 0, fixed_exchange("expired", &calls));
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://example.cern.ch/expired"), false, token));
+
+    manager.clear();
+    EXPECT_EQ(0u, manager.size());
+}
+
+
+// Wait for the background refresh to get somewhere
+static bool wait_for(const std::function<bool()>& condition)
+{
+    for (int i = 0; i < 500; ++i) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+
+class FakeClock {
+public:
+    std::atomic<time_t> now;
+
+    FakeClock(): now(1000) {}
+
+    void install(TokenManager& manager) {
+        manager.set_clock([this] { return now.load(); });
+    }
+
+    // Setting the clock again wakes up the refresh thread
+    void advance(TokenManager& manager, time_t seconds) {
+        now += seconds;
+        install(manager);
+    }
+};
+
+
+TEST(TokenManagerTest, BackgroundRefresh)
+{
+    TokenManager manager;
+    FakeClock clock;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    clock.install(manager);
+    manager.set_refresh_margin(300);
+
+    // The first refreshes fail, in all the ways an exchange can fail
+    auto exchange = [&calls](unsigned) -> std::string {
+        int call = ++calls;
+        switch (call) {
+            case 2:
+                throw Gfal::CoreException(0, EACCES, "denied");
+            case 3:
+                throw std::runtime_error("unexpected");
+            case 4:
+                throw 42;
+        }
+        return "token" + std::to_string(call);
+    };
+
+    manager.get(Davix::Uri("davs://example.cern.ch/path/"), false, 60, exchange);
+    ASSERT_EQ(1, calls);
+
+    // Not yet within the margin
+    clock.advance(manager, 3600 - 301);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(1, calls);
+
+    // Each failure is retried a while later, and the old token is still handed out meanwhile
+    clock.advance(manager, 1);
+    for (int expected = 2; expected <= 4; ++expected) {
+        ASSERT_TRUE(wait_for([&] { return calls == expected; }));
+        ASSERT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/path/file"), false, token));
+        EXPECT_EQ("token1", token);
+        clock.advance(manager, 30);
+    }
+
+    ASSERT_TRUE(wait_for([&] {
+        return manager.find(Davix::Uri("davs://example.cern.ch/path/file"), false, token) && token == "token5";
+    }));
+    EXPECT_EQ(5, calls);
+    EXPECT_EQ(1u, manager.size());
+}
+
+
+TEST(TokenManagerTest, IdleDropped)
+{
+    TokenManager manager;
+    FakeClock clock;
+    std::atomic<int> calls(0);
+    std::string token;
+
+    clock.install(manager);
+    manager.set_refresh_margin(300);
+    manager.set_idle_limit(100);
+    manager.get(Davix::Uri("davs://example.cern.ch/used"), false, 60, fixed_exchange("used", &calls));
+    manager.get(Davix::Uri("davs://example.cern.ch/idle"), false, 60, fixed_exchange("idle", &calls));
+    ASSERT_EQ(2u, manager.size());
+
+    // Keep using one of them while the other goes idle
+    clock.advance(manager, 50);
+    EXPECT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/used/file"), false, token));
+    clock.advance(manager, 51);
+
+    ASSERT_TRUE(wait_for([&] { return manager.size() == 1; }));
+    EXPECT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/used/file"), false, token));
+    EXPECT_EQ("used", token);
+    EXPECT_FALSE(manager.find(Davix::Uri("davs://example.cern.ch/idle/file"), false, token));
+
+    // Once in the refresh margin, only the token in use is exchanged again
+    while (clock.now < 1000 + 3600 - 300) {
+        clock.advance(manager, 50);
+        EXPECT_TRUE(manager.find(Davix::Uri("davs://example.cern.ch/used/file"), false, token));
+    }
+    ASSERT_TRUE(wait_for([&] { return calls == 3; }));
+    EXPECT_EQ(1u, manager.size());
+}
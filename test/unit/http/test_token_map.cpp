@@ -62,7 +62,7 @@ protected:
         ASSERT_PRED_FORMAT2(AssertGfalSuccess, 0, error);
 
         if (!user_set) {
-            httpData->token_map[std::string(token)] = httpData->writeFlagFromOperation(operation);
+            httpData->token_map.set(std::string(token), httpData->writeFlagFromOperation(operation));
         }
     }
 
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <localio/gfal2_local_reader.h>
+
+
+class LocalReaderTest: public testing::Test {
+protected:
+    std::string path;
+    std::vector<char> content;
+
+public:
+    LocalReaderTest() {
+        char tmpl[] = "/tmp/gfal2_local_reader_XXXXXX";
+        int fd = mkstemp(tmpl);
+        EXPECT_GE(fd, 0);
+        path = tmpl;
+
+        // Not a multiple of the page size, nor of the O_DIRECT alignment
+        content.resize(10 * 4096 + 123);
+        for (size_t i = 0; i < content.size(); ++i) {
+            content[i] = static_cast<char>((i * 13) % 251);
+        }
+        EXPECT_EQ(static_cast<ssize_t>(content.size()), write(fd, content.data(), content.size()));
+        close(fd);
+    }
+
+    ~LocalReaderTest() {
+        unlink(path.c_str());
+    }
+
+    // Read the whole range, checking each piece is within the window and matches the file
+    size_t read_all(gfal2_local_reader_t* reader, off_t offset, size_t window) {
+        const void* data;
+        ssize_t ret;
+        size_t done = 0;
+
+        while ((ret = gfal2_local_reader_next(reader, &data)) > 0) {
+            EXPECT_LE(static_cast<size_t>(ret), window);
+            EXPECT_EQ(0, memcmp(data, content.data() + offset + done, ret)) << "at " << offset + done;
+            done += ret;
+        }
+        EXPECT_EQ(0, ret);
+        return done;
+    }
+};
+
+
+TEST_F(LocalReaderTest, MmapWindows)
+{
+    const size_t window = 8192;
+    gfal2_local_reader_t* reader = gfal2_local_reader_open(path.c_str(), 0, 0, window, 0);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(GFAL2_LOCAL_READER_MMAP, gfal2_local_reader_get_mode(reader));
+    EXPECT_EQ(content.size(), read_all(reader, 0, window));
+    gfal2_local_reader_close(reader);
+}
+
+
+TEST_F(LocalReaderTest, MmapUnalignedRange)
+{
+    // The first window starts in the middle of a page
+    const off_t offset = 5000;
+    const size_t length = 20000;
+    const size_t window = 8192;
+    gfal2_local_reader_t* reader = gfal2_local_reader_open(path.c_str(), offset, length, window, 0);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(length, read_all(reader, offset, window));
+    gfal2_local_reader_close(reader);
+
+    // A range going past the end stops at the end of the file
+    reader = gfal2_local_reader_open(path.c_str(), offset, content.size(), window, 0);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(content.size() - offset, read_all(reader, offset, window));
+    gfal2_local_reader_close(reader);
+}
+
+
+TEST_F(LocalReaderTest, DirectUnalignedTail)
+{
+    // The last block is short, which must not break the read, whether O_DIRECT is supported or not
+    const size_t window = 16384;
+    gfal2_local_reader_t* reader = gfal2_local_reader_open(path.c_str(), 0, 0, window, 1);
+    ASSERT_NE(nullptr, reader);
+    if (gfal2_local_reader_get_mode(reader) != GFAL2_LOCAL_READER_DIRECT) {
+        std::cerr << "O_DIRECT not supported on /tmp, read with "
+                  << gfal2_local_reader_mode_name(gfal2_local_reader_get_mode(reader)) << std::endl;
+    }
+    EXPECT_EQ(content.size(), read_all(reader, 0, window));
+    gfal2_local_reader_close(reader);
+
+    // Same with a range ending before the end of the file, but not on a block boundary
+    reader = gfal2_local_reader_open(path.c_str(), 4096, 6 * 4096 + 7, window, 1);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ(6 * 4096 + 7, read_all(reader, 4096, window));
+    gfal2_local_reader_close(reader);
+}
+
+
+TEST_F(LocalReaderTest, DirectUnalignedOffset)
+{
+    // O_DIRECT needs an aligned start, so the reader does without
+    gfal2_local_reader_t* reader = gfal2_local_reader_open(path.c_str(), 100, 0, 8192, 1);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_NE(GFAL2_LOCAL_READER_DIRECT, gfal2_local_reader_get_mode(reader));
+    EXPECT_EQ(content.size() - 100, read_all(reader, 100, 8192));
+    gfal2_local_reader_close(reader);
+}
+
+
+// The file shrinks before the end of the range
+static void expect_eof_error(const std::string& path, off_t direct_io_threshold)
+{
+    const void* data;
+    gfal2_local_reader_t* reader = gfal2_local_reader_open(path.c_str(), 0, 0, 8192, direct_io_threshold);
+    ASSERT_NE(nullptr, reader);
+    ASSERT_EQ(8192, gfal2_local_reader_next(reader, &data));
+
+    // Whatever is left in the file may still come, but the range can not be completed
+    ASSERT_EQ(0, truncate(path.c_str(), 12288));
+    ssize_t ret;
+    size_t done = 8192;
+    errno = 0;
+    while ((ret = gfal2_local_reader_next(reader, &data)) > 0) {
+        done += ret;
+    }
+    EXPECT_EQ(-1, ret);
+    EXPECT_EQ(EIO, errno);
+    EXPECT_LE(done, 12288);
+    gfal2_local_reader_close(reader);
+}
+
+
+TEST_F(LocalReaderTest, MmapEarlyEof)
+{
+    expect_eof_error(path, 0);
+}
+
+
+TEST_F(LocalReaderTest, DirectEarlyEof)
+{
+    expect_eof_error(path, 1);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) CERN 2013-2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "plugins/xrootd/gfal_xrootd_plugin_utils.h"
+
+
+TEST(XrootdChecksumModeTest, Plain)
+{
+    EXPECT_EQ("none", checksum_mode_to_xrootd(GFALT_CHECKSUM_NONE));
+    EXPECT_EQ("source", checksum_mode_to_xrootd(GFALT_CHECKSUM_SOURCE));
+    EXPECT_EQ("target", checksum_mode_to_xrootd(GFALT_CHECKSUM_TARGET));
+    EXPECT_EQ("end2end", checksum_mode_to_xrootd(GFALT_CHECKSUM_BOTH));
+}
+
+
+TEST(XrootdChecksumModeTest, InlineIgnored)
+{
+    EXPECT_EQ("end2end", checksum_mode_to_xrootd(GFALT_CHECKSUM_BOTH_INLINE));
+    EXPECT_EQ("source", checksum_mode_to_xrootd(
+        (gfalt_checksum_mode_t)(GFALT_CHECKSUM_SOURCE | GFALT_CHECKSUM_INLINE)));
+    EXPECT_EQ("none", checksum_mode_to_xrootd(GFALT_CHECKSUM_INLINE));
+}